@@ -40,6 +40,7 @@ workspace ('ryujin')
     group ('Engine')
     include ('projects/ryujin')
     include ('projects/ryujin-test')
+    include ('projects/ryujin-bench')
     group ('')
 
     group ('Sandbox')
@@ -0,0 +1,51 @@
+project ('ryujin-bench')
+    kind ('ConsoleApp')
+    language ('C++')
+    cppdialect ('C++20')
+
+    targetdir (binaries)
+    objdir (intermediate)
+
+    files ({
+        'src/**.hpp',
+        'src/**.cpp'
+    })
+
+    includedirs ({
+        'src/',
+        "%{IncludeDir.ryujin}",
+        "%{IncludeDir.json}"
+    })
+
+    links ({
+        'ryujin'
+    })
+
+    dependson ({
+        'ryujin'
+    })
+
+    defines ({
+        'RYUJIN_PROVIDE_STRUCTURED_BINDINGS'
+    })
+
+    filter ({ 'configurations:Debug' })
+        optimize ('Off')
+
+    filter ({ 'configurations:Release' })
+        optimize ('Speed')
+        defines ({ 'NDEBUG' })
+
+    filter ({ 'system:windows' })
+        cppdialect ('C++20')
+        defines ({ '_RYUJIN_WINDOWS' })
+
+    filter ({ 'system:linux' })
+        cppdialect ('C++2a')
+        defines ({ '_RYUJIN_LINUX' })
+        links ({
+            'pthread'
+        })
+
+
+    filter ()
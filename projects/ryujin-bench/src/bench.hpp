@@ -0,0 +1,80 @@
+#ifndef bench_hpp__
+#define bench_hpp__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bench
+{
+	/// <summary>
+	/// Timing state handed to a benchmark.  Setup runs untimed, each start/stop pair adds a measured section and the
+	/// number of operations it performed.
+	/// </summary>
+	class state
+	{
+	public:
+		explicit state(const std::size_t entities) : _entities(entities) {}
+
+		std::size_t entities() const noexcept { return _entities; }
+
+		void start() noexcept { _start = std::chrono::steady_clock::now(); }
+		void stop(const std::size_t operations) noexcept
+		{
+			_elapsed += std::chrono::steady_clock::now() - _start;
+			_operations += operations;
+		}
+
+		double elapsed_ns() const noexcept { return std::chrono::duration<double, std::nano>(_elapsed).count(); }
+		std::size_t operations() const noexcept { return _operations; }
+
+	private:
+		std::size_t _entities;
+		std::size_t _operations = 0;
+		std::chrono::steady_clock::time_point _start;
+		std::chrono::steady_clock::duration _elapsed = {};
+	};
+
+	using benchmark_fn = void(*)(state&);
+
+	struct benchmark
+	{
+		const char* name;
+		benchmark_fn fn;
+	};
+
+	inline std::vector<benchmark>& benchmarks()
+	{
+		static std::vector<benchmark> all;
+		return all;
+	}
+
+	struct registration
+	{
+		registration(const char* name, const benchmark_fn fn)
+		{
+			benchmarks().push_back({ name, fn });
+		}
+	};
+
+	namespace detail
+	{
+		// written through volatile stores only, shared by every benchmark
+		inline volatile std::uintptr_t sink = 0;
+	}
+
+	// keeps the optimizer from discarding results that are otherwise unused
+	template <typename T>
+	inline void keep(const T& value) noexcept
+	{
+		detail::sink = static_cast<std::uintptr_t>(value);
+	}
+}
+
+#define RYUJIN_BENCHMARK(group, name) \
+	static void group##_##name(bench::state&); \
+	static const bench::registration group##_##name##_registration(#group "/" #name, &group##_##name); \
+	static void group##_##name(bench::state& state)
+
+#endif // bench_hpp__
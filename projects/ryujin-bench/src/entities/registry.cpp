@@ -0,0 +1,214 @@
+#include "bench.hpp"
+
+#include <ryujin/entities/registry.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using ryujin::base_registry;
+using ryujin::entity;
+using ryujin::entity_handle;
+
+namespace
+{
+	using entity_type = entity<std::uint32_t>;
+	using registry_type = base_registry<entity_type>;
+	using handle_type = entity_handle<entity_type>;
+
+	struct position
+	{
+		float x, y, z;
+	};
+
+	struct velocity
+	{
+		float x, y, z;
+	};
+
+	template <int N>
+	struct payload
+	{
+		std::uint64_t value;
+	};
+
+	std::vector<handle_type> populate(registry_type& reg, const std::size_t count)
+	{
+		std::vector<handle_type> handles(count);
+		reg.allocate_n(count, handles.data());
+		return handles;
+	}
+
+	template <int ... Ns>
+	void assign_payloads(handle_type& handle, std::integer_sequence<int, Ns...>)
+	{
+		(handle.assign(payload<Ns>{ static_cast<std::uint64_t>(Ns) }), ...);
+	}
+}
+
+RYUJIN_BENCHMARK(registry, allocate)
+{
+	registry_type reg;
+
+	state.start();
+	for (std::size_t i = 0; i < state.entities(); ++i)
+	{
+		bench::keep(reg.allocate().handle().identifier);
+	}
+	state.stop(state.entities());
+}
+
+RYUJIN_BENCHMARK(registry, create_destroy_churn)
+{
+	// frame style churn, a fixed batch spread over the live entities is destroyed and recreated every pass
+	constexpr std::size_t batch = 1024;
+	constexpr std::size_t passes = 16;
+
+	registry_type reg;
+	auto handles = populate(reg, state.entities());
+	const std::size_t stride = handles.size() / batch;
+
+	state.start();
+	for (std::size_t pass = 0; pass < passes; ++pass)
+	{
+		const std::size_t offset = pass % stride;
+		for (std::size_t i = 0; i < batch; ++i)
+		{
+			reg.deallocate(handles[i * stride + offset]);
+		}
+		for (std::size_t i = 0; i < batch; ++i)
+		{
+			handles[i * stride + offset] = reg.allocate();
+		}
+	}
+	state.stop(2 * batch * passes);
+}
+
+RYUJIN_BENCHMARK(registry, assign)
+{
+	registry_type reg;
+	auto handles = populate(reg, state.entities());
+
+	state.start();
+	for (auto& handle : handles)
+	{
+		handle.assign(position{ 1.0f, 2.0f, 3.0f });
+	}
+	state.stop(handles.size());
+}
+
+RYUJIN_BENCHMARK(registry, remove)
+{
+	registry_type reg;
+	auto handles = populate(reg, state.entities());
+	for (auto& handle : handles)
+	{
+		handle.assign(position{ 1.0f, 2.0f, 3.0f });
+	}
+
+	state.start();
+	for (auto& handle : handles)
+	{
+		handle.remove<position>();
+	}
+	state.stop(handles.size());
+}
+
+RYUJIN_BENCHMARK(registry, view_single)
+{
+	registry_type reg;
+	auto handles = populate(reg, state.entities());
+	for (auto& handle : handles)
+	{
+		handle.assign(position{ 1.0f, 2.0f, 3.0f });
+	}
+
+	float sum = 0.0f;
+	state.start();
+	reg.entity_view<position>().each([&sum](const handle_type&, position& p) {
+		p.x += 1.0f;
+		sum += p.x;
+	});
+	state.stop(handles.size());
+	bench::keep(static_cast<std::uint32_t>(sum));
+}
+
+RYUJIN_BENCHMARK(registry, view_multi)
+{
+	// half of the entities carry both components, so the view has to reject the other half
+	registry_type reg;
+	auto handles = populate(reg, state.entities());
+	for (std::size_t i = 0; i < handles.size(); ++i)
+	{
+		handles[i].assign(position{ 1.0f, 2.0f, 3.0f });
+		if (i & 1)
+		{
+			handles[i].assign(velocity{ 0.1f, 0.2f, 0.3f });
+		}
+	}
+
+	float sum = 0.0f;
+	state.start();
+	reg.entity_view<position, velocity>().each([&sum](const handle_type&, position& p, velocity& v) {
+		p.x += v.x;
+		sum += p.x;
+	});
+	state.stop(handles.size());
+	bench::keep(static_cast<std::uint32_t>(sum));
+}
+
+RYUJIN_BENCHMARK(registry, deallocate_many_pools)
+{
+	// sixteen pools besides the defaults, every entity is in all of them
+	registry_type reg;
+	auto handles = populate(reg, state.entities());
+	for (auto& handle : handles)
+	{
+		assign_payloads(handle, std::make_integer_sequence<int, 16>{});
+	}
+
+	// descending identifiers keep the sorted free list insert at the head, leaving the pool removals to measure
+	state.start();
+	for (std::size_t i = handles.size(); i > 0; --i)
+	{
+		reg.deallocate(handles[i - 1]);
+	}
+	state.stop(handles.size());
+}
+
+RYUJIN_BENCHMARK(registry, assign_with_event)
+{
+	registry_type reg;
+	std::uint64_t received = 0;
+	reg.events().subscribe<ryujin::component_add_event<position, entity_type>>(
+		[&received](const ryujin::component_add_event<position, entity_type>&) { ++received; });
+	auto handles = populate(reg, state.entities());
+
+	state.start();
+	for (auto& handle : handles)
+	{
+		handle.assign(position{ 1.0f, 2.0f, 3.0f });
+	}
+	state.stop(handles.size());
+	bench::keep(received);
+}
+
+RYUJIN_BENCHMARK(registry, remove_with_event)
+{
+	registry_type reg;
+	std::uint64_t received = 0;
+	reg.events().subscribe<ryujin::component_remove_event<position, entity_type>>(
+		[&received](const ryujin::component_remove_event<position, entity_type>&) { ++received; });
+	auto handles = populate(reg, state.entities());
+	for (auto& handle : handles)
+	{
+		handle.assign(position{ 1.0f, 2.0f, 3.0f });
+	}
+
+	state.start();
+	for (auto& handle : handles)
+	{
+		handle.remove<position>();
+	}
+	state.stop(handles.size());
+	bench::keep(received);
+}
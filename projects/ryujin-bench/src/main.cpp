@@ -0,0 +1,148 @@
+#include "bench.hpp"
+
+#include <json/json.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	constexpr std::size_t entityCounts[] = { 10'000, 100'000, 1'000'000 };
+
+	struct options
+	{
+		std::string out;
+		std::string filter;
+		std::size_t repetitions = 5;
+		std::size_t maxEntities = 1'000'000;
+	};
+
+	void usage()
+	{
+		std::fprintf(stderr,
+			"usage: ryujin-bench [--out file.json] [--filter substring] [--repetitions n] [--max-entities n]\n"
+			"Runs every registry benchmark at 10k, 100k and 1M entities and writes the results as JSON to stdout or\n"
+			"the given file.\n");
+	}
+
+	bool parse(int argc, char* argv[], options& opts)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+			{
+				opts.out = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+			{
+				opts.filter = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue)
+			{
+				opts.repetitions = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+			}
+			else if (std::strcmp(argv[i], "--max-entities") == 0 && hasValue)
+			{
+				opts.maxEntities = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	options opts;
+	if (!parse(argc, argv, opts))
+	{
+		usage();
+		return 1;
+	}
+
+	nlohmann::json results = nlohmann::json::array();
+	for (const auto& benchmark : bench::benchmarks())
+	{
+		if (!opts.filter.empty() && std::string(benchmark.name).find(opts.filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		for (const std::size_t entities : entityCounts)
+		{
+			if (entities > opts.maxEntities)
+			{
+				continue;
+			}
+
+			// every repetition starts from a fresh registry, the spread shows how noisy the run was
+			std::vector<double> perOperation;
+			std::size_t operations = 0;
+			for (std::size_t rep = 0; rep < opts.repetitions; ++rep)
+			{
+				bench::state state(entities);
+				benchmark.fn(state);
+				operations = state.operations();
+				perOperation.push_back(state.elapsed_ns() / static_cast<double>(std::max<std::size_t>(1, operations)));
+			}
+
+			std::sort(perOperation.begin(), perOperation.end());
+			const double median = perOperation[perOperation.size() / 2];
+			double mean = 0.0;
+			for (const double ns : perOperation)
+			{
+				mean += ns;
+			}
+			mean /= static_cast<double>(perOperation.size());
+
+			std::fprintf(stderr, "%-40s %9zu entities %10.2f ns/op\n", benchmark.name, entities, median);
+
+			results.push_back({
+				{ "name", benchmark.name },
+				{ "entities", entities },
+				{ "repetitions", opts.repetitions },
+				{ "operations", operations },
+				{ "ns_per_op_min", perOperation.front() },
+				{ "ns_per_op_median", median },
+				{ "ns_per_op_mean", mean },
+				{ "ns_per_op_max", perOperation.back() }
+			});
+		}
+	}
+
+	nlohmann::json report = {
+#ifdef NDEBUG
+		{ "configuration", "release" },
+#else
+		{ "configuration", "debug" },
+#endif
+		{ "benchmarks", results }
+	};
+
+	const std::string text = report.dump(2);
+	if (opts.out.empty())
+	{
+		std::cout << text << '\n';
+	}
+	else
+	{
+		std::ofstream file(opts.out);
+		if (!file)
+		{
+			std::fprintf(stderr, "could not open %s\n", opts.out.c_str());
+			return 1;
+		}
+		file << text << '\n';
+	}
+
+	return 0;
+}
@@ -214,4 +214,177 @@ TEST(SparseMapEntityUint32, DifferentKeyEquality)
 
 	ASSERT_FALSE(lhs == rhs);
 	ASSERT_TRUE(lhs != rhs);
-}
\ No newline at end of file
+}
+TEST(SparseMapEntityUint32, RemoveFromMiddleKeepsOthers)
+{
+	sparse_map<entity<std::uint32_t>, int, 1024> map;
+
+	for (std::uint32_t i = 0; i < 4; ++i)
+	{
+		map.insert(entity<std::uint32_t>{ i, 0 }, static_cast<int>(i));
+	}
+
+	ASSERT_TRUE(map.remove(entity<std::uint32_t>{ 1, 0 }));
+
+	ASSERT_EQ(map.size(), 3);
+	ASSERT_FALSE(map.contains(entity<std::uint32_t>{ 1, 0 }));
+	for (std::uint32_t i : { 0u, 2u, 3u })
+	{
+		ASSERT_TRUE(map.contains(entity<std::uint32_t>{ i, 0 }));
+		ASSERT_EQ(map.get(entity<std::uint32_t>{ i, 0 }), static_cast<int>(i));
+	}
+}
+
+TEST(SparseMapEntityUint32, SwapIndices)
+{
+	sparse_map<entity<std::uint32_t>, int, 1024> map;
+
+	const entity<std::uint32_t> first = { 3, 0 };
+	const entity<std::uint32_t> second = { 7, 0 };
+	map.insert(first, 3);
+	map.insert(second, 7);
+
+	ASSERT_EQ(map.index_of(first), 0);
+	ASSERT_EQ(map.index_of(second), 1);
+
+	map.swap_indices(0, 1);
+
+	ASSERT_EQ(map.index_of(first), 1);
+	ASSERT_EQ(map.index_of(second), 0);
+	ASSERT_EQ(map.key_at(0), second);
+	ASSERT_EQ(map.value_at(0), 7);
+	ASSERT_EQ(map.get(first), 3);
+	ASSERT_EQ(map.get(second), 7);
+}
+
+TEST(SparseMapEntityUint32, InsertRangeSkipsExistingKeys)
+{
+	sparse_map<entity<std::uint32_t>, int, 1024> map;
+	map.insert(entity<std::uint32_t>{ 2, 0 }, -1);
+
+	const entity<std::uint32_t> keys[] = { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 }, { 2048, 0 } };
+	const int values[] = { 0, 1, 2, 3, 2048 };
+
+	ASSERT_EQ(map.insert(keys, keys + 5, values), 4);
+	ASSERT_EQ(map.size(), 5);
+	ASSERT_EQ(map.get(entity<std::uint32_t>{ 2, 0 }), -1);
+	for (std::uint32_t i : { 0u, 1u, 3u, 2048u })
+	{
+		ASSERT_TRUE(map.contains(entity<std::uint32_t>{ i, 0 }));
+		ASSERT_EQ(map.get(entity<std::uint32_t>{ i, 0 }), static_cast<int>(i));
+	}
+}
+
+TEST(SparseMapEntityUint32, SortByValue)
+{
+	sparse_map<entity<std::uint32_t>, int, 1024> map;
+	const int values[] = { 5, 1, 4, 2, 3, 0 };
+	for (std::uint32_t i = 0; i < 6; ++i)
+	{
+		map.insert(entity<std::uint32_t>{ i * 700, 0 }, values[i]);
+	}
+
+	map.sort([](const int lhs, const int rhs) { return lhs < rhs; });
+
+	for (std::size_t i = 0; i < map.size(); ++i)
+	{
+		ASSERT_EQ(map.value_at(i), static_cast<int>(i));
+		ASSERT_EQ(map.index_of(map.key_at(i)), i);
+	}
+	for (std::uint32_t i = 0; i < 6; ++i)
+	{
+		ASSERT_EQ(map.get(entity<std::uint32_t>{ i * 700, 0 }), values[i]);
+	}
+}
+
+TEST(SparseMapEntityUint32, SortByKey)
+{
+	sparse_map<entity<std::uint32_t>, int, 1024> map;
+	for (std::uint32_t i : { 3u, 1u, 2048u, 0u, 2u })
+	{
+		map.insert(entity<std::uint32_t>{ i, 0 }, static_cast<int>(i));
+	}
+
+	map.sort([](const entity<std::uint32_t> lhs, const entity<std::uint32_t> rhs) { return lhs.identifier > rhs.identifier; });
+
+	const std::uint32_t expected[] = { 2048u, 3u, 2u, 1u, 0u };
+	for (std::size_t i = 0; i < map.size(); ++i)
+	{
+		ASSERT_EQ(map.key_at(i).identifier, expected[i]);
+		ASSERT_EQ(map.value_at(i), static_cast<int>(expected[i]));
+		ASSERT_TRUE(map.contains(map.key_at(i)));
+	}
+}
+
+TEST(SparseMapEntityUint32, SortAsOtherMap)
+{
+	sparse_map<entity<std::uint32_t>, int, 1024> map;
+	sparse_map<entity<std::uint32_t>, float, 512> order;
+	for (std::uint32_t i = 0; i < 5; ++i)
+	{
+		map.insert(entity<std::uint32_t>{ i, 0 }, static_cast<int>(i));
+	}
+	for (std::uint32_t i : { 4u, 9u, 1u, 3u })
+	{
+		order.insert(entity<std::uint32_t>{ i, 0 }, 0.0f);
+	}
+
+	ASSERT_EQ(map.sort_as(order), 3);
+	ASSERT_EQ(map.key_at(0).identifier, 4u);
+	ASSERT_EQ(map.key_at(1).identifier, 1u);
+	ASSERT_EQ(map.key_at(2).identifier, 3u);
+	for (std::uint32_t i = 0; i < 5; ++i)
+	{
+		ASSERT_EQ(map.get(entity<std::uint32_t>{ i, 0 }), static_cast<int>(i));
+	}
+}
+
+TEST(SparseMapEntityUint32, PagesAllocatedOnDemandAndReleasedWhenEmpty)
+{
+	sparse_map<entity<std::uint32_t>, int, 16> map;
+	map.set_page_policy(ryujin::sparse_page_policy::release_empty);
+
+	const entity<std::uint32_t> low = { 3, 0 };
+	const entity<std::uint32_t> high = { 100, 0 };
+	map.insert(low, 1);
+	map.insert(high, 2);
+
+	// only the two touched pages exist, not every page below the highest identifier
+	ASSERT_EQ(map.sparse_page_count(), 2u);
+	ASSERT_GT(map.memory_usage(), 0u);
+
+	ASSERT_TRUE(map.remove(high));
+	ASSERT_EQ(map.sparse_page_count(), 1u);
+	ASSERT_FALSE(map.contains(high));
+	ASSERT_FALSE(map.replace(high, 3));
+
+	map.insert(high, 4);
+	ASSERT_EQ(map.sparse_page_count(), 2u);
+	ASSERT_EQ(map.get(high), 4);
+	ASSERT_EQ(map.get(low), 1);
+}
+
+TEST(SparseMapEntityUint32, ShrinkToFitReleasesEmptyPages)
+{
+	sparse_map<entity<std::uint32_t>, int, 16> map;
+	for (std::uint32_t i = 0; i < 64; ++i)
+	{
+		map.insert(entity<std::uint32_t>{ i, 0 }, static_cast<int>(i));
+	}
+	ASSERT_EQ(map.sparse_page_count(), 4u);
+
+	for (std::uint32_t i = 16; i < 64; ++i)
+	{
+		map.remove(entity<std::uint32_t>{ i, 0 });
+	}
+
+	// the default policy keeps pages until asked
+	ASSERT_EQ(map.sparse_page_count(), 4u);
+	const auto before = map.memory_usage();
+
+	map.shrink_to_fit();
+	ASSERT_EQ(map.sparse_page_count(), 1u);
+	ASSERT_LT(map.memory_usage(), before);
+	ASSERT_EQ(map.size(), 16u);
+	ASSERT_EQ(map.get(entity<std::uint32_t>{ 7, 0 }), 7);
+}
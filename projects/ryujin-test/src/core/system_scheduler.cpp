@@ -0,0 +1,169 @@
+#include <ryujin/core/system_scheduler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using ryujin::reads;
+using ryujin::registry;
+using ryujin::system_scheduler;
+using ryujin::writes;
+
+namespace
+{
+    struct position
+    {
+        float x;
+    };
+
+    struct velocity
+    {
+        float x;
+    };
+
+    struct health
+    {
+        int value;
+    };
+}
+
+TEST(SystemScheduler, NonConflictingSystemsRunInParallel)
+{
+    registry reg;
+    system_scheduler scheduler(1);
+
+    // each system waits for the other to start, which only completes if both run at the same time
+    std::atomic<int> started = 0;
+    std::atomic<int> overlapped = 0;
+    auto rendezvous = [&started, &overlapped](registry&) {
+        ++started;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (started.load() < 2 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+        if (started.load() == 2)
+        {
+            ++overlapped;
+        }
+    };
+
+    scheduler.add_system("movement", reads<velocity>{}, writes<position>{}, rendezvous);
+    scheduler.add_system("regen", reads<>{}, writes<health>{}, rendezvous);
+    scheduler.execute(reg);
+
+    ASSERT_EQ(overlapped.load(), 2);
+}
+
+TEST(SystemScheduler, ConflictingSystemsRunInRegistrationOrder)
+{
+    registry reg;
+    system_scheduler scheduler(3);
+
+    std::mutex lock;
+    std::vector<int> order;
+    const auto record = [&lock, &order](int id) {
+        return [&lock, &order, id](registry&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            std::scoped_lock guard(lock);
+            order.push_back(id);
+        };
+    };
+
+    scheduler.add_system("integrate", reads<velocity>{}, writes<position>{}, record(0));
+    scheduler.add_system("collide", reads<position>{}, writes<velocity>{}, record(1));
+    scheduler.add_system("render", reads<position, velocity>{}, writes<>{}, record(2));
+    scheduler.add_exclusive_system("spawn", record(3));
+
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        order.clear();
+        scheduler.execute(reg);
+
+        ASSERT_EQ(order.size(), 4);
+        ASSERT_EQ(order[0], 0);
+        ASSERT_EQ(order[1], 1);
+        ASSERT_EQ(order[2], 2);
+        ASSERT_EQ(order[3], 3);
+    }
+}
+
+TEST(SystemScheduler, RecordsTimingsAndSkipsDisabledSystems)
+{
+    registry reg;
+    system_scheduler scheduler(2);
+
+    int disabledRuns = 0;
+    const auto slow = scheduler.add_system("slow", reads<position>{}, writes<>{}, [](registry&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        });
+    const auto disabled = scheduler.add_system("disabled", reads<>{}, writes<position>{}, [&disabledRuns](registry&) {
+            ++disabledRuns;
+        });
+    scheduler.set_enabled(disabled, false);
+
+    scheduler.execute(reg);
+
+    ASSERT_EQ(scheduler.system_count(), 2);
+    ASSERT_EQ(scheduler.name(slow), "slow");
+    ASSERT_FALSE(scheduler.is_enabled(disabled));
+    ASSERT_EQ(disabledRuns, 0);
+    ASSERT_GE(scheduler.last_duration(slow), 0.004);
+    ASSERT_EQ(scheduler.last_duration(disabled), 0.0);
+    ASSERT_GE(scheduler.last_frame_duration(), scheduler.last_duration(slow));
+}
+
+TEST(SystemScheduler, RunsWithoutWorkers)
+{
+    registry reg;
+    system_scheduler scheduler(0);
+
+    int runs = 0;
+    scheduler.add_system("a", reads<position>{}, writes<>{}, [&runs](registry&) { ++runs; });
+    scheduler.add_system("b", reads<position>{}, writes<>{}, [&runs](registry&) { ++runs; });
+    scheduler.execute(reg);
+    scheduler.execute(reg);
+
+    ASSERT_EQ(scheduler.worker_count(), 0);
+    ASSERT_EQ(runs, 4);
+}
+
+TEST(SystemScheduler, ParallelForVisitsEveryIndexOnce)
+{
+    system_scheduler scheduler(3);
+    system_scheduler serial(0);
+
+    for (system_scheduler* s : { &scheduler, &serial })
+    {
+        std::vector<std::atomic<int>> visits(1000);
+        s->parallel_for(visits.size(), [&visits](const std::size_t i) { ++visits[i]; });
+
+        for (const auto& v : visits)
+        {
+            ASSERT_EQ(v.load(), 1);
+        }
+    }
+}
+
+TEST(SystemScheduler, ParallelForFromInsideSystems)
+{
+    registry reg;
+    system_scheduler scheduler(2);
+
+    // both systems split work across the pool while the graph is running, nested batches must not deadlock
+    std::atomic<int> sum = 0;
+    const auto split = [&scheduler, &sum]() {
+        return [&scheduler, &sum](registry&) {
+            scheduler.parallel_for(64, [&sum](const std::size_t i) { sum += static_cast<int>(i); });
+        };
+    };
+    scheduler.add_system("a", reads<position>{}, writes<>{}, split());
+    scheduler.add_system("b", reads<position>{}, writes<>{}, split());
+    scheduler.execute(reg);
+
+    ASSERT_EQ(sum.load(), 2 * (63 * 64 / 2));
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/command_buffer.hpp>
+
+#include <thread>
+
+using ryujin::entity;
+using ryujin::base_registry;
+using ryujin::base_registry_command_buffer;
+using ryujin::base_registry_command_queue;
+
+namespace
+{
+	using entity_type = entity<std::uint32_t>;
+	using test_registry = base_registry<entity_type>;
+	using test_buffer = base_registry_command_buffer<entity_type>;
+
+	struct counter
+	{
+		int value;
+	};
+
+	template <int N>
+	struct first_touched
+	{
+		int value;
+	};
+
+	template <int N>
+	void record_first_touch(base_registry_command_queue<entity_type>& queue)
+	{
+		auto& buffer = queue.local();
+		auto e = buffer.create();
+		buffer.assign(e, first_touched<N>{ N });
+	}
+}
+
+TEST(CommandBuffer, RecordingDoesNotTouchRegistry)
+{
+	test_registry reg;
+	test_buffer buffer;
+
+	auto e = buffer.create();
+	buffer.assign(e, counter{ 1 });
+
+	ASSERT_EQ(buffer.size(), 2);
+	ASSERT_EQ(reg.active(), 0);
+}
+
+TEST(CommandBuffer, SubmitCreatesAndAssigns)
+{
+	test_registry reg;
+	test_buffer buffer;
+
+	auto e = buffer.create();
+	buffer.assign(e, counter{ 7 });
+	buffer.submit(reg);
+
+	ASSERT_TRUE(buffer.empty());
+	ASSERT_EQ(reg.active(), 1);
+
+	auto handle = buffer.resolve(e, reg);
+	ASSERT_TRUE(handle.contains<counter>());
+	ASSERT_EQ(handle.get<counter>().value, 7);
+}
+
+TEST(CommandBuffer, TargetsExistingEntities)
+{
+	test_registry reg;
+	auto existing = reg.allocate();
+	existing.assign(counter{ 1 });
+
+	test_buffer buffer;
+	auto e = buffer.wrap(existing);
+	buffer.remove<counter>(e);
+	buffer.submit(reg);
+
+	ASSERT_FALSE(existing.contains<counter>());
+}
+
+TEST(CommandBuffer, CreateThenDestroyIsNeverMaterialized)
+{
+	test_registry reg;
+	int added = 0;
+	reg.events().subscribe<ryujin::component_add_event<counter, entity_type>>([&](const auto&) { ++added; });
+
+	test_buffer buffer;
+	auto e = buffer.create();
+	buffer.assign(e, counter{ 1 });
+	buffer.destroy(e);
+	buffer.submit(reg);
+
+	ASSERT_EQ(reg.active(), 0);
+	ASSERT_EQ(added, 0);
+	ASSERT_EQ(buffer.resolve(e, reg).handle(), reg.invalid().handle());
+}
+
+TEST(CommandBuffer, RepeatedWritesCoalesce)
+{
+	test_registry reg;
+	int added = 0;
+	int replaced = 0;
+	reg.events().subscribe<ryujin::component_add_event<counter, entity_type>>([&](const auto&) { ++added; });
+	reg.events().subscribe<ryujin::component_replace_event<counter, entity_type>>([&](const auto&) { ++replaced; });
+
+	auto existing = reg.allocate();
+
+	test_buffer buffer;
+	auto e = buffer.wrap(existing);
+	for (int i = 0; i < 10; ++i)
+	{
+		buffer.assign_or_replace(e, counter{ i });
+	}
+	buffer.submit(reg);
+
+	ASSERT_EQ(added, 1);
+	ASSERT_EQ(replaced, 0);
+	ASSERT_EQ(existing.get<counter>().value, 9);
+}
+
+TEST(CommandBuffer, WriteAfterRemoveIsKept)
+{
+	test_registry reg;
+	auto existing = reg.allocate();
+
+	test_buffer buffer;
+	auto e = buffer.wrap(existing);
+	buffer.assign_or_replace(e, counter{ 1 });
+	buffer.remove<counter>(e);
+	buffer.assign_or_replace(e, counter{ 2 });
+	buffer.submit(reg);
+
+	ASSERT_EQ(existing.get<counter>().value, 2);
+}
+
+TEST(CommandQueue, FlushesEveryThreadBuffer)
+{
+	test_registry reg;
+	base_registry_command_queue<entity_type> queue;
+
+	constexpr int threadCount = 4;
+	constexpr int perThread = 256;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&queue, t]() {
+			auto& buffer = queue.local();
+			for (int i = 0; i < perThread; ++i)
+			{
+				auto e = buffer.create();
+				buffer.assign(e, counter{ t });
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	queue.flush(reg);
+
+	ASSERT_EQ(reg.active(), threadCount * perThread);
+
+	int sum = 0;
+	reg.entity_view<counter>().each([&](auto, counter& c) { sum += c.value; });
+	ASSERT_EQ(sum, perThread * (0 + 1 + 2 + 3));
+}
+
+TEST(CommandQueue, ConcurrentFirstTouchGetsDistinctComponentIds)
+{
+	test_registry reg;
+	base_registry_command_queue<entity_type> queue;
+
+	// every thread records a component type nothing has touched yet, racing on the identifier counter
+	std::vector<std::thread> threads;
+	threads.emplace_back([&queue]() { record_first_touch<0>(queue); });
+	threads.emplace_back([&queue]() { record_first_touch<1>(queue); });
+	threads.emplace_back([&queue]() { record_first_touch<2>(queue); });
+	threads.emplace_back([&queue]() { record_first_touch<3>(queue); });
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	queue.flush(reg);
+
+	ASSERT_EQ(reg.size<first_touched<0>>(), 1);
+	ASSERT_EQ(reg.size<first_touched<1>>(), 1);
+	ASSERT_EQ(reg.size<first_touched<2>>(), 1);
+	ASSERT_EQ(reg.size<first_touched<3>>(), 1);
+}
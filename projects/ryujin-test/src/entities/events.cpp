@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/events.hpp>
+
+using ryujin::event_delegate;
+using ryujin::event_manager;
+
+namespace
+{
+	struct damage_event
+	{
+		int amount;
+	};
+
+	struct heal_event
+	{
+		int amount;
+	};
+
+	int freeTotal = 0;
+
+	void accumulate_free(const damage_event& e)
+	{
+		freeTotal += e.amount;
+	}
+
+	struct health_listener
+	{
+		int health = 100;
+
+		void on_damage(const damage_event& e)
+		{
+			health -= e.amount;
+		}
+
+		void on_heal(const heal_event& e)
+		{
+			health += e.amount;
+		}
+	};
+}
+
+TEST(Events, EmitInvokesEveryDelegateKind)
+{
+	event_manager events;
+	health_listener listener;
+	int lambdaTotal = 0;
+	int refTotal = 0;
+	auto byRef = [&refTotal](const damage_event& e) { refTotal += e.amount; };
+
+	freeTotal = 0;
+	events.subscribe(event_delegate<damage_event>::bind<&accumulate_free>());
+	events.subscribe<damage_event, &health_listener::on_damage>(&listener);
+	events.subscribe<damage_event>([&lambdaTotal](const damage_event& e) { lambdaTotal += e.amount; });
+	events.subscribe(event_delegate<damage_event>::bind_ref(byRef));
+
+	events.emit<damage_event>(10);
+	events.emit<heal_event>(5);
+
+	ASSERT_EQ(freeTotal, 10);
+	ASSERT_EQ(listener.health, 90);
+	ASSERT_EQ(lambdaTotal, 10);
+	ASSERT_EQ(refTotal, 10);
+}
+
+TEST(Events, UnsubscribeRemovesInstanceDelegates)
+{
+	event_manager events;
+	health_listener first;
+	health_listener second;
+
+	events.subscribe<damage_event, &health_listener::on_damage>(&first);
+	events.subscribe<heal_event, &health_listener::on_heal>(&first);
+	events.subscribe<damage_event, &health_listener::on_damage>(&second);
+
+	events.unsubscribe(&first);
+	events.emit<damage_event>(20);
+	events.emit<heal_event>(20);
+
+	ASSERT_EQ(first.health, 100);
+	ASSERT_EQ(second.health, 80);
+}
+
+TEST(Events, QueuedEventsDispatchInBatches)
+{
+	event_manager events;
+	health_listener listener;
+	events.subscribe<damage_event, &health_listener::on_damage>(&listener);
+	events.subscribe<heal_event, &health_listener::on_heal>(&listener);
+
+	events.enqueue<damage_event>(10);
+	events.enqueue<heal_event>(3);
+	events.enqueue<damage_event>(20);
+
+	ASSERT_TRUE(events.has_queued());
+	ASSERT_EQ(listener.health, 100);
+
+	events.dispatch();
+
+	ASSERT_FALSE(events.has_queued());
+	ASSERT_EQ(listener.health, 73);
+
+	events.dispatch();
+	ASSERT_EQ(listener.health, 73);
+}
+
+TEST(Events, EventsQueuedDuringDispatchWaitForNextDispatch)
+{
+	event_manager events;
+	int delivered = 0;
+	events.subscribe<damage_event>([&events, &delivered](const damage_event& e) {
+			++delivered;
+			if (e.amount > 0)
+			{
+				events.enqueue<damage_event>(e.amount - 1);
+			}
+		});
+
+	events.enqueue<damage_event>(2);
+	events.dispatch();
+	ASSERT_EQ(delivered, 1);
+	ASSERT_TRUE(events.has_queued());
+
+	events.dispatch();
+	events.dispatch();
+	ASSERT_EQ(delivered, 3);
+	ASSERT_FALSE(events.has_queued());
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/hierarchy.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using ryujin::entity_handle;
+using ryujin::hierarchy;
+using ryujin::registry;
+
+namespace
+{
+	using entity_type = registry::entity_type;
+	using relationship_type = hierarchy::relationship_type;
+
+	struct name_component
+	{
+		int id;
+	};
+
+	// root(0) -> a(1) -> { c(3), d(4) }, root -> b(2)
+	std::vector<entity_type> build(registry& reg, hierarchy& h)
+	{
+		std::vector<entity_type> ents;
+		for (int i = 0; i < 5; ++i)
+		{
+			auto e = reg.allocate();
+			e.assign(name_component{ i });
+			ents.push_back(e.handle());
+		}
+
+		h.add(ents[0]);
+		h.add(ents[1], ents[0]);
+		h.add(ents[2], ents[0]);
+		h.add(ents[3], ents[1]);
+		h.add(ents[4], ents[1]);
+		return ents;
+	}
+
+	std::vector<int> names(registry& reg, const ryujin::span<hierarchy::node> nodes)
+	{
+		std::vector<int> result;
+		for (ryujin::sz i = 0; i < nodes.length(); ++i)
+		{
+			result.push_back(entity_handle<entity_type>(nodes[i].entity, &reg).get<name_component>().id);
+		}
+		return result;
+	}
+}
+
+TEST(Hierarchy, NodesAreDepthFirstWithContiguousSubtrees)
+{
+	registry reg;
+	hierarchy h(reg);
+	const auto ents = build(reg, h);
+
+	ASSERT_EQ(names(reg, h.nodes()), (std::vector<int>{ 0, 1, 3, 4, 2 }));
+	ASSERT_EQ(names(reg, h.subtree(ents[1])), (std::vector<int>{ 1, 3, 4 }));
+	ASSERT_EQ(h.subtree(ents[0]).length(), 5u);
+	ASSERT_EQ(h.parent(ents[4]), ents[1]);
+
+	// relationship links mirror the packed order
+	const auto& rootRel = entity_handle<entity_type>(ents[0], &reg).get<relationship_type>();
+	ASSERT_EQ(rootRel.firstChild, ents[1]);
+	const auto& aRel = entity_handle<entity_type>(ents[1], &reg).get<relationship_type>();
+	ASSERT_EQ(aRel.parent, ents[0]);
+	ASSERT_EQ(aRel.firstChild, ents[3]);
+	ASSERT_EQ(aRel.nextSibling, ents[2]);
+	ASSERT_EQ(entity_handle<entity_type>(ents[3], &reg).get<relationship_type>().nextSibling, ents[4]);
+	ASSERT_EQ(entity_handle<entity_type>(ents[4], &reg).get<relationship_type>().nextSibling, relationship_type::tombstone);
+}
+
+TEST(Hierarchy, DestroySubtreeDeallocatesDescendants)
+{
+	registry reg;
+	hierarchy h(reg);
+	const auto ents = build(reg, h);
+
+	h.destroy_subtree(ents[1]);
+
+	ASSERT_EQ(h.size(), 2u);
+	ASSERT_EQ(reg.active(), 2u);
+	ASSERT_FALSE(h.contains(ents[3]));
+	ASSERT_EQ(names(reg, h.nodes()), (std::vector<int>{ 0, 2 }));
+	ASSERT_EQ(entity_handle<entity_type>(ents[0], &reg).get<relationship_type>().firstChild, ents[2]);
+}
+
+TEST(Hierarchy, DestroySubtreeEmitsRemoveEvents)
+{
+	registry reg;
+	hierarchy h(reg);
+	const auto ents = build(reg, h);
+
+	// listeners such as the renderable manager release their state through remove events
+	std::vector<entity_type> removed;
+	reg.events().subscribe<ryujin::component_remove_event<name_component, entity_type>>([&removed](const auto& e) {
+		removed.push_back(e.entity.handle());
+	});
+
+	h.destroy_subtree(ents[1]);
+
+	std::sort(removed.begin(), removed.end(), [](const entity_type lhs, const entity_type rhs) { return lhs.identifier < rhs.identifier; });
+	ASSERT_EQ(removed, (std::vector<entity_type>{ ents[1], ents[3], ents[4] }));
+}
+
+TEST(Hierarchy, EntitiesDeallocatedElsewhereLeaveTheHierarchy)
+{
+	registry reg;
+	hierarchy h(reg);
+	const auto ents = build(reg, h);
+
+	// the children of a dead entity move up to its parent, in place
+	entity_handle<entity_type> a(ents[1], &reg);
+	reg.deallocate(a);
+
+	ASSERT_FALSE(h.contains(ents[1]));
+	ASSERT_EQ(names(reg, h.nodes()), (std::vector<int>{ 0, 3, 4, 2 }));
+	ASSERT_EQ(h.parent(ents[3]), ents[0]);
+	ASSERT_EQ(h.subtree(ents[0]).length(), 4u);
+	ASSERT_EQ(entity_handle<entity_type>(ents[0], &reg).get<relationship_type>().firstChild, ents[3]);
+	ASSERT_EQ(entity_handle<entity_type>(ents[4], &reg).get<relationship_type>().parent, ents[0]);
+	ASSERT_EQ(entity_handle<entity_type>(ents[4], &reg).get<relationship_type>().nextSibling, ents[2]);
+
+	// destroying an ancestor later leaves the recycled identifier's new owner alone
+	auto recycled = reg.allocate();
+	recycled.assign(name_component{ 5 });
+	ASSERT_EQ(recycled.handle().identifier, ents[1].identifier);
+
+	h.destroy_subtree(ents[0]);
+	ASSERT_EQ(h.size(), 0u);
+	ASSERT_EQ(reg.active(), 1u);
+	ASSERT_EQ(recycled.get<name_component>().id, 5);
+
+	// a dead root's children become roots
+	auto root = reg.allocate();
+	auto child = reg.allocate();
+	h.add(root.handle());
+	h.add(child.handle(), root.handle());
+	reg.deallocate(root);
+	ASSERT_EQ(h.parent(child.handle()), relationship_type::tombstone);
+	ASSERT_EQ(child.get<relationship_type>().parent, relationship_type::tombstone);
+}
+
+TEST(Hierarchy, ReparentMovesWholeSubtree)
+{
+	registry reg;
+	hierarchy h(reg);
+	const auto ents = build(reg, h);
+
+	h.reparent(ents[1], ents[2]);
+	ASSERT_EQ(names(reg, h.nodes()), (std::vector<int>{ 0, 2, 1, 3, 4 }));
+	ASSERT_EQ(h.parent(ents[1]), ents[2]);
+	ASSERT_EQ(h.subtree(ents[2]).length(), 4u);
+	ASSERT_EQ(entity_handle<entity_type>(ents[0], &reg).get<relationship_type>().firstChild, ents[2]);
+	ASSERT_EQ(entity_handle<entity_type>(ents[2], &reg).get<relationship_type>().firstChild, ents[1]);
+
+	h.reparent(ents[3], relationship_type::tombstone);
+	ASSERT_EQ(names(reg, h.nodes()), (std::vector<int>{ 0, 2, 1, 4, 3 }));
+	ASSERT_EQ(h.parent(ents[3]), relationship_type::tombstone);
+	ASSERT_EQ(entity_handle<entity_type>(ents[1], &reg).get<relationship_type>().firstChild, ents[4]);
+}
+
+TEST(Hierarchy, CloneSubtreeCopiesComponentsAndLinks)
+{
+	registry reg;
+	hierarchy h(reg);
+	const auto ents = build(reg, h);
+
+	const auto copy = h.clone_subtree(ents[1], ents[2]);
+
+	ASSERT_EQ(reg.active(), 8u);
+	ASSERT_EQ(names(reg, h.nodes()), (std::vector<int>{ 0, 1, 3, 4, 2, 1, 3, 4 }));
+	ASSERT_EQ(h.parent(copy), ents[2]);
+
+	const auto cloned = h.subtree(copy);
+	ASSERT_EQ(cloned.length(), 3u);
+	for (ryujin::sz i = 0; i < cloned.length(); ++i)
+	{
+		ASSERT_FALSE(cloned[i].entity == ents[1] || cloned[i].entity == ents[3] || cloned[i].entity == ents[4]);
+	}
+
+	const auto& copyRel = entity_handle<entity_type>(copy, &reg).get<relationship_type>();
+	ASSERT_EQ(copyRel.parent, ents[2]);
+	ASSERT_EQ(copyRel.firstChild, cloned[1].entity);
+	ASSERT_EQ(entity_handle<entity_type>(cloned[1].entity, &reg).get<relationship_type>().parent, copy);
+}
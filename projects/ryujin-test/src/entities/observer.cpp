@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/observer.hpp>
+
+#include <algorithm>
+#include <utility>
+
+using ryujin::entity_handle;
+using ryujin::observer;
+using ryujin::observer_matcher;
+using ryujin::registry;
+
+namespace
+{
+	using entity_type = registry::entity_type;
+
+	struct health_component
+	{
+		int value;
+	};
+
+	struct speed_component
+	{
+		float value;
+	};
+
+	template <int N>
+	struct padding_component
+	{
+		int value;
+	};
+
+	struct late_component
+	{
+		int value;
+	};
+
+	// hands out component identifiers until the mask capacity is used up
+	template <int ... Ns>
+	void exhaust_component_masks(std::integer_sequence<int, Ns...>)
+	{
+		(ryujin::detail::component_identifier_utility::fetch_identifier<padding_component<Ns>>(), ...);
+	}
+
+	std::vector<entity_type> drained(observer& obs)
+	{
+		std::vector<entity_type> result;
+		obs.drain([&result](const entity_handle<entity_type>& handle) {
+			result.push_back(handle.handle());
+		});
+		std::sort(result.begin(), result.end(), [](const entity_type lhs, const entity_type rhs) {
+			return lhs.identifier < rhs.identifier;
+		});
+		return result;
+	}
+}
+
+TEST(Observer, CollectsMatchingChangesOnce)
+{
+	registry reg;
+	observer obs(reg, observer_matcher().added<health_component>().updated<speed_component>());
+
+	auto a = reg.allocate();
+	auto b = reg.allocate();
+	auto c = reg.allocate();
+
+	a.assign(health_component{ 10 });
+	b.assign(health_component{ 20 });
+	b.patch<health_component>([](health_component& h) { h.value = 5; });
+
+	// speed is only observed for updates, the assignment is ignored
+	c.assign(speed_component{ 1.0f });
+	ASSERT_EQ(obs.size(), 2);
+	ASSERT_FALSE(obs.contains(c.handle()));
+
+	c.replace(speed_component{ 2.0f });
+	c.patch<speed_component>([](speed_component& s) { s.value = 3.0f; });
+	c.get_mut<speed_component>().value = 4.0f;
+	ASSERT_EQ(obs.size(), 3);
+
+	const auto first = drained(obs);
+	ASSERT_EQ(first.size(), 3);
+	ASSERT_EQ(first[0], a.handle());
+	ASSERT_EQ(first[1], b.handle());
+	ASSERT_EQ(first[2], c.handle());
+	ASSERT_TRUE(obs.empty());
+
+	a.remove<health_component>();
+	ASSERT_TRUE(obs.empty());
+}
+
+TEST(Observer, DeallocatedEntitiesOnlyReportedForRemovals)
+{
+	registry reg;
+	observer added(reg, observer_matcher().added<health_component>());
+	observer removed(reg, observer_matcher().removed<health_component>());
+
+	auto a = reg.allocate();
+	auto b = reg.allocate();
+	a.assign(health_component{ 1 });
+	b.assign(health_component{ 2 });
+	ASSERT_EQ(added.size(), 2);
+	ASSERT_TRUE(removed.empty());
+
+	const auto deadA = a.handle();
+	reg.deallocate(a);
+	b.remove<health_component>();
+
+	ASSERT_EQ(added.size(), 1);
+	ASSERT_TRUE(added.contains(b.handle()));
+	ASSERT_FALSE(added.contains(deadA));
+
+	const auto gone = drained(removed);
+	ASSERT_EQ(gone.size(), 2);
+	ASSERT_EQ(gone[0], deadA);
+	ASSERT_EQ(gone[1], b.handle());
+}
+
+TEST(Observer, ChangesDuringDrainStartTheNextBatch)
+{
+	registry reg;
+	observer obs(reg, observer_matcher().added<health_component>().updated<health_component>());
+
+	for (int i = 0; i < 64; ++i)
+	{
+		reg.allocate().assign(health_component{ i });
+	}
+	ASSERT_EQ(obs.size(), 64);
+
+	int visited = 0;
+	obs.drain([&visited](const entity_handle<entity_type>& handle) {
+		handle.get_mut<health_component>().value += 1;
+		++visited;
+	});
+	ASSERT_EQ(visited, 64);
+	ASSERT_EQ(obs.size(), 64);
+
+	obs.clear();
+	ASSERT_TRUE(obs.empty());
+
+	{
+		observer scoped(reg, observer_matcher().added<speed_component>());
+		reg.allocate().assign(speed_component{ 1.0f });
+		ASSERT_EQ(scoped.size(), 1);
+	}
+
+	// the scoped observer detached itself, later changes are still delivered to the remaining one
+	reg.allocate().assign(speed_component{ 2.0f });
+	reg.allocate().assign(health_component{ 1 });
+	ASSERT_EQ(obs.size(), 1);
+}
+
+TEST(Observer, ObservesComponentsPastTheMaskCapacity)
+{
+	using ryujin::detail::component_mask;
+
+	exhaust_component_masks(std::make_integer_sequence<int, component_mask::capacity>());
+	ASSERT_GE(ryujin::detail::component_identifier_utility::fetch_identifier<late_component>(), component_mask::capacity);
+
+	registry reg;
+	observer added(reg, observer_matcher().added<late_component>());
+	observer changed(reg, observer_matcher().updated<late_component>().removed<late_component>());
+
+	auto a = reg.allocate();
+	auto b = reg.allocate();
+	auto c = reg.allocate();
+	a.assign(late_component{ 1 });
+	b.assign(late_component{ 2 });
+	c.assign(late_component{ 3 });
+	ASSERT_EQ(added.size(), 3);
+	ASSERT_TRUE(changed.empty());
+
+	a.get_mut<late_component>().value = 4;
+	b.remove<late_component>();
+	const auto deadC = c.handle();
+	reg.deallocate(c);
+
+	const auto gone = drained(changed);
+	ASSERT_EQ(gone.size(), 3);
+	ASSERT_EQ(gone[0], a.handle());
+	ASSERT_EQ(gone[1], b.handle());
+	ASSERT_EQ(gone[2], deadC);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/prefab.hpp>
+
+using ryujin::base_prefab;
+using ryujin::base_registry;
+using ryujin::entity;
+using ryujin::entity_handle;
+using ryujin::entity_relationship_component;
+using ryujin::transform_component;
+
+namespace
+{
+	using entity_type = entity<std::uint32_t>;
+	using relationship_type = entity_relationship_component<entity_type>;
+
+	struct mesh_component
+	{
+		int mesh;
+	};
+
+	struct static_tag
+	{
+	};
+}
+
+TEST(Prefab, InstantiateCopiesComponentsAndRemapsHierarchy)
+{
+	base_registry<entity_type> reg;
+	base_prefab<entity_type> pf;
+
+	transform_component rootTx;
+	rootTx.position = ryujin::vec3(1.0f, 2.0f, 3.0f);
+	const auto root = pf.add_node(base_prefab<entity_type>::no_parent, rootTx);
+	const auto first = pf.add_node(root);
+	const auto second = pf.add_node(root);
+	const auto grandchild = pf.add_node(first);
+	pf.set(first, mesh_component{ 1 });
+	pf.set(second, mesh_component{ 2 });
+	pf.set(grandchild, mesh_component{ 3 });
+	pf.set(grandchild, mesh_component{ 4 });
+	pf.set(root, static_tag{});
+	ASSERT_EQ(pf.node_count(), 4);
+
+	// an unrelated entity first, so instance entities do not start at identifier zero
+	reg.allocate();
+
+	constexpr std::size_t copies = 3;
+	std::vector<entity_handle<entity_type>> entities(copies * pf.node_count());
+	pf.instantiate(reg, copies, entities.data());
+
+	ASSERT_EQ(reg.active(), 1 + copies * 4);
+	ASSERT_EQ(reg.size<mesh_component>(), copies * 3);
+	ASSERT_EQ(reg.size<static_tag>(), copies);
+
+	for (std::size_t copy = 0; copy < copies; ++copy)
+	{
+		const auto* nodes = entities.data() + copy * 4;
+		ASSERT_EQ(nodes[0].get<transform_component>().position.y, 2.0f);
+		ASSERT_TRUE(nodes[0].contains<static_tag>());
+		ASSERT_FALSE(nodes[0].contains<mesh_component>());
+		ASSERT_EQ(nodes[1].get<mesh_component>().mesh, 1);
+		ASSERT_EQ(nodes[2].get<mesh_component>().mesh, 2);
+		ASSERT_EQ(nodes[3].get<mesh_component>().mesh, 4);
+
+		const auto& rootRel = nodes[0].get<relationship_type>();
+		ASSERT_EQ(rootRel.parent, relationship_type::tombstone);
+		ASSERT_EQ(rootRel.firstChild, nodes[1].handle());
+
+		const auto& firstRel = nodes[1].get<relationship_type>();
+		ASSERT_EQ(firstRel.parent, nodes[0].handle());
+		ASSERT_EQ(firstRel.nextSibling, nodes[2].handle());
+		ASSERT_EQ(firstRel.firstChild, nodes[3].handle());
+
+		const auto& secondRel = nodes[2].get<relationship_type>();
+		ASSERT_EQ(secondRel.nextSibling, relationship_type::tombstone);
+		ASSERT_EQ(nodes[3].get<relationship_type>().parent, nodes[1].handle());
+	}
+}
@@ -2,10 +2,53 @@
 
 #include <ryujin/entities/registry.hpp>
 
+#include <cstring>
+#include <utility>
+#include <vector>
+
 using ryujin::entity;
 using ryujin::entity_handle;
 using ryujin::base_registry;
 
+namespace
+{
+	struct tag_component
+	{
+	};
+
+	struct pinned_component
+	{
+		int value;
+	};
+
+	template <int N>
+	struct padding_component
+	{
+		int value;
+	};
+
+	struct late_component
+	{
+		int value;
+	};
+
+	struct late_tag
+	{
+	};
+
+	// hands out component identifiers until the mask capacity is used up
+	template <int ... Ns>
+	void exhaust_component_masks(std::integer_sequence<int, Ns...>)
+	{
+		(ryujin::detail::component_identifier_utility::fetch_identifier<padding_component<Ns>>(), ...);
+	}
+}
+
+template <>
+struct ryujin::component_traits<pinned_component> : ryujin::component_storage_traits<ryujin::stable_storage, 4>
+{
+};
+
 TEST(Registry, DefaultConstructor)
 {
 	base_registry<entity<std::uint32_t>> reg;
@@ -332,4 +375,836 @@ TEST(Registry, IterateOverEveryOtherEntityWithComponentAfterDeallocationOfCompon
 	}
 
 	ASSERT_EQ(count, 8);
-}
\ No newline at end of file
+}
+
+TEST(Registry, GroupOverNoEntities)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	auto group = reg.group<int, float>();
+
+	ASSERT_EQ(group.size(), 0u);
+	ASSERT_TRUE(group.empty());
+	ASSERT_TRUE(group.begin() == group.end());
+}
+
+TEST(Registry, GroupPacksExistingEntities)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		auto entity = reg.allocate();
+		entity.assign(i);
+		if (i % 4 == 0)
+		{
+			entity.assign(static_cast<float>(i));
+		}
+	}
+
+	auto group = reg.group<int, float>();
+	ASSERT_EQ(group.size(), 4u);
+
+	int count = 0; // expect 4
+	for (auto [handle, i, f] : group)
+	{
+		ASSERT_EQ(i % 4, 0);
+		ASSERT_EQ(static_cast<float>(i), f);
+		ASSERT_EQ(handle.get<int>(), i);
+		++count;
+	}
+
+	ASSERT_EQ(count, 4);
+}
+
+TEST(Registry, GroupTracksAssignAndRemove)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	auto group = reg.group<int, float>();
+
+	std::vector<entity_handle<entity<std::uint32_t>>> ents;
+	for (int i = 0; i < 8; ++i)
+	{
+		auto entity = reg.allocate();
+		entity.assign(i);
+		ents.push_back(entity);
+	}
+
+	ASSERT_EQ(group.size(), 0u);
+
+	for (auto& ent : ents)
+	{
+		ent.assign(1.0f);
+	}
+
+	ASSERT_EQ(group.size(), 8u);
+
+	ents[2].remove<float>();
+	ents[5].remove<int>();
+	reg.deallocate(ents[7]);
+
+	ASSERT_EQ(group.size(), 5u);
+
+	int sum = 0;
+	group.each([&sum](auto handle, int& i, float& f) {
+		ASSERT_TRUE(handle.template contains<float>());
+		ASSERT_EQ(f, 1.0f);
+		sum += i;
+	});
+
+	ASSERT_EQ(sum, 0 + 1 + 3 + 4 + 6);
+}
+
+TEST(Registry, GroupIsReusedForSameComponents)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.allocate().assign(1).assign(1.0f);
+
+	auto first = reg.group<int, float>();
+	auto second = reg.group<float, int>();
+
+	reg.allocate().assign(2).assign(2.0f);
+
+	ASSERT_EQ(first.size(), 2u);
+	ASSERT_EQ(second.size(), 2u);
+}
+
+TEST(Registry, GroupOverlappingAnotherGroupIsInvalid)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.allocate().assign(1).assign(1.0f);
+	reg.allocate().assign(2).assign(2.0).assign(2.0f);
+
+	auto owner = reg.group<int, float>();
+	ASSERT_TRUE(owner.valid());
+
+	// a subset, a superset and a partial overlap of the owned pools are all rejected without touching the owner
+	auto overlap = reg.group<double, float>();
+	ASSERT_FALSE(reg.group<int>().valid());
+	ASSERT_FALSE((reg.group<int, float, double>().valid()));
+	ASSERT_FALSE(overlap.valid());
+
+	int visited = 0;
+	reg.group<double, float>().each([&visited](auto, double&, float&) { ++visited; });
+	ASSERT_EQ(visited, 0);
+	ASSERT_TRUE(overlap.empty());
+
+	ASSERT_EQ(owner.size(), 2u);
+	ASSERT_TRUE(reg.group<double>().valid());
+}
+
+TEST(Registry, IterateYieldsComponentReferences)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	for (int i = 0; i < 8; ++i)
+	{
+		auto entity = reg.allocate().assign(i);
+		if (i % 2 == 1)
+		{
+			entity.assign(static_cast<float>(i));
+		}
+	}
+
+	for (auto [handle, i, f] : reg.entity_view<int, float>())
+	{
+		ASSERT_EQ(static_cast<float>(i), f);
+		i *= 10;
+	}
+
+	int sum = 0;
+	for (auto [handle, i] : reg.entity_view<int>())
+	{
+		sum += i;
+	}
+
+	ASSERT_EQ(sum, 0 + 10 + 2 + 30 + 4 + 50 + 6 + 70);
+}
+
+TEST(Registry, ViewReadsDrivingPoolByPackedIndex)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	// float is the smaller pool and drives the view from either position
+	for (int i = 0; i < 16; ++i)
+	{
+		auto entity = reg.allocate().assign(i);
+		if (i % 4 == 3)
+		{
+			entity.assign(static_cast<float>(i));
+		}
+	}
+
+	int visited = 0;
+	reg.entity_view<float, int>().each([&visited](auto handle, float& f, int& i) {
+		ASSERT_EQ(f, static_cast<float>(i));
+		ASSERT_EQ(handle.template get<float>(), f);
+		++visited;
+	});
+	ASSERT_EQ(visited, 4);
+
+	for (auto [handle, f, i] : reg.entity_view<float, int>())
+	{
+		ASSERT_EQ(f, static_cast<float>(i));
+		ASSERT_EQ(&handle.get<float>(), &f);
+		--visited;
+	}
+	ASSERT_EQ(visited, 0);
+}
+
+TEST(Registry, EachOverMultipleComponents)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	for (int i = 0; i < 64; ++i)
+	{
+		auto entity = reg.allocate().assign(i);
+		if (i % 8 == 0)
+		{
+			entity.assign(1u);
+		}
+	}
+
+	int count = 0; // expect 8
+	reg.entity_view<int, unsigned int>().each([&count](auto handle, int& i, unsigned int& u) {
+		ASSERT_EQ(i % 8, 0);
+		ASSERT_EQ(u, 1u);
+		ASSERT_EQ(handle.template get<int>(), i);
+		++count;
+	});
+
+	ASSERT_EQ(count, 8);
+}
+
+TEST(Registry, ContainsMultipleComponents)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	auto entity = reg.allocate().assign(1).assign(1.0f);
+
+	ASSERT_TRUE((reg.contains<int, float>(entity)));
+	ASSERT_FALSE((reg.contains<int, float, double>(entity)));
+
+	entity.remove<float>();
+
+	ASSERT_TRUE(reg.contains<int>(entity));
+	ASSERT_FALSE((reg.contains<int, float>(entity)));
+}
+
+TEST(Registry, DeallocateClearsComponentsOfRecycledEntity)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	auto entity = reg.allocate().assign(1).assign(1.0f).assign(1.0);
+	reg.deallocate(entity);
+
+	ASSERT_FALSE(reg.contains<int>(entity));
+
+	auto recycled = reg.allocate();
+
+	ASSERT_EQ(recycled.handle().identifier, entity.handle().identifier);
+	ASSERT_TRUE(recycled.contains<ryujin::transform_component>());
+	ASSERT_FALSE(recycled.contains<int>());
+	ASSERT_FALSE(recycled.contains<float>());
+	ASSERT_FALSE(recycled.contains<double>());
+
+	int count = 0; // expect 0
+	for (auto component : reg.entity_view<double>())
+	{
+		++count;
+	}
+
+	ASSERT_EQ(count, 0);
+}
+
+TEST(Registry, DeallocateEmitsRemoveEvents)
+{
+	using entity_type = entity<std::uint32_t>;
+	base_registry<entity_type> reg;
+
+	std::vector<entity_type> removedInts;
+	int removedTransforms = 0;
+	bool stillContained = false;
+	reg.events().subscribe<ryujin::component_remove_event<int, entity_type>>([&](const auto& e) {
+		removedInts.push_back(e.entity.handle());
+		stillContained |= reg.contains<int>(e.entity);
+	});
+	reg.events().subscribe<ryujin::component_remove_event<ryujin::transform_component, entity_type>>([&](const auto&) {
+		++removedTransforms;
+	});
+
+	auto first = reg.allocate().assign(1);
+	auto untouched = reg.allocate().assign(2);
+	reg.deallocate(first);
+
+	ASSERT_EQ(removedInts, std::vector<entity_type>{ first.handle() });
+	ASSERT_EQ(removedTransforms, 1);
+	ASSERT_FALSE(stillContained);
+
+	// the recycled identifier reports its own removal again
+	auto recycled = reg.allocate().assign(3);
+	ASSERT_EQ(recycled.handle().identifier, first.handle().identifier);
+	reg.deallocate(recycled);
+
+	ASSERT_EQ(removedInts, (std::vector<entity_type>{ first.handle(), recycled.handle() }));
+	ASSERT_EQ(removedTransforms, 2);
+	ASSERT_TRUE(untouched.contains<int>());
+}
+
+TEST(Registry, DeallocatingAStaleHandleIsIgnored)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	auto first = reg.allocate();
+	const auto stale = first.handle();
+	reg.deallocate(first);
+
+	auto owner = reg.allocate().assign(7);
+	ASSERT_EQ(owner.handle().identifier, stale.identifier);
+
+	entity_handle<entity<std::uint32_t>> again(stale, &reg);
+	reg.deallocate(again);
+	ASSERT_EQ(reg.active(), 1u);
+	ASSERT_EQ(owner.get<int>(), 7);
+
+	// the identifier was freed once, the next allocation does not hand it out again
+	auto next = reg.allocate();
+	ASSERT_NE(next.handle().identifier, stale.identifier);
+}
+
+TEST(Registry, AllocateN)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	auto first = reg.allocate();
+	reg.deallocate(first);
+
+	entity_handle<entity<std::uint32_t>> handles[64];
+	reg.allocate_n(64, handles);
+
+	ASSERT_EQ(reg.active(), 64);
+	ASSERT_EQ(handles[0].handle().identifier, first.handle().identifier);
+	for (auto& handle : handles)
+	{
+		ASSERT_TRUE(handle.contains<ryujin::transform_component>());
+	}
+}
+
+TEST(Registry, AssignRangeEmitsSingleBatchEvent)
+{
+	using entity_type = entity<std::uint32_t>;
+	base_registry<entity_type> reg;
+
+	int batches = 0;
+	std::size_t added = 0;
+	reg.events().subscribe<ryujin::component_batch_add_event<int, entity_type>>([&](const auto& e) {
+		++batches;
+		added += e.entities.length();
+	});
+
+	entity_handle<entity_type> handles[8];
+	reg.allocate_n(8, handles);
+	handles[3].assign(-1);
+
+	int values[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	reg.assign_range<int>(ryujin::span(handles, 8), ryujin::span(values, 8));
+
+	ASSERT_EQ(batches, 1);
+	ASSERT_EQ(added, 7);
+	ASSERT_EQ(handles[3].get<int>(), -1);
+	ASSERT_EQ(handles[5].get<int>(), 5);
+	ASSERT_TRUE((reg.contains<ryujin::transform_component, int>(handles[7])));
+}
+
+TEST(Registry, UpdatedSinceYieldsOnlyModifiedComponents)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.track_changes<int>();
+
+	auto a = reg.allocate().assign(1);
+	auto b = reg.allocate().assign(2);
+	auto c = reg.allocate().assign(3);
+
+	const auto synced = reg.tick();
+
+	int count = 0;
+	for (auto [e, value] : reg.updated_since<int>(synced))
+	{
+		++count;
+	}
+	ASSERT_EQ(count, 0);
+
+	b.get_mut<int>() = 20;
+	c.patch<int>([](int& v) { v = 30; });
+
+	count = 0;
+	int sum = 0;
+	reg.updated_since<int>(synced).each([&](auto e, int& value) {
+		ASSERT_NE(e.handle(), a.handle());
+		++count;
+		sum += value;
+	});
+	ASSERT_EQ(count, 2);
+	ASSERT_EQ(sum, 50);
+
+	reg.remove<int>(b);
+	count = 0;
+	for (auto [e, value] : reg.updated_since<int>(synced))
+	{
+		ASSERT_EQ(e.handle(), c.handle());
+		++count;
+	}
+	ASSERT_EQ(count, 1);
+}
+
+TEST(Registry, UpdatedSinceYieldsEachValueOnceInChangeOrder)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.track_changes<int>();
+
+	auto a = reg.allocate().assign(1);
+	auto b = reg.allocate().assign(2);
+	const auto synced = reg.tick();
+
+	for (int i = 0; i < 100; ++i)
+	{
+		b.get_mut<int>() = i;
+	}
+	a.get_mut<int>() = 10;
+
+	std::vector<entity<std::uint32_t>> changed;
+	for (auto [e, value] : reg.updated_since<int>(synced))
+	{
+		changed.push_back(e.handle());
+	}
+	ASSERT_EQ(changed, (std::vector{ b.handle(), a.handle() }));
+
+	// only changes after the given tick are visited, touches made while iterating are left for the next call
+	const auto partial = reg.tick();
+	b.get_mut<int>() = 200;
+	int count = 0;
+	reg.updated_since<int>(partial).each([&](auto e, int& value) {
+		ASSERT_EQ(e.handle(), b.handle());
+		ASSERT_EQ(value, 200);
+		e.template get_mut<int>() = 300;
+		++count;
+	});
+	ASSERT_EQ(count, 1);
+
+	// pools that were never created have nothing to report
+	ASSERT_TRUE(reg.updated_since<double>(0).begin() == reg.updated_since<double>(0).end());
+}
+
+TEST(Registry, UntrackedComponentsAlwaysReportUpdated)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.allocate().assign(1.0f);
+
+	int count = 0;
+	reg.updated_since<float>(reg.tick()).each([&](auto, float&) { ++count; });
+	ASSERT_EQ(count, 1);
+}
+
+TEST(Registry, SortComponentsAndSortAs)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	std::vector<entity_handle<entity<std::uint32_t>>> handles;
+	for (int i = 0; i < 4; ++i)
+	{
+		auto e = reg.allocate();
+		e.assign(3 - i);
+		e.assign(static_cast<float>(i));
+		handles.push_back(e);
+	}
+
+	ASSERT_TRUE(reg.sort<int>([](const int lhs, const int rhs) { return lhs < rhs; }));
+	ASSERT_TRUE((reg.sort_as<float, int>()));
+
+	int expected = 0;
+	reg.entity_view<int>().each([&](auto, int& value) { ASSERT_EQ(value, expected++); });
+
+	float previous = 4.0f;
+	reg.entity_view<float>().each([&](auto, float& value) {
+		ASSERT_LT(value, previous);
+		previous = value;
+	});
+
+	for (int i = 0; i < 4; ++i)
+	{
+		ASSERT_EQ(handles[i].get<int>(), 3 - i);
+		ASSERT_FLOAT_EQ(handles[i].get<float>(), static_cast<float>(i));
+	}
+
+	reg.group<int, float>();
+	ASSERT_FALSE(reg.sort<int>([](const int lhs, const int rhs) { return lhs > rhs; }));
+}
+
+TEST(Registry, TagComponentsStoreNoValues)
+{
+	static_assert(std::is_same_v<ryujin::component_traits<tag_component>::storage, ryujin::tag_storage>);
+	static_assert(std::is_same_v<ryujin::component_traits<int>::storage, ryujin::dense_storage>);
+
+	base_registry<entity<std::uint32_t>> reg;
+	auto a = reg.allocate();
+	auto b = reg.allocate();
+	auto c = reg.allocate();
+	a.assign(tag_component{});
+	c.assign(tag_component{});
+
+	ASSERT_TRUE(a.contains<tag_component>());
+	ASSERT_FALSE(b.contains<tag_component>());
+	ASSERT_EQ(reg.size<tag_component>(), 2);
+
+	a.remove<tag_component>();
+	ASSERT_FALSE(a.contains<tag_component>());
+	ASSERT_TRUE(c.contains<tag_component>());
+
+	int count = 0;
+	for (auto& tag : reg.component_view<tag_component>())
+	{
+		(void)tag;
+		++count;
+	}
+	ASSERT_EQ(count, 1);
+}
+
+TEST(Registry, StableStorageKeepsComponentAddresses)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	std::vector<entity_handle<entity<std::uint32_t>>> handles;
+	for (int i = 0; i < 10; ++i)
+	{
+		auto e = reg.allocate();
+		e.assign(pinned_component{ i });
+		handles.push_back(e);
+	}
+
+	const pinned_component* last = &handles[9].get<pinned_component>();
+	const pinned_component* middle = &handles[5].get<pinned_component>();
+
+	// removals swap the packed entities, inserts grow new pages, neither may move existing values
+	handles[0].remove<pinned_component>();
+	handles[3].remove<pinned_component>();
+	for (int i = 10; i < 40; ++i)
+	{
+		reg.allocate().assign(pinned_component{ i });
+	}
+	reg.sort<pinned_component>([](const pinned_component& lhs, const pinned_component& rhs) { return lhs.value > rhs.value; });
+
+	ASSERT_EQ(&handles[9].get<pinned_component>(), last);
+	ASSERT_EQ(&handles[5].get<pinned_component>(), middle);
+	ASSERT_EQ(last->value, 9);
+	ASSERT_EQ(middle->value, 5);
+
+	int sum = 0;
+	int previous = 40;
+	for (auto& component : reg.component_view<pinned_component>())
+	{
+		ASSERT_LT(component.value, previous);
+		previous = component.value;
+		sum += component.value;
+	}
+	ASSERT_EQ(sum, (39 * 40) / 2 - 3);
+}
+
+TEST(Registry, SnapshotRestoresEntitiesAndComponents)
+{
+	using registry_type = base_registry<entity<std::uint32_t>>;
+
+	registry_type reg;
+	std::vector<entity_handle<entity<std::uint32_t>>> handles;
+	for (int i = 0; i < 8; ++i)
+	{
+		auto e = reg.allocate();
+		e.assign(pinned_component{ i * 10 });
+		if (i % 3 == 0)
+		{
+			e.assign(tag_component{});
+		}
+		handles.push_back(e);
+	}
+	reg.deallocate(handles[2]);
+	reg.deallocate(handles[5]);
+
+	ryujin::vector<ryujin::u8> snapshot;
+	reg.snapshot<ryujin::transform_component, pinned_component, tag_component>(snapshot);
+
+	// diverge from the snapshot, then roll back
+	reg.allocate().assign(pinned_component{ 99 });
+	handles[1].remove<pinned_component>();
+	handles[4].get<pinned_component>().value = -1;
+
+	registry_type copy;
+	ASSERT_TRUE((reg.restore<ryujin::transform_component, pinned_component, tag_component>(snapshot.data(), snapshot.size())));
+	ASSERT_TRUE((copy.restore<ryujin::transform_component, pinned_component, tag_component>(snapshot.data(), snapshot.size())));
+
+	for (registry_type* restored : { &reg, &copy })
+	{
+		ASSERT_EQ(restored->active(), 6);
+		ASSERT_EQ(restored->size<ryujin::transform_component>(), 6);
+		ASSERT_EQ(restored->size<pinned_component>(), 6);
+		ASSERT_EQ(restored->size<tag_component>(), 3);
+
+		for (int i = 0; i < 8; ++i)
+		{
+			entity_handle<entity<std::uint32_t>> e(handles[i].handle(), restored);
+			if (i == 2 || i == 5)
+			{
+				ASSERT_FALSE(e.contains<pinned_component>());
+				continue;
+			}
+			ASSERT_EQ(e.get<pinned_component>().value, i * 10);
+			ASSERT_EQ(e.contains<tag_component>(), i % 3 == 0);
+		}
+
+		// the free list survives, so recycled identifiers come back with bumped versions
+		auto recycled = restored->allocate();
+		ASSERT_EQ(recycled.handle().identifier, handles[2].handle().identifier);
+		ASSERT_NE(recycled.handle().version, handles[2].handle().version);
+	}
+}
+
+TEST(Registry, RestoreRejectsInvalidSnapshots)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.allocate().assign(pinned_component{ 7 });
+
+	ryujin::vector<ryujin::u8> snapshot;
+	reg.snapshot<pinned_component>(snapshot);
+
+	// mismatched component list, truncated data and a corrupted header are all rejected
+	ASSERT_FALSE((reg.restore<pinned_component, tag_component>(snapshot.data(), snapshot.size())));
+	ASSERT_FALSE(reg.restore<pinned_component>(snapshot.data(), snapshot.size() - 16));
+	snapshot[0] = 0;
+	ASSERT_FALSE(reg.restore<pinned_component>(snapshot.data(), snapshot.size()));
+
+	ASSERT_EQ(reg.active(), 1);
+	ASSERT_EQ(reg.size<pinned_component>(), 1);
+}
+
+TEST(Registry, RestoreRejectsCorruptEntitiesAndKeys)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	reg.allocate().assign(pinned_component{ 1 });
+	reg.allocate().assign(pinned_component{ 2 });
+
+	ryujin::vector<ryujin::u8> snapshot;
+	reg.snapshot<pinned_component>(snapshot);
+
+	// header at 0, free list head at 32, entities at 48, pool header at 64, keys at 80
+	const auto corrupted = [&](const std::size_t offset, const auto value) {
+		std::vector<ryujin::u8> bytes(snapshot.begin(), snapshot.end());
+		std::memcpy(bytes.data() + offset, &value, sizeof(value));
+		return bytes;
+	};
+
+	const std::vector<ryujin::u8> invalid[] = {
+		corrupted(16, std::uint64_t{ 1 } << 40), // entity count past the data
+		corrupted(24, std::uint64_t{ 3 }), // active count disagrees with the entities
+		corrupted(32, std::uint32_t{ 0 }), // free list starts at a live entity
+		corrupted(84, std::uint32_t{ 5 }), // key out of range
+		corrupted(84, std::uint32_t{ 0 }), // duplicate key
+	};
+
+	for (const auto& bytes : invalid)
+	{
+		ASSERT_FALSE(reg.restore<pinned_component>(bytes.data(), bytes.size()));
+		ASSERT_EQ(reg.active(), 2);
+		ASSERT_EQ(reg.size<pinned_component>(), 2);
+	}
+	ASSERT_TRUE(reg.restore<pinned_component>(snapshot.data(), snapshot.size()));
+}
+
+TEST(Registry, QueryTracksAssignRemoveAndExclusions)
+{
+	base_registry<entity<std::uint32_t>> reg;
+
+	std::vector<entity_handle<entity<std::uint32_t>>> ents;
+	for (int i = 0; i < 8; ++i)
+	{
+		auto entity = reg.allocate();
+		entity.assign(i);
+		if (i % 2 == 0)
+		{
+			entity.assign(static_cast<double>(i));
+		}
+		ents.push_back(entity);
+	}
+	ents[4].assign(tag_component{});
+
+	// matches existing entities on creation
+	auto query = reg.query<int, double>(ryujin::exclude<tag_component>);
+	ASSERT_EQ(query.size(), 3u);
+
+	ents[1].assign(1.0);
+	ents[2].assign(tag_component{});
+	ents[4].remove<tag_component>();
+	ents[6].remove<double>();
+	reg.deallocate(ents[0]);
+
+	auto recycled = reg.allocate();
+	recycled.assign(100).assign(100.0);
+
+	int sum = 0;
+	int visited = 0;
+	query.each([&](auto handle, int& i, double& d) {
+		ASSERT_FALSE(handle.template contains<tag_component>());
+		ASSERT_EQ(static_cast<double>(i), d);
+		sum += i;
+		++visited;
+	});
+	ASSERT_EQ(visited, 3);
+	ASSERT_EQ(sum, 1 + 4 + 100);
+
+	// the same component sets return the same query, a different exclusion is a different query
+	ASSERT_EQ((reg.query<int, double>(ryujin::exclude<tag_component>).size()), 3u);
+	ASSERT_EQ((reg.query<int, double>().size()), 4u);
+
+	int iterated = 0;
+	for (auto [handle, i, d] : query)
+	{
+		ASSERT_EQ(handle.get<int>(), i);
+		++iterated;
+	}
+	ASSERT_EQ(iterated, 3);
+}
+
+TEST(Registry, QueryMatchesComponentsPastTheMaskCapacity)
+{
+	using ryujin::detail::component_identifier_utility;
+	using ryujin::detail::component_mask;
+
+	exhaust_component_masks(std::make_integer_sequence<int, component_mask::capacity>());
+	ASSERT_GE(component_identifier_utility::fetch_identifier<late_component>(), component_mask::capacity);
+	ASSERT_GE(component_identifier_utility::fetch_identifier<late_tag>(), component_mask::capacity);
+
+	base_registry<entity<std::uint32_t>> reg;
+	std::vector<entity_handle<entity<std::uint32_t>>> ents;
+	for (int i = 0; i < 6; ++i)
+	{
+		auto entity = reg.allocate();
+		entity.assign(i);
+		if (i % 2 == 0)
+		{
+			entity.assign(late_component{ i });
+		}
+		ents.push_back(entity);
+	}
+	ents[2].assign(late_tag{});
+
+	auto query = reg.query<int, late_component>(ryujin::exclude<late_tag>);
+	ASSERT_EQ(query.size(), 2u);
+
+	// matches follow the unmasked pools
+	ents[1].assign(late_component{ 1 });
+	ents[4].assign(late_tag{});
+	ents[2].remove<late_tag>();
+	reg.deallocate(ents[0]);
+
+	int sum = 0;
+	query.each([&sum](auto, int& i, late_component& late) {
+		ASSERT_EQ(i, late.value);
+		sum += i;
+	});
+	ASSERT_EQ(sum, 1 + 2);
+	ASSERT_EQ((reg.query<int, late_component>().size()), 3u);
+}
+
+TEST(Registry, QueryAllowsRemovalDuringEach)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	for (int i = 0; i < 10; ++i)
+	{
+		reg.allocate().assign(i).assign(static_cast<double>(i));
+	}
+
+	auto query = reg.query<int, double>();
+	int visited = 0;
+	query.each([&](auto handle, int&, double&) {
+		handle.template remove<double>();
+		++visited;
+	});
+
+	ASSERT_EQ(visited, 10);
+	ASSERT_TRUE(query.empty());
+}
+
+TEST(Registry, QueryOverGroupUsesPackedRange)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	auto group = reg.group<int, float>();
+	auto query = reg.query<int, float>();
+
+	for (int i = 0; i < 6; ++i)
+	{
+		auto entity = reg.allocate();
+		entity.assign(i);
+		if (i != 3)
+		{
+			entity.assign(static_cast<float>(i));
+		}
+	}
+
+	ASSERT_EQ(query.size(), group.size());
+	ASSERT_EQ(query.size(), 5u);
+
+	int sum = 0;
+	query.each([&sum](auto, int& i, float& f) {
+		ASSERT_EQ(static_cast<float>(i), f);
+		sum += i;
+	});
+	ASSERT_EQ(sum, 0 + 1 + 2 + 4 + 5);
+}
+
+TEST(Registry, StatsReportPoolsAndFreeList)
+{
+	base_registry<entity<std::uint32_t>> reg;
+	std::vector<entity_handle<entity<std::uint32_t>>> handles;
+	for (int i = 0; i < 2048; ++i)
+	{
+		auto e = reg.allocate();
+		e.assign(i);
+		handles.push_back(e);
+	}
+	for (int i = 1024; i < 2048; ++i)
+	{
+		reg.deallocate(handles[i]);
+	}
+
+	auto stats = reg.stats();
+	ASSERT_EQ(stats.allocated, 2048u);
+	ASSERT_EQ(stats.active, 1024u);
+	ASSERT_EQ(stats.free_list_length, 1024u);
+	ASSERT_GT(stats.entity_bytes, 0u);
+
+	const auto intId = ryujin::detail::component_identifier_utility::fetch_identifier<int>();
+	const auto findPool = [&](const ryujin::registry_stats& s) {
+		for (const auto& pool : s.pools)
+		{
+			if (pool.identifier == intId)
+			{
+				return pool;
+			}
+		}
+		return ryujin::component_pool_stats{};
+	};
+
+	auto intPool = findPool(stats);
+	ASSERT_EQ(intPool.size, 1024u);
+	ASSERT_EQ(intPool.sparse_pages, 2u);
+	ASSERT_FLOAT_EQ(intPool.occupancy, 0.5f);
+	ASSERT_GE(intPool.bytes, 2 * 1024 * sizeof(entity<std::uint32_t>));
+
+	// the second page is empty, shrinking releases it
+	reg.shrink_to_fit();
+	stats = reg.stats();
+	intPool = findPool(stats);
+	ASSERT_EQ(intPool.sparse_pages, 1u);
+	ASSERT_FLOAT_EQ(intPool.occupancy, 1.0f);
+
+	// with the release policy pages go as soon as they empty
+	reg.set_page_policy(ryujin::sparse_page_policy::release_empty);
+	for (int i = 0; i < 1024; ++i)
+	{
+		handles[i].remove<int>();
+	}
+	ASSERT_EQ(findPool(reg.stats()).sparse_pages, 0u);
+}
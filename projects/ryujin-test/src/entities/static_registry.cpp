@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/static_registry.hpp>
+
+using ryujin::entity;
+using ryujin::static_registry;
+using ryujin::u32;
+
+namespace
+{
+	struct position
+	{
+		float x, y;
+	};
+
+	struct velocity
+	{
+		float dx, dy;
+	};
+
+	struct frozen {};
+
+	using test_registry = static_registry<entity<u32>, position, velocity, frozen>;
+}
+
+TEST(StaticRegistry, AllocateRecyclesIdentifiersWithNewVersions)
+{
+	test_registry reg;
+	const auto first = reg.allocate();
+	const auto second = reg.allocate();
+	ASSERT_TRUE(reg.alive(first));
+	ASSERT_TRUE(reg.alive(second));
+	ASSERT_EQ(reg.active(), 2);
+
+	reg.assign(first, position{ 1.0f, 2.0f });
+	reg.deallocate(first);
+	ASSERT_FALSE(reg.alive(first));
+	ASSERT_EQ(reg.size<position>(), 0);
+	ASSERT_EQ(reg.active(), 1);
+
+	const auto recycled = reg.allocate();
+	ASSERT_EQ(recycled.identifier, first.identifier);
+	ASSERT_NE(recycled.version, first.version);
+	ASSERT_TRUE(reg.alive(recycled));
+	ASSERT_FALSE(reg.contains<position>(recycled));
+}
+
+TEST(StaticRegistry, AssignGetAndRemove)
+{
+	test_registry reg;
+	const auto e = reg.allocate();
+
+	ASSERT_TRUE(reg.assign(e, position{ 1.0f, 2.0f }));
+	ASSERT_FALSE(reg.assign(e, position{ 3.0f, 4.0f }));
+	ASSERT_EQ(reg.get<position>(e).x, 1.0f);
+
+	reg.assign_or_replace(e, position{ 3.0f, 4.0f });
+	ASSERT_EQ(reg.get<position>(e).y, 4.0f);
+	ASSERT_EQ(reg.try_get<velocity>(e), nullptr);
+
+	reg.assign(e, frozen{});
+	ASSERT_TRUE((reg.contains<position, frozen>(e)));
+	ASSERT_FALSE((reg.contains<position, velocity>(e)));
+
+	ASSERT_TRUE(reg.remove<frozen>(e));
+	ASSERT_FALSE(reg.contains<frozen>(e));
+}
+
+TEST(StaticRegistry, EachVisitsEntitiesWithAllComponents)
+{
+	test_registry reg;
+	entity<u32> entities[6];
+	reg.allocate_n(6, entities);
+
+	for (u32 i = 0; i < 6; ++i)
+	{
+		reg.assign(entities[i], position{ static_cast<float>(i), 0.0f });
+		if (i % 2 == 0)
+		{
+			reg.assign(entities[i], velocity{ 1.0f, 2.0f });
+		}
+	}
+	reg.assign(entities[2], frozen{});
+
+	int visited = 0;
+	reg.each<position, velocity>([&](const entity<u32>, position& p, const velocity& v) {
+		p.x += v.dx;
+		p.y += v.dy;
+		++visited;
+	});
+	ASSERT_EQ(visited, 3);
+	ASSERT_EQ(reg.get<position>(entities[4]).x, 5.0f);
+	ASSERT_EQ(reg.get<position>(entities[1]).x, 1.0f);
+
+	visited = 0;
+	reg.each<position, frozen>([&](const entity<u32> e, position&, frozen&) {
+		ASSERT_EQ(e, entities[2]);
+		reg.remove<frozen>(e);
+		++visited;
+	});
+	ASSERT_EQ(visited, 1);
+	ASSERT_EQ(reg.size<frozen>(), 0);
+}
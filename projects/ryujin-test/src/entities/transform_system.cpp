@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/core/system_scheduler.hpp>
+#include <ryujin/entities/observer.hpp>
+#include <ryujin/entities/transform_system.hpp>
+
+using ryujin::entity_handle;
+using ryujin::observer;
+using ryujin::observer_matcher;
+using ryujin::registry;
+using ryujin::system_scheduler;
+using ryujin::transform_component;
+using ryujin::transform_system;
+using ryujin::vec3;
+
+namespace
+{
+	using relationship = ryujin::entity_relationship_component<registry::entity_type>;
+
+	void set_translation(entity_handle<registry::entity_type>& e, const vec3<float>& position)
+	{
+		e.get_mut<transform_component>().matrix = ryujin::translate(position);
+	}
+
+	float world_x(const entity_handle<registry::entity_type>& e)
+	{
+		return e.get<transform_component>().world[3][0];
+	}
+
+	void attach(entity_handle<registry::entity_type>& parent, entity_handle<registry::entity_type>& child)
+	{
+		if (!parent.contains<relationship>())
+		{
+			parent.assign(relationship{ relationship::tombstone, relationship::tombstone, relationship::tombstone });
+		}
+
+		auto& parentRelationship = parent.get_mut<relationship>();
+		child.assign_or_replace(relationship{ parent.handle(), relationship::tombstone, parentRelationship.firstChild });
+		parentRelationship.firstChild = child.handle();
+	}
+}
+
+TEST(TransformSystem, PropagatesThroughHierarchy)
+{
+	registry reg;
+	transform_system system(reg);
+
+	auto root = reg.allocate();
+	auto child = reg.allocate();
+	auto grandchild = reg.allocate();
+	attach(root, child);
+	attach(child, grandchild);
+
+	set_translation(root, vec3(1.0f, 0.0f, 0.0f));
+	set_translation(child, vec3(2.0f, 0.0f, 0.0f));
+	set_translation(grandchild, vec3(4.0f, 0.0f, 0.0f));
+
+	system.update();
+
+	ASSERT_FLOAT_EQ(world_x(root), 1.0f);
+	ASSERT_FLOAT_EQ(world_x(child), 3.0f);
+	ASSERT_FLOAT_EQ(world_x(grandchild), 7.0f);
+
+	ASSERT_FLOAT_EQ(child.get<transform_component>().matrix[3][0], 2.0f);
+}
+
+TEST(TransformSystem, RecomputesOnlyDirtySubtrees)
+{
+	registry reg;
+	transform_system system(reg);
+
+	auto a = reg.allocate();
+	auto aChild = reg.allocate();
+	auto b = reg.allocate();
+	auto bChild = reg.allocate();
+	attach(a, aChild);
+	attach(b, bChild);
+
+	system.update();
+
+	// untracked write, only a recompute would overwrite it
+	b.get<transform_component>().world[3][0] = 42.0f;
+	bChild.get<transform_component>().world[3][0] = 42.0f;
+
+	set_translation(a, vec3(5.0f, 0.0f, 0.0f));
+	system.update();
+
+	ASSERT_FLOAT_EQ(world_x(a), 5.0f);
+	ASSERT_FLOAT_EQ(world_x(aChild), 5.0f);
+	ASSERT_FLOAT_EQ(world_x(b), 42.0f);
+	ASSERT_FLOAT_EQ(world_x(bChild), 42.0f);
+}
+
+TEST(TransformSystem, ReportsMovedEntitiesToObservers)
+{
+	registry reg;
+	transform_system system(reg);
+
+	auto a = reg.allocate();
+	auto aChild = reg.allocate();
+	auto b = reg.allocate();
+	attach(a, aChild);
+	system.update();
+
+	observer moved(reg, observer_matcher().updated<transform_component>());
+	set_translation(a, vec3(1.0f, 0.0f, 0.0f));
+	moved.clear();
+	system.update();
+
+	// the child moved through its parent without being touched itself
+	ASSERT_TRUE(moved.contains(a.handle()));
+	ASSERT_TRUE(moved.contains(aChild.handle()));
+	ASSERT_FALSE(moved.contains(b.handle()));
+
+	// the reported updates do not mark the entities dirty for the next update
+	moved.clear();
+	aChild.get<transform_component>().world[3][0] = 42.0f;
+	system.update();
+	ASSERT_TRUE(moved.empty());
+	ASSERT_FLOAT_EQ(world_x(aChild), 42.0f);
+}
+
+TEST(TransformSystem, ReparentingRebuildsOrder)
+{
+	registry reg;
+	transform_system system(reg);
+
+	auto a = reg.allocate();
+	auto b = reg.allocate();
+	auto child = reg.allocate();
+	set_translation(a, vec3(1.0f, 0.0f, 0.0f));
+	set_translation(b, vec3(10.0f, 0.0f, 0.0f));
+	set_translation(child, vec3(1.0f, 0.0f, 0.0f));
+	attach(a, child);
+
+	system.update();
+	ASSERT_FLOAT_EQ(world_x(child), 2.0f);
+
+	auto& aRelationship = a.get_mut<relationship>();
+	aRelationship.firstChild = relationship::tombstone;
+	attach(b, child);
+
+	system.update();
+	ASSERT_FLOAT_EQ(world_x(child), 11.0f);
+}
+
+TEST(TransformSystem, ParallelAcrossRoots)
+{
+	registry reg;
+	transform_system system(reg);
+
+	constexpr std::size_t roots = 4096;
+	std::vector<entity_handle<registry::entity_type>> children;
+	for (std::size_t i = 0; i < roots; ++i)
+	{
+		auto root = reg.allocate();
+		auto child = reg.allocate();
+		set_translation(root, vec3(static_cast<float>(i), 0.0f, 0.0f));
+		set_translation(child, vec3(0.5f, 0.0f, 0.0f));
+		attach(root, child);
+		children.push_back(child);
+	}
+
+	system_scheduler scheduler(3);
+	system.update(&scheduler);
+
+	for (std::size_t i = 0; i < roots; ++i)
+	{
+		ASSERT_FLOAT_EQ(world_x(children[i]), static_cast<float>(i) + 0.5f);
+	}
+}
+
+TEST(TransformSystem, SpawnAndDespawnOnlyTouchTheirTrees)
+{
+	registry reg;
+	transform_system system(reg);
+
+	std::vector<entity_handle<registry::entity_type>> roots;
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		auto root = reg.allocate();
+		auto child = reg.allocate();
+		set_translation(root, vec3(static_cast<float>(i), 0.0f, 0.0f));
+		set_translation(child, vec3(0.5f, 0.0f, 0.0f));
+		attach(root, child);
+		roots.push_back(root);
+	}
+	system.update();
+
+	observer moved(reg, observer_matcher().updated<transform_component>());
+
+	auto spawned = reg.allocate();
+	set_translation(spawned, vec3(3.0f, 0.0f, 0.0f));
+	moved.clear();
+	system.update();
+	ASSERT_EQ(moved.size(), 1);
+	ASSERT_TRUE(moved.contains(spawned.handle()));
+	ASSERT_FLOAT_EQ(world_x(spawned), 3.0f);
+
+	// despawning a leaf moves nothing else
+	moved.clear();
+	reg.deallocate(spawned);
+	system.update();
+	ASSERT_TRUE(moved.empty());
+
+	// despawning a parent turns its child into a root, which is the only entity that moves
+	const auto orphan = entity_handle(roots[10].get<relationship>().firstChild, &reg);
+	moved.clear();
+	reg.deallocate(roots[10]);
+	system.update();
+	ASSERT_EQ(moved.size(), 1);
+	ASSERT_TRUE(moved.contains(orphan.handle()));
+	ASSERT_FLOAT_EQ(world_x(orphan), 0.5f);
+}
+
+TEST(TransformSystem, RecycledIdentifiersJoinTheirNewParent)
+{
+	registry reg;
+	transform_system system(reg);
+
+	auto parent = reg.allocate();
+	auto first = reg.allocate();
+	set_translation(parent, vec3(10.0f, 0.0f, 0.0f));
+	set_translation(first, vec3(1.0f, 0.0f, 0.0f));
+	system.update();
+
+	const auto identifier = first.handle().identifier;
+	reg.deallocate(first);
+	auto second = reg.allocate();
+	ASSERT_EQ(second.handle().identifier, identifier);
+
+	set_translation(second, vec3(2.0f, 0.0f, 0.0f));
+	attach(parent, second);
+	system.update();
+	ASSERT_FLOAT_EQ(world_x(second), 12.0f);
+
+	set_translation(parent, vec3(20.0f, 0.0f, 0.0f));
+	system.update();
+	ASSERT_FLOAT_EQ(world_x(second), 22.0f);
+}
+
+TEST(TransformSystem, ManyDespawnsCompactTheOrdering)
+{
+	registry reg;
+	transform_system system(reg);
+
+	std::vector<entity_handle<registry::entity_type>> entities;
+	for (std::size_t i = 0; i < 64; ++i)
+	{
+		auto e = reg.allocate();
+		set_translation(e, vec3(static_cast<float>(i), 0.0f, 0.0f));
+		entities.push_back(e);
+	}
+	system.update();
+
+	// release most segments, forcing a rebuild of the ordering, then keep moving the survivors
+	for (std::size_t i = 0; i < 48; ++i)
+	{
+		reg.deallocate(entities[i]);
+		system.update();
+	}
+
+	for (std::size_t i = 48; i < 64; ++i)
+	{
+		set_translation(entities[i], vec3(static_cast<float>(i) * 2.0f, 0.0f, 0.0f));
+	}
+	system.update();
+
+	for (std::size_t i = 48; i < 64; ++i)
+	{
+		ASSERT_FLOAT_EQ(world_x(entities[i]), static_cast<float>(i) * 2.0f);
+	}
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/graphics/culling.hpp>
+#include <ryujin/math/transformations.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using ryujin::frustum;
+using ryujin::gpu_indirect_call;
+using ryujin::gpu_instance_data;
+using ryujin::instance_source;
+using ryujin::mat4;
+using ryujin::mesh_bounds;
+using ryujin::quat;
+using ryujin::span;
+using ryujin::u32;
+using ryujin::vec3;
+using ryujin::vec4;
+
+namespace
+{
+	// the unit cube [-1, 1]^3 as six planes
+	frustum unit_box()
+	{
+		frustum f;
+		f.planes[0] = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+		f.planes[1] = vec4(-1.0f, 0.0f, 0.0f, 1.0f);
+		f.planes[2] = vec4(0.0f, 1.0f, 0.0f, 1.0f);
+		f.planes[3] = vec4(0.0f, -1.0f, 0.0f, 1.0f);
+		f.planes[4] = vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		f.planes[5] = vec4(0.0f, 0.0f, -1.0f, 1.0f);
+		return f;
+	}
+
+	gpu_instance_data instance_at(const vec3<float>& position, const u32 id)
+	{
+		gpu_instance_data instance = {};
+		instance.transform = ryujin::translate(position);
+		instance.material = id;
+		return instance;
+	}
+}
+
+TEST(Culling, FrustumMatchesClipSpace)
+{
+	const auto proj = ryujin::perspective(16.0f / 9.0f, 70.0f, 0.1f, 50.0f);
+	const auto view = ryujin::look_direction(vec3(1.0f, 2.0f, 3.0f), ryujin::normalize(vec3(0.3f, -0.2f, 1.0f)), vec3(0.0f, 1.0f, 0.0f));
+	const auto viewProj = proj * view;
+	const frustum f = ryujin::extract_frustum(viewProj);
+
+	// a point sized mesh is visible exactly when its clip space position is inside -w <= xyz <= w
+	const mesh_bounds point = {};
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> coord(-60.0f, 60.0f);
+	int inside = 0;
+	for (int i = 0; i < 2000; ++i)
+	{
+		const vec3<float> p(coord(rng), coord(rng), coord(rng));
+		const vec4<float> clip = viewProj * vec4(p.x, p.y, p.z, 1.0f);
+		const float margin = 1e-3f * std::abs(clip.w);
+		const bool clipInside = std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && std::abs(clip.z) <= clip.w;
+		const bool clipOutside = std::abs(clip.x) > clip.w + margin || std::abs(clip.y) > clip.w + margin || std::abs(clip.z) > clip.w + margin;
+		if (!clipInside && !clipOutside)
+		{
+			continue; // too close to a plane to compare reliably
+		}
+
+		ASSERT_EQ(ryujin::is_visible(f, point, ryujin::translate(p)), clipInside);
+		inside += clipInside;
+	}
+	ASSERT_GT(inside, 0);
+}
+
+TEST(Culling, BoxRefinesTheSphereTest)
+{
+	const frustum f = unit_box();
+	const mesh_bounds rod = {
+		.center = vec3(0.0f),
+		.extents = vec3(5.0f, 0.1f, 0.1f),
+		.radius = 5.01f
+	};
+
+	// the sphere reaches into the box while the rod itself passes above it
+	ASSERT_FALSE(ryujin::is_visible(f, rod, ryujin::translate(vec3(0.0f, 3.0f, 0.0f))));
+	ASSERT_TRUE(ryujin::is_visible(f, rod, ryujin::translate(vec3(0.0f, 1.05f, 0.0f))));
+	ASSERT_FALSE(ryujin::is_visible(f, rod, ryujin::translate(vec3(0.0f, 7.0f, 0.0f))));
+
+	// rotated upright the rod reaches the box from far above
+	const auto upright = ryujin::transform(vec3(0.0f, 5.5f, 0.0f), quat(vec3(0.0f, 0.0f, 90.0f)), vec3(1.0f));
+	ASSERT_TRUE(ryujin::is_visible(f, rod, upright));
+}
+
+TEST(Culling, CullInstancesCompactsDrawRanges)
+{
+	const frustum f = unit_box();
+	const mesh_bounds unit = {
+		.center = vec3(0.0f),
+		.extents = vec3(0.25f),
+		.radius = 0.44f
+	};
+
+	// draw 0 alternates visible and hidden instances, draw 1 is fully visible
+	std::vector<gpu_instance_data> instances;
+	for (u32 i = 0; i < 10; ++i)
+	{
+		instances.push_back(instance_at(i % 2 == 0 ? vec3(0.0f, 0.0f, 0.5f) : vec3(0.0f, 0.0f, 4.0f), i));
+	}
+	for (u32 i = 10; i < 17; ++i)
+	{
+		instances.push_back(instance_at(vec3(0.5f, -0.5f, 0.0f), i));
+	}
+
+	const gpu_indirect_call calls[] = {
+		{ .indexCount = 36, .instanceCount = 10, .firstIndex = 0, .vertexOffset = 0, .firstInstance = 0 },
+		{ .indexCount = 6, .instanceCount = 7, .firstIndex = 36, .vertexOffset = 8, .firstInstance = 10 }
+	};
+	const mesh_bounds bounds[] = { unit, unit };
+
+	// the second draw references the dynamic table, its slots are stored reversed
+	std::vector<gpu_instance_data> dynamics(instances.begin() + 10, instances.end());
+	std::reverse(dynamics.begin(), dynamics.end());
+	std::vector<u32> refs;
+	for (u32 i = 0; i < 10; ++i)
+	{
+		refs.push_back(i);
+	}
+	for (u32 i = 0; i < 7; ++i)
+	{
+		refs.push_back((6 - i) | ryujin::dynamic_instance_bit);
+	}
+	const instance_source source = { .statics = instances.data(), .dynamics = dynamics.data() };
+
+	// host memory stands in for the mapped reference and indirect buffers
+	std::vector<u32> mapped(32);
+	gpu_indirect_call culled[2] = {};
+	const auto written = ryujin::cull_instances(f, span(calls, 2), span(bounds, 2), span(refs.data(), refs.size()), source, 100, mapped.size(), mapped.data(), culled);
+
+	ASSERT_EQ(written, 12u);
+	ASSERT_EQ(culled[0].instanceCount, 5u);
+	ASSERT_EQ(culled[0].firstInstance, 100u);
+	ASSERT_EQ(culled[0].indexCount, 36u);
+	ASSERT_EQ(culled[1].instanceCount, 7u);
+	ASSERT_EQ(culled[1].firstInstance, 105u);
+	ASSERT_EQ(culled[1].firstIndex, 36u);
+	ASSERT_EQ(culled[1].vertexOffset, 8);
+
+	for (u32 i = 0; i < 5; ++i)
+	{
+		ASSERT_EQ(mapped[i], i * 2);
+	}
+	for (u32 i = 0; i < 7; ++i)
+	{
+		ASSERT_EQ(mapped[5 + i], refs[10 + i]);
+		ASSERT_EQ(source[mapped[5 + i]].material, 10 + i);
+	}
+
+	// instances past the capacity are dropped and the draws shrink to match
+	const auto truncated = ryujin::cull_instances(f, span(calls, 2), span(bounds, 2), span(refs.data(), refs.size()), source, 0, 7, mapped.data(), culled);
+	ASSERT_EQ(truncated, 7u);
+	ASSERT_EQ(culled[0].instanceCount, 5u);
+	ASSERT_EQ(culled[1].instanceCount, 2u);
+	ASSERT_EQ(culled[1].firstInstance, 5u);
+}
+
+TEST(Culling, BatchedCullingMatchesSingleTests)
+{
+	const auto viewProj = ryujin::perspective(1.0f, 60.0f, 0.5f, 40.0f) * ryujin::look_direction(vec3(0.0f), vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, 1.0f, 0.0f));
+	const frustum f = ryujin::extract_frustum(viewProj);
+	const mesh_bounds bounds = {
+		.center = vec3(0.1f, 0.0f, -0.2f),
+		.extents = vec3(1.0f, 0.5f, 0.25f),
+		.radius = 1.15f
+	};
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> coord(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::uniform_real_distribution<float> size(0.2f, 3.0f);
+
+	std::vector<gpu_instance_data> instances(1003);
+	std::vector<u32> refs(instances.size());
+	std::vector<u32> expected;
+	for (u32 i = 0; i < instances.size(); ++i)
+	{
+		instances[i].transform = ryujin::transform(vec3(coord(rng), coord(rng), coord(rng)), quat(vec3(angle(rng), angle(rng), angle(rng))), vec3(size(rng), size(rng), size(rng)));
+		instances[i].material = i;
+		refs[i] = i;
+		if (ryujin::is_visible(f, bounds, instances[i].transform))
+		{
+			expected.push_back(i);
+		}
+	}
+
+	const gpu_indirect_call call = { .indexCount = 3, .instanceCount = static_cast<u32>(instances.size()), .firstIndex = 0, .vertexOffset = 0, .firstInstance = 0 };
+	std::vector<u32> mapped(instances.size());
+	gpu_indirect_call culled = {};
+	const auto written = ryujin::cull_instances(f, span(&call, 1), span(&bounds, 1), span(refs.data(), refs.size()), instance_source{ .statics = instances.data() },
+		0, mapped.size(), mapped.data(), &culled);
+
+	ASSERT_GT(expected.size(), 0u);
+	ASSERT_LT(expected.size(), instances.size());
+	ASSERT_EQ(written, expected.size());
+	ASSERT_EQ(culled.instanceCount, expected.size());
+	for (ryujin::sz i = 0; i < written; ++i)
+	{
+		ASSERT_EQ(mapped[i], expected[i]);
+	}
+}
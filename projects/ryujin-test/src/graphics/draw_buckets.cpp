@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/registry.hpp>
+#include <ryujin/graphics/draw_buckets.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+using ryujin::draw_bucket_table;
+using ryujin::gpu_indirect_call;
+using ryujin::mesh_bounds;
+using ryujin::u32;
+
+namespace
+{
+	using key = draw_bucket_table::bucket_key;
+
+	gpu_indirect_call mesh_call(const u32 mesh)
+	{
+		return { .indexCount = 3 * (mesh + 1), .instanceCount = 0, .firstIndex = 100 * mesh, .vertexOffset = static_cast<ryujin::i32>(10 * mesh), .firstInstance = 0 };
+	}
+
+	// instance references drawn by a call, in draw order
+	std::vector<u32> drawn(const draw_bucket_table& table, const gpu_indirect_call& call)
+	{
+		const auto refs = table.refs();
+		std::vector<u32> result;
+		for (u32 i = 0; i < call.instanceCount; ++i)
+		{
+			result.push_back(refs[call.firstInstance + i]);
+		}
+		return result;
+	}
+}
+
+TEST(DrawBuckets, DrawsAreOrderedByMeshGroup)
+{
+	draw_bucket_table table(2);
+	const mesh_bounds bounds = {};
+
+	// buckets are created out of group order and across both material types
+	table.add(0, 100, key{ .type = 0, .group = 2, .mesh = 5 }, mesh_call(5), bounds);
+	table.add(1, 101, key{ .type = 0, .group = 0, .mesh = 1 }, mesh_call(1), bounds);
+	table.add(2, 102, key{ .type = 1, .group = 1, .mesh = 3 }, mesh_call(3), bounds);
+	table.add(3, 103, key{ .type = 0, .group = 0, .mesh = 0 }, mesh_call(0), bounds);
+	table.add(4, 104, key{ .type = 0, .group = 2, .mesh = 5 }, mesh_call(5), bounds);
+	ASSERT_EQ(table.bucket_count(), 4u);
+
+	const auto opaque = table.calls(0);
+	ASSERT_EQ(opaque.length(), 3u);
+	ASSERT_EQ(opaque[0].firstIndex, 0u);
+	ASSERT_EQ(opaque[1].firstIndex, 100u);
+	ASSERT_EQ(opaque[2].firstIndex, 500u);
+	ASSERT_EQ(opaque[2].indexCount, 18u);
+	ASSERT_EQ(opaque[2].vertexOffset, 50);
+	ASSERT_EQ(drawn(table, opaque[2]), (std::vector<u32>{ 100, 104 }));
+
+	// counts are indexed by mesh group, groups without draws count zero
+	const auto counts = table.group_counts(0);
+	ASSERT_EQ(counts.length(), 3u);
+	ASSERT_EQ(counts[0], 2u);
+	ASSERT_EQ(counts[1], 0u);
+	ASSERT_EQ(counts[2], 1u);
+
+	const auto translucent = table.calls(1);
+	ASSERT_EQ(translucent.length(), 1u);
+	ASSERT_EQ(drawn(table, translucent[0]), (std::vector<u32>{ 102 }));
+	ASSERT_EQ(table.group_counts(1).length(), 2u);
+}
+
+TEST(DrawBuckets, AddAndRemoveOnlyTouchTheirOwnDraw)
+{
+	draw_bucket_table table(1);
+	const mesh_bounds bounds = {};
+	const key a = { .type = 0, .group = 0, .mesh = 0 };
+	const key b = { .type = 0, .group = 0, .mesh = 1 };
+
+	for (u32 i = 0; i < 4; ++i)
+	{
+		table.add(i, 10 + i, a, mesh_call(0), bounds);
+	}
+	table.add(4, 20, b, mesh_call(1), bounds);
+
+	const gpu_indirect_call before = table.calls(0)[1];
+	const auto refsBefore = table.refs().length();
+
+	// removing from the middle moves the last instance into the hole
+	ASSERT_TRUE(table.remove(1));
+	ASSERT_FALSE(table.remove(1));
+	ASSERT_FALSE(table.contains(1));
+	ASSERT_EQ(drawn(table, table.calls(0)[0]), (std::vector<u32>{ 10, 13, 12 }));
+
+	// the moved instance keeps a valid back pointer
+	ASSERT_TRUE(table.remove(3));
+	ASSERT_EQ(drawn(table, table.calls(0)[0]), (std::vector<u32>{ 10, 12 }));
+
+	table.add(5, 15, a, mesh_call(0), bounds);
+	ASSERT_EQ(drawn(table, table.calls(0)[0]), (std::vector<u32>{ 10, 12, 15 }));
+
+	const gpu_indirect_call after = table.calls(0)[1];
+	ASSERT_EQ(after.instanceCount, before.instanceCount);
+	ASSERT_EQ(after.firstInstance, before.firstInstance);
+	ASSERT_EQ(table.refs().length(), refsBefore);
+
+	// an emptied bucket keeps its draw, drawing nothing
+	ASSERT_TRUE(table.remove(4));
+	ASSERT_EQ(table.calls(0).length(), 2u);
+	ASSERT_EQ(table.calls(0)[1].instanceCount, 0u);
+}
+
+TEST(DrawBuckets, GrowingBucketsKeepTheirInstances)
+{
+	draw_bucket_table table(2);
+	const mesh_bounds bounds = {};
+	const key keys[] = {
+		{ .type = 0, .group = 0, .mesh = 0 },
+		{ .type = 0, .group = 1, .mesh = 1 },
+		{ .type = 1, .group = 0, .mesh = 2 }
+	};
+
+	std::mt19937 rng(9);
+	std::map<u32, u32> live; // entity -> bucket
+	u32 nextEntity = 0;
+	for (u32 step = 0; step < 5000; ++step)
+	{
+		if (live.empty() || rng() % 3 != 0)
+		{
+			const u32 bucket = rng() % 3;
+			table.add(nextEntity, nextEntity * 2, keys[bucket], mesh_call(keys[bucket].mesh), bounds);
+			live[nextEntity++] = bucket;
+		}
+		else
+		{
+			auto it = live.begin();
+			std::advance(it, rng() % live.size());
+			ASSERT_TRUE(table.remove(it->first));
+			live.erase(it);
+		}
+	}
+
+	std::vector<u32> expected[3];
+	for (const auto& [entity, bucket] : live)
+	{
+		expected[bucket].push_back(entity * 2);
+	}
+
+	const gpu_indirect_call calls[] = { table.calls(0)[0], table.calls(0)[1], table.calls(1)[0] };
+	for (u32 bucket = 0; bucket < 3; ++bucket)
+	{
+		auto refs = drawn(table, calls[bucket]);
+		std::sort(refs.begin(), refs.end());
+		ASSERT_EQ(refs, expected[bucket]);
+	}
+
+	// relocated ranges are reclaimed, the reference array stays within a small factor of the instances
+	ASSERT_LT(table.refs().length(), live.size() * 8);
+}
+
+TEST(DrawBuckets, DespawnedEntitiesLeaveTheirBucketsBeforeRespawning)
+{
+	using entity_type = ryujin::entity<std::uint32_t>;
+	ryujin::base_registry<entity_type> reg;
+	draw_bucket_table table(1);
+	const mesh_bounds bounds = {};
+
+	// mirrors the renderable manager, the component holds the mesh an entity is drawn with
+	reg.events().subscribe<ryujin::component_add_event<u32, entity_type>>([&](const auto& e) {
+		const u32 mesh = reg.get<u32>(e.entity);
+		table.add(e.entity.handle().identifier, 100 + mesh, key{ .type = 0, .group = 0, .mesh = mesh }, mesh_call(mesh), bounds);
+	});
+	reg.events().subscribe<ryujin::component_remove_event<u32, entity_type>>([&](const auto& e) {
+		table.remove(e.entity.handle().identifier);
+	});
+
+	auto despawned = reg.allocate().assign(u32(0));
+	auto kept = reg.allocate().assign(u32(0));
+	const u32 identifier = despawned.handle().identifier;
+	ASSERT_TRUE(table.contains(identifier));
+
+	reg.deallocate(despawned);
+	ASSERT_FALSE(table.contains(identifier));
+	ASSERT_EQ(drawn(table, table.calls(0)[0]), (std::vector<u32>{ 100 }));
+
+	// the recycled identifier is drawn once, by its new entity only
+	auto respawned = reg.allocate().assign(u32(1));
+	ASSERT_EQ(respawned.handle().identifier, identifier);
+	ASSERT_TRUE(table.contains(identifier));
+	ASSERT_EQ(drawn(table, table.calls(0)[0]), (std::vector<u32>{ 100 }));
+	ASSERT_EQ(drawn(table, table.calls(0)[1]), (std::vector<u32>{ 101 }));
+
+	reg.deallocate(respawned);
+	reg.deallocate(kept);
+	ASSERT_EQ(table.calls(0)[0].instanceCount, 0u);
+	ASSERT_EQ(table.calls(0)[1].instanceCount, 0u);
+}
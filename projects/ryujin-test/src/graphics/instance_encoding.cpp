@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/graphics/instance_encoding.hpp>
+#include <ryujin/math/transformations.hpp>
+
+#include <random>
+#include <vector>
+
+using ryujin::gpu_instance_data;
+using ryujin::instance_format;
+using ryujin::mat4;
+using ryujin::quat;
+using ryujin::u32;
+using ryujin::vec3;
+
+namespace
+{
+	std::vector<gpu_instance_data> random_instances(const u32 count)
+	{
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> coord(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> size(0.1f, 8.0f);
+
+		std::vector<gpu_instance_data> instances(count);
+		for (u32 i = 0; i < count; ++i)
+		{
+			instances[i].transform = ryujin::transform(vec3(coord(rng), coord(rng), coord(rng)), quat(vec3(angle(rng), angle(rng), angle(rng))), vec3(size(rng), size(rng), size(rng)));
+			instances[i].material = i * 7;
+		}
+		return instances;
+	}
+
+	// largest difference between the transformed corners of a unit cube, relative to the instance's scale
+	float corner_error(const mat4<float>& expected, const mat4<float>& actual)
+	{
+		float error = 0.0f;
+		for (u32 corner = 0; corner < 8; ++corner)
+		{
+			const auto p = ryujin::vec4((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f, 1.0f);
+			const auto a = expected * p;
+			const auto b = actual * p;
+			error = std::max({ error, std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z) });
+		}
+		return error;
+	}
+}
+
+TEST(InstanceEncoding, FormatsShrinkTheInstance)
+{
+	ASSERT_EQ(ryujin::instance_stride(instance_format::FULL), 80u);
+	ASSERT_EQ(ryujin::instance_stride(instance_format::AFFINE), 52u);
+	ASSERT_EQ(ryujin::instance_stride(instance_format::QUANTIZED), 32u);
+}
+
+TEST(InstanceEncoding, AffineIsExact)
+{
+	const auto instances = random_instances(64);
+	std::vector<unsigned char> encoded(instances.size() * ryujin::instance_stride(instance_format::AFFINE));
+	ryujin::encode_instances(instance_format::AFFINE, instances.data(), instances.size(), encoded.data());
+
+	for (u32 i = 0; i < instances.size(); ++i)
+	{
+		const auto decoded = ryujin::decode_instance(instance_format::AFFINE, encoded.data() + i * ryujin::instance_stride(instance_format::AFFINE));
+		ASSERT_EQ(decoded.material, instances[i].material);
+		for (u32 col = 0; col < 4; ++col)
+		{
+			for (u32 row = 0; row < 4; ++row)
+			{
+				ASSERT_EQ(decoded.transform[col][row], instances[i].transform[col][row]);
+			}
+		}
+	}
+}
+
+TEST(InstanceEncoding, QuantizedStaysCloseToTheMatrix)
+{
+	auto instances = random_instances(256);
+
+	// mirrored instances are carried by a negative scale
+	instances[3].transform = instances[3].transform * ryujin::scale(vec3(1.0f, -1.0f, 1.0f));
+
+	std::vector<unsigned char> encoded(instances.size() * ryujin::instance_stride(instance_format::QUANTIZED));
+	ryujin::encode_instances(instance_format::QUANTIZED, instances.data(), instances.size(), encoded.data());
+
+	for (u32 i = 0; i < instances.size(); ++i)
+	{
+		const auto decoded = ryujin::decode_instance(instance_format::QUANTIZED, encoded.data() + i * ryujin::instance_stride(instance_format::QUANTIZED));
+		ASSERT_EQ(decoded.material, instances[i].material);
+
+		// half float scale and snorm16 rotation keep corners within a small fraction of the instance size
+		const auto& m = instances[i].transform;
+		const float extent = std::max({ ryujin::norm(vec3(m[0][0], m[0][1], m[0][2])), ryujin::norm(vec3(m[1][0], m[1][1], m[1][2])), ryujin::norm(vec3(m[2][0], m[2][1], m[2][2])) });
+		ASSERT_LT(corner_error(m, decoded.transform), extent * 2e-3f) << "instance " << i;
+	}
+}
+
+TEST(InstanceEncoding, HalfFloatRoundTrip)
+{
+	for (const float value : { 0.0f, 1.0f, -2.5f, 0.1f, 1000.0f, 65504.0f, 6.1035156e-5f })
+	{
+		const float decoded = ryujin::inflate_to_float(ryujin::deflate_to_half(value));
+		ASSERT_NEAR(decoded, value, std::abs(value) * 1e-3f);
+	}
+
+	// values past the half range saturate instead of becoming infinite
+	ASSERT_EQ(ryujin::inflate_to_float(ryujin::deflate_to_half(1e6f)), 65504.0f);
+	ASSERT_EQ(ryujin::inflate_to_float(ryujin::deflate_to_half(-1e6f)), -65504.0f);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/graphics/instance_table.hpp>
+
+using ryujin::gpu_instance_data;
+using ryujin::instance_table;
+using ryujin::u32;
+
+namespace
+{
+	gpu_instance_data instance_with(const u32 material)
+	{
+		gpu_instance_data instance = {};
+		instance.material = material;
+		return instance;
+	}
+}
+
+TEST(InstanceTable, ReleasedSlotsAreReused)
+{
+	instance_table table;
+	const u32 a = table.allocate(instance_with(1));
+	const u32 b = table.allocate(instance_with(2));
+	const u32 c = table.allocate(instance_with(3));
+	ASSERT_EQ(a, 0u);
+	ASSERT_EQ(b, 1u);
+	ASSERT_EQ(c, 2u);
+
+	table.release(b);
+	ASSERT_EQ(table.live(), 2u);
+	ASSERT_EQ(table.size(), 3u);
+
+	// the freed slot is handed out before the table grows
+	const u32 d = table.allocate(instance_with(4));
+	ASSERT_EQ(d, b);
+	ASSERT_EQ(table[d].material, 4u);
+	ASSERT_EQ(table.size(), 3u);
+	ASSERT_EQ(table.allocate(instance_with(5)), 3u);
+}
+
+TEST(InstanceTable, FlushMergesAdjacentSlots)
+{
+	instance_table table;
+	for (u32 i = 0; i < 8; ++i)
+	{
+		table.allocate(instance_with(i));
+	}
+
+	const auto initial = table.flush(0);
+	ASSERT_EQ(initial.length(), 1u);
+	ASSERT_EQ(initial[0].first, 0u);
+	ASSERT_EQ(initial[0].count, 8u);
+	ASSERT_EQ(table.flush(0).length(), 0u);
+
+	// updates in any order, repeated updates are listed once
+	table.update(6, instance_with(60));
+	table.update(2, instance_with(20));
+	table.update(3, instance_with(30));
+	table.update(2, instance_with(21));
+	table.update(7, instance_with(70));
+
+	const auto ranges = table.flush(0);
+	ASSERT_EQ(ranges.length(), 2u);
+	ASSERT_EQ(ranges[0].first, 2u);
+	ASSERT_EQ(ranges[0].count, 2u);
+	ASSERT_EQ(ranges[1].first, 6u);
+	ASSERT_EQ(ranges[1].count, 2u);
+	ASSERT_EQ(table[2].material, 21u);
+}
+
+TEST(InstanceTable, EveryFrameSeesEachChangeOnce)
+{
+	instance_table table(3);
+	ASSERT_EQ(table.frames(), 3u);
+	for (u32 i = 0; i < 4; ++i)
+	{
+		table.allocate(instance_with(i));
+	}
+	for (u32 frame = 0; frame < 3; ++frame)
+	{
+		table.flush(frame);
+	}
+
+	table.update(1, instance_with(10));
+
+	// frame 0 is written right away, the other frames catch up when they are next written
+	const auto first = table.flush(0);
+	ASSERT_EQ(first.length(), 1u);
+	ASSERT_EQ(first[0].first, 1u);
+	ASSERT_EQ(first[0].count, 1u);
+	ASSERT_EQ(table.flush(0).length(), 0u);
+
+	table.update(3, instance_with(30));
+	for (u32 frame = 1; frame < 3; ++frame)
+	{
+		const auto ranges = table.flush(frame);
+		ASSERT_EQ(ranges.length(), 2u);
+		ASSERT_EQ(ranges[0].first, 1u);
+		ASSERT_EQ(ranges[0].count, 1u);
+		ASSERT_EQ(ranges[1].first, 3u);
+		ASSERT_EQ(ranges[1].count, 1u);
+	}
+
+	const auto last = table.flush(0);
+	ASSERT_EQ(last.length(), 1u);
+	ASSERT_EQ(last[0].first, 3u);
+}
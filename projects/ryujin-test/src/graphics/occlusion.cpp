@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/core/system_scheduler.hpp>
+#include <ryujin/graphics/occlusion.hpp>
+#include <ryujin/math/transformations.hpp>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+using ryujin::gpu_indirect_call;
+using ryujin::gpu_instance_data;
+using ryujin::mat4;
+using ryujin::mesh_bounds;
+using ryujin::occlusion_buffer;
+using ryujin::quat;
+using ryujin::span;
+using ryujin::u32;
+using ryujin::vec3;
+using ryujin::vec4;
+
+namespace
+{
+	// unit quad in the xy plane facing the camera
+	const vec3<float> quad_positions[] = {
+		vec3(-1.0f, -1.0f, 0.0f),
+		vec3(1.0f, -1.0f, 0.0f),
+		vec3(1.0f, 1.0f, 0.0f),
+		vec3(-1.0f, 1.0f, 0.0f)
+	};
+	const u32 quad_indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	const mesh_bounds unit_box = {
+		.center = vec3(0.0f),
+		.extents = vec3(0.5f),
+		.radius = 0.87f
+	};
+
+	mat4<float> camera()
+	{
+		return ryujin::perspective(16.0f / 9.0f, 70.0f, 0.1f, 100.0f) * ryujin::look_direction(vec3(0.0f), vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	mat4<float> wall_at(const float z, const float halfSize)
+	{
+		return ryujin::transform(vec3(0.0f, 0.0f, z), quat(vec3(0.0f)), vec3(halfSize, halfSize, 1.0f));
+	}
+}
+
+TEST(Occlusion, WallHidesBoxesBehindIt)
+{
+	occlusion_buffer buffer(256, 144);
+	const auto viewProj = camera();
+	buffer.begin(viewProj);
+	buffer.add_occluder(span(quad_positions, 4), span(quad_indices, 6), wall_at(10.0f, 5.0f));
+	buffer.rasterize();
+
+	// the wall faces the camera, its depth is the same at every covered pixel
+	const vec4<float> wallClip = viewProj * vec4(0.0f, 0.0f, 10.0f, 1.0f);
+	ASSERT_NEAR(buffer.depth(buffer.width() / 2, buffer.height() / 2), wallClip.z / wallClip.w, 1e-5f);
+	ASSERT_EQ(buffer.depth(0, 0), std::numeric_limits<float>::max());
+
+	ASSERT_FALSE(buffer.is_visible(unit_box, ryujin::translate(vec3(0.0f, 0.0f, 20.0f))));
+	ASSERT_FALSE(buffer.is_visible(unit_box, ryujin::translate(vec3(5.0f, 0.0f, 20.0f))));
+	ASSERT_TRUE(buffer.is_visible(unit_box, ryujin::translate(vec3(0.0f, 0.0f, 5.0f))));
+	ASSERT_TRUE(buffer.is_visible(unit_box, ryujin::translate(vec3(12.0f, 0.0f, 20.0f))));
+
+	// a box passing through the wall is nearer than it at some pixels
+	ASSERT_TRUE(buffer.is_visible(unit_box, ryujin::translate(vec3(0.0f, 0.0f, 10.2f))));
+
+	// a box reaching behind the camera cannot be tested and is kept
+	ASSERT_TRUE(buffer.is_visible(unit_box, ryujin::translate(vec3(0.0f, 0.0f, 0.2f))));
+
+	// begin clears the previous occluders
+	buffer.begin(viewProj);
+	buffer.rasterize();
+	ASSERT_TRUE(buffer.is_visible(unit_box, ryujin::translate(vec3(0.0f, 0.0f, 20.0f))));
+}
+
+TEST(Occlusion, TrianglesBehindTheCameraAreSkipped)
+{
+	occlusion_buffer buffer(64, 32);
+	buffer.begin(camera());
+	buffer.add_occluder(span(quad_positions, 4), span(quad_indices, 6), wall_at(-5.0f, 5.0f));
+	buffer.add_occluder(span(quad_positions, 4), span(quad_indices, 6), wall_at(0.0f, 50.0f));
+	buffer.rasterize();
+
+	for (u32 y = 0; y < buffer.height(); ++y)
+	{
+		for (u32 x = 0; x < buffer.width(); ++x)
+		{
+			ASSERT_EQ(buffer.depth(x, y), std::numeric_limits<float>::max());
+		}
+	}
+}
+
+TEST(Occlusion, ResultDoesNotDependOnWorkerCount)
+{
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> lateral(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> depth(2.0f, 60.0f);
+
+	// enough triangles to split the setup across several jobs
+	std::vector<vec3<float>> positions;
+	std::vector<u32> indices;
+	for (u32 i = 0; i < 1500; ++i)
+	{
+		const float z = depth(rng);
+		for (u32 v = 0; v < 3; ++v)
+		{
+			positions.push_back(vec3(lateral(rng), lateral(rng), z + lateral(rng) * 0.05f));
+			indices.push_back(static_cast<u32>(positions.size() - 1));
+		}
+	}
+
+	ryujin::system_scheduler scheduler(3);
+	occlusion_buffer serial(200, 100);
+	occlusion_buffer parallel(200, 100, &scheduler);
+	ASSERT_EQ(serial.width(), 200u);
+	ASSERT_EQ(parallel.worker_count(), 3u);
+
+	const auto identity = mat4<float>(1.0f);
+	for (occlusion_buffer* buffer : { &serial, &parallel })
+	{
+		buffer->begin(camera());
+		buffer->add_occluder(span(positions.data(), positions.size()), span(indices.data(), indices.size()), identity);
+		buffer->add_occluder(span(quad_positions, 4), span(quad_indices, 6), wall_at(40.0f, 10.0f));
+		buffer->rasterize();
+	}
+
+	u32 covered = 0;
+	for (u32 y = 0; y < serial.height(); ++y)
+	{
+		for (u32 x = 0; x < serial.width(); ++x)
+		{
+			ASSERT_EQ(serial.depth(x, y), parallel.depth(x, y));
+			covered += serial.depth(x, y) < std::numeric_limits<float>::max();
+		}
+	}
+	ASSERT_GT(covered, 0u);
+}
+
+TEST(Occlusion, CullInstancesDropsOccludedInstances)
+{
+	ryujin::system_scheduler scheduler(1);
+	occlusion_buffer buffer(128, 72, &scheduler);
+	const auto viewProj = camera();
+	buffer.begin(viewProj);
+	buffer.add_occluder(span(quad_positions, 4), span(quad_indices, 6), wall_at(10.0f, 5.0f));
+	buffer.rasterize();
+
+	// instances alternate between in front of and behind the wall
+	std::vector<gpu_instance_data> instances(8);
+	std::vector<u32> refs(instances.size());
+	for (u32 i = 0; i < instances.size(); ++i)
+	{
+		instances[i].transform = ryujin::translate(vec3(0.0f, 0.0f, i % 2 == 0 ? 5.0f : 20.0f));
+		refs[i] = i;
+	}
+
+	const gpu_indirect_call call = { .indexCount = 3, .instanceCount = 8, .firstIndex = 0, .vertexOffset = 0, .firstInstance = 0 };
+	const ryujin::instance_source source = { .statics = instances.data() };
+	std::vector<u32> mapped(instances.size());
+	gpu_indirect_call culled = {};
+
+	const auto frustumOnly = ryujin::cull_instances(ryujin::extract_frustum(viewProj), span(&call, 1), span(&unit_box, 1), span(refs.data(), refs.size()),
+		source, 0, mapped.size(), mapped.data(), &culled);
+	ASSERT_EQ(frustumOnly, 8u);
+
+	const auto written = ryujin::cull_instances(ryujin::extract_frustum(viewProj), span(&call, 1), span(&unit_box, 1), span(refs.data(), refs.size()),
+		source, 0, mapped.size(), mapped.data(), &culled, &buffer);
+	ASSERT_EQ(written, 4u);
+	ASSERT_EQ(culled.instanceCount, 4u);
+	for (u32 i = 0; i < written; ++i)
+	{
+		ASSERT_EQ(mapped[i], i * 2);
+	}
+}
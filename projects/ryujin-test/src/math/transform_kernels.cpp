@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <ryujin/entities/transform_storage.hpp>
+#include <ryujin/math/transform_kernels.hpp>
+#include <ryujin/math/transformations.hpp>
+
+#include <vector>
+
+using ryujin::mat4;
+using ryujin::quat;
+using ryujin::span;
+using ryujin::transform_storage;
+using ryujin::vec3;
+
+namespace
+{
+    void expect_matrix_near(const mat4<float>& actual, const mat4<float>& expected)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            ASSERT_NEAR(actual.data[i], expected.data[i], 1e-5f);
+        }
+    }
+}
+
+TEST(TransformKernels, ComposeMatchesScalarTransform)
+{
+    // 11 exercises both the four wide path and the scalar tail
+    constexpr std::size_t count = 11;
+    std::vector<vec3<float>> positions;
+    std::vector<quat<float>> rotations;
+    std::vector<vec3<float>> scales;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float f = static_cast<float>(i);
+        positions.push_back(vec3(f, -2.0f * f, 0.5f * f));
+        rotations.push_back(quat(vec3(0.1f * f, 0.2f * f, -0.3f * f)));
+        scales.push_back(vec3(1.0f + f, 2.0f, 0.5f + 0.25f * f));
+    }
+
+    std::vector<mat4<float>> out(count);
+    ryujin::compose_transforms(span<vec3<float>>(positions.data(), count), span<quat<float>>(rotations.data(), count),
+        span<vec3<float>>(scales.data(), count), out.data());
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        expect_matrix_near(out[i], ryujin::transform(positions[i], rotations[i], scales[i]));
+    }
+}
+
+TEST(TransformStorage, ComposesOnlyDirtyTransforms)
+{
+    transform_storage storage;
+    for (std::size_t i = 0; i < 130; ++i)
+    {
+        storage.push_back(vec3(static_cast<float>(i), 0.0f, 0.0f), quat<float>(), vec3(1.0f));
+    }
+
+    ASSERT_EQ(storage.dirty_count(), 130);
+    ASSERT_EQ(storage.compose(), 130);
+    ASSERT_EQ(storage.dirty_count(), 0);
+    ASSERT_FLOAT_EQ(storage.matrix(129)[3][0], 129.0f);
+
+    storage.set_position(3, vec3(-1.0f, 0.0f, 0.0f));
+    storage.set_scale(64, vec3(2.0f));
+    storage.set_position(64, vec3(-2.0f, 0.0f, 0.0f));
+    storage.set_rotation(65, quat(vec3(0.0f, 1.0f, 0.0f)));
+
+    ASSERT_EQ(storage.compose(), 3);
+    ASSERT_FLOAT_EQ(storage.matrix(3)[3][0], -1.0f);
+    ASSERT_FLOAT_EQ(storage.matrix(64)[3][0], -2.0f);
+    ASSERT_FLOAT_EQ(storage.matrix(64)[0][0], 2.0f);
+    expect_matrix_near(storage.matrix(65), ryujin::transform(vec3(65.0f, 0.0f, 0.0f), quat(vec3(0.0f, 1.0f, 0.0f)), vec3(1.0f)));
+    ASSERT_FLOAT_EQ(storage.matrix(4)[3][0], 4.0f);
+}
+
+TEST(TransformStorage, SwapRemoveKeepsDirtyState)
+{
+    transform_storage storage;
+    storage.push_back(vec3(0.0f), quat<float>(), vec3(1.0f));
+    storage.push_back(vec3(1.0f), quat<float>(), vec3(1.0f));
+    storage.push_back(vec3(2.0f), quat<float>(), vec3(1.0f));
+    storage.compose();
+
+    storage.set_position(2, vec3(5.0f));
+    ASSERT_EQ(storage.swap_remove(0), 2);
+    ASSERT_EQ(storage.size(), 2);
+    ASSERT_EQ(storage.dirty_count(), 1);
+
+    ASSERT_EQ(storage.compose(), 1);
+    ASSERT_FLOAT_EQ(storage.matrix(0)[3][0], 5.0f);
+    ASSERT_EQ(storage.swap_remove(1), 1);
+}
@@ -26,6 +26,20 @@ void decode_tbn_quaternion(vec4 encodedTbn, out vec3 normal, out vec3 tangent, o
     bitangent = sign(encodedTbn.w) * binorm;
 }
 
+mat3 quat_to_mat3(const vec4 q)
+{
+    vec3 q2 = q.xyz * 2.0;
+    vec3 qq = q.xyz * q2;
+    float xy = q.x * q2.y;
+    float xz = q.x * q2.z;
+    float yz = q.y * q2.z;
+    vec3 w = q.w * q2;
+    return mat3(
+        vec3(1.0 - qq.y - qq.z, xy + w.z, xz - w.y),
+        vec3(xy - w.z, 1.0 - qq.x - qq.z, yz + w.x),
+        vec3(xz + w.y, yz - w.x, 1.0 - qq.x - qq.y));
+}
+
 float unPremultLinearToSRGB(float c)
 {
     if (c < 0.0031308f)
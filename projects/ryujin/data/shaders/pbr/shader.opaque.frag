@@ -11,7 +11,7 @@ layout (location = 0) in VS_OUT
     vec3 normal;
     vec3 tangent;
     vec3 bitangent;
-    flat int instanceID;
+    flat uint materialID;
 } fs_in;
 
 layout (set = 0, binding = 0) uniform Camera
@@ -25,11 +25,6 @@ layout (set = 0, binding = 1) buffer SceneData
     uint texturesLoaded;
 };
 
-layout (std430, set = 1, binding = 0) buffer Instances
-{
-    instance_data instances[MAX_INSTANCE_COUNT];
-};
-
 layout (std430, set = 1, binding = 1) buffer Materials
 {
     material materials[MAX_MATERIAL_COUNT];
@@ -44,7 +39,7 @@ layout (push_constant) uniform constants
 
 vec3 get_normal_from_map()
 {
-    uint matId = instances[fs_in.instanceID].material;
+    uint matId = fs_in.materialID;
     material mat = materials[matId];
     if (mat.normal >= texturesLoaded)
     {
@@ -117,7 +112,7 @@ float get_ao(uint id)
 
 void main(void)
 {
-    uint matId = instances[fs_in.instanceID].material;
+    uint matId = fs_in.materialID;
     material mat = materials[matId];
 
     if (mat.albedo >= texturesLoaded)
@@ -14,7 +14,7 @@ layout (location = 0) out VS_OUT
     vec3 normal;
     vec3 tangent;
     vec3 bitangent;
-    flat int instanceID;
+    flat uint materialID;
 } vs_out;
 
 layout (set = 0, binding = 0) uniform Camera
@@ -22,9 +22,21 @@ layout (set = 0, binding = 0) uniform Camera
     scene_camera cameras[MAX_CAMERA_COUNT];
 };
 
-layout (set = 1, binding = 0) buffer Instances
+// instances are stored as raw words, laid out according to INSTANCE_FORMAT
+layout (std430, set = 1, binding = 0) readonly buffer StaticInstances
 {
-    instance_data instances[MAX_INSTANCE_COUNT];
+    uint staticInstances[];
+};
+
+layout (std430, set = 1, binding = 3) readonly buffer DynamicInstances
+{
+    uint dynamicInstances[];
+};
+
+// culled instance references, selecting a slot of the static or dynamic instance buffer
+layout (std430, set = 1, binding = 4) readonly buffer VisibleInstances
+{
+    uint visibleInstances[MAX_INSTANCE_COUNT];
 };
 
 layout (push_constant) uniform constants
@@ -32,11 +44,67 @@ layout (push_constant) uniform constants
     uint activeCamera;
 };
 
+uint instance_word(const bool dynamicInstance, const uint index)
+{
+    return dynamicInstance ? dynamicInstances[index] : staticInstances[index];
+}
+
+float instance_float(const bool dynamicInstance, const uint index)
+{
+    return uintBitsToFloat(instance_word(dynamicInstance, index));
+}
+
+instance_data load_instance(const uint ref)
+{
+    const bool dynamicInstance = (ref & DYNAMIC_INSTANCE_BIT) != 0;
+    const uint base = (ref & ~DYNAMIC_INSTANCE_BIT) * INSTANCE_STRIDE;
+
+    instance_data instance;
+    instance.parent = 0;
+    instance.pad0 = 0;
+    instance.pad1 = 0;
+
+    if (INSTANCE_FORMAT == INSTANCE_FORMAT_AFFINE)
+    {
+        // upper three rows of the matrix, row major
+        vec4 rows[3];
+        for (uint r = 0; r < 3; ++r)
+        {
+            const uint at = base + r * 4;
+            rows[r] = vec4(instance_float(dynamicInstance, at), instance_float(dynamicInstance, at + 1), instance_float(dynamicInstance, at + 2), instance_float(dynamicInstance, at + 3));
+        }
+        instance.transform = transpose(mat4(rows[0], rows[1], rows[2], vec4(0, 0, 0, 1)));
+        instance.material = instance_word(dynamicInstance, base + 12);
+    }
+    else if (INSTANCE_FORMAT == INSTANCE_FORMAT_QUANTIZED)
+    {
+        // translation, snorm16 rotation quaternion and half float scale
+        const vec3 translation = vec3(instance_float(dynamicInstance, base), instance_float(dynamicInstance, base + 1), instance_float(dynamicInstance, base + 2));
+        const vec4 rotation = vec4(unpackSnorm2x16(instance_word(dynamicInstance, base + 3)), unpackSnorm2x16(instance_word(dynamicInstance, base + 4)));
+        const vec3 scale = vec3(unpackHalf2x16(instance_word(dynamicInstance, base + 5)), unpackHalf2x16(instance_word(dynamicInstance, base + 6)).x);
+        const mat3 basis = quat_to_mat3(normalize(rotation));
+        instance.transform = mat4(vec4(basis[0] * scale.x, 0), vec4(basis[1] * scale.y, 0), vec4(basis[2] * scale.z, 0), vec4(translation, 1));
+        instance.material = instance_word(dynamicInstance, base + 7);
+    }
+    else
+    {
+        for (uint c = 0; c < 4; ++c)
+        {
+            const uint at = base + c * 4;
+            instance.transform[c] = vec4(instance_float(dynamicInstance, at), instance_float(dynamicInstance, at + 1), instance_float(dynamicInstance, at + 2), instance_float(dynamicInstance, at + 3));
+        }
+        instance.material = instance_word(dynamicInstance, base + 16);
+        instance.parent = instance_word(dynamicInstance, base + 17);
+    }
+
+    return instance;
+}
+
 void main(void)
 {
     scene_camera camera = cameras[activeCamera];
 
-    instance_data instance = instances[gl_InstanceIndex];
+    instance_data instance = load_instance(visibleInstances[gl_InstanceIndex]);
     mat4 mvp = camera.viewProj * instance.transform;
     vec4 worldPos = mvp * vec4(position, 1);
     gl_Position = worldPos;
@@ -44,5 +112,5 @@ void main(void)
     vs_out.texcoord0 = texcoord0;
     decode_tbn_quaternion(encodedTbn, vs_out.normal, vs_out.tangent, vs_out.bitangent);
     vs_out.normal = mat3(transpose(inverse(instance.transform))) * vs_out.normal;
-    vs_out.instanceID = gl_InstanceIndex;
+    vs_out.materialID = instance.material;
 }
\ No newline at end of file
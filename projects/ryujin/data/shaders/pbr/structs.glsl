@@ -8,6 +8,17 @@ layout (constant_id = 3) const uint MAX_POINT_LIGHT_COUNT = 512;
 layout (constant_id = 4) const uint MAX_SPOT_LIGHT_COUNT = 512;
 layout (constant_id = 5) const uint MAX_CAMERA_COUNT = 32;
 
+layout (constant_id = 6) const uint INSTANCE_FORMAT = 0;
+
+const uint INSTANCE_FORMAT_FULL = 0;
+const uint INSTANCE_FORMAT_AFFINE = 1;
+const uint INSTANCE_FORMAT_QUANTIZED = 2;
+
+// size of one instance in 32 bit words, see gpu_instance_data, gpu_affine_instance_data and gpu_quantized_instance_data
+const uint INSTANCE_STRIDE = INSTANCE_FORMAT == INSTANCE_FORMAT_AFFINE ? 13 : (INSTANCE_FORMAT == INSTANCE_FORMAT_QUANTIZED ? 8 : 20);
+
+const uint DYNAMIC_INSTANCE_BIT = 0x80000000u;
+
 struct material
 {
     uint albedo;
@@ -3,9 +3,12 @@
 
 #include "assets.hpp"
 #include "memory.hpp"
+#include "system_scheduler.hpp"
 #include "unordered_map.hpp"
 
+#include "../entities/command_buffer.hpp"
 #include "../entities/registry.hpp"
+#include "../entities/transform_system.hpp"
 #include "../graphics/window.hpp"
 #include "../graphics/render_system.hpp"
 
@@ -122,6 +125,20 @@ namespace ryujin
         /// <returns>Engine entity registry</returns>
         registry& get_registry() noexcept;
 
+        /// <summary>
+        /// Gets a reference to the engine's deferred registry command queue.  Each thread records into its own
+        /// buffer, and all buffers are applied to the registry after the application's frame logic completes.
+        /// </summary>
+        /// <returns>Engine registry command queue</returns>
+        registry_command_queue& get_command_queue() noexcept;
+
+        /// <summary>
+        /// Gets a reference to the engine's system scheduler.  Registered systems execute on worker threads after
+        /// the application's frame logic, before the registry command queue is applied.
+        /// </summary>
+        /// <returns>Engine system scheduler</returns>
+        system_scheduler& get_scheduler() noexcept;
+
         /// <summary>
         /// Gets a reference to the engine's assset manager.
         /// </summary>
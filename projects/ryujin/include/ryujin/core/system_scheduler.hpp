@@ -0,0 +1,204 @@
+#ifndef system_scheduler_hpp__
+#define system_scheduler_hpp__
+
+#include "export.hpp"
+#include "functional.hpp"
+#include "primitives.hpp"
+#include "string.hpp"
+#include "type_traits.hpp"
+#include "vector.hpp"
+
+#include "../entities/registry.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace ryujin
+{
+    /// <summary>
+    /// Declares the component types a system reads.
+    /// </summary>
+    template <typename ... Ts>
+    struct reads {};
+
+    /// <summary>
+    /// Declares the component types a system writes.
+    /// </summary>
+    template <typename ... Ts>
+    struct writes {};
+
+    /// <summary>
+    /// Runs registered systems each frame.  Every system declares the components it reads and writes, and systems
+    /// whose accesses do not conflict run in parallel on the scheduler's worker threads.  Conflicting systems run in
+    /// registration order.  Systems must not create or destroy entities or add or remove components directly;
+    /// structural changes should be recorded into the engine's command queue.
+    ///
+    /// The worker threads also run data parallel tasks submitted through parallel_for, so that engine code splitting
+    /// work across threads shares one persistent pool.
+    /// </summary>
+    class system_scheduler
+    {
+    public:
+        using system_fn = move_only_function<void(registry&)>;
+        using system_id = sz;
+
+        /// <summary>
+        /// Constructs a scheduler.
+        /// </summary>
+        /// <param name="workerCount">Number of worker threads in addition to the calling thread.  Defaults to one
+        /// less than the hardware concurrency.</param>
+        RYUJIN_API explicit system_scheduler(const sz workerCount = ~sz(0));
+
+        /// <summary>
+        /// Stops and joins all worker threads.
+        /// </summary>
+        RYUJIN_API ~system_scheduler();
+
+        system_scheduler(const system_scheduler&) = delete;
+        system_scheduler(system_scheduler&&) noexcept = delete;
+        system_scheduler& operator=(const system_scheduler&) = delete;
+        system_scheduler& operator=(system_scheduler&&) noexcept = delete;
+
+        /// <summary>
+        /// Registers a system with declared component access.
+        /// </summary>
+        /// <param name="name">Name of the system, used for timings</param>
+        /// <param name="fn">Function executing the system</param>
+        /// <returns>Identifier of the system</returns>
+        template <typename ... Rs, typename ... Ws, typename Fn>
+        system_id add_system(const string& name, reads<Rs...>, writes<Ws...>, Fn&& fn);
+
+        /// <summary>
+        /// Registers a system that conflicts with every other system.  Exclusive systems run alone, in
+        /// registration order.
+        /// </summary>
+        /// <param name="name">Name of the system, used for timings</param>
+        /// <param name="fn">Function executing the system</param>
+        /// <returns>Identifier of the system</returns>
+        RYUJIN_API system_id add_exclusive_system(const string& name, system_fn&& fn);
+
+        RYUJIN_API void set_enabled(const system_id id, const bool enabled) noexcept;
+        RYUJIN_API bool is_enabled(const system_id id) const noexcept;
+
+        /// <summary>
+        /// Builds the dependency graph of all enabled systems and executes them.  Returns once every system has
+        /// completed.
+        /// </summary>
+        /// <param name="reg">Registry passed to each system</param>
+        RYUJIN_API void execute(registry& reg);
+
+        /// <summary>
+        /// Invokes fn(index) for every index in [0, count) across the worker threads and the calling thread.  Returns
+        /// once every invocation has completed.  May be called from any thread, including from inside a running
+        /// system or while execute runs on another thread.
+        /// </summary>
+        /// <param name="count">Number of indices</param>
+        /// <param name="fn">Function invoked once per index, concurrently with itself</param>
+        template <typename Fn>
+        void parallel_for(const sz count, Fn&& fn);
+
+        RYUJIN_API sz system_count() const noexcept;
+        RYUJIN_API sz worker_count() const noexcept;
+        RYUJIN_API const string& name(const system_id id) const noexcept;
+
+        /// <summary>
+        /// Gets the time the system took in the last call to execute.
+        /// </summary>
+        /// <param name="id">Identifier of the system</param>
+        /// <returns>Time in seconds, zero if the system did not run</returns>
+        RYUJIN_API f64 last_duration(const system_id id) const noexcept;
+
+        /// <summary>
+        /// Gets the wall time of the last call to execute.
+        /// </summary>
+        /// <returns>Time in seconds</returns>
+        RYUJIN_API f64 last_frame_duration() const noexcept;
+
+    private:
+        struct system
+        {
+            string name;
+            system_fn fn;
+            void (*prepare)(registry&);
+            vector<sz> reads; // component identifiers, sorted on registration
+            vector<sz> writes; // component identifiers, sorted on registration
+            bool exclusive;
+            bool enabled;
+            f64 duration;
+        };
+
+        vector<system> _systems;
+
+        // per frame dependency graph, rebuilt on each execute
+        vector<sz> _dependentOffsets;
+        vector<sz> _dependents;
+        vector<sz> _pending;
+        vector<sz> _ready;
+        sz _scheduled = 0;
+        sz _completed = 0;
+        registry* _registry = nullptr;
+        f64 _frameDuration = 0.0;
+
+        struct task_batch
+        {
+            void (*invoke)(void*, const sz);
+            void* context;
+            sz count;
+            sz next; // next index to hand out
+            sz completed;
+        };
+
+        // batches with indices left to hand out, the most recently submitted last
+        vector<task_batch*> _batches;
+
+        vector<std::thread> _workers;
+        std::mutex _lock;
+        std::condition_variable _signal;
+        bool _stop = false;
+
+        system_id _addSystem(const string& name, system_fn&& fn, void (*prepare)(registry&), vector<sz>&& reads, vector<sz>&& writes, const bool exclusive);
+        bool _conflicts(const system& a, const system& b) const noexcept;
+        void _buildGraph();
+        void _workerLoop();
+        void _run(const sz idx);
+        void _complete(const sz idx);
+        RYUJIN_API void _runBatch(task_batch& batch);
+        bool _runTask(std::unique_lock<std::mutex>& guard);
+
+        template <typename ... Ts>
+        static vector<sz> _identifiers();
+    };
+
+    template <typename ... Rs, typename ... Ws, typename Fn>
+    inline system_scheduler::system_id system_scheduler::add_system(const string& name, reads<Rs...>, writes<Ws...>, Fn&& fn)
+    {
+        return _addSystem(name, system_fn(ryujin::forward<Fn>(fn)), [](registry& reg) { reg.register_components<Rs..., Ws...>(); },
+            _identifiers<Rs...>(), _identifiers<Ws...>(), false);
+    }
+
+    template <typename Fn>
+    inline void system_scheduler::parallel_for(const sz count, Fn&& fn)
+    {
+        using fn_type = remove_reference_t<Fn>;
+
+        task_batch batch = {
+            .invoke = [](void* context, const sz index) { (*reinterpret_cast<fn_type*>(context))(index); },
+            .context = const_cast<void*>(reinterpret_cast<const void*>(&fn)),
+            .count = count,
+            .next = 0,
+            .completed = 0
+        };
+        _runBatch(batch);
+    }
+
+    template <typename ... Ts>
+    inline vector<sz> system_scheduler::_identifiers()
+    {
+        vector<sz> ids;
+        (ids.push_back(detail::component_identifier_utility::fetch_identifier<Ts>()), ...);
+        return ids;
+    }
+}
+
+#endif // system_scheduler_hpp__
@@ -48,9 +48,11 @@ namespace ryujin
 
         constexpr void resize(const sz newSize, const Type& value = Type());
         constexpr void reserve(const sz newCapacity);
+        constexpr void shrink_to_fit();
 
         constexpr void insert(const_iterator pos, const Type& value);
         constexpr void insert(const_iterator pos, Type&& value);
+        constexpr void insert(const_iterator pos, const Type* first, const Type* last);
         constexpr void push_back(const Type& value);
         constexpr void push_back(Type&& value);
 
@@ -197,7 +199,7 @@ namespace ryujin
     inline constexpr vector<Type, Allocator>::vector(const sz count, const Type& value)
     {
         _resize_buffer(count);
-        for (sz i = 0; i < _size; ++i)
+        for (sz i = 0; i < count; ++i)
         {
             ryujin::construct_at(_data + i, value);
         }
@@ -246,6 +248,10 @@ namespace ryujin
         }
 
         clear();
+        if (_capacity)
+        {
+            _alloc.deallocate(_data, _capacity);
+        }
 
         _data = rhs._data;
         _size = rhs._size;
@@ -364,17 +370,21 @@ namespace ryujin
     template<typename Type, typename Allocator>
     void constexpr vector<Type, Allocator>::pop_back()
     {
-        erase(end());
+        ryujin::destroy_at(_data + _size - 1);
+        --_size;
     }
 
     template<typename Type, typename Allocator>
     inline constexpr void vector<Type, Allocator>::resize(const sz newSize, const Type& value)
     {
-        if (newSize <= _capacity)
+        while (_size > newSize)
         {
-            return;
+            pop_back();
+        }
+        if (newSize > _capacity)
+        {
+            _resize_buffer(newSize);
         }
-        _resize_buffer(newSize);
         for (sz i = _size; i < newSize; ++i)
         {
             ryujin::construct_at(_data + i, value);
@@ -392,6 +402,24 @@ namespace ryujin
         _resize_buffer(newCapacity);
     }
 
+    template<typename Type, typename Allocator>
+    inline constexpr void vector<Type, Allocator>::shrink_to_fit()
+    {
+        if (_size == _capacity)
+        {
+            return;
+        }
+
+        if (_size == 0)
+        {
+            _alloc.deallocate(_data, _capacity);
+            _data = nullptr;
+            _capacity = 0;
+            return;
+        }
+        _resize_buffer(_size);
+    }
+
     template<typename Type, typename Allocator>
     inline constexpr void vector<Type, Allocator>::insert(const_iterator pos, const Type& value)
     {
@@ -418,6 +446,37 @@ namespace ryujin
         ++_size;
     }
 
+    template<typename Type, typename Allocator>
+    inline constexpr void vector<Type, Allocator>::insert(const_iterator pos, const Type* first, const Type* last)
+    {
+        const sz idx = pos - _data;
+        const sz count = last - first;
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (_size + count > _capacity)
+        {
+            const sz grown = _capacity * 2;
+            _resize_buffer(grown > _size + count ? grown : _size + count);
+        }
+        _make_hole(idx, count);
+
+        if constexpr (is_trivially_copyable_v<Type>)
+        {
+            ryujin::memcpy(_data + idx, first, count * sizeof(Type));
+        }
+        else
+        {
+            for (sz i = 0; i < count; ++i)
+            {
+                ryujin::construct_at(_data + idx + i, first[i]);
+            }
+        }
+        _size += count;
+    }
+
     template<typename Type, typename Allocator>
     inline constexpr void vector<Type, Allocator>::push_back(const Type& value)
     {
@@ -0,0 +1,544 @@
+#ifndef command_buffer_hpp__
+#define command_buffer_hpp__
+
+#include "registry.hpp"
+
+#include "../core/memory.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+
+#include <cassert>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ryujin
+{
+    namespace detail
+    {
+        /// <summary>
+        /// Growable bump arena for command payloads.  Memory is handed out from fixed size chunks so payloads never
+        /// move once recorded.
+        /// </summary>
+        class command_arena
+        {
+        public:
+            static constexpr sz chunk_size = 16 * 1024;
+
+            void* allocate(const sz bytes, const sz alignment);
+            void reset() noexcept;
+
+        private:
+            struct chunk
+            {
+                unique_ptr<u8[]> data;
+                sz size;
+            };
+
+            vector<chunk> _chunks;
+            sz _activeChunk = 0;
+            sz _offset = 0;
+        };
+
+        inline void* command_arena::allocate(const sz bytes, const sz alignment)
+        {
+            while (_activeChunk < _chunks.size())
+            {
+                chunk& c = _chunks[_activeChunk];
+                const auto base = reinterpret_cast<sz>(c.data.get());
+                const auto aligned = (base + _offset + alignment - 1) & ~(alignment - 1);
+                if (aligned + bytes <= base + c.size)
+                {
+                    _offset = aligned + bytes - base;
+                    return reinterpret_cast<void*>(aligned);
+                }
+                ++_activeChunk;
+                _offset = 0;
+            }
+
+            const sz size = bytes + alignment > chunk_size ? bytes + alignment : chunk_size;
+            _chunks.push_back({ make_unique<u8[]>(size), size });
+            _activeChunk = _chunks.size() - 1;
+            _offset = 0;
+            return allocate(bytes, alignment);
+        }
+
+        inline void command_arena::reset() noexcept
+        {
+            _activeChunk = 0;
+            _offset = 0;
+        }
+    }
+
+    /// <summary>
+    /// Records registry mutations for deferred application.  A command buffer is not internally synchronized, each
+    /// recording thread should own its own buffer (see base_registry_command_queue).  Recorded commands are applied
+    /// on the thread owning the registry at a sync point, at which point the registry events fire.
+    ///
+    /// Commands are coalesced on submission:
+    ///  - entities created and destroyed within the same submission are never materialized
+    ///  - component commands targeting an entity destroyed later in the submission are dropped
+    ///  - repeated assign_or_replace calls for the same entity and component collapse into the last one
+    /// </summary>
+    /// <typeparam name="Type">Entity type of the target registry</typeparam>
+    template <typename Type>
+    class base_registry_command_buffer
+    {
+    public:
+        using entity_type = Type;
+
+        /// <summary>
+        /// Entity targeted by a command.  Either an existing entity or an entity that will be created when the
+        /// buffer is submitted.
+        /// </summary>
+        struct deferred_entity
+        {
+            static constexpr u32 existing = ~u32(0);
+
+            entity_type entity = {};
+            u32 pending = existing;
+
+            bool is_pending() const noexcept;
+        };
+
+        base_registry_command_buffer() = default;
+        base_registry_command_buffer(const base_registry_command_buffer&) = delete;
+        base_registry_command_buffer(base_registry_command_buffer&& other) noexcept = default;
+        ~base_registry_command_buffer();
+
+        base_registry_command_buffer& operator=(const base_registry_command_buffer&) = delete;
+        base_registry_command_buffer& operator=(base_registry_command_buffer&& rhs) noexcept = default;
+
+        /// <summary>
+        /// Records the creation of an entity.
+        /// </summary>
+        /// <returns>Deferred entity usable as a target of further commands in this buffer</returns>
+        deferred_entity create();
+
+        /// <summary>
+        /// Wraps an existing entity so that it can be targeted by commands.
+        /// </summary>
+        /// <param name="handle">Existing entity</param>
+        /// <returns>Deferred entity referencing the existing entity</returns>
+        deferred_entity wrap(const entity_handle<Type>& handle) const noexcept;
+
+        template <typename T>
+        void assign(const deferred_entity& target, const T& value);
+
+        template <typename T>
+        void assign_or_replace(const deferred_entity& target, const T& value);
+
+        template <typename T>
+        void remove(const deferred_entity& target);
+
+        void destroy(const deferred_entity& target);
+
+        /// <summary>
+        /// Fetches the entity materialized for a deferred entity by the last submission of this buffer.  Entities
+        /// coalesced away by the submission resolve to the registry's invalid handle.
+        /// </summary>
+        /// <param name="target">Deferred entity to resolve</param>
+        /// <param name="reg">Registry the buffer was submitted to</param>
+        /// <returns>Entity handle</returns>
+        entity_handle<Type> resolve(const deferred_entity& target, base_registry<Type>& reg) const noexcept;
+
+        bool empty() const noexcept;
+        sz size() const noexcept;
+
+        /// <summary>
+        /// Drops all recorded commands and resolved entities.
+        /// </summary>
+        void clear();
+
+        /// <summary>
+        /// Applies the recorded commands to the registry and clears the buffer.  Must be called from the thread that
+        /// owns the registry.
+        /// </summary>
+        /// <param name="reg">Registry to apply to</param>
+        void submit(base_registry<Type>& reg);
+
+        /// <summary>
+        /// Merges and applies a set of buffers in order, coalescing across all of them, then clears them.
+        /// </summary>
+        /// <param name="reg">Registry to apply to</param>
+        /// <param name="buffers">Buffers to apply, in application order</param>
+        static void submit(base_registry<Type>& reg, span<base_registry_command_buffer*> buffers);
+
+    private:
+        enum class command_type : u8
+        {
+            CREATE,
+            DESTROY,
+            ASSIGN,
+            ASSIGN_OR_REPLACE,
+            REMOVE
+        };
+
+        struct command
+        {
+            command_type type;
+            deferred_entity target;
+            sz component;
+            void* payload;
+            void (*apply)(base_registry<Type>&, entity_handle<Type>&, void*);
+            void (*destroy)(void*);
+        };
+
+        struct coalesce_key
+        {
+            u64 target;
+            sz component;
+
+            bool operator==(const coalesce_key& rhs) const noexcept = default;
+        };
+
+        struct coalesce_key_hash
+        {
+            sz operator()(const coalesce_key& key) const noexcept;
+        };
+
+        vector<command> _commands;
+        vector<entity_type> _created;
+        u32 _pendingCount = 0;
+        detail::command_arena _arena;
+
+        template <typename T, typename Fn>
+        void _record(const command_type type, const deferred_entity& target, const T* value, Fn apply);
+
+        void _releasePayloads() noexcept;
+
+        static u64 _coalesceTarget(const deferred_entity& target, const sz buffer) noexcept;
+    };
+
+    /// <summary>
+    /// Hands out one command buffer per recording thread and applies them together at a sync point.
+    /// </summary>
+    /// <typeparam name="Type">Entity type of the target registry</typeparam>
+    template <typename Type>
+    class base_registry_command_queue
+    {
+    public:
+        using buffer_type = base_registry_command_buffer<Type>;
+
+        /// <summary>
+        /// Fetches the calling thread's command buffer, creating it on first use.  The returned reference remains
+        /// valid until the queue is destroyed.
+        /// </summary>
+        /// <returns>Command buffer owned by the calling thread</returns>
+        buffer_type& local();
+
+        /// <summary>
+        /// Applies every thread's buffer to the registry in the order the threads first recorded.  No thread may be
+        /// recording while the queue is flushed.
+        /// </summary>
+        /// <param name="reg">Registry to apply to</param>
+        void flush(base_registry<Type>& reg);
+
+    private:
+        std::mutex _lock;
+        std::unordered_map<std::thread::id, sz> _threadBuffers;
+        vector<unique_ptr<buffer_type>> _buffers;
+        vector<buffer_type*> _submission;
+    };
+
+    using registry_command_buffer = base_registry_command_buffer<registry::entity_type>;
+    using registry_command_queue = base_registry_command_queue<registry::entity_type>;
+
+    template <typename Type>
+    inline bool base_registry_command_buffer<Type>::deferred_entity::is_pending() const noexcept
+    {
+        return pending != existing;
+    }
+
+    template <typename Type>
+    inline base_registry_command_buffer<Type>::~base_registry_command_buffer()
+    {
+        _releasePayloads();
+    }
+
+    template <typename Type>
+    inline typename base_registry_command_buffer<Type>::deferred_entity base_registry_command_buffer<Type>::create()
+    {
+        deferred_entity result;
+        result.pending = _pendingCount++;
+        _commands.push_back({ command_type::CREATE, result, ~sz(0), nullptr, nullptr, nullptr });
+        return result;
+    }
+
+    template <typename Type>
+    inline typename base_registry_command_buffer<Type>::deferred_entity base_registry_command_buffer<Type>::wrap(const entity_handle<Type>& handle) const noexcept
+    {
+        deferred_entity result;
+        result.entity = handle.handle();
+        return result;
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline void base_registry_command_buffer<Type>::assign(const deferred_entity& target, const T& value)
+    {
+        _record(command_type::ASSIGN, target, &value, [](base_registry<Type>& reg, entity_handle<Type>& handle, void* payload) {
+            reg.template assign<T>(handle, *reinterpret_cast<T*>(payload));
+        });
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline void base_registry_command_buffer<Type>::assign_or_replace(const deferred_entity& target, const T& value)
+    {
+        _record(command_type::ASSIGN_OR_REPLACE, target, &value, [](base_registry<Type>& reg, entity_handle<Type>& handle, void* payload) {
+            reg.template assign_or_replace<T>(handle, *reinterpret_cast<T*>(payload));
+        });
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline void base_registry_command_buffer<Type>::remove(const deferred_entity& target)
+    {
+        _record<T>(command_type::REMOVE, target, nullptr, [](base_registry<Type>& reg, entity_handle<Type>& handle, void*) {
+            reg.template remove<T>(handle);
+        });
+    }
+
+    template <typename Type>
+    inline void base_registry_command_buffer<Type>::destroy(const deferred_entity& target)
+    {
+        _commands.push_back({ command_type::DESTROY, target, ~sz(0), nullptr, nullptr, nullptr });
+    }
+
+    template <typename Type>
+    inline entity_handle<Type> base_registry_command_buffer<Type>::resolve(const deferred_entity& target, base_registry<Type>& reg) const noexcept
+    {
+        if (!target.is_pending())
+        {
+            return entity_handle<Type>(target.entity, &reg);
+        }
+
+        if (target.pending < _created.size())
+        {
+            return entity_handle<Type>(_created[target.pending], &reg);
+        }
+
+        return reg.invalid();
+    }
+
+    template <typename Type>
+    inline bool base_registry_command_buffer<Type>::empty() const noexcept
+    {
+        return _commands.empty();
+    }
+
+    template <typename Type>
+    inline sz base_registry_command_buffer<Type>::size() const noexcept
+    {
+        return _commands.size();
+    }
+
+    template <typename Type>
+    inline void base_registry_command_buffer<Type>::clear()
+    {
+        _releasePayloads();
+        _commands.clear();
+        _created.clear();
+        _pendingCount = 0;
+        _arena.reset();
+    }
+
+    template <typename Type>
+    inline void base_registry_command_buffer<Type>::submit(base_registry<Type>& reg)
+    {
+        base_registry_command_buffer* self = this;
+        submit(reg, span<base_registry_command_buffer*>(&self, 1));
+    }
+
+    template <typename Type>
+    inline void base_registry_command_buffer<Type>::submit(base_registry<Type>& reg, span<base_registry_command_buffer*> buffers)
+    {
+        sz total = 0;
+        for (sz b = 0; b < buffers.length(); ++b)
+        {
+            total += buffers[b]->_commands.size();
+        }
+
+        // walk the merged stream backwards, so every command knows what happens to its target later in the batch
+        vector<bool> dropped(total, false);
+        std::unordered_set<u64> destroyed;
+        std::unordered_set<coalesce_key, coalesce_key_hash> overwritten;
+
+        sz cursor = total;
+        for (sz b = buffers.length(); b > 0; --b)
+        {
+            const base_registry_command_buffer* buffer = buffers[b - 1];
+            for (sz c = buffer->_commands.size(); c > 0; --c)
+            {
+                const command& cmd = buffer->_commands[c - 1];
+                const u64 target = _coalesceTarget(cmd.target, b - 1);
+                --cursor;
+
+                switch (cmd.type)
+                {
+                case command_type::DESTROY:
+                    if (!destroyed.insert(target).second)
+                    {
+                        dropped[cursor] = true;
+                    }
+                    break;
+                case command_type::CREATE:
+                    if (destroyed.contains(target))
+                    {
+                        dropped[cursor] = true;
+                    }
+                    break;
+                case command_type::ASSIGN_OR_REPLACE:
+                    if (destroyed.contains(target) || !overwritten.insert({ target, cmd.component }).second)
+                    {
+                        dropped[cursor] = true;
+                    }
+                    break;
+                default:
+                    overwritten.erase({ target, cmd.component });
+                    if (destroyed.contains(target))
+                    {
+                        dropped[cursor] = true;
+                    }
+                    break;
+                }
+            }
+        }
+
+        cursor = 0;
+        for (sz b = 0; b < buffers.length(); ++b)
+        {
+            base_registry_command_buffer* buffer = buffers[b];
+            buffer->_created.clear();
+            buffer->_created.resize(buffer->_pendingCount);
+            for (entity_type& created : buffer->_created)
+            {
+                created = reg.invalid().handle();
+            }
+
+            for (command& cmd : buffer->_commands)
+            {
+                const bool skip = dropped[cursor++];
+
+                // a destroyed entity that was created in this batch was never materialized
+                const bool pending = cmd.target.is_pending();
+                if (skip || (pending && cmd.type != command_type::CREATE && buffer->_created[cmd.target.pending] == reg.invalid().handle()))
+                {
+                    continue;
+                }
+
+                switch (cmd.type)
+                {
+                case command_type::CREATE:
+                    buffer->_created[cmd.target.pending] = reg.allocate().handle();
+                    break;
+                case command_type::DESTROY:
+                {
+                    auto handle = buffer->resolve(cmd.target, reg);
+                    reg.deallocate(handle);
+                    break;
+                }
+                default:
+                {
+                    auto handle = buffer->resolve(cmd.target, reg);
+                    cmd.apply(reg, handle, cmd.payload);
+                    break;
+                }
+                }
+            }
+
+            auto created = ryujin::move(buffer->_created);
+            buffer->clear();
+            buffer->_created = ryujin::move(created);
+        }
+    }
+
+    template <typename Type>
+    template <typename T, typename Fn>
+    inline void base_registry_command_buffer<Type>::_record(const command_type type, const deferred_entity& target, const T* value, Fn apply)
+    {
+        assert((!target.is_pending() || target.pending < _pendingCount) && "Deferred entity was not created by this command buffer.");
+
+        void* payload = nullptr;
+        void (*destroy)(void*) = nullptr;
+        if (value)
+        {
+            payload = new (_arena.allocate(sizeof(T), alignof(T))) T(*value);
+            destroy = [](void* p) { reinterpret_cast<T*>(p)->~T(); };
+        }
+
+        static const sz component = detail::component_identifier_utility::fetch_identifier<T>();
+        _commands.push_back({ type, target, component, payload, +apply, destroy });
+    }
+
+    template <typename Type>
+    inline void base_registry_command_buffer<Type>::_releasePayloads() noexcept
+    {
+        for (command& cmd : _commands)
+        {
+            if (cmd.destroy)
+            {
+                cmd.destroy(cmd.payload);
+                cmd.destroy = nullptr;
+            }
+        }
+    }
+
+    template <typename Type>
+    inline u64 base_registry_command_buffer<Type>::_coalesceTarget(const deferred_entity& target, const sz buffer) noexcept
+    {
+        // pending entities are local to their buffer, existing entities are shared across the batch
+        if (target.is_pending())
+        {
+            return (u64(1) << 63) | (u64(buffer) << 32) | target.pending;
+        }
+        return (u64(target.entity.version) << 32) | target.entity.identifier;
+    }
+
+    template <typename Type>
+    inline sz base_registry_command_buffer<Type>::coalesce_key_hash::operator()(const coalesce_key& key) const noexcept
+    {
+        return std::hash<u64>{}(key.target) ^ (std::hash<sz>{}(key.component) * 0x9E3779B97F4A7C15ull);
+    }
+
+    template <typename Type>
+    inline typename base_registry_command_queue<Type>::buffer_type& base_registry_command_queue<Type>::local()
+    {
+        std::lock_guard guard(_lock);
+        const auto id = std::this_thread::get_id();
+        const auto it = _threadBuffers.find(id);
+        if (it != _threadBuffers.end())
+        {
+            return *_buffers[it->second];
+        }
+
+        _threadBuffers[id] = _buffers.size();
+        _buffers.push_back(make_unique<buffer_type>());
+        return *_buffers.back();
+    }
+
+    template <typename Type>
+    inline void base_registry_command_queue<Type>::flush(base_registry<Type>& reg)
+    {
+        std::lock_guard guard(_lock);
+        _submission.clear();
+        for (auto& buffer : _buffers)
+        {
+            if (!buffer->empty())
+            {
+                _submission.push_back(buffer.get());
+            }
+        }
+
+        if (!_submission.empty())
+        {
+            buffer_type::submit(reg, span<buffer_type*>(_submission.data(), _submission.size()));
+        }
+    }
+}
+
+#endif // command_buffer_hpp__
@@ -0,0 +1,290 @@
+#ifndef component_storage_hpp__
+#define component_storage_hpp__
+
+#include "../core/allocator.hpp"
+#include "../core/memory.hpp"
+#include "../core/primitives.hpp"
+#include "../core/utility.hpp"
+#include "../core/vector.hpp"
+
+#include <type_traits>
+
+namespace ryujin
+{
+    /// <summary>
+    /// Storage policy keeping component values contiguous, parallel to the packed entities.  Pointers to components
+    /// are invalidated by inserts and removals.
+    /// </summary>
+    struct dense_storage {};
+
+    /// <summary>
+    /// Storage policy for empty components.  Only membership is stored, every entity shares a single value.
+    /// </summary>
+    struct tag_storage {};
+
+    /// <summary>
+    /// Storage policy allocating component values in fixed size pages that are never moved.  Pointers to components
+    /// remain valid until the component is removed, at the cost of one indirection when iterating.
+    /// </summary>
+    struct stable_storage {};
+
+    /// <summary>
+    /// Convenience base for component_traits specializations.
+    /// </summary>
+    /// <typeparam name="Storage">Storage policy of the component</typeparam>
+    /// <typeparam name="PageSize">Number of entries per sparse page and, for stable storage, per value page</typeparam>
+    template <typename Storage, sz PageSize = 1024>
+    struct component_storage_traits
+    {
+        using storage = Storage;
+        static constexpr sz page_size = PageSize;
+    };
+
+    /// <summary>
+    /// Selects how the registry stores a component type.  Empty types default to tag storage, everything else to
+    /// dense storage.  Specialize to override, for example
+    /// template &lt;&gt; struct component_traits&lt;my_component&gt; : component_storage_traits&lt;stable_storage, 256&gt; {};
+    /// </summary>
+    template <typename T>
+    struct component_traits : component_storage_traits<std::conditional_t<std::is_empty_v<T>, tag_storage, dense_storage>>
+    {
+    };
+
+    namespace detail
+    {
+        template <typename T, typename Storage, sz PageSize>
+        class value_storage;
+
+        template <typename T, sz PageSize>
+        class value_storage<T, dense_storage, PageSize>
+        {
+        public:
+            using iterator = T*;
+            using const_iterator = const T*;
+
+            T& operator[](const sz idx) noexcept { return _values[idx]; }
+            const T& operator[](const sz idx) const noexcept { return _values[idx]; }
+
+            void push_back(const T& value) { _values.push_back(value); }
+            void append(const T* first, const T* last) { _values.insert(_values.end(), first, last); }
+            void swap_remove(const sz idx)
+            {
+                if (idx + 1 != _values.size())
+                {
+                    _values[idx] = ryujin::move(_values.back());
+                }
+                _values.pop_back();
+            }
+            void swap(const sz lhs, const sz rhs) { ryujin::move_swap(_values[lhs], _values[rhs]); }
+
+            void reserve(const sz count) { _values.reserve(count); }
+            void shrink_to_fit() { _values.shrink_to_fit(); }
+            void clear() { _values.clear(); }
+            sz memory_usage() const noexcept { return _values.capacity() * sizeof(T); }
+
+            iterator begin() noexcept { return _values.begin(); }
+            const_iterator begin() const noexcept { return _values.begin(); }
+            iterator end() noexcept { return _values.end(); }
+            const_iterator end() const noexcept { return _values.end(); }
+
+        private:
+            vector<T> _values;
+        };
+
+        template <typename T>
+        class tag_iterator
+        {
+        public:
+            tag_iterator(T* value, const sz idx) : _value(value), _idx(idx) {}
+
+            T& operator*() const noexcept { return *_value; }
+            T* operator->() const noexcept { return _value; }
+            tag_iterator& operator++() noexcept { ++_idx; return *this; }
+            tag_iterator operator++(int) noexcept { tag_iterator it = *this; ++_idx; return it; }
+            bool operator==(const tag_iterator& rhs) const noexcept { return _idx == rhs._idx; }
+            bool operator!=(const tag_iterator& rhs) const noexcept { return _idx != rhs._idx; }
+
+        private:
+            T* _value;
+            sz _idx;
+        };
+
+        template <typename T, sz PageSize>
+        class value_storage<T, tag_storage, PageSize>
+        {
+        public:
+            static_assert(std::is_empty_v<T>, "Tag storage is only valid for empty component types.");
+
+            using iterator = tag_iterator<T>;
+            using const_iterator = tag_iterator<const T>;
+
+            T& operator[](const sz) noexcept { return _value; }
+            const T& operator[](const sz) const noexcept { return _value; }
+
+            void push_back(const T&) { ++_size; }
+            void append(const T* first, const T* last) { _size += last - first; }
+            void swap_remove(const sz) { --_size; }
+            void swap(const sz, const sz) {}
+
+            void reserve(const sz) {}
+            void shrink_to_fit() {}
+            void clear() { _size = 0; }
+            sz memory_usage() const noexcept { return 0; }
+
+            iterator begin() noexcept { return iterator(&_value, 0); }
+            const_iterator begin() const noexcept { return const_iterator(&_value, 0); }
+            iterator end() noexcept { return iterator(&_value, _size); }
+            const_iterator end() const noexcept { return const_iterator(&_value, _size); }
+
+        private:
+            T _value = {};
+            sz _size = 0;
+        };
+
+        template <typename T>
+        class indirect_iterator
+        {
+        public:
+            explicit indirect_iterator(T* const* slot) : _slot(slot) {}
+
+            T& operator*() const noexcept { return **_slot; }
+            T* operator->() const noexcept { return *_slot; }
+            indirect_iterator& operator++() noexcept { ++_slot; return *this; }
+            indirect_iterator operator++(int) noexcept { indirect_iterator it = *this; ++_slot; return it; }
+            bool operator==(const indirect_iterator& rhs) const noexcept { return _slot == rhs._slot; }
+            bool operator!=(const indirect_iterator& rhs) const noexcept { return _slot != rhs._slot; }
+
+        private:
+            T* const* _slot;
+        };
+
+        template <typename T, sz PageSize>
+        class value_storage<T, stable_storage, PageSize>
+        {
+        public:
+            using iterator = indirect_iterator<T>;
+            using const_iterator = indirect_iterator<const T>;
+
+            value_storage() = default;
+            value_storage(const value_storage&) = delete;
+            value_storage(value_storage&&) noexcept = delete;
+            ~value_storage();
+
+            value_storage& operator=(const value_storage&) = delete;
+            value_storage& operator=(value_storage&&) noexcept = delete;
+
+            T& operator[](const sz idx) noexcept { return *_slots[idx]; }
+            const T& operator[](const sz idx) const noexcept { return *_slots[idx]; }
+
+            void push_back(const T& value);
+            void append(const T* first, const T* last);
+            void swap_remove(const sz idx);
+            void swap(const sz lhs, const sz rhs) { ryujin::move_swap(_slots[lhs], _slots[rhs]); }
+
+            void reserve(const sz count) { _slots.reserve(count); }
+            void shrink_to_fit() { _slots.shrink_to_fit(); }
+            void clear();
+            sz memory_usage() const noexcept
+            {
+                return _pages.size() * PageSize * sizeof(T) + (_slots.capacity() + _free.capacity() + _pages.capacity()) * sizeof(T*);
+            }
+
+            iterator begin() noexcept { return iterator(_slots.data()); }
+            const_iterator begin() const noexcept { return const_iterator(_slots.data()); }
+            iterator end() noexcept { return iterator(_slots.data() + _slots.size()); }
+            const_iterator end() const noexcept { return const_iterator(_slots.data() + _slots.size()); }
+
+        private:
+            vector<T*> _slots; // packed index -> live value
+            vector<T*> _free; // destroyed values available for reuse
+            vector<T*> _pages;
+            sz _page = 0; // page values are currently bump allocated from
+            sz _pageUsed = 0; // values handed out from the current page
+
+            T* _acquire();
+        };
+
+        template <typename T, sz PageSize>
+        inline value_storage<T, stable_storage, PageSize>::~value_storage()
+        {
+            clear();
+
+            allocator<T> alloc;
+            for (T* page : _pages)
+            {
+                alloc.deallocate(page, PageSize);
+            }
+        }
+
+        template <typename T, sz PageSize>
+        inline void value_storage<T, stable_storage, PageSize>::push_back(const T& value)
+        {
+            T* slot = _acquire();
+            ryujin::construct_at(slot, value);
+            _slots.push_back(slot);
+        }
+
+        template <typename T, sz PageSize>
+        inline void value_storage<T, stable_storage, PageSize>::append(const T* first, const T* last)
+        {
+            _slots.reserve(_slots.size() + (last - first));
+            for (; first != last; ++first)
+            {
+                push_back(*first);
+            }
+        }
+
+        template <typename T, sz PageSize>
+        inline void value_storage<T, stable_storage, PageSize>::swap_remove(const sz idx)
+        {
+            T* slot = _slots[idx];
+            ryujin::destroy_at(slot);
+            _free.push_back(slot);
+
+            _slots[idx] = _slots.back();
+            _slots.pop_back();
+        }
+
+        template <typename T, sz PageSize>
+        inline void value_storage<T, stable_storage, PageSize>::clear()
+        {
+            for (T* slot : _slots)
+            {
+                ryujin::destroy_at(slot);
+            }
+            _slots.clear();
+            _free.clear();
+
+            // pages are kept and handed out again from the first one
+            _page = 0;
+            _pageUsed = 0;
+        }
+
+        template <typename T, sz PageSize>
+        inline T* value_storage<T, stable_storage, PageSize>::_acquire()
+        {
+            if (!_free.empty())
+            {
+                T* slot = _free.back();
+                _free.pop_back();
+                return slot;
+            }
+
+            if (_pageUsed == PageSize)
+            {
+                ++_page;
+                _pageUsed = 0;
+            }
+
+            if (_page == _pages.size())
+            {
+                allocator<T> alloc;
+                _pages.push_back(alloc.allocate(PageSize));
+            }
+
+            return _pages[_page] + _pageUsed++;
+        }
+    }
+}
+
+#endif // component_storage_hpp__
@@ -1,11 +1,13 @@
 #ifndef events_hpp__
 #define events_hpp__
 
+#include "../core/memory.hpp"
 #include "../core/primitives.hpp"
+#include "../core/type_traits.hpp"
+#include "../core/utility.hpp"
+#include "../core/vector.hpp"
 
 #include <cstddef>
-#include <functional>
-#include <unordered_map>
 
 namespace ryujin
 {
@@ -22,50 +24,287 @@ namespace ryujin
                 return typeId;
             }
         };
+
+        struct event_delegate_entry
+        {
+            void* instance;
+            void (*invoke)(void*, const void*);
+        };
+
+        struct owned_event_callback
+        {
+            virtual ~owned_event_callback() = default;
+        };
+
+        template <typename Fn>
+        struct owned_event_callback_impl final : owned_event_callback
+        {
+            explicit owned_event_callback_impl(Fn&& fn)
+                : fn(ryujin::move(fn))
+            {
+            }
+
+            explicit owned_event_callback_impl(const Fn& fn)
+                : fn(fn)
+            {
+            }
+
+            Fn fn;
+        };
+
+        class event_queue_base
+        {
+        public:
+            virtual ~event_queue_base() = default;
+            virtual void dispatch(const vector<event_delegate_entry>& delegates) = 0;
+            virtual bool empty() const noexcept = 0;
+        };
+
+        template <typename T>
+        class event_queue final : public event_queue_base
+        {
+        public:
+            template <typename ... Args>
+            void push(Args&& ... args);
+
+            void dispatch(const vector<event_delegate_entry>& delegates) override;
+            bool empty() const noexcept override;
+
+        private:
+            vector<T> _events;
+            vector<T> _inFlight;
+        };
     }
 
+    /// <summary>
+    /// Non-owning callable bound to an event type.  Wraps a free function, a member function and instance, or a
+    /// reference to a callable object.  The bound instance or callable must outlive the delegate.
+    /// </summary>
+    /// <typeparam name="T">Type of event the delegate receives</typeparam>
+    template <typename T>
+    class event_delegate
+    {
+    public:
+        template <void (*Fn)(const T&)>
+        static event_delegate bind() noexcept;
+
+        template <auto Method, typename C>
+        static event_delegate bind(C* instance) noexcept;
+
+        template <typename Fn>
+        static event_delegate bind_ref(Fn& fn) noexcept;
+
+        void operator()(const T& e) const;
+
+    private:
+        detail::event_delegate_entry _entry = {};
+
+        friend class event_manager;
+    };
+
+    /// <summary>
+    /// Type indexed event dispatcher.  Subscribers are stored as flat delegate arrays indexed by event type, so
+    /// emitting an event costs one indirect call per subscriber and never allocates.  Events may also be queued
+    /// into per-type buffers and delivered in one batch by dispatch().
+    /// </summary>
     class event_manager
     {
     public:
+        /// <summary>
+        /// Constructs an event in place and immediately invokes every subscriber of its type.
+        /// </summary>
+        template <typename T, typename ... Args>
+        void emit(Args&& ... args) const;
+
+        /// <summary>
+        /// Constructs an event into the queue for its type.  Queued events are delivered by dispatch().
+        /// </summary>
         template <typename T, typename ... Args>
-        void emit(Args&& ... args) const noexcept;
+        void enqueue(Args&& ... args);
 
+        /// <summary>
+        /// Delivers all queued events, one batch per event type.  Events queued by subscribers during dispatch are
+        /// delivered no later than the next call.
+        /// </summary>
+        void dispatch();
+
+        /// <summary>
+        /// Checks if any events are queued.
+        /// </summary>
+        bool has_queued() const noexcept;
+
+        /// <summary>
+        /// Subscribes a non-owning delegate.
+        /// </summary>
         template <typename T>
-        void subscribe(const std::function<void(const T&)> cb);
+        void subscribe(const event_delegate<T> delegate);
+
+        /// <summary>
+        /// Subscribes a member function of an instance.  The instance must outlive the subscription or be removed
+        /// with unsubscribe.
+        /// </summary>
+        template <typename T, auto Method, typename C>
+        void subscribe(C* instance);
+
+        /// <summary>
+        /// Subscribes a callable object.  The callable is copied into storage owned by the event manager when
+        /// subscribing, so emitting remains allocation free.
+        /// </summary>
+        template <typename T, typename Fn>
+        void subscribe(Fn&& fn);
+
+        /// <summary>
+        /// Removes every subscription bound to an instance.
+        /// </summary>
+        /// <param name="instance">Instance passed to subscribe</param>
+        void unsubscribe(const void* instance);
 
     private:
-        using event_callback = std::function<void(const void*)>;
+        vector<vector<detail::event_delegate_entry>> _delegates; // indexed by event type identifier
+        vector<unique_ptr<detail::event_queue_base>> _queues; // indexed by event type identifier
+        vector<sz> _queued; // event type identifiers with a non-empty queue
+        vector<unique_ptr<detail::owned_event_callback>> _owned;
+
+        template <typename T>
+        static sz _identifier() noexcept;
 
-        std::unordered_map<sz, std::vector<event_callback>> _callbacks;
+        vector<detail::event_delegate_entry>& _delegatesOf(const sz id);
     };
-    
+
+    template <typename T>
+    template <typename ... Args>
+    inline void detail::event_queue<T>::push(Args&& ... args)
+    {
+        _events.push_back(T(ryujin::forward<Args>(args)...));
+    }
+
+    template <typename T>
+    inline void detail::event_queue<T>::dispatch(const vector<event_delegate_entry>& delegates)
+    {
+        // swap buffers so that subscribers may queue further events without invalidating the batch
+        ryujin::move_swap(_events, _inFlight);
+        for (const T& e : _inFlight)
+        {
+            for (sz i = 0; i < delegates.size(); ++i)
+            {
+                delegates[i].invoke(delegates[i].instance, &e);
+            }
+        }
+        _inFlight.clear();
+    }
+
+    template <typename T>
+    inline bool detail::event_queue<T>::empty() const noexcept
+    {
+        return _events.empty();
+    }
+
+    template <typename T>
+    template <void (*Fn)(const T&)>
+    inline event_delegate<T> event_delegate<T>::bind() noexcept
+    {
+        event_delegate<T> delegate;
+        delegate._entry.instance = nullptr;
+        delegate._entry.invoke = [](void*, const void* e) {
+            Fn(*static_cast<const T*>(e));
+        };
+        return delegate;
+    }
+
+    template <typename T>
+    template <auto Method, typename C>
+    inline event_delegate<T> event_delegate<T>::bind(C* instance) noexcept
+    {
+        event_delegate<T> delegate;
+        delegate._entry.instance = const_cast<remove_cv_t<C>*>(instance);
+        delegate._entry.invoke = [](void* self, const void* e) {
+            (static_cast<C*>(self)->*Method)(*static_cast<const T*>(e));
+        };
+        return delegate;
+    }
+
+    template <typename T>
+    template <typename Fn>
+    inline event_delegate<T> event_delegate<T>::bind_ref(Fn& fn) noexcept
+    {
+        event_delegate<T> delegate;
+        delegate._entry.instance = const_cast<remove_cv_t<Fn>*>(&fn);
+        delegate._entry.invoke = [](void* self, const void* e) {
+            (*static_cast<Fn*>(self))(*static_cast<const T*>(e));
+        };
+        return delegate;
+    }
+
+    template <typename T>
+    inline void event_delegate<T>::operator()(const T& e) const
+    {
+        _entry.invoke(_entry.instance, &e);
+    }
+
     template <typename T, typename ... Args>
-    inline void event_manager::emit(Args&& ... args) const noexcept
+    inline void event_manager::emit(Args&& ... args) const
     {
-        static const auto id = detail::struct_identifier_utility::fetch_identifier<T>();
-        const auto& it = _callbacks.find(id);
-        
-        if (it != _callbacks.end())
+        const sz id = _identifier<T>();
+        if (id < _delegates.size() && !_delegates[id].empty())
         {
-            const T e(std::forward<Args>(args)...);
-            const std::vector<event_callback>& cbs = it->second;
-            for (const auto& cb : cbs)
+            const T e(ryujin::forward<Args>(args)...);
+            const vector<detail::event_delegate_entry>& delegates = _delegates[id];
+            for (sz i = 0; i < delegates.size(); ++i)
             {
-                cb(&e);
+                delegates[i].invoke(delegates[i].instance, &e);
             }
         }
     }
-    
-    template<typename T>
-    inline void event_manager::subscribe(const std::function<void(const T&)> cb)
+
+    template <typename T, typename ... Args>
+    inline void event_manager::enqueue(Args&& ... args)
+    {
+        const sz id = _identifier<T>();
+        while (id >= _queues.size())
+        {
+            _queues.push_back(nullptr);
+        }
+
+        if (!_queues[id])
+        {
+            _queues[id] = make_unique<detail::event_queue<T>>().release();
+        }
+
+        auto* queue = static_cast<detail::event_queue<T>*>(_queues[id].get());
+        if (queue->empty())
+        {
+            _queued.push_back(id);
+        }
+        queue->push(ryujin::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    inline void event_manager::subscribe(const event_delegate<T> delegate)
+    {
+        _delegatesOf(_identifier<T>()).push_back(delegate._entry);
+    }
+
+    template <typename T, auto Method, typename C>
+    inline void event_manager::subscribe(C* instance)
+    {
+        subscribe(event_delegate<T>::template bind<Method>(instance));
+    }
+
+    template <typename T, typename Fn>
+    inline void event_manager::subscribe(Fn&& fn)
+    {
+        using callable = remove_cvref_t<Fn>;
+        auto owned = make_unique<detail::owned_event_callback_impl<callable>>(ryujin::forward<Fn>(fn));
+        subscribe(event_delegate<T>::bind_ref(owned->fn));
+        _owned.push_back(unique_ptr<detail::owned_event_callback>(owned.release()));
+    }
+
+    template <typename T>
+    inline sz event_manager::_identifier() noexcept
     {
         static const auto id = detail::struct_identifier_utility::fetch_identifier<T>();
-        std::vector<event_callback>& cbs = _callbacks[id];
-        cbs.push_back([=](const void* e) {
-                const T* casted_e = reinterpret_cast<const T*>(e);
-                cb(*casted_e);
-            });
+        return id;
     }
 }
 
-#endif // events_hpp__
\ No newline at end of file
+#endif // events_hpp__
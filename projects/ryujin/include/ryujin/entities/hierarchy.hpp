@@ -0,0 +1,93 @@
+#ifndef hierarchy_hpp__
+#define hierarchy_hpp__
+
+#include "entity_relationship_component.hpp"
+#include "registry.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Entity hierarchy stored in depth first order with subtree sizes.  Every subtree occupies a contiguous range
+    /// starting at its root, so subtree traversal is a linear walk and subtree operations move or remove a single
+    /// block.  Children are kept in insertion order.  The entity_relationship_component links of affected entities
+    /// are rewritten after each operation, so systems reading the links observe the same hierarchy.
+    ///
+    /// Entities that lose their relationship component, including entities deallocated outside of the hierarchy,
+    /// leave it on their own; their children move up to their parent.
+    /// </summary>
+    class hierarchy
+    {
+    public:
+        using entity_type = registry::entity_type;
+        using relationship_type = entity_relationship_component<entity_type>;
+
+        static constexpr u32 no_parent = ~u32(0);
+
+        struct node
+        {
+            entity_type entity;
+            u32 parent; // index of the parent node, or no_parent for roots
+            u32 size; // number of nodes in the subtree, including this node
+        };
+
+        RYUJIN_API explicit hierarchy(registry& reg);
+        RYUJIN_API ~hierarchy();
+
+        hierarchy(const hierarchy&) = delete;
+        hierarchy& operator=(const hierarchy&) = delete;
+
+        /// <summary>
+        /// Adds an entity as the last child of parent, or as a new root if parent is the tombstone.
+        /// </summary>
+        RYUJIN_API void add(const entity_type entity, const entity_type parent = relationship_type::tombstone);
+
+        /// <summary>
+        /// Deallocates an entity and all of its descendants.
+        /// </summary>
+        RYUJIN_API void destroy_subtree(const entity_type entity);
+
+        /// <summary>
+        /// Moves an entity and its descendants to the end of parent's children, or makes it a root if parent is the
+        /// tombstone.  The new parent may not be inside the moved subtree.
+        /// </summary>
+        RYUJIN_API void reparent(const entity_type entity, const entity_type parent);
+
+        /// <summary>
+        /// Copies an entity and its descendants, components included, and attaches the copy to parent.
+        /// </summary>
+        /// <returns>Root of the copy</returns>
+        RYUJIN_API entity_type clone_subtree(const entity_type entity, const entity_type parent = relationship_type::tombstone);
+
+        /// <summary>
+        /// Nodes of the subtree rooted at entity in depth first order, the root first.
+        /// </summary>
+        RYUJIN_API span<node> subtree(const entity_type entity) const noexcept;
+
+        RYUJIN_API bool contains(const entity_type entity) const noexcept;
+        RYUJIN_API entity_type parent(const entity_type entity) const noexcept;
+        RYUJIN_API span<node> nodes() const noexcept;
+        RYUJIN_API sz size() const noexcept;
+
+    private:
+        registry* _registry;
+        vector<node> _nodes;
+        vector<u32> _slots; // entity identifier -> node index
+
+        u32 _indexOf(const entity_type entity) const noexcept;
+        u32 _previousSibling(const u32 idx) const noexcept;
+        u32 _insert(const node* block, const sz count, const u32 parent);
+        void _erase(const u32 first);
+        void _reindex(const sz first);
+        void _link(const u32 idx);
+        void _linkAround(const u32 parent, const u32 idx);
+        void _dissolve(const u32 idx);
+        void _onRelationshipRemoved(const component_remove_event<relationship_type, entity_type>& e);
+    };
+}
+
+#endif // hierarchy_hpp__
@@ -0,0 +1,183 @@
+#ifndef observer_hpp__
+#define observer_hpp__
+
+#include "registry.hpp"
+
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/utility.hpp"
+#include "../core/vector.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Declarative description of the changes an observer collects, for example
+    /// observer_matcher().added&lt;renderable_component&gt;().updated&lt;transform_component&gt;().  An entity matches
+    /// when any of the listed changes happens to it.
+    /// </summary>
+    class observer_matcher
+    {
+    public:
+        /// <summary>
+        /// Collects entities that receive any of the components.
+        /// </summary>
+        template <typename ... Ts>
+        observer_matcher& added();
+
+        /// <summary>
+        /// Collects entities that lose any of the components, including through deallocation.
+        /// </summary>
+        template <typename ... Ts>
+        observer_matcher& removed();
+
+        /// <summary>
+        /// Collects entities whose components are replaced, patched or fetched with get_mut.
+        /// </summary>
+        template <typename ... Ts>
+        observer_matcher& updated();
+
+    private:
+        detail::observer_masks _masks;
+
+        template <typename T>
+        static sz _identifier() noexcept;
+
+        template <typename Type>
+        friend class base_observer;
+    };
+
+    /// <summary>
+    /// Collects the entities matching an observer_matcher as the registry changes.  Each entity is held once no matter
+    /// how often it changed, and the set is emptied by drain, typically once per frame.  Entities that are deallocated
+    /// are dropped unless the matcher observes removals, in which case they are reported even though they are no
+    /// longer alive.  The registry must outlive the observer.
+    /// </summary>
+    /// <typeparam name="Type">Entity handle type of the observed registry</typeparam>
+    template <typename Type>
+    class base_observer
+    {
+    public:
+        using entity_type = Type;
+
+        base_observer(base_registry<Type>& reg, const observer_matcher& matcher);
+        base_observer(const base_observer&) = delete;
+        base_observer(base_observer&&) noexcept = delete;
+        ~base_observer();
+
+        base_observer& operator=(const base_observer&) = delete;
+        base_observer& operator=(base_observer&&) noexcept = delete;
+
+        /// <summary>
+        /// Invokes fn(entity_handle) for every collected entity and empties the observer.  Changes made by fn are
+        /// collected for the next drain.
+        /// </summary>
+        template <typename Fn>
+        void drain(Fn&& fn);
+
+        void clear();
+
+        bool contains(const entity_type entity) const noexcept;
+        span<entity_type> entities() const noexcept;
+        sz size() const noexcept;
+        bool empty() const noexcept;
+
+    private:
+        base_registry<Type>* _registry;
+        detail::observer_data<Type> _data;
+        vector<Type> _draining;
+    };
+
+    template <typename ... Ts>
+    inline observer_matcher& observer_matcher::added()
+    {
+        (_masks.added.set(_identifier<Ts>()), ...);
+        return *this;
+    }
+
+    template <typename ... Ts>
+    inline observer_matcher& observer_matcher::removed()
+    {
+        (_masks.removed.set(_identifier<Ts>()), ...);
+        return *this;
+    }
+
+    template <typename ... Ts>
+    inline observer_matcher& observer_matcher::updated()
+    {
+        (_masks.updated.set(_identifier<Ts>()), ...);
+        return *this;
+    }
+
+    template <typename T>
+    inline sz observer_matcher::_identifier() noexcept
+    {
+        return detail::component_identifier_utility::fetch_identifier<T>();
+    }
+
+    template <typename Type>
+    inline base_observer<Type>::base_observer(base_registry<Type>& reg, const observer_matcher& matcher)
+        : _registry(&reg)
+    {
+        _data.masks = matcher._masks;
+        _registry->_attachObserver(&_data);
+    }
+
+    template <typename Type>
+    inline base_observer<Type>::~base_observer()
+    {
+        _registry->_detachObserver(&_data);
+    }
+
+    template <typename Type>
+    template <typename Fn>
+    inline void base_observer<Type>::drain(Fn&& fn)
+    {
+        // move the batch out first so that entities changed by fn start the next batch instead of this one
+        ryujin::move_swap(_draining, _data.entities);
+        for (const Type entity : _draining)
+        {
+            _data.index[entity.identifier] = _data.absent;
+        }
+
+        for (const Type entity : _draining)
+        {
+            fn(entity_handle<Type>(entity, _registry));
+        }
+        _draining.clear();
+    }
+
+    template <typename Type>
+    inline void base_observer<Type>::clear()
+    {
+        _data.clear();
+    }
+
+    template <typename Type>
+    inline bool base_observer<Type>::contains(const entity_type entity) const noexcept
+    {
+        return entity.identifier < _data.index.size() && _data.index[entity.identifier] != _data.absent
+            && _data.entities[_data.index[entity.identifier]] == entity;
+    }
+
+    template <typename Type>
+    inline span<Type> base_observer<Type>::entities() const noexcept
+    {
+        return span<Type>(_data.entities.data(), _data.entities.size());
+    }
+
+    template <typename Type>
+    inline sz base_observer<Type>::size() const noexcept
+    {
+        return _data.entities.size();
+    }
+
+    template <typename Type>
+    inline bool base_observer<Type>::empty() const noexcept
+    {
+        return _data.entities.empty();
+    }
+
+    using observer = base_observer<registry::entity_type>;
+}
+
+#endif // observer_hpp__
@@ -0,0 +1,239 @@
+#ifndef prefab_hpp__
+#define prefab_hpp__
+
+#include "entity_relationship_component.hpp"
+#include "registry.hpp"
+#include "transform_component.hpp"
+
+#include "../core/memory.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+
+#include <cassert>
+
+namespace ryujin
+{
+    namespace detail
+    {
+        template <typename Type>
+        struct prefab_block_base
+        {
+            virtual ~prefab_block_base() = default;
+
+            // entities holds copies * nodeCount handles, copy major
+            virtual void instantiate(base_registry<Type>& reg, const span<entity_handle<Type>> entities, const sz nodeCount, const sz copies) const = 0;
+
+            sz identifier;
+        };
+
+        template <typename Type, typename T>
+        struct prefab_block final : prefab_block_base<Type>
+        {
+            void instantiate(base_registry<Type>& reg, const span<entity_handle<Type>> entities, const sz nodeCount, const sz copies) const override;
+
+            vector<u32> nodes;
+            vector<T> values;
+        };
+    }
+
+    /// <summary>
+    /// Template for a hierarchy of entities, stored as one block of values per component type and parent links
+    /// relative to the prefab.  Instantiation allocates every entity of every copy in one batch and assigns each
+    /// component block with a single range assignment, remapping the relative links to the allocated entities.
+    /// </summary>
+    /// <typeparam name="Type">Entity handle type of the registry the prefab is instantiated into</typeparam>
+    template <typename Type>
+    class base_prefab
+    {
+    public:
+        static constexpr u32 no_parent = ~u32(0);
+
+        base_prefab() = default;
+        base_prefab(const base_prefab&) = delete;
+        base_prefab(base_prefab&&) noexcept = default;
+        ~base_prefab() = default;
+
+        base_prefab& operator=(const base_prefab&) = delete;
+        base_prefab& operator=(base_prefab&&) noexcept = default;
+
+        /// <summary>
+        /// Adds a node to the prefab.  Parents must be added before their children, node 0 is the root of each
+        /// instance.
+        /// </summary>
+        /// <param name="parent">Index of the parent node, or no_parent</param>
+        /// <param name="transform">Transform of the node relative to its parent</param>
+        /// <returns>Index of the new node</returns>
+        u32 add_node(const u32 parent = no_parent, const transform_component& transform = {});
+
+        /// <summary>
+        /// Sets the value a component takes on a node in every instance.
+        /// </summary>
+        template <typename T>
+        void set(const u32 node, const T& value);
+
+        transform_component& transform(const u32 node) noexcept;
+        sz node_count() const noexcept;
+
+        /// <summary>
+        /// Creates copies of the prefab.  Entities are written to out copy major, the entity for node n of copy c
+        /// is out[c * node_count() + n].
+        /// </summary>
+        void instantiate(base_registry<Type>& reg, const sz copies, entity_handle<Type>* out) const;
+
+    private:
+        vector<u32> _parents;
+        vector<transform_component> _transforms;
+        vector<unique_ptr<detail::prefab_block_base<Type>>> _blocks;
+    };
+
+    template <typename Type>
+    inline u32 base_prefab<Type>::add_node(const u32 parent, const transform_component& transform)
+    {
+        assert((parent == no_parent || parent < _parents.size()) && "Prefab parents must be added before their children.");
+        assert((parent != no_parent || _parents.empty()) && "Prefabs have a single root node.");
+
+        _parents.push_back(parent);
+        _transforms.push_back(transform);
+        return static_cast<u32>(_parents.size() - 1);
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline void base_prefab<Type>::set(const u32 node, const T& value)
+    {
+        static_assert(!is_same_v<T, transform_component>, "Node transforms are set through add_node or transform.");
+        static_assert(!is_same_v<T, entity_relationship_component<Type>>, "Prefab relationships are derived from the node parents.");
+        assert(node < _parents.size() && "Prefab node out of range.");
+
+        const sz identifier = detail::component_identifier_utility::fetch_identifier<T>();
+        detail::prefab_block<Type, T>* block = nullptr;
+        for (auto& existing : _blocks)
+        {
+            if (existing->identifier == identifier)
+            {
+                block = static_cast<detail::prefab_block<Type, T>*>(existing.get());
+                break;
+            }
+        }
+
+        if (block == nullptr)
+        {
+            auto created = make_unique<detail::prefab_block<Type, T>>();
+            created->identifier = identifier;
+            block = created.get();
+            _blocks.push_back(unique_ptr<detail::prefab_block_base<Type>>(created.release()));
+        }
+
+        for (sz i = 0; i < block->nodes.size(); ++i)
+        {
+            if (block->nodes[i] == node)
+            {
+                block->values[i] = value;
+                return;
+            }
+        }
+
+        block->nodes.push_back(node);
+        block->values.push_back(value);
+    }
+
+    template <typename Type>
+    inline transform_component& base_prefab<Type>::transform(const u32 node) noexcept
+    {
+        return _transforms[node];
+    }
+
+    template <typename Type>
+    inline sz base_prefab<Type>::node_count() const noexcept
+    {
+        return _parents.size();
+    }
+
+    template <typename Type>
+    inline void base_prefab<Type>::instantiate(base_registry<Type>& reg, const sz copies, entity_handle<Type>* out) const
+    {
+        const sz nodeCount = _parents.size();
+        const sz total = nodeCount * copies;
+        if (total == 0)
+        {
+            return;
+        }
+
+        reg.allocate_n(total, out);
+        const span<entity_handle<Type>> entities(out, total);
+
+        // allocation assigned default transforms, overwrite them in place
+        for (sz i = 0; i < total; ++i)
+        {
+            reg.template get_mut<transform_component>(out[i]) = _transforms[i % nodeCount];
+        }
+
+        // children are linked in node order, each node points at its first child and next sibling
+        using relationship_type = entity_relationship_component<Type>;
+        vector<u32> firstChild(nodeCount, no_parent);
+        vector<u32> nextSibling(nodeCount, no_parent);
+        for (sz node = nodeCount; node-- > 1; )
+        {
+            const u32 parent = _parents[node];
+            if (parent != no_parent)
+            {
+                nextSibling[node] = firstChild[parent];
+                firstChild[parent] = static_cast<u32>(node);
+            }
+        }
+
+        vector<relationship_type> relationships;
+        relationships.reserve(total);
+        for (sz copy = 0; copy < copies; ++copy)
+        {
+            const entity_handle<Type>* base = out + copy * nodeCount;
+            const auto resolve = [base](const u32 node) {
+                return node == no_parent ? relationship_type::tombstone : base[node].handle();
+            };
+
+            for (sz node = 0; node < nodeCount; ++node)
+            {
+                relationships.push_back(relationship_type{
+                        .parent = resolve(_parents[node]),
+                        .firstChild = resolve(firstChild[node]),
+                        .nextSibling = resolve(nextSibling[node])
+                    });
+            }
+        }
+        reg.assign_range(entities, span<relationship_type>(relationships.data(), total));
+
+        for (const auto& block : _blocks)
+        {
+            block->instantiate(reg, entities, nodeCount, copies);
+        }
+    }
+
+    namespace detail
+    {
+        template <typename Type, typename T>
+        inline void prefab_block<Type, T>::instantiate(base_registry<Type>& reg, const span<entity_handle<Type>> entities, const sz nodeCount, const sz copies) const
+        {
+            const sz total = nodes.size() * copies;
+
+            vector<entity_handle<Type>> targets;
+            vector<T> repeated;
+            targets.reserve(total);
+            repeated.reserve(total);
+            for (sz copy = 0; copy < copies; ++copy)
+            {
+                for (sz i = 0; i < nodes.size(); ++i)
+                {
+                    targets.push_back(entities[copy * nodeCount + nodes[i]]);
+                }
+                repeated.insert(repeated.end(), values.data(), values.data() + values.size());
+            }
+
+            reg.assign_range(span<entity_handle<Type>>(targets.data(), total), span<T>(repeated.data(), total));
+        }
+    }
+
+    using prefab = base_prefab<registry::entity_type>;
+}
+
+#endif // prefab_hpp__
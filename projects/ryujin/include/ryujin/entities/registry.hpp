@@ -10,8 +10,14 @@
 #include "transform_component.hpp"
 
 #include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/utility.hpp"
 #include "../core/vector.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
 #include <utility>
 
 namespace ryujin
@@ -19,6 +25,35 @@ namespace ryujin
     template <typename Type>
     class base_registry;
 
+    template <typename Type>
+    class entity_handle;
+
+    template <typename Type>
+    class base_observer;
+
+    template <typename ComponentType, typename EntityType>
+    struct component_remove_event;
+
+    struct component_pool_stats
+    {
+        sz identifier; // component identifier, as used by the registry's pool table
+        sz size; // live components
+        sz capacity; // packed key capacity
+        sz sparse_pages; // allocated sparse pages
+        f32 occupancy; // live components per entity identifier covered by the allocated sparse pages
+        sz bytes; // sparse pages, packed keys, values, change ticks and change journal
+    };
+
+    struct registry_stats
+    {
+        sz allocated; // entity identifiers handed out, live or free
+        sz active;
+        sz free_list_length;
+        sz entity_bytes; // entity list and component masks
+        sz component_bytes; // sum over all pools
+        vector<component_pool_stats> pools;
+    };
+
     namespace detail
     {
         struct pool_function_table
@@ -27,6 +62,14 @@ namespace ryujin
             bool (*contains)(void*, void*); // pool, entity pointer
             void (*remove)(void*, void*); // pool, entity pointer
             void (*delete_map)(void*); // pool
+            sz (*index_of)(void*, void*); // pool, entity pointer
+            void (*swap)(void*, sz, sz); // pool, packed index, packed index
+            void (*clear)(void*); // pool
+            void (*clone)(void*, void*, void*, void*); // pool, registry, source entity pointer, target entity pointer
+            void (*stats)(const void*, component_pool_stats*); // pool, output
+            void (*shrink_to_fit)(void*); // pool
+            void (*set_page_policy)(void*, sparse_page_policy); // pool, policy
+            void (*emit_remove)(void*, void*); // registry, entity pointer
         };
 
         struct pool
@@ -34,21 +77,282 @@ namespace ryujin
             sz identifier;
             void* sparse_map;
             pool_function_table fn;
+            sz group = ~sz(0); // owning group, if any
+        };
+
+        struct component_mask
+        {
+            static constexpr sz word_count = 2;
+            static constexpr sz capacity = word_count * 64; // component identifiers past this fall back to pool probes
+
+            u64 words[word_count] = {};
+
+            inline void set(const sz bit) noexcept
+            {
+                words[bit / 64] |= u64(1) << (bit % 64);
+            }
+
+            inline void reset(const sz bit) noexcept
+            {
+                words[bit / 64] &= ~(u64(1) << (bit % 64));
+            }
+
+            inline bool test(const sz bit) const noexcept
+            {
+                return (words[bit / 64] >> (bit % 64)) & 1;
+            }
+
+            inline bool contains_all(const component_mask& required) const noexcept
+            {
+                for (sz i = 0; i < word_count; ++i)
+                {
+                    if ((words[i] & required.words[i]) != required.words[i])
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            inline bool intersects(const component_mask& other) const noexcept
+            {
+                for (sz i = 0; i < word_count; ++i)
+                {
+                    if ((words[i] & other.words[i]) != 0)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            inline component_mask& operator|=(const component_mask& other) noexcept
+            {
+                for (sz i = 0; i < word_count; ++i)
+                {
+                    words[i] |= other.words[i];
+                }
+                return *this;
+            }
+
+            bool operator==(const component_mask&) const noexcept = default;
+
+            inline void clear() noexcept
+            {
+                for (auto& word : words)
+                {
+                    word = 0;
+                }
+            }
+
+            template <typename Fn>
+            inline void for_each(Fn&& fn) const
+            {
+                for (sz i = 0; i < word_count; ++i)
+                {
+                    for (u64 word = words[i]; word != 0; word &= word - 1)
+                    {
+                        fn(i * 64 + std::countr_zero(word));
+                    }
+                }
+            }
+        };
+
+        struct group_data
+        {
+            vector<sz> owned; // component identifiers of the owned pools
+            sz size = 0; // number of entities packed at the front of each owned pool
+        };
+
+        template <typename EntityType>
+        struct query_data
+        {
+            static constexpr u32 absent = ~u32(0);
+
+            component_mask required;
+            component_mask excluded;
+            vector<sz> requiredUnmasked; // identifiers past the mask capacity, matched by probing their pools
+            vector<sz> excludedUnmasked;
+            sz group = ~sz(0); // group whose packed range holds exactly the matches, the entity list is unused then
+            vector<EntityType> entities; // matching entities, unordered
+            vector<u32> index; // entity identifier -> position in entities
+        };
+
+        struct observed_components
+        {
+            component_mask mask;
+            vector<sz> unmasked; // identifiers past the mask capacity
+
+            inline void set(const sz id)
+            {
+                if (id < component_mask::capacity)
+                {
+                    mask.set(id);
+                }
+                else if (!test(id))
+                {
+                    unmasked.push_back(id);
+                }
+            }
+
+            inline bool test(const sz id) const noexcept
+            {
+                if (id < component_mask::capacity)
+                {
+                    return mask.test(id);
+                }
+                return std::find(unmasked.begin(), unmasked.end(), id) != unmasked.end();
+            }
+
+            inline bool empty() const noexcept
+            {
+                return mask == component_mask{} && unmasked.empty();
+            }
+
+            inline observed_components& operator|=(const observed_components& other)
+            {
+                mask |= other.mask;
+                for (const sz id : other.unmasked)
+                {
+                    set(id);
+                }
+                return *this;
+            }
+        };
+
+        struct observer_masks
+        {
+            observed_components added;
+            observed_components removed;
+            observed_components updated;
+
+            inline observer_masks& operator|=(const observer_masks& other)
+            {
+                added |= other.added;
+                removed |= other.removed;
+                updated |= other.updated;
+                return *this;
+            }
+        };
+
+        template <typename EntityType>
+        struct observer_data
+        {
+            static constexpr u32 absent = ~u32(0);
+
+            observer_masks masks;
+            vector<EntityType> entities; // collected since the last drain, unordered
+            vector<u32> index; // entity identifier -> position in entities
+
+            void collect(const EntityType entity)
+            {
+                if (entity.identifier >= index.size())
+                {
+                    const sz grown = index.size() * 2;
+                    index.resize(grown > entity.identifier ? grown : entity.identifier + 1, absent);
+                }
+
+                if (index[entity.identifier] == absent)
+                {
+                    index[entity.identifier] = static_cast<u32>(entities.size());
+                    entities.push_back(entity);
+                }
+                else
+                {
+                    // a recycled identifier replaces the destroyed entity it was collected for
+                    entities[index[entity.identifier]] = entity;
+                }
+            }
+
+            void discard(const EntityType entity)
+            {
+                if (entity.identifier >= index.size() || index[entity.identifier] == absent)
+                {
+                    return;
+                }
+
+                const u32 position = index[entity.identifier];
+                const EntityType last = entities.back();
+                entities[position] = last;
+                index[last.identifier] = position;
+                entities.pop_back();
+                index[entity.identifier] = absent;
+            }
+
+            void clear()
+            {
+                for (const EntityType entity : entities)
+                {
+                    index[entity.identifier] = absent;
+                }
+                entities.clear();
+            }
+        };
+
+        // binary snapshot layout, every block is padded so that the following block starts aligned
+        struct snapshot_header
+        {
+            static constexpr u32 magic_value = 0x4e4a5952; // "RYJN"
+            static constexpr u32 current_version = 1;
+
+            u32 magic;
+            u32 version;
+            u32 component_count;
+            u32 entity_size;
+            u64 entity_count;
+            u64 active;
         };
 
+        struct snapshot_pool_header
+        {
+            u64 count;
+            u64 value_size; // zero for tag components, which store keys only
+        };
+
+        inline constexpr sz snapshot_alignment = 16;
+
+        inline constexpr sz snapshot_padded(const sz bytes) noexcept
+        {
+            return (bytes + snapshot_alignment - 1) & ~(snapshot_alignment - 1);
+        }
+
+        inline void snapshot_write(vector<u8>& out, const void* data, const sz bytes)
+        {
+            const sz offset = out.size();
+            out.resize(offset + snapshot_padded(bytes), 0);
+            if (bytes > 0)
+            {
+                ryujin::memcpy(out.data() + offset, data, bytes);
+            }
+        }
+
+        inline const u8* snapshot_read(const u8*& cursor, const u8* end, const sz bytes) noexcept
+        {
+            const sz padded = snapshot_padded(bytes);
+            if (static_cast<sz>(end - cursor) < padded)
+            {
+                return nullptr;
+            }
+
+            const u8* block = cursor;
+            cursor += padded;
+            return block;
+        }
+
         struct component_identifier_utility
         {
-            static sz id;
+            // command buffers may first touch a component type while recording on worker threads
+            static std::atomic<sz> id;
 
             template <typename T>
             static sz fetch_identifier()
             {
-                static sz typeId = id++;
+                static const sz typeId = id.fetch_add(1, std::memory_order_relaxed);
                 return typeId;
             }
         };
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
+        template <typename EntityType, typename ComponentType>
         class component_view_iterable
         {
         public:
@@ -67,7 +371,7 @@ namespace ryujin
             friend class base_registry<EntityType>;
         };
 
-        template <typename EntityType, typename PoolValueType, sz PageSize>
+        template <typename EntityType, typename PoolValueType>
         constexpr pool_function_table construct_pool_fn_table()
         {
             pool_function_table table;
@@ -75,73 +379,127 @@ namespace ryujin
             table.contains = [](void* raw, void* e) {
                 pool* p = reinterpret_cast<pool*>(raw);
                 void* rawSparseMap = p->sparse_map;
-                sparse_map<EntityType, PoolValueType, PageSize>* sparseMap = reinterpret_cast<sparse_map<EntityType, PoolValueType, PageSize>*>(rawSparseMap);
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
                 return sparseMap->contains(*reinterpret_cast<EntityType*>(e));
             };
             table.remove = [](void* raw, void* e) {
                 pool* p = reinterpret_cast<pool*>(raw);
                 void* rawSparseMap = p->sparse_map;
-                sparse_map<EntityType, PoolValueType, PageSize>* sparseMap = reinterpret_cast<sparse_map<EntityType, PoolValueType, PageSize>*>(rawSparseMap);
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
                 sparseMap->remove(*reinterpret_cast<EntityType*>(e));
             };
             table.delete_map = [](void* raw) {
                 pool* p = reinterpret_cast<pool*>(raw);
                 void* rawSparseMap = p->sparse_map;
-                sparse_map<EntityType, PoolValueType, PageSize>* sparseMap = reinterpret_cast<sparse_map<EntityType, PoolValueType, PageSize>*>(rawSparseMap);
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
                 delete sparseMap;
             };
+            table.index_of = [](void* raw, void* e) {
+                pool* p = reinterpret_cast<pool*>(raw);
+                void* rawSparseMap = p->sparse_map;
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
+                return sparseMap->index_of(*reinterpret_cast<EntityType*>(e));
+            };
+            table.swap = [](void* raw, sz lhs, sz rhs) {
+                pool* p = reinterpret_cast<pool*>(raw);
+                void* rawSparseMap = p->sparse_map;
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
+                sparseMap->swap_indices(lhs, rhs);
+            };
+            table.clear = [](void* raw) {
+                pool* p = reinterpret_cast<pool*>(raw);
+                void* rawSparseMap = p->sparse_map;
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
+                sparseMap->clear();
+            };
+            table.clone = [](void* raw, void* reg, void* source, void* target) {
+                pool* p = reinterpret_cast<pool*>(raw);
+                void* rawSparseMap = p->sparse_map;
+                pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(rawSparseMap);
+                const EntityType src = *reinterpret_cast<EntityType*>(source);
+                if (sparseMap->contains(src))
+                {
+                    // copied out first, assigning may grow the pool the value lives in
+                    const PoolValueType value = sparseMap->get(src);
+                    entity_handle<EntityType> handle(*reinterpret_cast<EntityType*>(target), reinterpret_cast<base_registry<EntityType>*>(reg));
+                    reinterpret_cast<base_registry<EntityType>*>(reg)->assign_or_replace(handle, value);
+                }
+            };
+            table.stats = [](const void* raw, component_pool_stats* out) {
+                const pool* p = reinterpret_cast<const pool*>(raw);
+                const pool_map_t<EntityType, PoolValueType>* sparseMap = reinterpret_cast<const pool_map_t<EntityType, PoolValueType>*>(p->sparse_map);
+                const sz pages = sparseMap->sparse_page_count();
+                out->identifier = p->identifier;
+                out->size = sparseMap->size();
+                out->capacity = sparseMap->capacity();
+                out->sparse_pages = pages;
+                out->occupancy = pages > 0 ? static_cast<f32>(sparseMap->size()) / static_cast<f32>(pages * component_traits<PoolValueType>::page_size) : 0.0f;
+                out->bytes = sparseMap->memory_usage();
+            };
+            table.shrink_to_fit = [](void* raw) {
+                pool* p = reinterpret_cast<pool*>(raw);
+                reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(p->sparse_map)->shrink_to_fit();
+            };
+            table.set_page_policy = [](void* raw, sparse_page_policy policy) {
+                pool* p = reinterpret_cast<pool*>(raw);
+                reinterpret_cast<pool_map_t<EntityType, PoolValueType>*>(p->sparse_map)->set_page_policy(policy);
+            };
+            table.emit_remove = [](void* reg, void* e) {
+                base_registry<EntityType>* registry = reinterpret_cast<base_registry<EntityType>*>(reg);
+                registry->events().template emit<component_remove_event<PoolValueType, EntityType>>(entity_handle<EntityType>(*reinterpret_cast<EntityType*>(e), registry));
+            };
             return table;
         }
 
-        template <typename EntityType, typename ValueType, sz PageSize>
+        template <typename EntityType, typename ValueType>
         pool allocate_pool(const sz identifier)
         {
             pool p;
             p.identifier = identifier;
-            p.fn = construct_pool_fn_table<EntityType, ValueType, PageSize>();
-            p.sparse_map = new sparse_map<EntityType, ValueType, PageSize>();
+            p.fn = construct_pool_fn_table<EntityType, ValueType>();
+            p.sparse_map = new pool_map_t<EntityType, ValueType>();
             return p;
         }
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
-        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType, PageSize>::begin() noexcept
+        template <typename EntityType, typename ComponentType>
+        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType>::begin() noexcept
         {
-            sparse_map<EntityType, ComponentType, PageSize>* map = reinterpret_cast<sparse_map<EntityType, ComponentType, PageSize>*>(_pool.sparse_map);
+            pool_map_t<EntityType, ComponentType>* map = reinterpret_cast<pool_map_t<EntityType, ComponentType>*>(_pool.sparse_map);
             return map->value_begin();
         }
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
-        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType, PageSize>::begin() const noexcept
+        template <typename EntityType, typename ComponentType>
+        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType>::begin() const noexcept
         {
-            const sparse_map<EntityType, ComponentType, PageSize>* map = reinterpret_cast<const sparse_map<EntityType, ComponentType, PageSize>*>(_pool.sparse_map);
+            const pool_map_t<EntityType, ComponentType>* map = reinterpret_cast<const pool_map_t<EntityType, ComponentType>*>(_pool.sparse_map);
             return map->value_begin();
         }
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
-        inline const auto ryujin::detail::component_view_iterable<EntityType, ComponentType, PageSize>::cbegin() const noexcept
+        template <typename EntityType, typename ComponentType>
+        inline const auto ryujin::detail::component_view_iterable<EntityType, ComponentType>::cbegin() const noexcept
         {
-            const sparse_map<EntityType, ComponentType, PageSize>* map = reinterpret_cast<const sparse_map<EntityType, ComponentType, PageSize>*>(_pool.sparse_map);
+            const pool_map_t<EntityType, ComponentType>* map = reinterpret_cast<const pool_map_t<EntityType, ComponentType>*>(_pool.sparse_map);
             return map->value_cbegin();
         }
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
-        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType, PageSize>::end() noexcept
+        template <typename EntityType, typename ComponentType>
+        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType>::end() noexcept
         {
-            sparse_map<EntityType, ComponentType, PageSize>* map = reinterpret_cast<sparse_map<EntityType, ComponentType, PageSize>*>(_pool.sparse_map);
+            pool_map_t<EntityType, ComponentType>* map = reinterpret_cast<pool_map_t<EntityType, ComponentType>*>(_pool.sparse_map);
             return map->value_end();
         }
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
-        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType, PageSize>::end() const noexcept
+        template <typename EntityType, typename ComponentType>
+        inline auto ryujin::detail::component_view_iterable<EntityType, ComponentType>::end() const noexcept
         {
-            const sparse_map<EntityType, ComponentType, PageSize>* map = reinterpret_cast<const sparse_map<EntityType, ComponentType, PageSize>*>(_pool.sparse_map);
+            const pool_map_t<EntityType, ComponentType>* map = reinterpret_cast<const pool_map_t<EntityType, ComponentType>*>(_pool.sparse_map);
             return map->value_end();
         }
 
-        template <typename EntityType, typename ComponentType, sz PageSize>
-        inline const auto ryujin::detail::component_view_iterable<EntityType, ComponentType, PageSize>::cend() const noexcept
+        template <typename EntityType, typename ComponentType>
+        inline const auto ryujin::detail::component_view_iterable<EntityType, ComponentType>::cend() const noexcept
         {
-            const sparse_map<EntityType, ComponentType, PageSize>* map = reinterpret_cast<const sparse_map<EntityType, ComponentType, PageSize>*>(_pool.sparse_map);
+            const pool_map_t<EntityType, ComponentType>* map = reinterpret_cast<const pool_map_t<EntityType, ComponentType>*>(_pool.sparse_map);
             return map->value_cend();
         }
     }
@@ -167,6 +525,12 @@ namespace ryujin
         template <typename T>
         T* try_get() const noexcept;
 
+        template <typename T>
+        T& get_mut() const noexcept;
+
+        template <typename T, typename Fn>
+        entity_handle& patch(Fn&& fn);
+
         template <typename T>
         entity_handle& remove();
 
@@ -186,6 +550,34 @@ namespace ryujin
         template <typename EntityType, typename ... Ts>
         class entity_view_iterator
         {
+        public:
+            using pool_pointers = tuple<typename base_registry<EntityType>::template pool_type<Ts>*...>;
+
+            entity_view_iterator(base_registry<EntityType>* base_registry, const EntityType* current, const EntityType* last, const pool_pointers& pools, sz driver);
+
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = tuple<entity_handle<EntityType>, Ts&...>;
+
+            bool operator==(const entity_view_iterator& rhs) const noexcept;
+            bool operator!=(const entity_view_iterator& rhs) const noexcept;
+
+            entity_view_iterator& operator++();
+            entity_view_iterator operator++(int);
+
+            value_type operator*() const;
+        private:
+            base_registry<EntityType>* _registry;
+            const EntityType* _current;
+            const EntityType* _last;
+            pool_pointers _pools;
+            sz _driver; // index of the pool whose keys are walked
+
+            void _skip();
+        };
+
+        template <typename EntityType>
+        class entity_view_iterator<EntityType>
+        {
         public:
             entity_view_iterator(base_registry<EntityType>* base_registry, sz index, sz nextFreeIndex)
                 : _registry(base_registry), _index(index), _nextFreeIndex(nextFreeIndex)
@@ -193,8 +585,7 @@ namespace ryujin
             }
 
             using iterator_category = std::forward_iterator_tag;
-            using value_type = entity_handle<EntityType>;
-            using reference_type = entity_handle<EntityType>&;
+            using value_type = tuple<entity_handle<EntityType>>;
 
             bool operator==(const entity_view_iterator& rhs) const noexcept;
             bool operator!=(const entity_view_iterator& rhs) const noexcept;
@@ -202,7 +593,6 @@ namespace ryujin
             entity_view_iterator& operator++();
             entity_view_iterator operator++(int);
 
-            value_type operator*();
             value_type operator*() const;
         private:
             base_registry<EntityType>* _registry;
@@ -216,78 +606,262 @@ namespace ryujin
         public:
             entity_view_iterable(base_registry<EntityType>* base_registry);
 
-            auto begin() noexcept;
             auto begin() const noexcept;
             const auto cbegin() const noexcept;
 
-            auto end() noexcept;
             auto end() const noexcept;
             const auto cend() const noexcept;
+
+            template <typename Fn>
+            void each(Fn&& fn) const;
         private:
+            using pool_pointers = typename entity_view_iterator<EntityType, ComponentTypes...>::pool_pointers;
+
             base_registry<EntityType>* _registry;
+            pool_pointers _pools;
+            const EntityType* _first = nullptr;
+            const EntityType* _last = nullptr;
+            sz _driver = 0;
         };
-    }
 
-    template <typename ComponentType, typename EntityType>
-    struct component_add_event
-    {
-        component_add_event(const ComponentType& value, const entity_handle<EntityType> entity)
-            : value(value), entity(entity)
-        {}
-
-        const ComponentType& value;
-        const entity_handle<EntityType> entity;
-    };
+        template <typename EntityType>
+        class entity_view_iterable<EntityType>
+        {
+        public:
+            entity_view_iterable(base_registry<EntityType>* base_registry);
 
-    template <typename ComponentType, typename EntityType>
-    struct component_remove_event
-    {
-        component_remove_event(const entity_handle<EntityType> entity)
-            : entity(entity)
-        {}
+            auto begin() const noexcept;
+            const auto cbegin() const noexcept;
 
-        const entity_handle<EntityType> entity;
-    };
+            auto end() const noexcept;
+            const auto cend() const noexcept;
 
-    template <typename ComponentType, typename EntityType>
-    struct component_replace_event
-    {
-        component_replace_event(const entity_handle<EntityType> entity)
-            : entity(entity)
-        {}
+            template <typename Fn>
+            void each(Fn&& fn) const;
+        private:
+            base_registry<EntityType>* _registry;
+        };
 
-        const entity_handle<EntityType> entity;
-    };
+        template <typename EntityType, typename ... ComponentTypes>
+        class entity_group_iterator
+        {
+        public:
+            entity_group_iterator(base_registry<EntityType>* base_registry, sz index);
 
-    template <typename Type>
-    class base_registry
-    {
-    public:
-        using entity_type = Type;
-        using entity_type_traits = entity_traits<typename Type::type>;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = tuple<entity_handle<EntityType>, ComponentTypes&...>;
 
-        base_registry();
-        base_registry(const base_registry&) = delete;
-        base_registry(base_registry&&) noexcept = delete;
-        ~base_registry();
+            bool operator==(const entity_group_iterator& rhs) const noexcept;
+            bool operator!=(const entity_group_iterator& rhs) const noexcept;
 
-        base_registry& operator=(const base_registry&) = delete;
-        base_registry& operator=(base_registry&&) noexcept = delete;
+            entity_group_iterator& operator++();
+            entity_group_iterator operator++(int);
 
-        sz active() const noexcept;
-        sz capacity() const noexcept;
-        sz allocated() const noexcept;
+            value_type operator*() const;
+        private:
+            base_registry<EntityType>* _registry;
+            sz _index;
+        };
 
-        entity_handle<Type> allocate();
-        void deallocate(entity_handle<Type>& handle);
+        template <typename EntityType, typename ... ComponentTypes>
+        class entity_group_iterable
+        {
+        public:
+            entity_group_iterable(base_registry<EntityType>* base_registry, sz group);
 
-        template <typename T>
-        void assign(entity_handle<Type>& handle, const T& value);
+            // false if the group could not be created because one of its pools is owned by another group, an invalid
+            // group is always empty
+            bool valid() const noexcept;
+            sz size() const noexcept;
+            bool empty() const noexcept;
 
-        template <typename T>
-        void assign_or_replace(entity_handle<Type>& handle, const T& value);
+            auto begin() const noexcept;
+            auto end() const noexcept;
 
-        template <typename T, typename ... Ts>
+            template <typename Fn>
+            void each(Fn&& fn) const;
+        private:
+            base_registry<EntityType>* _registry;
+            sz _group;
+        };
+
+        template <typename EntityType, typename ComponentType>
+        class entity_change_iterator
+        {
+        public:
+            using pool_pointer = typename base_registry<EntityType>::template pool_type<ComponentType>*;
+
+            // journaled iterators walk the pool's change journal, others every packed value
+            entity_change_iterator(base_registry<EntityType>* base_registry, pool_pointer pool, sz index, sz last, bool journaled);
+
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = tuple<entity_handle<EntityType>, ComponentType&>;
+
+            bool operator==(const entity_change_iterator& rhs) const noexcept;
+            bool operator!=(const entity_change_iterator& rhs) const noexcept;
+
+            entity_change_iterator& operator++();
+            entity_change_iterator operator++(int);
+
+            value_type operator*() const;
+        private:
+            base_registry<EntityType>* _registry;
+            pool_pointer _pool;
+            sz _index;
+            sz _last;
+            sz _packed = 0; // packed index of the current value
+            bool _journaled;
+
+            void _skip() noexcept;
+        };
+
+        template <typename EntityType, typename ... ComponentTypes>
+        class entity_query_iterator
+        {
+        public:
+            entity_query_iterator(base_registry<EntityType>* base_registry, sz query, sz index);
+
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = tuple<entity_handle<EntityType>, ComponentTypes&...>;
+
+            bool operator==(const entity_query_iterator& rhs) const noexcept;
+            bool operator!=(const entity_query_iterator& rhs) const noexcept;
+
+            entity_query_iterator& operator++();
+            entity_query_iterator operator++(int);
+
+            value_type operator*() const;
+        private:
+            base_registry<EntityType>* _registry;
+            sz _query;
+            sz _index;
+        };
+
+        template <typename EntityType, typename ... ComponentTypes>
+        class entity_query_iterable
+        {
+        public:
+            entity_query_iterable(base_registry<EntityType>* base_registry, sz query);
+
+            sz size() const noexcept;
+            bool empty() const noexcept;
+
+            auto begin() const noexcept;
+            auto end() const noexcept;
+
+            template <typename Fn>
+            void each(Fn&& fn) const;
+        private:
+            base_registry<EntityType>* _registry;
+            sz _query;
+        };
+
+        template <typename EntityType, typename ComponentType>
+        class entity_change_iterable
+        {
+        public:
+            entity_change_iterable(base_registry<EntityType>* base_registry, u64 since);
+
+            auto begin() const noexcept;
+            auto end() const noexcept;
+
+            template <typename Fn>
+            void each(Fn&& fn) const;
+        private:
+            base_registry<EntityType>* _registry;
+            typename base_registry<EntityType>::template pool_type<ComponentType>* _pool;
+            sz _first = 0;
+            sz _last = 0;
+            bool _journaled = false;
+        };
+    }
+
+    /// <summary>
+    /// Components an entity must not have to match a query, passed as query&lt;Ts...&gt;(exclude&lt;Us...&gt;).
+    /// </summary>
+    template <typename ... Ts>
+    struct exclude_t
+    {
+    };
+
+    template <typename ... Ts>
+    inline constexpr exclude_t<Ts...> exclude{};
+
+    template <typename ComponentType, typename EntityType>
+    struct component_add_event
+    {
+        component_add_event(const ComponentType& value, const entity_handle<EntityType> entity)
+            : value(value), entity(entity)
+        {}
+
+        const ComponentType& value;
+        const entity_handle<EntityType> entity;
+    };
+
+    template <typename ComponentType, typename EntityType>
+    struct component_batch_add_event
+    {
+        component_batch_add_event(const span<EntityType> entities, base_registry<EntityType>* registry)
+            : entities(entities), registry(registry)
+        {}
+
+        const span<EntityType> entities;
+        base_registry<EntityType>* const registry;
+    };
+
+    template <typename ComponentType, typename EntityType>
+    struct component_remove_event
+    {
+        component_remove_event(const entity_handle<EntityType> entity)
+            : entity(entity)
+        {}
+
+        const entity_handle<EntityType> entity;
+    };
+
+    template <typename ComponentType, typename EntityType>
+    struct component_replace_event
+    {
+        component_replace_event(const entity_handle<EntityType> entity)
+            : entity(entity)
+        {}
+
+        const entity_handle<EntityType> entity;
+    };
+
+    template <typename Type>
+    class base_registry
+    {
+    public:
+        using entity_type = Type;
+        using entity_type_traits = entity_traits<typename Type::type>;
+
+        base_registry();
+        base_registry(const base_registry&) = delete;
+        base_registry(base_registry&&) noexcept = delete;
+        ~base_registry();
+
+        base_registry& operator=(const base_registry&) = delete;
+        base_registry& operator=(base_registry&&) noexcept = delete;
+
+        sz active() const noexcept;
+        sz capacity() const noexcept;
+        sz allocated() const noexcept;
+
+        entity_handle<Type> allocate();
+        void allocate_n(const sz count, entity_handle<Type>* out);
+        void deallocate(entity_handle<Type>& handle);
+
+        template <typename T>
+        void assign(entity_handle<Type>& handle, const T& value);
+
+        template <typename T>
+        void assign_range(const span<entity_handle<Type>> entities, const span<T> values);
+
+        template <typename T>
+        void assign_or_replace(entity_handle<Type>& handle, const T& value);
+
+        template <typename T, typename ... Ts>
         bool contains(const entity_handle<Type>& handle) const;
 
         template <typename T>
@@ -296,6 +870,12 @@ namespace ryujin
         template <typename T>
         T* try_get(const entity_handle<Type>& handle) const noexcept;
 
+        template <typename T>
+        T& get_mut(const entity_handle<Type>& handle) noexcept;
+
+        template <typename T, typename Fn>
+        void patch(entity_handle<Type>& handle, Fn&& fn);
+
         template <typename T>
         void remove(entity_handle<Type>& handle);
 
@@ -304,28 +884,114 @@ namespace ryujin
 
         entity_handle<Type> at(const sz idx) noexcept;
 
+        // copies every component of source onto target, replacing components target already has
+        void clone(const entity_handle<Type>& source, entity_handle<Type>& target);
+
         template <typename T>
         auto component_view() noexcept;
 
         template <typename ... Ts>
         auto entity_view() noexcept;
 
+        template <typename T>
+        sz size() const noexcept;
+
+        template <typename ... Ts>
+        void register_components();
+
+        // appends the entity list, free list and the packed pools of Ts to out, component values are copied as blocks
+        template <typename ... Ts>
+        void snapshot(vector<u8>& out) const;
+
+        // replaces the registry contents with a snapshot taken with the same component list, returns false and leaves
+        // the registry untouched if the data is not a valid snapshot; no component events are emitted
+        template <typename ... Ts>
+        bool restore(const u8* data, const sz size);
+
+        template <typename T>
+        void track_changes();
+
+        template <typename T, typename Compare>
+        bool sort(Compare&& cmp);
+
+        template <typename T, typename U>
+        bool sort_as();
+
+        u64 tick() const noexcept;
+
+        // values of T touched after tick, found through the pool's change journal without scanning the pool when T
+        // tracks changes, every value otherwise; compacts the journal, so it must not be called while iterating
+        // another change view of T
+        template <typename T>
+        auto updated_since(const u64 tick) noexcept;
+
+        // owning group that packs its pools for iteration, invalid if any of the pools is owned by a different group
+        template <typename T, typename ... Ts>
+        auto group();
+
+        // persistent query kept up to date as components are added and removed, repeated calls with the same
+        // component sets return the same query
+        template <typename T, typename ... Ts, typename ... Excludes>
+        auto query(exclude_t<Excludes...> = {});
+
         auto& events() noexcept;
         auto& events() const noexcept;
 
+        registry_stats stats() const;
+
+        // page policy of every current and future pool
+        void set_page_policy(const sparse_page_policy policy);
+
+        // releases empty sparse pages and excess capacity of every pool
+        void shrink_to_fit();
+
         entity_handle<Type> invalid() noexcept;
 
     private:
-        static constexpr sz _poolSize = 1024;
+        template <typename T>
+        using pool_type = detail::pool_map_t<entity_type, T>;
         static constexpr entity_type _tombstone = entity_traits<typename entity_type::type>::from_type(~(typename entity_type::type)(0));
 
         vector<detail::pool> _pools;
         vector<entity_type> _entities;
+        vector<detail::component_mask> _masks; // per entity identifier
         entity_type _freeListHead = _tombstone;
 
+        vector<detail::group_data> _groups;
+        vector<detail::query_data<entity_type>> _queries;
+        vector<detail::observer_data<entity_type>*> _observers;
+        detail::observer_masks _observed; // union of every observer's masks
+        u64 _changeTick = 0;
+        sparse_page_policy _pagePolicy = sparse_page_policy::keep;
+
         entity_type _allocateNewIdentifier();
         entity_type _recycleExistingIdentifier();
 
+        template <typename T>
+        pool_type<T>* _fetchPool() const noexcept;
+
+        template <typename T>
+        detail::pool& _fetchOrCreatePool();
+
+        template <typename T>
+        static sz _componentId() noexcept;
+
+        bool _isAlive(const entity_type entity) const noexcept;
+
+        template <typename T>
+        void _stamp(pool_type<T>* pool, const entity_type entity);
+
+        void _enterGroup(const sz group, entity_type entity);
+        void _leaveGroup(const sz group, entity_type entity);
+
+        bool _matchesQuery(const detail::query_data<entity_type>& query, const entity_type entity);
+        void _refreshQueries(const entity_type entity);
+        void _rebuildQuery(detail::query_data<entity_type>& query);
+
+        void _notifyObservers(detail::observed_components detail::observer_masks::* kind, const sz id, const entity_type entity);
+        void _attachObserver(detail::observer_data<entity_type>* observer);
+        void _detachObserver(detail::observer_data<entity_type>* observer);
+
         sz _active;
 
         event_manager _events;
@@ -333,7 +999,28 @@ namespace ryujin
         template <typename EntityType, typename ... ComponentTypes>
         friend class detail::entity_view_iterable;
 
-        friend class detail::entity_view_iterator<Type>;
+        template <typename EntityType, typename ... ComponentTypes>
+        friend class detail::entity_view_iterator;
+
+        template <typename EntityType, typename ... ComponentTypes>
+        friend class detail::entity_group_iterable;
+
+        template <typename EntityType, typename ... ComponentTypes>
+        friend class detail::entity_group_iterator;
+
+        template <typename EntityType, typename ... ComponentTypes>
+        friend class detail::entity_query_iterable;
+
+        template <typename EntityType, typename ... ComponentTypes>
+        friend class detail::entity_query_iterator;
+
+        template <typename EntityType, typename ComponentType>
+        friend class detail::entity_change_iterator;
+
+        template <typename EntityType, typename ComponentType>
+        friend class detail::entity_change_iterable;
+
+        friend class base_observer<Type>;
     };
 
     template <typename Type>
@@ -401,16 +1088,27 @@ namespace ryujin
         return _registry->template try_get<T>(*this);
     }
 
+    template <typename Type>
+    template <typename T>
+    inline T& entity_handle<Type>::get_mut() const noexcept
+    {
+        return _registry->template get_mut<T>(*this);
+    }
+
+    template <typename Type>
+    template <typename T, typename Fn>
+    inline entity_handle<Type>& entity_handle<Type>::patch(Fn&& fn)
+    {
+        _registry->template patch<T>(*this, ryujin::forward<Fn>(fn));
+        return *this;
+    }
+
 
     template <typename Type>
     inline base_registry<Type>::base_registry()
         : _active(0)
     {
-        using T = entity_relationship_component<Type>;
-
-        const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        auto pool = detail::allocate_pool<entity_type, T, _poolSize>(typeId);
-        _pools.push_back(pool);
+        _fetchOrCreatePool<entity_relationship_component<Type>>();
     }
 
     template <typename Type>
@@ -450,22 +1148,88 @@ namespace ryujin
     template <typename Type>
     inline entity_handle<Type> base_registry<Type>::allocate()
     {
-        entity_type entity = _freeListHead == _tombstone ? _allocateNewIdentifier() : _recycleExistingIdentifier();
+        entity_type entity = _freeListHead.identifier == _tombstone.identifier ? _allocateNewIdentifier() : _recycleExistingIdentifier();
         ++_active;
         auto handle = entity_handle(entity, this);
         assign<transform_component>(handle, {});
         return handle;
     }
     
+    template <typename Type>
+    inline void base_registry<Type>::allocate_n(const sz count, entity_handle<Type>* out)
+    {
+        _entities.reserve(_entities.size() + count);
+        _masks.reserve(_masks.size() + count);
+
+        for (sz i = 0; i < count; ++i)
+        {
+            entity_type entity = _freeListHead.identifier == _tombstone.identifier ? _allocateNewIdentifier() : _recycleExistingIdentifier();
+            out[i] = entity_handle(entity, this);
+        }
+        _active += count;
+
+        const vector<transform_component> transforms(count, transform_component{});
+        assign_range<transform_component>(span<entity_handle<Type>>(out, count), span<transform_component>(transforms.data(), count));
+    }
+
     template <typename Type>
     inline void base_registry<Type>::deallocate(entity_handle<Type>& handle)
     {
         auto entity = handle.handle();
-    
-        // release value from pools
-        for (auto& pool : _pools)
+
+        // a stale handle must neither free its identifier twice nor strip the components of the identifier's new owner
+        if (!_isAlive(entity))
+        {
+            return;
+        }
+
+        // pull the entity out of any group before its components are swapped out of the pools
+        for (sz group = 0; group < _groups.size(); ++group)
         {
+            _leaveGroup(group, entity);
+        }
+    
+        // release value from only the pools the entity is known to be in
+        const detail::component_mask removed = _masks[entity.identifier];
+        removed.for_each([&](const sz id) {
+            auto& pool = _pools[id];
             pool.fn.remove(&pool, &entity);
+            _notifyObservers(&detail::observer_masks::removed, id, entity);
+        });
+        _masks[entity.identifier].clear();
+
+        // observers without removal matchers only report live entities
+        for (auto observer : _observers)
+        {
+            if (observer->masks.removed.empty())
+            {
+                observer->discard(entity);
+            }
+        }
+
+        vector<sz> removedUnmasked;
+        for (sz id = detail::component_mask::capacity; id < _pools.size(); ++id)
+        {
+            auto& pool = _pools[id];
+            if (pool.sparse_map && pool.fn.contains(&pool, &entity))
+            {
+                pool.fn.remove(&pool, &entity);
+                _notifyObservers(&detail::observer_masks::removed, id, entity);
+                removedUnmasked.push_back(id);
+            }
+        }
+        _refreshQueries(entity);
+
+        // remove events go out once the entity has left every pool, as if each component had been removed in turn;
+        // the function tables are copied, handlers may register new pools
+        removed.for_each([&](const sz id) {
+            const auto emit = _pools[id].fn.emit_remove;
+            emit(this, &entity);
+        });
+        for (const sz id : removedUnmasked)
+        {
+            const auto emit = _pools[id].fn.emit_remove;
+            emit(this, &entity);
         }
 
         auto identifier = entity.identifier;
@@ -493,6 +1257,23 @@ namespace ryujin
         }
     }
 
+    template <typename Type>
+    inline void base_registry<Type>::clone(const entity_handle<Type>& source, entity_handle<Type>& target)
+    {
+        auto src = source.handle();
+        auto dst = target.handle();
+
+        // index based with a copied pool, add event handlers may register new pools while cloning
+        for (sz id = 0; id < _pools.size(); ++id)
+        {
+            if (_pools[id].sparse_map)
+            {
+                detail::pool p = _pools[id];
+                p.fn.clone(&p, this, &src, &dst);
+            }
+        }
+    }
+
     template<typename Type>
     inline entity_handle<Type> ryujin::base_registry<Type>::at(const sz idx) noexcept
     {
@@ -509,60 +1290,115 @@ namespace ryujin
     template <typename T>
     inline void base_registry<Type>::assign(entity_handle<Type>& handle, const T& value)
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        while (typeId >= _pools.size())
-        {
-            detail::pool p;
-            p.sparse_map = nullptr;
-            p.identifier = ~sz(0);
-
-            _pools.push_back(p);
-        }
-
-        if (_pools[typeId].sparse_map == nullptr)
-        {
-            _pools[typeId] = detail::allocate_pool<entity_type, T, _poolSize>(typeId);
-        }
-
         auto entity = handle.handle();
-        detail::pool& pool = _pools[typeId];
-        sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
+        detail::pool& pool = _fetchOrCreatePool<T>();
+        pool_type<T>* sparseMap = reinterpret_cast<pool_type<T>*>(pool.sparse_map);
         const auto inserted = sparseMap->insert(entity, value);
         if (inserted)
         {
+            if (pool.identifier < detail::component_mask::capacity)
+            {
+                _masks[entity.identifier].set(pool.identifier);
+            }
+
+            if (pool.group != ~sz(0))
+            {
+                _enterGroup(pool.group, entity);
+            }
+            _refreshQueries(entity);
+            _notifyObservers(&detail::observer_masks::added, pool.identifier, entity);
+            _stamp(sparseMap, entity);
             _events.emit<component_add_event<T, Type>>(value, handle);
         }
     }
 
     template <typename Type>
     template <typename T>
-    inline void base_registry<Type>::assign_or_replace(entity_handle<Type>& handle, const T& value)
+    inline void base_registry<Type>::assign_range(const span<entity_handle<Type>> entities, const span<T> values)
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        while (typeId >= _pools.size())
-        {
-            detail::pool p;
-            p.sparse_map = nullptr;
-            p.identifier = ~sz(0);
+        assert(entities.length() == values.length() && "Entity and value ranges must be the same length.");
 
-            _pools.push_back(p);
+        const sz count = entities.length();
+        if (count == 0)
+        {
+            return;
         }
 
-        if (_pools[typeId].sparse_map == nullptr)
+        detail::pool& pool = _fetchOrCreatePool<T>();
+        pool_type<T>* sparseMap = reinterpret_cast<pool_type<T>*>(pool.sparse_map);
+
+        vector<entity_type> keys;
+        keys.reserve(count);
+        for (sz i = 0; i < count; ++i)
+        {
+            keys.push_back(entities[i].handle());
+        }
+
+        const sz first = sparseMap->size();
+        if (sparseMap->insert(keys.data(), keys.data() + count, values.data()) == 0)
+        {
+            return;
+        }
+
+        // newly inserted keys sit at the back of the pool, copy them out before group packing reorders it
+        keys.clear();
+        keys.insert(keys.end(), sparseMap->key_begin() + first, sparseMap->key_end());
+
+        if (sparseMap->tracks_changes())
+        {
+            ++_changeTick;
+            for (sz i = first; i < sparseMap->size(); ++i)
+            {
+                sparseMap->touch_at(i, _changeTick);
+            }
+        }
+
+        for (const entity_type entity : keys)
         {
-            _pools[typeId] = detail::allocate_pool<entity_type, T, _poolSize>(typeId);
+            if (pool.identifier < detail::component_mask::capacity)
+            {
+                _masks[entity.identifier].set(pool.identifier);
+            }
+
+            if (pool.group != ~sz(0))
+            {
+                _enterGroup(pool.group, entity);
+            }
+            _refreshQueries(entity);
+            _notifyObservers(&detail::observer_masks::added, pool.identifier, entity);
         }
 
+        _events.emit<component_batch_add_event<T, Type>>(span<entity_type>(keys.data(), keys.size()), this);
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline void base_registry<Type>::assign_or_replace(entity_handle<Type>& handle, const T& value)
+    {
         auto entity = handle.handle();
-        detail::pool& pool = _pools[typeId];
-        sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
+        detail::pool& pool = _fetchOrCreatePool<T>();
+        pool_type<T>* sparseMap = reinterpret_cast<pool_type<T>*>(pool.sparse_map);
         const auto replaced = sparseMap->insert_or_replace(entity, value);
         if (replaced)
         {
+            _stamp(sparseMap, entity);
+            _notifyObservers(&detail::observer_masks::updated, pool.identifier, entity);
             _events.emit<component_replace_event<T, Type>>(handle);
         }
         else
         {
+            if (pool.identifier < detail::component_mask::capacity)
+            {
+                _masks[entity.identifier].set(pool.identifier);
+            }
+
+            if (pool.group != ~sz(0))
+            {
+                _enterGroup(pool.group, entity);
+            }
+            _refreshQueries(entity);
+            _notifyObservers(&detail::observer_masks::added, pool.identifier, entity);
+            _stamp(sparseMap, entity);
             _events.emit<component_add_event<T, Type>>(value, handle);
         }
     }
@@ -571,11 +1407,36 @@ namespace ryujin
     template <typename T, typename ... Ts>
     inline bool base_registry<Type>::contains(const entity_handle<Type>& handle) const
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        if (typeId < _pools.size())
+        static const sz ids[] = { _componentId<T>(), _componentId<Ts>()... };
+        static const auto masked = [] {
+            for (const auto id : ids)
+            {
+                if (id >= detail::component_mask::capacity)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }();
+
+        if (masked)
+        {
+            static const auto required = [] {
+                detail::component_mask mask;
+                for (const auto id : ids)
+                {
+                    mask.set(id);
+                }
+                return mask;
+            }();
+
+            const auto entity = handle.handle();
+            return _isAlive(entity) && _masks[entity.identifier].contains_all(required);
+        }
+
+        const auto sparseMap = _fetchPool<T>();
+        if (sparseMap)
         {
-            const detail::pool& pool = _pools[typeId];
-            sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
             const bool res = sparseMap->contains(handle.handle());
             if constexpr (sizeof...(Ts) > 0)
             {
@@ -593,12 +1454,10 @@ namespace ryujin
     template <typename T>
     T& base_registry<Type>::get(const entity_handle<Type>& handle) const noexcept
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
         T* result = nullptr;
-        if (typeId < _pools.size())
+        const auto sparseMap = _fetchPool<T>();
+        if (sparseMap)
         {
-            const detail::pool& pool = _pools[typeId];
-            sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
             result = &sparseMap->get(handle.handle());
         }
         return *result;
@@ -608,12 +1467,10 @@ namespace ryujin
     template <typename T>
     T* base_registry<Type>::try_get(const entity_handle<Type>& handle) const noexcept
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
         T* result = nullptr;
-        if (typeId < _pools.size())
+        const auto sparseMap = _fetchPool<T>();
+        if (sparseMap)
         {
-            const detail::pool& pool = _pools[typeId];
-            sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
             if (sparseMap->contains(handle.handle()))
             {
                 result = &sparseMap->get(handle.handle());
@@ -627,13 +1484,25 @@ namespace ryujin
     inline void ryujin::base_registry<Type>::remove(entity_handle<Type>& handle)
     {
         static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        if (typeId < _pools.size())
+        const auto sparseMap = _fetchPool<T>();
+        if (sparseMap)
         {
-            detail::pool& pool = _pools[typeId];
-            sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
+            const detail::pool& pool = _pools[typeId];
+            if (pool.group != ~sz(0))
+            {
+                _leaveGroup(pool.group, handle.handle());
+            }
+
             const auto removed = sparseMap->remove(handle.handle());
             if (removed)
             {
+                if (typeId < detail::component_mask::capacity)
+                {
+                    _masks[handle.handle().identifier].reset(typeId);
+                }
+                _refreshQueries(handle.handle());
+                _notifyObservers(&detail::observer_masks::removed, typeId, handle.handle());
+
                 _events.emit<component_remove_event<T, Type>>(handle);
             }
         }
@@ -643,14 +1512,14 @@ namespace ryujin
     template <typename T>
     inline void ryujin::base_registry<Type>::replace(entity_handle<Type>& handle, const T& value)
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        if (typeId < _pools.size())
+        const auto sparseMap = _fetchPool<T>();
+        if (sparseMap)
         {
-            detail::pool& pool = _pools[typeId];
-            sparse_map<entity_type, T, _poolSize>* sparseMap = reinterpret_cast<sparse_map<entity_type, T, _poolSize>*>(pool.sparse_map);
             const auto replaced = sparseMap->replace(handle.handle(), value);
             if (replaced)
             {
+                _stamp(sparseMap, handle.handle());
+                _notifyObservers(&detail::observer_masks::updated, _componentId<T>(), handle.handle());
                 _events.emit<component_replace_event<T, Type>>(handle);
             }
         }
@@ -658,26 +1527,34 @@ namespace ryujin
 
     template <typename Type>
     template <typename T>
-    inline auto base_registry<Type>::component_view() noexcept
+    inline T& base_registry<Type>::get_mut(const entity_handle<Type>& handle) noexcept
     {
-        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
-        while (typeId >= _pools.size())
-        {
-            detail::pool p;
-            p.sparse_map = nullptr;
-            p.identifier = ~sz(0);
-            p.fn = {};
-
-            _pools.push_back(p);
-        }
+        const auto sparseMap = _fetchPool<T>();
+        _stamp(sparseMap, handle.handle());
+        _notifyObservers(&detail::observer_masks::updated, _componentId<T>(), handle.handle());
+        return sparseMap->get(handle.handle());
+    }
 
-        if (_pools[typeId].sparse_map == nullptr)
+    template <typename Type>
+    template <typename T, typename Fn>
+    inline void base_registry<Type>::patch(entity_handle<Type>& handle, Fn&& fn)
+    {
+        const auto sparseMap = _fetchPool<T>();
+        if (sparseMap && sparseMap->contains(handle.handle()))
         {
-            _pools[typeId] = detail::allocate_pool<entity_type, T, _poolSize>(typeId);
+            fn(sparseMap->get(handle.handle()));
+            _stamp(sparseMap, handle.handle());
+            _notifyObservers(&detail::observer_masks::updated, _componentId<T>(), handle.handle());
+            _events.emit<component_replace_event<T, Type>>(handle);
         }
+    }
 
-        detail::pool& pool = _pools[typeId];
-        detail::component_view_iterable<Type, T, _poolSize> it;
+    template <typename Type>
+    template <typename T>
+    inline auto base_registry<Type>::component_view() noexcept
+    {
+        detail::pool& pool = _fetchOrCreatePool<T>();
+        detail::component_view_iterable<Type, T> it;
         it._pool = pool;
         return it;
     }
@@ -690,255 +1567,1336 @@ namespace ryujin
         return iterable;
     }
 
-    template<typename Type>
-    inline auto& base_registry<Type>::events() noexcept
+    template <typename Type>
+    template <typename T>
+    inline sz base_registry<Type>::size() const noexcept
     {
-        return _events;
+        const auto sparseMap = _fetchPool<T>();
+        return sparseMap ? sparseMap->size() : 0;
     }
 
-    template<typename Type>
-    inline auto& base_registry<Type>::events() const noexcept
+    template <typename Type>
+    template <typename ... Ts>
+    inline void base_registry<Type>::register_components()
     {
-        return _events;
+        (_fetchOrCreatePool<Ts>(), ...);
     }
 
-    template<typename Type>
-    inline entity_handle<Type> base_registry<Type>::invalid() noexcept
-    {
-        return entity_handle<Type>(_tombstone, this);
-    }
-    
     template <typename Type>
-    inline typename base_registry<Type>::entity_type base_registry<Type>::_allocateNewIdentifier()
+    template <typename T>
+    inline void base_registry<Type>::track_changes()
     {
-        const auto identifier = static_cast<typename entity_type_traits::identifier_type>(_entities.size());
-        const auto generation = 0;
-        entity_type e{ identifier, generation };
-        _entities.push_back(e);
-        return e;
+        _fetchOrCreatePool<T>();
+        _fetchPool<T>()->enable_change_tracking();
     }
-    
+
     template <typename Type>
-    inline typename base_registry<Type>::entity_type base_registry<Type>::_recycleExistingIdentifier()
+    template <typename T, typename Compare>
+    inline bool base_registry<Type>::sort(Compare&& cmp)
     {
-        const auto identifier = _freeListHead.identifier;
-        const auto version = _entities[identifier].version;
-        _freeListHead = _entities[identifier];
-        return _entities[identifier] = entity_type{ identifier, version };
+        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
+        const auto sparseMap = _fetchPool<T>();
+        if (!sparseMap || _pools[typeId].group != ~sz(0))
+        {
+            // owning groups keep their own packing order
+            return false;
+        }
+
+        sparseMap->sort(ryujin::forward<Compare>(cmp));
+        return true;
     }
 
-    namespace detail
+    template <typename Type>
+    template <typename T, typename U>
+    inline bool base_registry<Type>::sort_as()
     {
-        template<typename EntityType, typename ...Ts>
-        inline bool entity_view_iterator<EntityType, Ts...>::operator==(const entity_view_iterator& rhs) const noexcept
-        {
-            return _index == rhs._index && _registry == rhs._registry;
-        }
-        
-        template<typename EntityType, typename ...Ts>
-        inline bool entity_view_iterator<EntityType, Ts...>::operator!=(const entity_view_iterator& rhs) const noexcept
+        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
+        const auto sparseMap = _fetchPool<T>();
+        const auto other = _fetchPool<U>();
+        if (!sparseMap || !other || _pools[typeId].group != ~sz(0))
         {
-            return _index != rhs._index || _registry != rhs._registry;
+            return false;
         }
-        
-        template<typename EntityType, typename ...Ts>
-        inline entity_view_iterator<EntityType, Ts...>& entity_view_iterator<EntityType, Ts...>::operator++()
-        {
-            ++_index;
 
-            if constexpr (sizeof...(Ts) == 0)
+        sparseMap->sort_as(*other);
+        return true;
+    }
+
+    template <typename Type>
+    template <typename ... Ts>
+    inline void base_registry<Type>::snapshot(vector<u8>& out) const
+    {
+        const detail::snapshot_header header = {
+            .magic = detail::snapshot_header::magic_value,
+            .version = detail::snapshot_header::current_version,
+            .component_count = static_cast<u32>(sizeof...(Ts)),
+            .entity_size = static_cast<u32>(sizeof(entity_type)),
+            .entity_count = _entities.size(),
+            .active = _active
+        };
+
+        detail::snapshot_write(out, &header, sizeof(header));
+        detail::snapshot_write(out, &_freeListHead, sizeof(entity_type));
+        detail::snapshot_write(out, _entities.data(), _entities.size() * sizeof(entity_type));
+
+        const auto writePool = [&]<typename T>(const pool_type<T>* pool) {
+            static_assert(is_trivially_copyable_v<T>, "Snapshot components must be trivially copyable.");
+            static_assert(alignof(T) <= detail::snapshot_alignment, "Snapshot component alignment exceeds the block alignment.");
+
+            constexpr bool tag = std::is_same_v<typename component_traits<T>::storage, tag_storage>;
+            const sz count = pool ? pool->size() : 0;
+            const detail::snapshot_pool_header poolHeader = { count, tag ? 0 : sizeof(T) };
+            detail::snapshot_write(out, &poolHeader, sizeof(poolHeader));
+            detail::snapshot_write(out, count > 0 ? &pool->key_at(0) : nullptr, count * sizeof(entity_type));
+
+            if constexpr (std::is_same_v<typename component_traits<T>::storage, dense_storage>)
             {
-                while (_index >= _nextFreeIndex)
-                {
-                    if (_index == _nextFreeIndex)
-                    {
-                        _nextFreeIndex = _registry->_entities[_nextFreeIndex].identifier;
-                    }
-                    ++_index;
-                }
+                detail::snapshot_write(out, count > 0 ? &pool->value_at(0) : nullptr, count * sizeof(T));
             }
-            else
+            else if constexpr (!tag)
             {
-                while (!_registry->template contains<Ts...>(_registry->at(_index)) || _index >= _nextFreeIndex)
+                // stable storage is not contiguous, gather the values into a single block
+                const sz offset = out.size();
+                out.resize(offset + detail::snapshot_padded(count * sizeof(T)), 0);
+                for (sz i = 0; i < count; ++i)
                 {
-                    if (_index == _nextFreeIndex)
-                    {
-                        _nextFreeIndex = _registry->at(_nextFreeIndex).handle().identifier;
-                    }
-                    ++_index;
-
-                    if (_index > _registry->allocated())
-                    {
-                        _index = _registry->allocated();
-                        break;
-                    }
+                    ryujin::memcpy(out.data() + offset + i * sizeof(T), &pool->value_at(i), sizeof(T));
                 }
             }
+        };
 
-            return *this;
+        (writePool.template operator()<Ts>(_fetchPool<Ts>()), ...);
+    }
+
+    template <typename Type>
+    template <typename ... Ts>
+    inline bool base_registry<Type>::restore(const u8* data, const sz size)
+    {
+        assert(reinterpret_cast<sz>(data) % detail::snapshot_alignment == 0 && "Snapshot data must be 16 byte aligned.");
+
+        const u8* cursor = data;
+        const u8* end = data + size;
+
+        const u8* headerBlock = detail::snapshot_read(cursor, end, sizeof(detail::snapshot_header));
+        if (!headerBlock)
+        {
+            return false;
         }
-        
-        template<typename EntityType, typename ...Ts>
-        inline entity_view_iterator<EntityType, Ts...> entity_view_iterator<EntityType, Ts...>::operator++(int)
+
+        detail::snapshot_header header;
+        ryujin::memcpy(&header, headerBlock, sizeof(header));
+        if (header.magic != detail::snapshot_header::magic_value || header.version != detail::snapshot_header::current_version
+            || header.component_count != sizeof...(Ts) || header.entity_size != sizeof(entity_type))
         {
-            auto copy = *this;
-            this->operator++();
-            return copy;
+            return false;
         }
-        
-        template<typename EntityType, typename ...Ts>
-        inline typename entity_view_iterator<EntityType, Ts...>::value_type entity_view_iterator<EntityType, Ts...>::operator*()
+
+        // the count is bounded by the remaining bytes first, so that the size of the entity block cannot overflow
+        const u8* freeListBlock = detail::snapshot_read(cursor, end, sizeof(entity_type));
+        if (!freeListBlock || header.entity_count > static_cast<sz>(end - cursor) / sizeof(entity_type) || header.entity_count >= _tombstone.identifier)
         {
-            return _registry->at(_index);
+            return false;
         }
-        
-        template<typename EntityType, typename ...Ts>
-        inline typename entity_view_iterator<EntityType, Ts...>::value_type entity_view_iterator<EntityType, Ts...>::operator*() const
+
+        const u8* entityBlock = detail::snapshot_read(cursor, end, header.entity_count * sizeof(entity_type));
+        if (!entityBlock)
         {
-            return _registry->at(_index);
+            return false;
         }
 
-        template<typename EntityType, typename ...ComponentTypes>
-        inline entity_view_iterable<EntityType, ComponentTypes...>::entity_view_iterable(base_registry<EntityType>* base_registry)
-            : _registry(base_registry)
+        // validate the snapshot before touching the registry, starting with the entities: every slot is either alive
+        // or on the free list
+        const auto entities = reinterpret_cast<const entity_type*>(entityBlock);
+        const sz entityCount = header.entity_count;
+        const auto isAlive = [&](const entity_type entity) {
+            return entity.identifier < entityCount && entities[entity.identifier] == entity;
+        };
+
+        entity_type freeListHead;
+        ryujin::memcpy(&freeListHead, freeListBlock, sizeof(entity_type));
+
+        sz live = 0;
+        for (sz idx = 0; idx < entityCount; ++idx)
         {
+            live += entities[idx].identifier == idx;
         }
-        
-        template<typename EntityType, typename ...ComponentTypes>
-        inline auto entity_view_iterable<EntityType, ComponentTypes...>::begin() noexcept
+
+        sz free = 0;
+        for (auto current = freeListHead.identifier; current != _tombstone.identifier; current = entities[current].identifier)
         {
-            sz index = 0;
-            sz nextFree = _registry->_freeListHead.identifier;
+            // a free list longer than the dead slots loops
+            if (current >= entityCount || entities[current].identifier == current || free == entityCount - live)
+            {
+                return false;
+            }
+            ++free;
+        }
+
+        if (live + free != entityCount || header.active != live)
+        {
+            return false;
+        }
+
+        // then every pool block, whose keys must be distinct live entities
+        vector<u8> seen(entityCount, 0);
+        struct pool_block
+        {
+            sz count;
+            const entity_type* keys;
+            const u8* values;
+        };
 
-            if constexpr (sizeof...(ComponentTypes) == 0)
+        pool_block blocks[sizeof...(Ts) + 1] = {};
+        sz blockIdx = 0;
+        const auto readPool = [&]<typename T>() {
+            constexpr bool tag = std::is_same_v<typename component_traits<T>::storage, tag_storage>;
+
+            const u8* poolHeaderBlock = detail::snapshot_read(cursor, end, sizeof(detail::snapshot_pool_header));
+            if (!poolHeaderBlock)
             {
-                while (index >= nextFree)
-                {
-                    if (index == nextFree)
-                    {
-                        nextFree = _registry->_entities[nextFree].identifier;
-                    }
-                    ++index;
-                }
+                return false;
             }
-            else
+
+            detail::snapshot_pool_header poolHeader;
+            ryujin::memcpy(&poolHeader, poolHeaderBlock, sizeof(poolHeader));
+            if (poolHeader.value_size != (tag ? 0 : sizeof(T)) || poolHeader.count > header.entity_count)
+            {
+                return false;
+            }
+
+            pool_block& block = blocks[blockIdx++];
+            block.count = poolHeader.count;
+            block.keys = reinterpret_cast<const entity_type*>(detail::snapshot_read(cursor, end, block.count * sizeof(entity_type)));
+            block.values = tag ? cursor : detail::snapshot_read(cursor, end, block.count * sizeof(T));
+            if (block.keys == nullptr || block.values == nullptr)
             {
-                if (index == _registry->_entities.size())
+                return false;
+            }
+
+            bool valid = true;
+            sz checked = 0;
+            for (; checked < block.count && valid; ++checked)
+            {
+                const entity_type key = block.keys[checked];
+                valid = isAlive(key) && !seen[key.identifier];
+                if (valid)
                 {
-                    return entity_view_iterator<EntityType, ComponentTypes...>(_registry, index, nextFree);
+                    seen[key.identifier] = 1;
                 }
+            }
 
-                while ((index != _registry->_entities.size() && index >= nextFree) || !_registry->template contains<ComponentTypes...>(_registry->at(index)))
+            // only the marked keys are reset, the markers are reused by the next pool
+            for (sz i = 0; i < checked; ++i)
+            {
+                if (block.keys[i].identifier < entityCount)
                 {
-                    if (index == nextFree)
-                    {
-                        nextFree = _registry->_entities[nextFree].identifier;
-                    }
-                    ++index;
-
-                    if (index > _registry->allocated())
-                    {
-                        index = _registry->allocated();
-                        break;
-                    }
+                    seen[block.keys[i].identifier] = 0;
                 }
             }
+            return valid;
+        };
 
-            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, index, nextFree);
+        if (!(readPool.template operator()<Ts>() && ...))
+        {
+            return false;
         }
-        
-        template<typename EntityType, typename ...ComponentTypes>
-        inline auto entity_view_iterable<EntityType, ComponentTypes...>::begin() const noexcept
+
+        for (auto& pool : _pools)
         {
-            sz index = 0;
-            sz nextFree = _registry->_freeListHead.identifier;
+            if (pool.sparse_map)
+            {
+                pool.fn.clear(&pool);
+            }
+        }
+
+        _entities.clear();
+        _entities.insert(_entities.end(), entities, entities + entityCount);
+        _masks.clear();
+        _masks.resize(entityCount);
+        _freeListHead = freeListHead;
+        _active = live;
+
+        blockIdx = 0;
+        const auto loadPool = [&]<typename T>() {
+            const pool_block& block = blocks[blockIdx++];
+            detail::pool& pool = _fetchOrCreatePool<T>();
+            auto map = reinterpret_cast<pool_type<T>*>(pool.sparse_map);
 
-            if constexpr (sizeof...(ComponentTypes) == 0)
+            if constexpr (std::is_same_v<typename component_traits<T>::storage, tag_storage>)
             {
-                while (index >= nextFree)
-                {
-                    if (index == nextFree)
-                    {
-                        nextFree = _registry->_entities[nextFree].identifier;
-                    }
-                    ++index;
-                }
+                const vector<T> tags(block.count, T{});
+                map->insert(block.keys, block.keys + block.count, tags.data());
             }
             else
             {
-                while ((index != _registry->_entities.size() && index >= nextFree) || !_registry->template contains<ComponentTypes...>(_registry->at(index)))
-                {
-                    if (index == nextFree)
-                    {
-                        nextFree = _registry->_entities[nextFree].identifier;
-                    }
-                    ++index;
+                map->insert(block.keys, block.keys + block.count, reinterpret_cast<const T*>(block.values));
+            }
 
-                    if (index > _registry->allocated())
-                    {
-                        index = _registry->allocated();
-                        break;
-                    }
+            const sz id = _componentId<T>();
+            if (id < detail::component_mask::capacity)
+            {
+                for (sz i = 0; i < block.count; ++i)
+                {
+                    _masks[block.keys[i].identifier].set(id);
                 }
             }
+        };
+
+        (loadPool.template operator()<Ts>(), ...);
 
-            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, index, nextFree);
+        for (auto& query : _queries)
+        {
+            _rebuildQuery(query);
         }
-        
-        template<typename EntityType, typename ...ComponentTypes>
-        inline const auto entity_view_iterable<EntityType, ComponentTypes...>::cbegin() const noexcept
+
+        // collected entities refer to the replaced contents
+        for (auto observer : _observers)
         {
-            sz index = 0;
-            sz nextFree = _registry->_freeListHead.identifier;
+            observer->clear();
+        }
 
-            if constexpr (sizeof...(ComponentTypes) == 0)
+        // group packing is not part of the snapshot, repack the owned pools from scratch
+        for (sz group = 0; group < _groups.size(); ++group)
+        {
+            _groups[group].size = 0;
+            for (sz idx = 0; idx < _entities.size(); ++idx)
             {
-                while (index >= nextFree)
+                if (_entities[idx].identifier == idx)
                 {
-                    if (index == nextFree)
-                    {
-                        nextFree = _registry->_entities[nextFree].identifier;
-                    }
-                    ++index;
+                    _enterGroup(group, _entities[idx]);
                 }
             }
-            else
-            {
-                while ((index != _registry->_entities.size() && index >= nextFree) || !_registry->template contains<ComponentTypes...>(_registry->at(index)))
-                {
-                    if (index == nextFree)
-                    {
-                        nextFree = _registry->_entities[nextFree].identifier;
-                    }
-                    ++index;
+        }
+
+        return true;
+    }
+
+    template <typename Type>
+    inline u64 base_registry<Type>::tick() const noexcept
+    {
+        return _changeTick;
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline auto base_registry<Type>::updated_since(const u64 tick) noexcept
+    {
+        // superseded journal entries are dropped here rather than on every touch, so touches made while iterating
+        // never move the entries an iterator is walking
+        if (const auto pool = _fetchPool<T>(); pool && pool->tracks_changes())
+        {
+            pool->compact_changes();
+        }
+        return detail::entity_change_iterable<Type, T>(this, tick);
+    }
+
+    template <typename Type>
+    template <typename T, typename ... Ts>
+    inline auto base_registry<Type>::group()
+    {
+        const sz owned[] = {
+            detail::component_identifier_utility::fetch_identifier<T>(),
+            detail::component_identifier_utility::fetch_identifier<Ts>()...
+        };
+
+        _fetchOrCreatePool<T>();
+        (_fetchOrCreatePool<Ts>(), ...);
+
+        // reuse a group that already owns exactly this set of pools, a group over any other combination of owned pools
+        // is invalid
+        const sz existing = _pools[owned[0]].group;
+        if (existing != ~sz(0))
+        {
+            bool matches = _groups[existing].owned.size() == sizeof...(Ts) + 1;
+            for (const auto id : owned)
+            {
+                matches = matches && _pools[id].group == existing;
+            }
+
+            return detail::entity_group_iterable<Type, T, Ts...>(this, matches ? existing : ~sz(0));
+        }
+
+        // a pool can only be packed by one group, reject any overlap before claiming pools
+        for (const auto id : owned)
+        {
+            if (_pools[id].group != ~sz(0))
+            {
+                return detail::entity_group_iterable<Type, T, Ts...>(this, ~sz(0));
+            }
+        }
+
+        const sz group = _groups.size();
+        detail::group_data data;
+        for (const auto id : owned)
+        {
+            _pools[id].group = group;
+            data.owned.push_back(id);
+        }
+        _groups.push_back(ryujin::move(data));
+
+        // pack the entities that already match to the front of the owned pools
+        const auto driver = _fetchPool<T>();
+        for (sz i = 0; i < driver->size(); ++i)
+        {
+            _enterGroup(group, driver->key_at(i));
+        }
+
+        return detail::entity_group_iterable<Type, T, Ts...>(this, group);
+    }
+
+    template <typename Type>
+    template <typename T, typename ... Ts, typename ... Excludes>
+    inline auto base_registry<Type>::query(exclude_t<Excludes...>)
+    {
+        const sz required[] = { _componentId<T>(), _componentId<Ts>()... };
+
+        _fetchOrCreatePool<T>();
+        (_fetchOrCreatePool<Ts>(), ...);
+
+        // queries match on the component masks, which only cover the first mask capacity component types; the pools
+        // of any later type are probed instead
+        detail::query_data<entity_type> data;
+        const auto add = [](detail::component_mask& mask, vector<sz>& unmasked, const sz id) {
+            if (id < detail::component_mask::capacity)
+            {
+                mask.set(id);
+            }
+            else if (std::find(unmasked.begin(), unmasked.end(), id) == unmasked.end())
+            {
+                unmasked.push_back(id);
+            }
+        };
+
+        for (const auto id : required)
+        {
+            add(data.required, data.requiredUnmasked, id);
+        }
+        (add(data.excluded, data.excludedUnmasked, _componentId<Excludes>()), ...);
+        std::sort(data.requiredUnmasked.begin(), data.requiredUnmasked.end());
+        std::sort(data.excludedUnmasked.begin(), data.excludedUnmasked.end());
+
+        for (sz existing = 0; existing < _queries.size(); ++existing)
+        {
+            const auto& query = _queries[existing];
+            if (query.required == data.required && query.excluded == data.excluded &&
+                std::equal(query.requiredUnmasked.begin(), query.requiredUnmasked.end(), data.requiredUnmasked.begin(), data.requiredUnmasked.end()) &&
+                std::equal(query.excludedUnmasked.begin(), query.excludedUnmasked.end(), data.excludedUnmasked.begin(), data.excludedUnmasked.end()))
+            {
+                return detail::entity_query_iterable<Type, T, Ts...>(this, existing);
+            }
+        }
+
+        // a group owning exactly the required pools already keeps the matches packed in a range
+        const sz group = _pools[required[0]].group;
+        if (sizeof...(Excludes) == 0 && group != ~sz(0) && _groups[group].owned.size() == sizeof...(Ts) + 1)
+        {
+            bool owned = true;
+            for (const auto id : required)
+            {
+                owned = owned && _pools[id].group == group;
+            }
+            data.group = owned ? group : ~sz(0);
+        }
+
+        _rebuildQuery(data);
+        _queries.push_back(ryujin::move(data));
+        return detail::entity_query_iterable<Type, T, Ts...>(this, _queries.size() - 1);
+    }
+
+    template <typename Type>
+    inline registry_stats base_registry<Type>::stats() const
+    {
+        registry_stats result = {};
+        result.allocated = _entities.size();
+        result.active = _active;
+        result.entity_bytes = _entities.capacity() * sizeof(entity_type) + _masks.capacity() * sizeof(detail::component_mask);
+
+        for (auto current = _freeListHead.identifier; current != _tombstone.identifier; current = _entities[current].identifier)
+        {
+            ++result.free_list_length;
+        }
+
+        for (const auto& pool : _pools)
+        {
+            if (pool.sparse_map)
+            {
+                component_pool_stats poolStats;
+                pool.fn.stats(&pool, &poolStats);
+                result.component_bytes += poolStats.bytes;
+                result.pools.push_back(poolStats);
+            }
+        }
+
+        return result;
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::set_page_policy(const sparse_page_policy policy)
+    {
+        _pagePolicy = policy;
+        for (auto& pool : _pools)
+        {
+            if (pool.sparse_map)
+            {
+                pool.fn.set_page_policy(&pool, policy);
+            }
+        }
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::shrink_to_fit()
+    {
+        for (auto& pool : _pools)
+        {
+            if (pool.sparse_map)
+            {
+                pool.fn.shrink_to_fit(&pool);
+            }
+        }
+    }
+
+    template<typename Type>
+    inline auto& base_registry<Type>::events() noexcept
+    {
+        return _events;
+    }
+
+    template<typename Type>
+    inline auto& base_registry<Type>::events() const noexcept
+    {
+        return _events;
+    }
+
+    template<typename Type>
+    inline entity_handle<Type> base_registry<Type>::invalid() noexcept
+    {
+        return entity_handle<Type>(_tombstone, this);
+    }
+    
+    template <typename Type>
+    inline typename base_registry<Type>::entity_type base_registry<Type>::_allocateNewIdentifier()
+    {
+        const auto identifier = static_cast<typename entity_type_traits::identifier_type>(_entities.size());
+        const auto generation = 0;
+        entity_type e{ identifier, generation };
+        _entities.push_back(e);
+        _masks.push_back({});
+        return e;
+    }
+    
+    template <typename Type>
+    inline typename base_registry<Type>::entity_type base_registry<Type>::_recycleExistingIdentifier()
+    {
+        const auto identifier = _freeListHead.identifier;
+        const auto version = _entities[identifier].version;
+        _freeListHead = _entities[identifier];
+        return _entities[identifier] = entity_type{ identifier, version };
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline typename base_registry<Type>::template pool_type<T>* base_registry<Type>::_fetchPool() const noexcept
+    {
+        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
+        if (typeId < _pools.size())
+        {
+            return reinterpret_cast<pool_type<T>*>(_pools[typeId].sparse_map);
+        }
+        return nullptr;
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline detail::pool& base_registry<Type>::_fetchOrCreatePool()
+    {
+        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
+        while (typeId >= _pools.size())
+        {
+            detail::pool p;
+            p.sparse_map = nullptr;
+            p.identifier = ~sz(0);
+            p.fn = {};
+
+            _pools.push_back(p);
+        }
+
+        if (_pools[typeId].sparse_map == nullptr)
+        {
+            _pools[typeId] = detail::allocate_pool<entity_type, T>(typeId);
+            _pools[typeId].fn.set_page_policy(&_pools[typeId], _pagePolicy);
+        }
+
+        return _pools[typeId];
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline sz base_registry<Type>::_componentId() noexcept
+    {
+        static const auto typeId = detail::component_identifier_utility::fetch_identifier<T>();
+        return typeId;
+    }
+
+    template <typename Type>
+    inline bool base_registry<Type>::_isAlive(const entity_type entity) const noexcept
+    {
+        return entity.identifier < _entities.size() && _entities[entity.identifier] == entity;
+    }
+
+    template <typename Type>
+    template <typename T>
+    inline void base_registry<Type>::_stamp(pool_type<T>* pool, const entity_type entity)
+    {
+        if (pool->tracks_changes())
+        {
+            pool->touch(entity, ++_changeTick);
+        }
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_enterGroup(const sz group, entity_type entity)
+    {
+        auto& data = _groups[group];
+        for (const auto id : data.owned)
+        {
+            auto& pool = _pools[id];
+            if (!pool.fn.contains(&pool, &entity))
+            {
+                return;
+            }
+        }
+
+        auto& lead = _pools[data.owned[0]];
+        if (lead.fn.index_of(&lead, &entity) < data.size)
+        {
+            return; // already packed
+        }
+
+        for (const auto id : data.owned)
+        {
+            auto& pool = _pools[id];
+            pool.fn.swap(&pool, pool.fn.index_of(&pool, &entity), data.size);
+        }
+        ++data.size;
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_leaveGroup(const sz group, entity_type entity)
+    {
+        auto& data = _groups[group];
+        for (const auto id : data.owned)
+        {
+            auto& pool = _pools[id];
+            if (!pool.fn.contains(&pool, &entity))
+            {
+                return;
+            }
+        }
+
+        auto& lead = _pools[data.owned[0]];
+        if (lead.fn.index_of(&lead, &entity) >= data.size)
+        {
+            return;
+        }
+
+        --data.size;
+        for (const auto id : data.owned)
+        {
+            auto& pool = _pools[id];
+            pool.fn.swap(&pool, pool.fn.index_of(&pool, &entity), data.size);
+        }
+    }
+
+    template <typename Type>
+    inline bool base_registry<Type>::_matchesQuery(const detail::query_data<entity_type>& query, const entity_type entity)
+    {
+        const auto& mask = _masks[entity.identifier];
+        if (!mask.contains_all(query.required) || mask.intersects(query.excluded))
+        {
+            return false;
+        }
+
+        auto probe = entity;
+        for (const sz id : query.requiredUnmasked)
+        {
+            auto& pool = _pools[id];
+            if (!pool.sparse_map || !pool.fn.contains(&pool, &probe))
+            {
+                return false;
+            }
+        }
+        for (const sz id : query.excludedUnmasked)
+        {
+            auto& pool = _pools[id];
+            if (pool.sparse_map && pool.fn.contains(&pool, &probe))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_refreshQueries(const entity_type entity)
+    {
+        for (auto& query : _queries)
+        {
+            if (query.group != ~sz(0))
+            {
+                continue;
+            }
+
+            const bool matches = _matchesQuery(query, entity);
+            const bool present = entity.identifier < query.index.size() && query.index[entity.identifier] != query.absent;
+            if (matches == present)
+            {
+                continue;
+            }
+
+            if (matches)
+            {
+                if (entity.identifier >= query.index.size())
+                {
+                    query.index.resize(_entities.size(), query.absent);
+                }
+                query.index[entity.identifier] = static_cast<u32>(query.entities.size());
+                query.entities.push_back(entity);
+            }
+            else
+            {
+                const u32 position = query.index[entity.identifier];
+                const entity_type last = query.entities.back();
+                query.entities[position] = last;
+                query.index[last.identifier] = position;
+                query.entities.pop_back();
+                query.index[entity.identifier] = query.absent;
+            }
+        }
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_rebuildQuery(detail::query_data<entity_type>& query)
+    {
+        query.entities.clear();
+        query.index.clear();
+        if (query.group != ~sz(0))
+        {
+            return;
+        }
+
+        query.index.resize(_entities.size(), query.absent);
+        for (sz idx = 0; idx < _entities.size(); ++idx)
+        {
+            if (_entities[idx].identifier == idx && _matchesQuery(query, _entities[idx]))
+            {
+                query.index[idx] = static_cast<u32>(query.entities.size());
+                query.entities.push_back(_entities[idx]);
+            }
+        }
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_notifyObservers(detail::observed_components detail::observer_masks::* kind, const sz id, const entity_type entity)
+    {
+        if (!(_observed.*kind).test(id))
+        {
+            return;
+        }
+
+        for (auto observer : _observers)
+        {
+            if ((observer->masks.*kind).test(id))
+            {
+                observer->collect(entity);
+            }
+        }
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_attachObserver(detail::observer_data<entity_type>* observer)
+    {
+        _observers.push_back(observer);
+        _observed |= observer->masks;
+    }
+
+    template <typename Type>
+    inline void base_registry<Type>::_detachObserver(detail::observer_data<entity_type>* observer)
+    {
+        _observed = {};
+        for (sz i = 0; i < _observers.size(); )
+        {
+            if (_observers[i] == observer)
+            {
+                _observers[i] = _observers.back();
+                _observers.pop_back();
+                continue;
+            }
+
+            _observed |= _observers[i]->masks;
+            ++i;
+        }
+    }
+
+    namespace detail
+    {
+        template<typename EntityType, typename ...Ts>
+        inline entity_view_iterator<EntityType, Ts...>::entity_view_iterator(base_registry<EntityType>* base_registry, const EntityType* current, const EntityType* last, const pool_pointers& pools, sz driver)
+            : _registry(base_registry), _current(current), _last(last), _pools(pools), _driver(driver)
+        {
+            _skip();
+        }
+
+        template<typename EntityType, typename ...Ts>
+        inline bool entity_view_iterator<EntityType, Ts...>::operator==(const entity_view_iterator& rhs) const noexcept
+        {
+            return _current == rhs._current && _registry == rhs._registry;
+        }
+        
+        template<typename EntityType, typename ...Ts>
+        inline bool entity_view_iterator<EntityType, Ts...>::operator!=(const entity_view_iterator& rhs) const noexcept
+        {
+            return _current != rhs._current || _registry != rhs._registry;
+        }
+        
+        template<typename EntityType, typename ...Ts>
+        inline entity_view_iterator<EntityType, Ts...>& entity_view_iterator<EntityType, Ts...>::operator++()
+        {
+            ++_current;
+            _skip();
+            return *this;
+        }
+        
+        template<typename EntityType, typename ...Ts>
+        inline entity_view_iterator<EntityType, Ts...> entity_view_iterator<EntityType, Ts...>::operator++(int)
+        {
+            auto copy = *this;
+            this->operator++();
+            return copy;
+        }
+        
+        template<typename EntityType, typename ...Ts>
+        inline typename entity_view_iterator<EntityType, Ts...>::value_type entity_view_iterator<EntityType, Ts...>::operator*() const
+        {
+            const auto entity = *_current;
+            return [&]<sz ... Is>(index_sequence<Is...>) {
+                // the driving pool's value sits at the same packed index as the current key
+                return value_type(entity_handle<EntityType>(entity, _registry), (Is == _driver
+                    ? ryujin::get<Is>(_pools)->value_at(static_cast<sz>(_current - ryujin::get<Is>(_pools)->key_begin()))
+                    : ryujin::get<Is>(_pools)->get(entity))...);
+            }(index_sequence_for<Ts...>{});
+        }
+
+        template<typename EntityType, typename ...Ts>
+        inline void entity_view_iterator<EntityType, Ts...>::_skip()
+        {
+            // the keys come from the smallest pool, so only the remaining pools need probing
+            while (_current != _last)
+            {
+                const auto entity = *_current;
+                const bool matches = [&]<sz ... Is>(index_sequence<Is...>) {
+                    return ((Is == _driver || ryujin::get<Is>(_pools)->contains(entity)) && ...);
+                }(index_sequence_for<Ts...>{});
+
+                if (matches)
+                {
+                    return;
+                }
+                ++_current;
+            }
+        }
+
+        template<typename EntityType>
+        inline bool entity_view_iterator<EntityType>::operator==(const entity_view_iterator& rhs) const noexcept
+        {
+            return _index == rhs._index && _registry == rhs._registry;
+        }
+        
+        template<typename EntityType>
+        inline bool entity_view_iterator<EntityType>::operator!=(const entity_view_iterator& rhs) const noexcept
+        {
+            return _index != rhs._index || _registry != rhs._registry;
+        }
+        
+        template<typename EntityType>
+        inline entity_view_iterator<EntityType>& entity_view_iterator<EntityType>::operator++()
+        {
+            ++_index;
 
-                    if (index > _registry->allocated())
-                    {
-                        index = _registry->allocated();
-                        break;
-                    }
+            while (_index >= _nextFreeIndex)
+            {
+                if (_index == _nextFreeIndex)
+                {
+                    _nextFreeIndex = _registry->_entities[_nextFreeIndex].identifier;
                 }
+                ++_index;
             }
 
-            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, index, nextFree);
+            return *this;
+        }
+        
+        template<typename EntityType>
+        inline entity_view_iterator<EntityType> entity_view_iterator<EntityType>::operator++(int)
+        {
+            auto copy = *this;
+            this->operator++();
+            return copy;
+        }
+        
+        template<typename EntityType>
+        inline typename entity_view_iterator<EntityType>::value_type entity_view_iterator<EntityType>::operator*() const
+        {
+            return value_type(_registry->at(_index));
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_view_iterable<EntityType, ComponentTypes...>::entity_view_iterable(base_registry<EntityType>* base_registry)
+            : _registry(base_registry), _pools(base_registry->template _fetchPool<ComponentTypes>()...)
+        {
+            [&]<sz ... Is>(index_sequence<Is...>) {
+                const bool allPresent = ((ryujin::get<Is>(_pools) != nullptr) && ...);
+                if (!allPresent)
+                {
+                    return;
+                }
+
+                // drive iteration off of the smallest participating pool
+                sz smallest = ~sz(0);
+                ([&] {
+                    const auto pool = ryujin::get<Is>(_pools);
+                    if (pool->size() < smallest)
+                    {
+                        smallest = pool->size();
+                        _first = pool->key_begin();
+                        _last = pool->key_end();
+                        _driver = Is;
+                    }
+                }(), ...);
+            }(index_sequence_for<ComponentTypes...>{});
+        }
+        
+        template<typename EntityType, typename ...ComponentTypes>
+        inline auto entity_view_iterable<EntityType, ComponentTypes...>::begin() const noexcept
+        {
+            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, _first, _last, _pools, _driver);
         }
         
         template<typename EntityType, typename ...ComponentTypes>
-        inline auto entity_view_iterable<EntityType, ComponentTypes...>::end() noexcept
+        inline const auto entity_view_iterable<EntityType, ComponentTypes...>::cbegin() const noexcept
         {
-            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, _registry->_entities.size(), 0);
+            return begin();
         }
         
         template<typename EntityType, typename ...ComponentTypes>
         inline auto entity_view_iterable<EntityType, ComponentTypes...>::end() const noexcept
         {
-            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, _registry->_entities.size(), 0);
+            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, _last, _last, _pools, _driver);
         }
         
         template<typename EntityType, typename ...ComponentTypes>
         inline const auto entity_view_iterable<EntityType, ComponentTypes...>::cend() const noexcept
         {
-            return entity_view_iterator<EntityType, ComponentTypes...>(_registry, _registry->_entities.size(), 0);
+            return end();
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        template<typename Fn>
+        inline void entity_view_iterable<EntityType, ComponentTypes...>::each(Fn&& fn) const
+        {
+            if (_first == _last)
+            {
+                return;
+            }
+
+            [&]<sz ... Is>(index_sequence<Is...>) {
+                // resolve the driving pool once so that the loop neither probes it nor looks its values up sparsely
+                const auto eachFrom = [&]<sz Driver>(integral_constant<sz, Driver>) {
+                    const auto driver = ryujin::get<Driver>(_pools);
+                    const auto valueOf = [&]<sz I>(integral_constant<sz, I>, const EntityType entity, const sz i) -> auto& {
+                        if constexpr (I == Driver)
+                        {
+                            return driver->value_at(i);
+                        }
+                        else
+                        {
+                            return ryujin::get<I>(_pools)->get(entity);
+                        }
+                    };
+
+                    const sz count = static_cast<sz>(_last - _first);
+                    for (sz i = 0; i < count; ++i)
+                    {
+                        const auto entity = driver->key_at(i);
+                        if (((Is == Driver || ryujin::get<Is>(_pools)->contains(entity)) && ...))
+                        {
+                            fn(entity_handle<EntityType>(entity, _registry), valueOf(integral_constant<sz, Is>{}, entity, i)...);
+                        }
+                    }
+                };
+
+                const bool dispatched = ((Is == _driver ? (eachFrom(integral_constant<sz, Is>{}), true) : false) || ...);
+                (void)dispatched;
+            }(index_sequence_for<ComponentTypes...>{});
+        }
+
+        template<typename EntityType>
+        inline entity_view_iterable<EntityType>::entity_view_iterable(base_registry<EntityType>* base_registry)
+            : _registry(base_registry)
+        {
+        }
+
+        template<typename EntityType>
+        inline auto entity_view_iterable<EntityType>::begin() const noexcept
+        {
+            sz index = 0;
+            sz nextFree = _registry->_freeListHead.identifier;
+
+            while (index >= nextFree)
+            {
+                if (index == nextFree)
+                {
+                    nextFree = _registry->_entities[nextFree].identifier;
+                }
+                ++index;
+            }
+
+            return entity_view_iterator<EntityType>(_registry, index, nextFree);
+        }
+
+        template<typename EntityType>
+        inline const auto entity_view_iterable<EntityType>::cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        template<typename EntityType>
+        inline auto entity_view_iterable<EntityType>::end() const noexcept
+        {
+            return entity_view_iterator<EntityType>(_registry, _registry->_entities.size(), 0);
+        }
+
+        template<typename EntityType>
+        inline const auto entity_view_iterable<EntityType>::cend() const noexcept
+        {
+            return end();
+        }
+
+        template<typename EntityType>
+        template<typename Fn>
+        inline void entity_view_iterable<EntityType>::each(Fn&& fn) const
+        {
+            for (auto it = begin(); it != end(); ++it)
+            {
+                fn(ryujin::get<0>(*it));
+            }
+        }
+    }
+
+    namespace detail
+    {
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_group_iterator<EntityType, ComponentTypes...>::entity_group_iterator(base_registry<EntityType>* base_registry, sz index)
+            : _registry(base_registry), _index(index)
+        {
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_group_iterator<EntityType, ComponentTypes...>::operator==(const entity_group_iterator& rhs) const noexcept
+        {
+            return _index == rhs._index && _registry == rhs._registry;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_group_iterator<EntityType, ComponentTypes...>::operator!=(const entity_group_iterator& rhs) const noexcept
+        {
+            return _index != rhs._index || _registry != rhs._registry;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_group_iterator<EntityType, ComponentTypes...>& entity_group_iterator<EntityType, ComponentTypes...>::operator++()
+        {
+            ++_index;
+            return *this;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_group_iterator<EntityType, ComponentTypes...> entity_group_iterator<EntityType, ComponentTypes...>::operator++(int)
+        {
+            auto copy = *this;
+            ++_index;
+            return copy;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline typename entity_group_iterator<EntityType, ComponentTypes...>::value_type entity_group_iterator<EntityType, ComponentTypes...>::operator*() const
+        {
+            using lead_type = typename tuple_element<0, tuple<ComponentTypes...>>::type;
+            const auto entity = _registry->template _fetchPool<lead_type>()->key_at(_index);
+            return value_type(entity_handle<EntityType>(entity, _registry), _registry->template _fetchPool<ComponentTypes>()->value_at(_index)...);
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_group_iterable<EntityType, ComponentTypes...>::entity_group_iterable(base_registry<EntityType>* base_registry, sz group)
+            : _registry(base_registry), _group(group)
+        {
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_group_iterable<EntityType, ComponentTypes...>::valid() const noexcept
+        {
+            return _group != ~sz(0);
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline sz entity_group_iterable<EntityType, ComponentTypes...>::size() const noexcept
+        {
+            return valid() ? _registry->_groups[_group].size : 0;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_group_iterable<EntityType, ComponentTypes...>::empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline auto entity_group_iterable<EntityType, ComponentTypes...>::begin() const noexcept
+        {
+            return entity_group_iterator<EntityType, ComponentTypes...>(_registry, 0);
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline auto entity_group_iterable<EntityType, ComponentTypes...>::end() const noexcept
+        {
+            return entity_group_iterator<EntityType, ComponentTypes...>(_registry, size());
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        template<typename Fn>
+        inline void entity_group_iterable<EntityType, ComponentTypes...>::each(Fn&& fn) const
+        {
+            using lead_type = typename tuple_element<0, tuple<ComponentTypes...>>::type;
+
+            // owned pools share the same order over the group prefix, so a single index walks all of them
+            const auto lead = _registry->template _fetchPool<lead_type>();
+            const auto pools = ryujin::make_tuple(_registry->template _fetchPool<ComponentTypes>()...);
+            const sz count = size();
+
+            for (sz i = 0; i < count; ++i)
+            {
+                [&]<sz ... Is>(index_sequence<Is...>) {
+                    fn(entity_handle<EntityType>(lead->key_at(i), _registry), ryujin::get<Is>(pools)->value_at(i)...);
+                }(index_sequence_for<ComponentTypes...>{});
+            }
+        }
+    }
+
+    namespace detail
+    {
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_query_iterator<EntityType, ComponentTypes...>::entity_query_iterator(base_registry<EntityType>* base_registry, sz query, sz index)
+            : _registry(base_registry), _query(query), _index(index)
+        {
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_query_iterator<EntityType, ComponentTypes...>::operator==(const entity_query_iterator& rhs) const noexcept
+        {
+            return _index == rhs._index && _query == rhs._query && _registry == rhs._registry;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_query_iterator<EntityType, ComponentTypes...>::operator!=(const entity_query_iterator& rhs) const noexcept
+        {
+            return !(*this == rhs);
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_query_iterator<EntityType, ComponentTypes...>& entity_query_iterator<EntityType, ComponentTypes...>::operator++()
+        {
+            ++_index;
+            return *this;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_query_iterator<EntityType, ComponentTypes...> entity_query_iterator<EntityType, ComponentTypes...>::operator++(int)
+        {
+            auto copy = *this;
+            ++_index;
+            return copy;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline typename entity_query_iterator<EntityType, ComponentTypes...>::value_type entity_query_iterator<EntityType, ComponentTypes...>::operator*() const
+        {
+            const auto& query = _registry->_queries[_query];
+            if (query.group != ~sz(0))
+            {
+                using lead_type = typename tuple_element<0, tuple<ComponentTypes...>>::type;
+                const auto entity = _registry->template _fetchPool<lead_type>()->key_at(_index);
+                return value_type(entity_handle<EntityType>(entity, _registry), _registry->template _fetchPool<ComponentTypes>()->value_at(_index)...);
+            }
+
+            const auto entity = query.entities[_index];
+            return value_type(entity_handle<EntityType>(entity, _registry), _registry->template _fetchPool<ComponentTypes>()->get(entity)...);
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline entity_query_iterable<EntityType, ComponentTypes...>::entity_query_iterable(base_registry<EntityType>* base_registry, sz query)
+            : _registry(base_registry), _query(query)
+        {
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline sz entity_query_iterable<EntityType, ComponentTypes...>::size() const noexcept
+        {
+            const auto& query = _registry->_queries[_query];
+            return query.group != ~sz(0) ? _registry->_groups[query.group].size : query.entities.size();
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline bool entity_query_iterable<EntityType, ComponentTypes...>::empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline auto entity_query_iterable<EntityType, ComponentTypes...>::begin() const noexcept
+        {
+            return entity_query_iterator<EntityType, ComponentTypes...>(_registry, _query, 0);
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        inline auto entity_query_iterable<EntityType, ComponentTypes...>::end() const noexcept
+        {
+            return entity_query_iterator<EntityType, ComponentTypes...>(_registry, _query, size());
+        }
+
+        template<typename EntityType, typename ...ComponentTypes>
+        template<typename Fn>
+        inline void entity_query_iterable<EntityType, ComponentTypes...>::each(Fn&& fn) const
+        {
+            const auto pools = ryujin::make_tuple(_registry->template _fetchPool<ComponentTypes>()...);
+
+            if (_registry->_queries[_query].group != ~sz(0))
+            {
+                using lead_type = typename tuple_element<0, tuple<ComponentTypes...>>::type;
+                const auto lead = _registry->template _fetchPool<lead_type>();
+                for (sz i = size(); i > 0; --i)
+                {
+                    [&]<sz ... Is>(index_sequence<Is...>) {
+                        fn(entity_handle<EntityType>(lead->key_at(i - 1), _registry), ryujin::get<Is>(pools)->value_at(i - 1)...);
+                    }(index_sequence_for<ComponentTypes...>{});
+                }
+                return;
+            }
+
+            // walk backwards, removing the current entity from the query swaps an already visited one into its place;
+            // the query is looked up on every step as the callback may register further queries
+            for (sz i = size(); i > 0; )
+            {
+                --i;
+                const auto entity = _registry->_queries[_query].entities[i];
+                [&]<sz ... Is>(index_sequence<Is...>) {
+                    fn(entity_handle<EntityType>(entity, _registry), ryujin::get<Is>(pools)->get(entity)...);
+                }(index_sequence_for<ComponentTypes...>{});
+                i = i < size() ? i : size();
+            }
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline entity_change_iterator<EntityType, ComponentType>::entity_change_iterator(base_registry<EntityType>* base_registry, pool_pointer pool, sz index, sz last, bool journaled)
+            : _registry(base_registry), _pool(pool), _index(index), _last(last), _journaled(journaled)
+        {
+            _skip();
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline bool entity_change_iterator<EntityType, ComponentType>::operator==(const entity_change_iterator& rhs) const noexcept
+        {
+            return _index == rhs._index && _pool == rhs._pool;
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline bool entity_change_iterator<EntityType, ComponentType>::operator!=(const entity_change_iterator& rhs) const noexcept
+        {
+            return _index != rhs._index || _pool != rhs._pool;
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline entity_change_iterator<EntityType, ComponentType>& entity_change_iterator<EntityType, ComponentType>::operator++()
+        {
+            ++_index;
+            _skip();
+            return *this;
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline entity_change_iterator<EntityType, ComponentType> entity_change_iterator<EntityType, ComponentType>::operator++(int)
+        {
+            auto copy = *this;
+            ++(*this);
+            return copy;
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline typename entity_change_iterator<EntityType, ComponentType>::value_type entity_change_iterator<EntityType, ComponentType>::operator*() const
+        {
+            return value_type(entity_handle<EntityType>(_pool->key_at(_packed), _registry), _pool->value_at(_packed));
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline void entity_change_iterator<EntityType, ComponentType>::_skip() noexcept
+        {
+            // journal entries of values touched again or removed since are skipped
+            for (; _index < _last; ++_index)
+            {
+                _packed = _journaled ? _pool->change_at(_index) : _index;
+                if (_packed != ~sz(0))
+                {
+                    return;
+                }
+            }
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline entity_change_iterable<EntityType, ComponentType>::entity_change_iterable(base_registry<EntityType>* base_registry, u64 since)
+            : _registry(base_registry), _pool(base_registry->template _fetchPool<ComponentType>())
+        {
+            if (!_pool)
+            {
+                return;
+            }
+
+            // the journal is ordered by tick, so everything after the first later entry is newer than since
+            _journaled = _pool->tracks_changes();
+            _first = _journaled ? _pool->first_change_after(since) : 0;
+            _last = _journaled ? _pool->change_count() : _pool->size();
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline auto entity_change_iterable<EntityType, ComponentType>::begin() const noexcept
+        {
+            return entity_change_iterator<EntityType, ComponentType>(_registry, _pool, _first, _last, _journaled);
+        }
+
+        template<typename EntityType, typename ComponentType>
+        inline auto entity_change_iterable<EntityType, ComponentType>::end() const noexcept
+        {
+            return entity_change_iterator<EntityType, ComponentType>(_registry, _pool, _last, _last, _journaled);
+        }
+
+        template<typename EntityType, typename ComponentType>
+        template<typename Fn>
+        inline void entity_change_iterable<EntityType, ComponentType>::each(Fn&& fn) const
+        {
+            for (sz i = _first; i < _last; ++i)
+            {
+                const sz packed = _journaled ? _pool->change_at(i) : i;
+                if (packed != ~sz(0))
+                {
+                    fn(entity_handle<EntityType>(_pool->key_at(packed), _registry), _pool->value_at(packed));
+                }
+            }
         }
     }
 
@@ -1,20 +1,43 @@
 #ifndef sparse_map_hpp__
 #define sparse_map_hpp__
 
+#include "component_storage.hpp"
 #include "entity.hpp"
 
 #include "../core/memory.hpp"
 #include "../core/primitives.hpp"
 #include "../core/vector.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <memory>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace ryujin
 {
-    template <typename EntityType, typename ValueType, sz PageSize>
+    /// <summary>
+    /// What a sparse map does with sparse pages whose last key is removed.  Released pages are reallocated on the
+    /// next insert into their range, which costs a page allocation when entities churn around a page boundary.
+    /// </summary>
+    enum class sparse_page_policy
+    {
+        keep,
+        release_empty
+    };
+
+    namespace detail
+    {
+        template <typename EntityType>
+        struct change_record
+        {
+            EntityType key;
+            u64 tick;
+        };
+    }
+
+    template <typename EntityType, typename ValueType, sz PageSize, typename Storage = dense_storage>
     class sparse_map
     {
     public:
@@ -30,16 +53,51 @@ namespace ryujin
         value_type& get(const key_type& key);
         const value_type& get(const key_type& key) const;
 
-        void shrink_to_fit();
+        void shrink_to_fit(); // also releases empty sparse pages regardless of the page policy
         void reserve(const sz count);
         
         void clear();
         bool insert(const key_type& key, const value_type& value);
+        sz insert(const key_type* first, const key_type* last, const value_type* values); // returns number inserted
         bool remove(const key_type& key);
         bool remove(const key_type& key, const value_type& value);
         bool replace(const key_type& key, const value_type& value);
         bool insert_or_replace(const key_type& key, const value_type& value); // true on replace, false on insert
 
+        sz index_of(const key_type& key) const noexcept;
+        const key_type& key_at(const sz idx) const noexcept;
+        value_type& value_at(const sz idx) noexcept;
+        const value_type& value_at(const sz idx) const noexcept;
+        void swap_indices(const sz lhs, const sz rhs);
+
+        // reorders the packed keys and values, comparing either values or keys depending on the comparator signature
+        template <typename Compare>
+        void sort(Compare&& cmp);
+
+        // moves keys shared with other to the front, in the order they appear in other
+        template <typename OtherValueType, sz OtherPageSize, typename OtherStorage>
+        sz sort_as(const sparse_map<EntityType, OtherValueType, OtherPageSize, OtherStorage>& other);
+
+        void set_page_policy(const sparse_page_policy policy) noexcept;
+        sz sparse_page_count() const noexcept; // allocated sparse pages
+        sz memory_usage() const noexcept; // bytes allocated for sparse pages, packed keys, values, ticks and the change journal
+
+        // change tracking, ticks are stored parallel to the packed values while enabled and every touch is appended
+        // to a journal, which callers passing non decreasing ticks keep ordered by tick
+        void enable_change_tracking();
+        bool tracks_changes() const noexcept;
+        void touch(const key_type& key, const u64 tick);
+        void touch_at(const sz idx, const u64 tick);
+        u64 tick_at(const sz idx) const noexcept;
+
+        sz change_count() const noexcept; // journal entries
+        sz first_change_after(const u64 tick) const noexcept; // first journal entry with a later tick
+        sz change_at(const sz entry) const noexcept; // packed index of a journal entry, ~sz(0) once superseded or removed
+        void compact_changes() noexcept; // drops superseded and removed journal entries, keeping the order
+
+        auto key_begin() const noexcept;
+        auto key_end() const noexcept;
+
         auto value_begin() noexcept;
         auto value_begin() const noexcept;
         const auto value_cbegin() const noexcept;
@@ -53,39 +111,46 @@ namespace ryujin
 
         sz _page(const key_type& tp) const noexcept;
         sz _offset(const key_type& tp) const noexcept;
+        void _growSparse(const sz pageCount);
+        EntityType* _acquirePage(const sz page);
 
-        vector<unique_ptr<sparse_page_type>> _sparse;
+        vector<unique_ptr<sparse_page_type>> _sparse; // null entries for pages never used or released
+        vector<u32> _pageOccupancy; // live keys per sparse page
+        sparse_page_policy _pagePolicy = sparse_page_policy::keep;
         vector<EntityType> _packed;
-        vector<ValueType> _values;
+        detail::value_storage<ValueType, Storage, PageSize> _values;
+        vector<u64> _ticks;
+        vector<detail::change_record<EntityType>> _changes;
+        bool _tracking = false;
 
         static constexpr EntityType _tombstone = entity_traits<typename EntityType::type>::from_type(~(typename EntityType::type)(0));
     };
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::empty() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::empty() const noexcept
     {
         return _packed.empty();
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline sz sparse_map<EntityType, ValueType, PageSize>::size() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::size() const noexcept
     {
         return _packed.size();
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline sz sparse_map<EntityType, ValueType, PageSize>::capacity() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::capacity() const noexcept
     {
         return _packed.capacity();
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::contains(const key_type& key) const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::contains(const key_type& key) const noexcept
     {
         const auto page = _page(key);
         const auto offset = _offset(key);
 
-        if (page < _sparse.size())
+        if (page < _sparse.size() && _sparse[page])
         {
             const auto trampoline = _sparse[page][offset];
             return trampoline.identifier < _packed.size() && _packed[trampoline.identifier] == key;
@@ -93,13 +158,13 @@ namespace ryujin
         return false;
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::contains(const key_type& key, const value_type& value)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::contains(const key_type& key, const value_type& value)
     {
         const auto page = _page(key);
         const auto offset = _offset(key);
 
-        if (page < _sparse.size())
+        if (page < _sparse.size() && _sparse[page])
         {
             const auto trampoline = _sparse[page][offset];
             return trampoline.identifier < _packed.size() && _packed[trampoline.identifier] == key && _values[trampoline.identifier] == value;
@@ -107,8 +172,8 @@ namespace ryujin
         return false;
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline typename sparse_map<EntityType, ValueType, PageSize>::value_type& sparse_map<EntityType, ValueType, PageSize>::get(const key_type& key)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline typename sparse_map<EntityType, ValueType, PageSize, Storage>::value_type& sparse_map<EntityType, ValueType, PageSize, Storage>::get(const key_type& key)
     {
         const auto page = _page(key);
         const auto offset = _offset(key);
@@ -117,8 +182,8 @@ namespace ryujin
         return _values[trampoline.identifier];
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline const typename sparse_map<EntityType, ValueType, PageSize>::value_type& sparse_map<EntityType, ValueType, PageSize>::get(const key_type& key) const
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline const typename sparse_map<EntityType, ValueType, PageSize, Storage>::value_type& sparse_map<EntityType, ValueType, PageSize, Storage>::get(const key_type& key) const
     {
         const auto page = _page(key);
         const auto offset = _offset(key);
@@ -127,150 +192,183 @@ namespace ryujin
         return _values[trampoline.identifier];
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline void sparse_map<EntityType, ValueType, PageSize>::shrink_to_fit()
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::shrink_to_fit()
     {
+        for (sz page = 0; page < _sparse.size(); ++page)
+        {
+            if (_sparse[page] && _pageOccupancy[page] == 0)
+            {
+                _sparse[page].reset();
+            }
+        }
+
+        // trailing pages without keys are dropped from the page table entirely
+        sz used = _sparse.size();
+        while (used > 0 && !_sparse[used - 1])
+        {
+            --used;
+        }
+        _sparse.erase(_sparse.begin() + used, _sparse.end());
+        _pageOccupancy.erase(_pageOccupancy.begin() + used, _pageOccupancy.end());
+
         _packed.shrink_to_fit();
         _sparse.shrink_to_fit();
+        _pageOccupancy.shrink_to_fit();
         _values.shrink_to_fit();
+        _ticks.shrink_to_fit();
+        _changes.shrink_to_fit();
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline void sparse_map<EntityType, ValueType, PageSize>::reserve(const sz count)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::reserve(const sz count)
     {
-        const auto pageCount = 1 + ((count - 1) / PageSize);
-        _sparse.reserve(pageCount);
         _packed.reserve(count);
         _values.reserve(count);
-
-        for (auto i = _sparse.size(); i < pageCount; ++i)
-        {
-            _sparse[i] = make_unique<EntityType[]>(PageSize);
-            for (auto j = 0; j < PageSize; ++j)
-            {
-                _sparse[i][j] = _tombstone;
-            }
-        }
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline void sparse_map<EntityType, ValueType, PageSize>::clear()
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::clear()
     {
         _packed.clear();
         _values.clear();
+        _ticks.clear();
+        _changes.clear();
         _sparse.clear();
+        _pageOccupancy.clear();
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::insert(const key_type& key, const value_type& value)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::insert(const key_type& key, const value_type& value)
     {
         const auto sparsePage = _page(key);
         const auto sparseOffset = _offset(key);
 
-        for (auto pg = _sparse.size(); pg <= sparsePage; ++pg)
-        {
-            auto page = make_unique<EntityType[]>(PageSize);
-            for (sz i = 0; i < PageSize; ++i)
-            {
-                page[i] = _tombstone;
-            }
-            _sparse.push_back(ryujin::move(page));
-        }
-
-        auto& page = _sparse[sparsePage];
+        auto page = _acquirePage(sparsePage);
         if (page[sparseOffset] == _tombstone)
         {
             // Value is not in the map
             page[sparseOffset] = EntityType{ static_cast<entity_traits<typename EntityType::type>::identifier_type>(_packed.size()), 0 };
+            ++_pageOccupancy[sparsePage];
             _packed.push_back(key);
             _values.push_back(value);
+            if (_tracking)
+            {
+                _ticks.push_back(0);
+            }
             return true;
         }
         return false;
     }
     
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::remove(const key_type& key)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::insert(const key_type* first, const key_type* last, const value_type* values)
     {
-        const auto sparsePage = _page(key);
-        const auto sparseOffset = _offset(key);
+        const sz count = last - first;
+        if (count == 0)
+        {
+            return 0;
+        }
 
-        if (sparsePage < _sparse.size())
+        sz maxPage = 0;
+        for (sz i = 0; i < count; ++i)
         {
-            const auto trampoline = _sparse[sparsePage][sparseOffset];
-            if (trampoline == key)
-            {
-                const auto packedIndex = trampoline.identifier;
-                _sparse[sparsePage][sparseOffset] = _tombstone;
+            const auto page = _page(first[i]);
+            maxPage = page > maxPage ? page : maxPage;
+        }
 
-                const auto back = _packed.back();
-                _packed[packedIndex] = back;
-                _packed.pop_back();
+        _growSparse(maxPage + 1);
+        reserve(_packed.size() + count);
 
-                const auto valueBack = _values.back();
-                _values[packedIndex] = ryujin::move(valueBack);
-                _values.pop_back();
+        // keys already in the map split the range into runs, each run is appended in one block
+        sz inserted = 0;
+        sz runStart = 0;
+        for (sz i = 0; i <= count; ++i)
+        {
+            if (i < count)
+            {
+                const auto page = _page(first[i]);
+                auto& slot = _acquirePage(page)[_offset(first[i])];
+                if (slot == _tombstone)
+                {
+                    slot = EntityType{ static_cast<entity_traits<typename EntityType::type>::identifier_type>(_packed.size() + i - runStart), 0 };
+                    ++_pageOccupancy[page];
+                    continue;
+                }
+            }
 
-                const auto toMove = entity_traits<typename EntityType::type>::from_type(packedIndex);
-                _sparse[_page(toMove)][_offset(toMove)] = toMove;
+            _packed.insert(_packed.end(), first + runStart, first + i);
+            _values.append(values + runStart, values + i);
+            inserted += i - runStart;
+            runStart = i + 1;
+        }
 
-                return true;
-            }
+        if (_tracking)
+        {
+            _ticks.resize(_packed.size(), 0);
         }
-        return false;
+
+        return inserted;
     }
-    
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::remove(const key_type& key, const value_type& value)
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::remove(const key_type& key)
     {
+        if (!contains(key))
+        {
+            return false;
+        }
+
         const auto sparsePage = _page(key);
         const auto sparseOffset = _offset(key);
+        const auto packedIndex = _sparse[sparsePage][sparseOffset].identifier;
 
-        if (sparsePage < _sparse.size())
+        // move the back of the packed arrays into the hole and repoint its sparse entry
+        if (packedIndex != _packed.size() - 1)
         {
-            const auto trampoline = _sparse[sparsePage][sparseOffset];
-            if (trampoline == key)
+            const auto back = _packed.back();
+            _packed[packedIndex] = back;
+            if (_tracking)
             {
-                const auto packedIndex = trampoline.identifier;
-
-                if (_values[packedIndex] != value)
-                {
-                    return false;
-                }
-
-                _sparse[sparsePage][sparseOffset] = _tombstone;
-
-                const auto back = _packed.back();
-                _packed[packedIndex] = back;
-                _packed.pop_back();
-
-                const auto valueBack = _values.back();
-                _values[packedIndex] = valueBack;
-                _values.pop_back();
+                _ticks[packedIndex] = _ticks.back();
+            }
+            _sparse[_page(back)][_offset(back)] = EntityType{ static_cast<entity_traits<typename EntityType::type>::identifier_type>(packedIndex), 0 };
+        }
 
-                const auto toMove = entity_traits<typename entity_traits<typename EntityType::type>::identifier_type>::from_type(packedIndex);
-                _sparse[_page(toMove)][_offset(toMove)] = toMove;
+        _packed.pop_back();
+        _values.swap_remove(packedIndex);
+        if (_tracking)
+        {
+            _ticks.pop_back();
+        }
+        _sparse[sparsePage][sparseOffset] = _tombstone;
+        if (--_pageOccupancy[sparsePage] == 0 && _pagePolicy == sparse_page_policy::release_empty)
+        {
+            _sparse[sparsePage].reset();
+        }
 
-                return true;
-            }
+        return true;
+    }
+    
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::remove(const key_type& key, const value_type& value)
+    {
+        if (!contains(key, value))
+        {
+            return false;
         }
-        return false;
+        return remove(key);
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::replace(const key_type& key, const value_type& value)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::replace(const key_type& key, const value_type& value)
     {
         const auto sparsePage = _page(key);
         const auto sparseOffset = _offset(key);
 
-        for (auto pg = _sparse.size(); pg <= sparsePage; ++pg)
+        if (sparsePage >= _sparse.size() || !_sparse[sparsePage])
         {
-            auto page = make_unique<EntityType[]>(PageSize);
-            for (sz i = 0; i < PageSize; ++i)
-            {
-                page[i] = _tombstone;
-            }
-            _sparse.push_back(ryujin::move(page));
+            return false;
         }
 
         auto& page = _sparse[sparsePage];
@@ -283,29 +381,24 @@ namespace ryujin
         return false;
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool sparse_map<EntityType, ValueType, PageSize>::insert_or_replace(const key_type& key, const value_type& value)
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::insert_or_replace(const key_type& key, const value_type& value)
     {
         const auto sparsePage = _page(key);
         const auto sparseOffset = _offset(key);
 
-        for (auto pg = _sparse.size(); pg <= sparsePage; ++pg)
-        {
-            auto page = make_unique<EntityType[]>(PageSize);
-            for (sz i = 0; i < PageSize; ++i)
-            {
-                page[i] = _tombstone;
-            }
-            _sparse.push_back(ryujin::move(page));
-        }
-
-        auto& page = _sparse[sparsePage];
+        auto page = _acquirePage(sparsePage);
         if (page[sparseOffset] == _tombstone)
         {
             // Value is not in the map
             page[sparseOffset] = EntityType{ static_cast<entity_traits<typename EntityType::type>::identifier_type>(_packed.size()), 0 };
+            ++_pageOccupancy[sparsePage];
             _packed.push_back(key);
             _values.push_back(value);
+            if (_tracking)
+            {
+                _ticks.push_back(0);
+            }
             return false;
         }
         else
@@ -316,46 +409,271 @@ namespace ryujin
         }
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline auto sparse_map<EntityType, ValueType, PageSize>::value_begin() noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::index_of(const key_type& key) const noexcept
+    {
+        return _sparse[_page(key)][_offset(key)].identifier;
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline const typename sparse_map<EntityType, ValueType, PageSize, Storage>::key_type& sparse_map<EntityType, ValueType, PageSize, Storage>::key_at(const sz idx) const noexcept
+    {
+        return _packed[idx];
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline typename sparse_map<EntityType, ValueType, PageSize, Storage>::value_type& sparse_map<EntityType, ValueType, PageSize, Storage>::value_at(const sz idx) noexcept
+    {
+        return _values[idx];
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline const typename sparse_map<EntityType, ValueType, PageSize, Storage>::value_type& sparse_map<EntityType, ValueType, PageSize, Storage>::value_at(const sz idx) const noexcept
+    {
+        return _values[idx];
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::swap_indices(const sz lhs, const sz rhs)
+    {
+        if (lhs == rhs)
+        {
+            return;
+        }
+
+        const auto left = _packed[lhs];
+        const auto right = _packed[rhs];
+
+        ryujin::move_swap(_packed[lhs], _packed[rhs]);
+        _values.swap(lhs, rhs);
+        if (_tracking)
+        {
+            ryujin::move_swap(_ticks[lhs], _ticks[rhs]);
+        }
+
+        _sparse[_page(left)][_offset(left)].identifier = static_cast<entity_traits<typename EntityType::type>::identifier_type>(rhs);
+        _sparse[_page(right)][_offset(right)].identifier = static_cast<entity_traits<typename EntityType::type>::identifier_type>(lhs);
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    template <typename Compare>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::sort(Compare&& cmp)
+    {
+        const sz count = _packed.size();
+        vector<sz> order(count);
+        for (sz i = 0; i < count; ++i)
+        {
+            order[i] = i;
+        }
+
+        if constexpr (std::is_invocable_r_v<bool, Compare, const value_type&, const value_type&>)
+        {
+            std::sort(order.begin(), order.end(), [this, &cmp](const sz lhs, const sz rhs) {
+                return cmp(_values[lhs], _values[rhs]);
+            });
+        }
+        else
+        {
+            std::sort(order.begin(), order.end(), [this, &cmp](const sz lhs, const sz rhs) {
+                return cmp(_packed[lhs], _packed[rhs]);
+            });
+        }
+
+        // apply the permutation one cycle at a time, swap_indices keeps the sparse pages pointing at the new slots
+        for (sz i = 0; i < count; ++i)
+        {
+            sz current = i;
+            while (order[current] != i)
+            {
+                const sz next = order[current];
+                swap_indices(current, next);
+                order[current] = current;
+                current = next;
+            }
+            order[current] = current;
+        }
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    template <typename OtherValueType, sz OtherPageSize, typename OtherStorage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::sort_as(const sparse_map<EntityType, OtherValueType, OtherPageSize, OtherStorage>& other)
+    {
+        sz position = 0;
+        for (auto it = other.key_begin(); it != other.key_end(); ++it)
+        {
+            const auto key = *it;
+            if (contains(key))
+            {
+                swap_indices(position, index_of(key));
+                ++position;
+            }
+        }
+        return position;
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::set_page_policy(const sparse_page_policy policy) noexcept
+    {
+        _pagePolicy = policy;
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::sparse_page_count() const noexcept
+    {
+        sz count = 0;
+        for (const auto& page : _sparse)
+        {
+            count += page ? 1 : 0;
+        }
+        return count;
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::memory_usage() const noexcept
+    {
+        return sparse_page_count() * PageSize * sizeof(EntityType)
+            + _sparse.capacity() * sizeof(unique_ptr<sparse_page_type>)
+            + _pageOccupancy.capacity() * sizeof(u32)
+            + _packed.capacity() * sizeof(EntityType)
+            + _values.memory_usage()
+            + _ticks.capacity() * sizeof(u64)
+            + _changes.capacity() * sizeof(detail::change_record<EntityType>);
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::enable_change_tracking()
+    {
+        if (!_tracking)
+        {
+            _tracking = true;
+            _ticks.resize(_packed.size(), 0);
+        }
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool sparse_map<EntityType, ValueType, PageSize, Storage>::tracks_changes() const noexcept
+    {
+        return _tracking;
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::touch(const key_type& key, const u64 tick)
+    {
+        touch_at(index_of(key), tick);
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::touch_at(const sz idx, const u64 tick)
+    {
+        if (_tracking)
+        {
+            _ticks[idx] = tick;
+            _changes.push_back({ .key = _packed[idx], .tick = tick });
+        }
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline u64 sparse_map<EntityType, ValueType, PageSize, Storage>::tick_at(const sz idx) const noexcept
+    {
+        // untracked pools report every value as modified
+        return _tracking ? _ticks[idx] : ~u64(0);
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::change_count() const noexcept
+    {
+        return _changes.size();
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::first_change_after(const u64 tick) const noexcept
+    {
+        const auto it = std::upper_bound(_changes.begin(), _changes.end(), tick, [](const u64 lhs, const detail::change_record<EntityType>& rhs) {
+            return lhs < rhs.tick;
+        });
+        return static_cast<sz>(it - _changes.begin());
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::change_at(const sz entry) const noexcept
+    {
+        // only the latest touch of a key still in the map refers to its value, older entries are left for compaction
+        const auto& change = _changes[entry];
+        if (!contains(change.key))
+        {
+            return ~sz(0);
+        }
+
+        const sz idx = index_of(change.key);
+        return _ticks[idx] == change.tick ? idx : ~sz(0);
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::compact_changes() noexcept
+    {
+        sz kept = 0;
+        for (sz entry = 0; entry < _changes.size(); ++entry)
+        {
+            if (change_at(entry) != ~sz(0))
+            {
+                _changes[kept++] = _changes[entry];
+            }
+        }
+        _changes.erase(_changes.begin() + kept, _changes.end());
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline auto sparse_map<EntityType, ValueType, PageSize, Storage>::key_begin() const noexcept
+    {
+        return _packed.begin();
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline auto sparse_map<EntityType, ValueType, PageSize, Storage>::key_end() const noexcept
+    {
+        return _packed.end();
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline auto sparse_map<EntityType, ValueType, PageSize, Storage>::value_begin() noexcept
     {
         return _values.begin();
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline auto sparse_map<EntityType, ValueType, PageSize>::value_begin() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline auto sparse_map<EntityType, ValueType, PageSize, Storage>::value_begin() const noexcept
     {
         return _values.begin();
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline const auto sparse_map<EntityType, ValueType, PageSize>::value_cbegin() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline const auto sparse_map<EntityType, ValueType, PageSize, Storage>::value_cbegin() const noexcept
     {
-        return _values.cbegin();
+        return static_cast<const decltype(_values)&>(_values).begin();
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline auto sparse_map<EntityType, ValueType, PageSize>::value_end() noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline auto sparse_map<EntityType, ValueType, PageSize, Storage>::value_end() noexcept
     {
         return _values.end();
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline auto sparse_map<EntityType, ValueType, PageSize>::value_end() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline auto sparse_map<EntityType, ValueType, PageSize, Storage>::value_end() const noexcept
     {
         return _values.end();
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline const auto sparse_map<EntityType, ValueType, PageSize>::value_cend() const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline const auto sparse_map<EntityType, ValueType, PageSize, Storage>::value_cend() const noexcept
     {
-        return _values.cend();
+        return static_cast<const decltype(_values)&>(_values).end();
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool operator==(const sparse_map<EntityType, ValueType, PageSize>& lhs, const sparse_map<EntityType, ValueType, PageSize>& rhs) noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool operator==(const sparse_map<EntityType, ValueType, PageSize, Storage>& lhs, const sparse_map<EntityType, ValueType, PageSize, Storage>& rhs) noexcept
     {
-        using tp = sparse_map<EntityType, ValueType, PageSize>::key_type::type;
+        using tp = sparse_map<EntityType, ValueType, PageSize, Storage>::key_type::type;
 
         if (lhs.size() == rhs.size())
         {
@@ -375,10 +693,10 @@ namespace ryujin
         return false;
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline bool operator!=(const sparse_map<EntityType, ValueType, PageSize>& lhs, const sparse_map<EntityType, ValueType, PageSize>& rhs) noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline bool operator!=(const sparse_map<EntityType, ValueType, PageSize, Storage>& lhs, const sparse_map<EntityType, ValueType, PageSize, Storage>& rhs) noexcept
     {
-        using tp = sparse_map<EntityType, ValueType, PageSize>::key_type::type;
+        using tp = sparse_map<EntityType, ValueType, PageSize, Storage>::key_type::type;
 
         if (lhs.size() == rhs.size())
         {
@@ -398,26 +716,64 @@ namespace ryujin
         return true;
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline sz sparse_map<EntityType, ValueType, PageSize>::_page(const key_type& tp) const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::_page(const key_type& tp) const noexcept
     {
         const auto result = tp.identifier / PageSize;
         return result;
     }
 
-    template<typename EntityType, typename ValueType, sz PageSize>
-    inline sz sparse_map<EntityType, ValueType, PageSize>::_offset(const key_type& tp) const noexcept
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline sz sparse_map<EntityType, ValueType, PageSize, Storage>::_offset(const key_type& tp) const noexcept
     {
-        constexpr bool isPowerOf2 = (PageSize != 0) && ((PageSize & (PageSize - 1)) != 0);
+        constexpr bool isPowerOf2 = (PageSize != 0) && ((PageSize & (PageSize - 1)) == 0);
         if constexpr (isPowerOf2)
         {
-            return __builtin_ctz(tp.identifier);
+            return tp.identifier & (PageSize - 1);
         }
         else
         {
             return tp.identifier % PageSize;
         }
     }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline void sparse_map<EntityType, ValueType, PageSize, Storage>::_growSparse(const sz pageCount)
+    {
+        // pages are allocated on first use, the page table only grows to cover the range
+        while (_sparse.size() < pageCount)
+        {
+            _sparse.push_back(unique_ptr<sparse_page_type>());
+        }
+        _pageOccupancy.resize(_sparse.size(), 0);
+    }
+
+    template<typename EntityType, typename ValueType, sz PageSize, typename Storage>
+    inline EntityType* sparse_map<EntityType, ValueType, PageSize, Storage>::_acquirePage(const sz page)
+    {
+        if (page >= _sparse.size())
+        {
+            _growSparse(page + 1);
+        }
+
+        if (!_sparse[page])
+        {
+            auto allocated = make_unique<EntityType[]>(PageSize);
+            for (sz i = 0; i < PageSize; ++i)
+            {
+                allocated[i] = _tombstone;
+            }
+            _sparse[page] = ryujin::move(allocated);
+        }
+        return _sparse[page].get();
+    }
+
+    namespace detail
+    {
+        // sparse map backing the pool of a component, laid out according to its component_traits
+        template <typename EntityType, typename T>
+        using pool_map_t = sparse_map<EntityType, T, component_traits<T>::page_size, typename component_traits<T>::storage>;
+    }
 }
 
 #endif // sparse_map_hpp__
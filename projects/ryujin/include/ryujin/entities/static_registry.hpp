@@ -0,0 +1,280 @@
+#ifndef static_registry_hpp__
+#define static_registry_hpp__
+
+#include "component_storage.hpp"
+#include "entity.hpp"
+#include "sparse_map.hpp"
+
+#include "../core/primitives.hpp"
+#include "../core/utility.hpp"
+#include "../core/vector.hpp"
+
+#include <cassert>
+#include <type_traits>
+
+namespace ryujin
+{
+    namespace detail
+    {
+        template <typename T, typename ... Ts>
+        struct type_index;
+
+        template <typename T, typename ... Ts>
+        struct type_index<T, T, Ts...> : integral_constant<sz, 0>
+        {
+        };
+
+        template <typename T, typename U, typename ... Ts>
+        struct type_index<T, U, Ts...> : integral_constant<sz, 1 + type_index<T, Ts...>::value>
+        {
+        };
+
+        template <typename T, typename ... Ts>
+        inline constexpr bool type_in_pack_v = (std::is_same_v<T, Ts> || ...);
+    }
+
+    /// <summary>
+    /// Registry over a fixed set of component types.  Pools live in a tuple indexed at compile time, so component
+    /// access and views resolve to direct sparse map calls with no type erasure, identifier lookup or indirect calls.
+    /// Pools follow the same component_traits storage policies as the dynamic registry.  The static registry emits
+    /// no events and does not track changes; use base_registry for components that are only known at runtime.
+    /// </summary>
+    /// <typeparam name="Entity">Entity handle type</typeparam>
+    /// <typeparam name="Components">Component types stored by the registry</typeparam>
+    template <typename Entity, typename ... Components>
+    class static_registry
+    {
+    public:
+        using entity_type = Entity;
+
+        static_registry() = default;
+        static_registry(const static_registry&) = delete;
+        static_registry(static_registry&&) noexcept = delete;
+        ~static_registry() = default;
+
+        static_registry& operator=(const static_registry&) = delete;
+        static_registry& operator=(static_registry&&) noexcept = delete;
+
+        entity_type allocate();
+        void allocate_n(const sz count, entity_type* out);
+        void deallocate(const entity_type entity);
+        bool alive(const entity_type entity) const noexcept;
+        sz active() const noexcept;
+
+        template <typename T>
+        bool assign(const entity_type entity, const T& value);
+
+        template <typename T>
+        void assign_or_replace(const entity_type entity, const T& value);
+
+        template <typename T>
+        bool remove(const entity_type entity);
+
+        template <typename T, typename ... Ts>
+        bool contains(const entity_type entity) const noexcept;
+
+        template <typename T>
+        T& get(const entity_type entity);
+
+        template <typename T>
+        const T& get(const entity_type entity) const;
+
+        template <typename T>
+        T* try_get(const entity_type entity) noexcept;
+
+        template <typename T>
+        sz size() const noexcept;
+
+        template <typename T>
+        auto& pool() noexcept;
+
+        template <typename T>
+        const auto& pool() const noexcept;
+
+        /// <summary>
+        /// Invokes fn(entity, Ts&...) for every entity with all of the given components.  Iteration is driven by
+        /// the smallest of the pools.
+        /// </summary>
+        template <typename ... Ts, typename Fn>
+        void each(Fn&& fn);
+
+    private:
+        static constexpr entity_type _tombstone = entity_traits<typename entity_type::type>::from_type(~(typename entity_type::type)(0));
+
+        tuple<detail::pool_map_t<entity_type, Components>...> _pools;
+        vector<entity_type> _entities; // live entities, or the next free identifier for released slots
+        entity_type _freeListHead = _tombstone;
+        sz _active = 0;
+
+        template <typename T>
+        static constexpr sz _index() noexcept;
+
+        template <typename Driver, typename ... Ts, typename Fn>
+        void _eachFrom(Fn& fn);
+    };
+
+    template <typename Entity, typename ... Components>
+    inline typename static_registry<Entity, Components...>::entity_type static_registry<Entity, Components...>::allocate()
+    {
+        using identifier_type = typename entity_traits<typename entity_type::type>::identifier_type;
+
+        ++_active;
+        if (_freeListHead.identifier == _tombstone.identifier)
+        {
+            const entity_type e{ static_cast<identifier_type>(_entities.size()), 0 };
+            _entities.push_back(e);
+            return e;
+        }
+
+        const auto identifier = _freeListHead.identifier;
+        const auto version = _entities[identifier].version;
+        _freeListHead.identifier = _entities[identifier].identifier;
+        return _entities[identifier] = entity_type{ identifier, version };
+    }
+
+    template <typename Entity, typename ... Components>
+    inline void static_registry<Entity, Components...>::allocate_n(const sz count, entity_type* out)
+    {
+        _entities.reserve(_entities.size() + count);
+        for (sz i = 0; i < count; ++i)
+        {
+            out[i] = allocate();
+        }
+    }
+
+    template <typename Entity, typename ... Components>
+    inline void static_registry<Entity, Components...>::deallocate(const entity_type entity)
+    {
+        assert(alive(entity) && "Cannot deallocate an entity that is not alive.");
+
+        (pool<Components>().remove(entity), ...);
+
+        // the released slot stores the previous free list head and the version its next owner receives
+        _entities[entity.identifier] = entity_type{ _freeListHead.identifier, static_cast<decltype(entity.version)>(entity.version + 1) };
+        _freeListHead.identifier = entity.identifier;
+        --_active;
+    }
+
+    template <typename Entity, typename ... Components>
+    inline bool static_registry<Entity, Components...>::alive(const entity_type entity) const noexcept
+    {
+        return entity.identifier < _entities.size() && _entities[entity.identifier] == entity;
+    }
+
+    template <typename Entity, typename ... Components>
+    inline sz static_registry<Entity, Components...>::active() const noexcept
+    {
+        return _active;
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline bool static_registry<Entity, Components...>::assign(const entity_type entity, const T& value)
+    {
+        return pool<T>().insert(entity, value);
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline void static_registry<Entity, Components...>::assign_or_replace(const entity_type entity, const T& value)
+    {
+        pool<T>().insert_or_replace(entity, value);
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline bool static_registry<Entity, Components...>::remove(const entity_type entity)
+    {
+        return pool<T>().remove(entity);
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T, typename ... Ts>
+    inline bool static_registry<Entity, Components...>::contains(const entity_type entity) const noexcept
+    {
+        return pool<T>().contains(entity) && (pool<Ts>().contains(entity) && ...);
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline T& static_registry<Entity, Components...>::get(const entity_type entity)
+    {
+        return pool<T>().get(entity);
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline const T& static_registry<Entity, Components...>::get(const entity_type entity) const
+    {
+        return pool<T>().get(entity);
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline T* static_registry<Entity, Components...>::try_get(const entity_type entity) noexcept
+    {
+        auto& p = pool<T>();
+        return p.contains(entity) ? &p.get(entity) : nullptr;
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline sz static_registry<Entity, Components...>::size() const noexcept
+    {
+        return pool<T>().size();
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline auto& static_registry<Entity, Components...>::pool() noexcept
+    {
+        return _pools.template get<_index<T>()>();
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline const auto& static_registry<Entity, Components...>::pool() const noexcept
+    {
+        return _pools.template get<_index<T>()>();
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename ... Ts, typename Fn>
+    inline void static_registry<Entity, Components...>::each(Fn&& fn)
+    {
+        static_assert(sizeof...(Ts) > 0, "At least one component type is required.");
+
+        // pick the smallest pool at runtime, the iteration over it is still resolved at compile time
+        sz smallest = ~sz(0);
+        ((smallest = pool<Ts>().size() < smallest ? pool<Ts>().size() : smallest), ...);
+        const bool dispatched = ((pool<Ts>().size() == smallest ? (_eachFrom<Ts, Ts...>(fn), true) : false) || ...);
+        (void)dispatched;
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename T>
+    inline constexpr sz static_registry<Entity, Components...>::_index() noexcept
+    {
+        static_assert(detail::type_in_pack_v<T, Components...>, "Component type is not part of this static registry.");
+        return detail::type_index<T, Components...>::value;
+    }
+
+    template <typename Entity, typename ... Components>
+    template <typename Driver, typename ... Ts, typename Fn>
+    inline void static_registry<Entity, Components...>::_eachFrom(Fn& fn)
+    {
+        auto& driver = pool<Driver>();
+
+        // walk backwards so that callbacks may remove the current entity's components
+        for (sz i = driver.size(); i > 0; --i)
+        {
+            const entity_type entity = driver.key_at(i - 1);
+            if (((std::is_same_v<Ts, Driver> || pool<Ts>().contains(entity)) && ...))
+            {
+                fn(entity, pool<Ts>().get(entity)...);
+            }
+        }
+    }
+}
+
+#endif // static_registry_hpp__
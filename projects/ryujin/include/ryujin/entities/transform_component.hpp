@@ -10,7 +10,8 @@ namespace ryujin
 {
     struct transform_component
     {
-        mat4<float> matrix = mat4(1.0f);
+        mat4<float> matrix = mat4(1.0f); // relative to parent
+        mat4<float> world = mat4(1.0f); // written by transform_system, do not manually manipulate
         vec3<float> position = vec3(0.0f);
         quat<float> rotation = quat<float>();
         vec3<float> scale = vec3<float>(1.0f);
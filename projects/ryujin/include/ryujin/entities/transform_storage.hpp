@@ -0,0 +1,77 @@
+#ifndef transform_storage_hpp__
+#define transform_storage_hpp__
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+#include "../math/mat4.hpp"
+#include "../math/quat.hpp"
+#include "../math/vec3.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Structure of arrays transform storage.  Positions, rotations and scales are kept in separate dense streams,
+    /// setters only mark an element dirty, and compose() rebuilds every dirty matrix in batches with
+    /// compose_transforms.  Intended for large sets of animated transforms where rebuilding each matrix on every
+    /// write is the bottleneck.
+    /// </summary>
+    class transform_storage
+    {
+    public:
+        /// <summary>
+        /// Appends a transform.  The new element starts dirty.
+        /// </summary>
+        /// <returns>Index of the new transform</returns>
+        RYUJIN_API sz push_back(const vec3<float>& position, const quat<float>& rotation, const vec3<float>& scale);
+
+        /// <summary>
+        /// Removes a transform by moving the last transform into its slot.
+        /// </summary>
+        /// <param name="idx">Index of the transform to remove</param>
+        /// <returns>Previous index of the transform moved into idx, or size() if nothing moved</returns>
+        RYUJIN_API sz swap_remove(const sz idx);
+
+        RYUJIN_API void reserve(const sz count);
+        RYUJIN_API void clear();
+
+        RYUJIN_API sz size() const noexcept;
+        RYUJIN_API sz dirty_count() const noexcept;
+
+        RYUJIN_API void set_position(const sz idx, const vec3<float>& position) noexcept;
+        RYUJIN_API void set_rotation(const sz idx, const quat<float>& rotation) noexcept;
+        RYUJIN_API void set_scale(const sz idx, const vec3<float>& scale) noexcept;
+        RYUJIN_API void set_transform(const sz idx, const vec3<float>& position, const quat<float>& rotation, const vec3<float>& scale) noexcept;
+
+        RYUJIN_API const vec3<float>& position(const sz idx) const noexcept;
+        RYUJIN_API const quat<float>& rotation(const sz idx) const noexcept;
+        RYUJIN_API const vec3<float>& scale(const sz idx) const noexcept;
+        RYUJIN_API const mat4<float>& matrix(const sz idx) const noexcept;
+
+        RYUJIN_API span<vec3<float>> positions() const noexcept;
+        RYUJIN_API span<quat<float>> rotations() const noexcept;
+        RYUJIN_API span<vec3<float>> scales() const noexcept;
+        RYUJIN_API span<mat4<float>> matrices() const noexcept;
+
+        /// <summary>
+        /// Recomposes the matrix of every dirty transform.  Contiguous runs of dirty transforms are composed in a
+        /// single kernel call.
+        /// </summary>
+        /// <returns>Number of matrices recomposed</returns>
+        RYUJIN_API sz compose();
+
+    private:
+        vector<vec3<float>> _positions;
+        vector<quat<float>> _rotations;
+        vector<vec3<float>> _scales;
+        vector<mat4<float>> _matrices;
+        vector<u64> _dirty; // one bit per transform
+        sz _dirtyCount = 0;
+
+        void _markDirty(const sz idx) noexcept;
+        bool _isDirty(const sz idx) const noexcept;
+    };
+}
+
+#endif // transform_storage_hpp__
@@ -0,0 +1,108 @@
+#ifndef transform_system_hpp__
+#define transform_system_hpp__
+
+#include "entity_relationship_component.hpp"
+#include "observer.hpp"
+#include "registry.hpp"
+#include "transform_component.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/vector.hpp"
+
+namespace ryujin
+{
+    class system_scheduler;
+
+    /// <summary>
+    /// Propagates local transforms down entity_relationship_component hierarchies into world matrices.
+    ///
+    /// Entities are ordered into one segment per root, each segment breadth first so that parents are always
+    /// resolved before their children.  Only subtrees below a modified transform are recomputed, and independent
+    /// segments are processed in parallel.  Local transforms must be modified through change tracked accessors
+    /// (get_mut, patch, replace) for the system to observe them.  Every world matrix whose value changed is in turn
+    /// reported as an update of its transform_component, so observers of the transform pool see entities that moved
+    /// through their parents.
+    ///
+    /// Spawning, despawning and reparenting only lay out the segments of the trees involved again, appending them
+    /// to the ordering.  The whole ordering is rebuilt once most of it belongs to released segments.
+    /// </summary>
+    class transform_system
+    {
+    public:
+        using entity_type = registry::entity_type;
+        using relationship_type = entity_relationship_component<entity_type>;
+
+        /// <summary>
+        /// Constructs a transform system over a registry, enabling change tracking on the transform and relationship
+        /// pools.
+        /// </summary>
+        /// <param name="reg">Registry to propagate transforms of</param>
+        RYUJIN_API explicit transform_system(registry& reg);
+
+        transform_system(const transform_system&) = delete;
+        transform_system& operator=(const transform_system&) = delete;
+
+        /// <summary>
+        /// Recomputes the world matrices of every entity whose local transform, or any ancestor's local transform,
+        /// changed since the last update.
+        /// </summary>
+        /// <param name="scheduler">Scheduler whose worker threads independent roots are split across, null to update
+        /// on the calling thread only</param>
+        RYUJIN_API void update(system_scheduler* scheduler = nullptr);
+
+        /// <summary>
+        /// Forces the hierarchy ordering to be rebuilt and every world matrix to be recomputed on the next update.
+        /// </summary>
+        RYUJIN_API void invalidate() noexcept;
+
+    private:
+        static constexpr u32 _noParent = ~u32(0);
+        static constexpr sz _parallelThreshold = 4096;
+
+        // node flags
+        static constexpr u8 _recompute = 1;
+        static constexpr u8 _changed = 2;
+
+        struct node
+        {
+            entity_type entity;
+            u32 parent; // index into _order
+            u32 segment;
+        };
+
+        registry* _registry;
+        observer _removals; // entities that lost their transform or relationship, including despawned ones
+        vector<node> _order;
+        vector<mat4<float>> _world;
+        vector<u8> _dirty;
+        vector<sz> _segments; // start offset of each root segment, followed by the total node count
+        vector<u8> _segmentDirty;
+        vector<u8> _segmentAlive; // released segments stay in _order until the next rebuild
+        vector<u32> _slots; // entity identifier -> index into _order
+        vector<u32> _dirtySegments;
+        sz _releasedNodes = 0;
+        u64 _lastTick = 0;
+        bool _invalid = true;
+
+        // per update scratch
+        vector<entity_type> _moved;
+        vector<entity_type> _restructured;
+        vector<entity_type> _roots;
+        vector<u32> _released;
+        vector<sz> _batches;
+
+        bool _isNode(const entity_type entity) const;
+        u32 _slotOf(const entity_type entity) const noexcept;
+        entity_type _rootOf(const entity_type entity) const;
+        void _collectChanges();
+        void _markDirty(const entity_type entity);
+        void _restructure();
+        void _release(const u32 segment);
+        void _rebuild();
+        void _appendSegment(const entity_type root);
+        void _propagate(const u32* segments, const sz count);
+    };
+}
+
+#endif // transform_system_hpp__
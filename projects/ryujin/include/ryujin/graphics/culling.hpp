@@ -0,0 +1,85 @@
+#ifndef culling_hpp__
+#define culling_hpp__
+
+#include "gpu_types.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../math/mat4.hpp"
+#include "../math/vec3.hpp"
+#include "../math/vec4.hpp"
+
+namespace ryujin
+{
+    class occlusion_buffer;
+
+    /// <summary>
+    /// Bounds of a mesh in its vertex space, a box and the sphere around the box center enclosing every vertex.
+    /// </summary>
+    struct mesh_bounds
+    {
+        vec3<float> center = vec3(0.0f);
+        vec3<float> extents = vec3(0.0f); // half size of the box along each axis
+        f32 radius = 0.0f;
+    };
+
+    /// <summary>
+    /// World space view volume.  Each plane stores an inward facing unit normal in xyz and the distance in w, a point
+    /// p is inside when dot(plane.xyz, p) + plane.w >= 0 holds for all six planes.
+    /// </summary>
+    struct frustum
+    {
+        vec4<float> planes[6]; // left, right, bottom, top, near, far
+    };
+
+    /// <summary>
+    /// Resolves instance references to the static and dynamic instance tables they point into.
+    /// </summary>
+    struct instance_source
+    {
+        const gpu_instance_data* statics = nullptr;
+        const gpu_instance_data* dynamics = nullptr;
+
+        const gpu_instance_data& operator[](const u32 ref) const noexcept
+        {
+            return (ref & dynamic_instance_bit) ? dynamics[ref & ~dynamic_instance_bit] : statics[ref];
+        }
+    };
+
+    /// <summary>
+    /// Extracts the frustum planes of a projection * view matrix.
+    /// </summary>
+    RYUJIN_API frustum extract_frustum(const mat4<float>& viewProj) noexcept;
+
+    /// <summary>
+    /// Tests a mesh placed by a world transform against a frustum.  The bounding sphere is tested first and the box,
+    /// oriented by the transform, refines the result.
+    /// </summary>
+    RYUJIN_API bool is_visible(const frustum& view, const mesh_bounds& bounds, const mat4<float>& transform) noexcept;
+
+    /// <summary>
+    /// Culls the instances of a set of indirect draws against a frustum.  Draw i reads instanceCount instance
+    /// references starting at firstInstance from refs and is tested with bounds[i].  References of visible instances
+    /// are written to out back to back in draw order, and outCalls[i] receives draw i with its instance count reduced
+    /// to the visible instances and its first instance pointing into out, offset by firstInstance.  Four instances are
+    /// tested per iteration using SSE when available.  Instances inside the frustum are then tested against the
+    /// occlusion buffer, if one is given.
+    /// </summary>
+    /// <param name="view">Frustum to test against</param>
+    /// <param name="calls">Draws over the instance references</param>
+    /// <param name="bounds">Bounds of the mesh drawn by each draw</param>
+    /// <param name="refs">Instance references in draw order</param>
+    /// <param name="instances">Tables the references point into</param>
+    /// <param name="firstInstance">Instance index of out[0] as seen by the draws</param>
+    /// <param name="capacity">Number of references out can hold, instances past it are dropped</param>
+    /// <param name="out">Destination of the visible instance references</param>
+    /// <param name="outCalls">Destination of the culled draws, must hold calls.length() draws</param>
+    /// <param name="occlusion">Rasterized occlusion buffer of the same view, or nullptr to skip occlusion culling</param>
+    /// <returns>Number of references written to out</returns>
+    RYUJIN_API sz cull_instances(const frustum& view, const span<gpu_indirect_call> calls, const span<mesh_bounds> bounds, const span<u32> refs,
+        const instance_source& instances, const u32 firstInstance, const sz capacity, u32* out, gpu_indirect_call* outCalls,
+        const occlusion_buffer* occlusion = nullptr) noexcept;
+}
+
+#endif // culling_hpp__
@@ -0,0 +1,106 @@
+#ifndef draw_buckets_hpp__
+#define draw_buckets_hpp__
+
+#include "culling.hpp"
+#include "gpu_types.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Flat table of the instances drawn by each (material type, mesh group, mesh) bucket, kept ready to be written
+    /// as indirect draw calls.  Every bucket owns a range of the instance reference array with room to grow, so that
+    /// adding or removing an instance only patches the bucket's own draw call.  Draw calls are ordered by mesh group
+    /// within a material type, and are only reordered when a bucket is created.
+    /// </summary>
+    class draw_bucket_table
+    {
+    public:
+        static constexpr u32 invalid_bucket = ~u32(0);
+
+        struct bucket_key
+        {
+            u32 type;
+            u32 group;
+            u32 mesh; // slot index of the mesh, buckets are looked up by it directly
+        };
+
+        /// <summary>
+        /// Constructs an empty table.
+        /// </summary>
+        /// <param name="typeCount">Number of material types, each drawn with its own set of draw calls</param>
+        RYUJIN_API explicit draw_bucket_table(const u32 typeCount);
+
+        /// <summary>
+        /// Adds an entity's instance to the bucket of a mesh, creating the bucket if it is the mesh's first instance.
+        /// </summary>
+        /// <param name="entity">Identifier of the entity, used to find the instance again on removal</param>
+        /// <param name="ref">Instance reference written for the entity</param>
+        /// <param name="key">Bucket the instance is drawn by</param>
+        /// <param name="mesh">Index range of the mesh, instance fields are ignored</param>
+        /// <param name="bounds">Bounds of the mesh</param>
+        RYUJIN_API void add(const u32 entity, const u32 ref, const bucket_key& key, const gpu_indirect_call& mesh, const mesh_bounds& bounds);
+
+        /// <summary>
+        /// Removes an entity's instance by moving the bucket's last instance into its place.
+        /// </summary>
+        /// <returns>True if the entity had an instance in the table</returns>
+        RYUJIN_API bool remove(const u32 entity);
+
+        RYUJIN_API bool contains(const u32 entity) const noexcept;
+
+        /// <summary>
+        /// Gets the draw calls of a material type.  Instance ranges index into refs().
+        /// </summary>
+        RYUJIN_API span<gpu_indirect_call> calls(const u32 type) const noexcept;
+        RYUJIN_API span<mesh_bounds> bounds(const u32 type) const noexcept;
+
+        /// <summary>
+        /// Gets the number of draw calls of each mesh group of a material type, indexed by mesh group.
+        /// </summary>
+        RYUJIN_API span<u32> group_counts(const u32 type) const noexcept;
+
+        RYUJIN_API span<u32> refs() const noexcept;
+        RYUJIN_API sz bucket_count() const noexcept;
+
+    private:
+        static constexpr u32 _minCapacity = 8;
+
+        struct bucket
+        {
+            bucket_key key;
+            u32 draw; // index into the type's draw calls
+            u32 first; // start of the bucket's range in _refs
+            u32 capacity;
+        };
+
+        struct location
+        {
+            u32 bucket = invalid_bucket;
+            u32 index = 0;
+        };
+
+        u32 _typeCount;
+        vector<bucket> _buckets;
+        vector<u32> _lut; // mesh * type count + type -> bucket
+        vector<location> _locations; // entity identifier -> instance
+        vector<u32> _refs;
+        vector<u32> _owners; // entity identifier of each instance in _refs
+        sz _unused = 0; // entries of _refs no longer owned by any bucket
+
+        vector<vector<gpu_indirect_call>> _calls;
+        vector<vector<mesh_bounds>> _bounds;
+        vector<vector<u32>> _groupCounts;
+
+        u32 _createBucket(const bucket_key& key, const gpu_indirect_call& mesh, const mesh_bounds& bounds);
+        void _rebuildDraws(const u32 type);
+        void _grow(const u32 bucketIndex);
+        void _compact();
+    };
+}
+
+#endif // draw_buckets_hpp__
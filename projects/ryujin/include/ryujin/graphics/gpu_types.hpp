@@ -0,0 +1,118 @@
+#ifndef gpu_types_hpp__
+#define gpu_types_hpp__
+
+#include "../core/primitives.hpp"
+#include "../math/mat4.hpp"
+#include "../math/vec4.hpp"
+
+namespace ryujin
+{
+    // instance references select a slot of the static instance buffer, or of the dynamic one when this bit is set
+    constexpr u32 dynamic_instance_bit = 0x80000000u;
+
+    struct gpu_instance_data
+    {
+        mat4<float> transform;
+        u32 material;
+        u32 parent;
+        u32 pad0, pad1;
+    };
+
+    // layout of the instances in the GPU instance buffers, chosen when the render pipeline is created
+    enum class instance_format : u32
+    {
+        FULL,      // gpu_instance_data
+        AFFINE,    // gpu_affine_instance_data
+        QUANTIZED  // gpu_quantized_instance_data
+    };
+
+    // specialization constant of pbr/shader.vert holding the instance_format
+    constexpr u32 instance_format_constant_id = 6;
+
+    struct gpu_affine_instance_data
+    {
+        f32 rows[3][4]; // upper three rows of the world matrix, the fourth row is always (0, 0, 0, 1)
+        u32 material;
+    };
+
+    struct gpu_quantized_instance_data
+    {
+        f32 position[3];
+        i16 rotation[4]; // snorm16 quaternion (x, y, z, w)
+        u16 scale[3]; // half floats, negative x scale for mirrored instances
+        u16 pad0;
+        u32 material;
+    };
+
+    static_assert(sizeof(gpu_instance_data) == 80);
+    static_assert(sizeof(gpu_affine_instance_data) == 52);
+    static_assert(sizeof(gpu_quantized_instance_data) == 32);
+
+    struct gpu_material_data
+    {
+        u32 albedo;
+        u32 normal;
+        u32 metallicRoughness;
+        u32 emissive;
+        u32 ambientOcclusion;
+    };
+
+    struct gpu_indirect_call
+    {
+        u32 indexCount;
+        u32 instanceCount;
+        u32 firstIndex;
+        i32 vertexOffset;
+        u32 firstInstance;
+    };
+
+    struct gpu_directional_light
+    {
+        vec4<float> directionIntensity; // (xyz) direction, (w) intensity
+        vec4<float> color;
+    };
+    
+    struct gpu_point_light
+    {
+        vec4<f32> position;
+        vec4<f32> color;
+        vec4<f32> attenuation; // constant, linear, quadratic, range
+    };
+
+    struct gpu_spot_light
+    {
+        vec4<f32> position;
+        vec4<f32> rotation;
+        vec4<f32> color;
+        vec4<f32> attenuation; // constant, linear, quadratic, range
+        f32 innerRadius;
+        f32 outerRadius;
+        f32 pad0, pad1;
+    };
+
+    struct alignas(16) gpu_ambient_light
+    {
+        vec4<float> color; // (xyz) color, (w) intensity
+    };
+
+    struct gpu_scene_lighting
+    {
+        static constexpr sz MAX_POINT_LIGHTS = 512;
+        static constexpr sz MAX_SPOT_LIGHTS = 512;
+        u32 numPointLights;
+        u32 numSpotLights;
+        u32 pad0, pad1;
+        gpu_point_light points[MAX_POINT_LIGHTS];
+        gpu_spot_light spots[MAX_SPOT_LIGHTS];
+        gpu_directional_light sun;
+        gpu_ambient_light ambient;
+    };
+
+    struct alignas(512) gpu_scene_data
+    {
+        gpu_scene_lighting lighting;
+        u32 texturesLoaded;
+    };
+}
+
+#endif // gpu_types_hpp__
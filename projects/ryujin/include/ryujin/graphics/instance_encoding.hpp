@@ -0,0 +1,33 @@
+#ifndef instance_encoding_hpp__
+#define instance_encoding_hpp__
+
+#include "gpu_types.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Gets the size in bytes of one instance stored in a format.
+    /// </summary>
+    RYUJIN_API sz instance_stride(const instance_format format) noexcept;
+
+    /// <summary>
+    /// Encodes instances into a GPU instance buffer.  AFFINE keeps the world matrix exactly, QUANTIZED decomposes
+    /// it into translation, rotation and scale, dropping any shear introduced by non-uniformly scaled parents.
+    /// The parent index is only kept by FULL.
+    /// </summary>
+    /// <param name="format">Format of the destination buffer</param>
+    /// <param name="instances">Instances to encode</param>
+    /// <param name="count">Number of instances to encode</param>
+    /// <param name="dst">Destination of the first instance, count * instance_stride(format) bytes long</param>
+    RYUJIN_API void encode_instances(const instance_format format, const gpu_instance_data* instances, const sz count, void* dst) noexcept;
+
+    /// <summary>
+    /// Decodes an instance the same way pbr/shader.vert does.
+    /// </summary>
+    RYUJIN_API gpu_instance_data decode_instance(const instance_format format, const void* src) noexcept;
+}
+
+#endif // instance_encoding_hpp__
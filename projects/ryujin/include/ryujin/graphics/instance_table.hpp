@@ -0,0 +1,81 @@
+#ifndef instance_table_hpp__
+#define instance_table_hpp__
+
+#include "gpu_types.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Host copy of a GPU instance buffer in which every instance keeps its slot for as long as it lives.  Changes
+    /// are tracked per frame in flight, so that each frame's copy of the buffer only receives the slots that changed
+    /// since that frame was last written.
+    /// </summary>
+    class instance_table
+    {
+    public:
+        static constexpr u32 max_frames = 8;
+        static constexpr u32 invalid_slot = ~u32(0);
+
+        struct range
+        {
+            u32 first;
+            u32 count;
+        };
+
+        /// <summary>
+        /// Constructs an empty table.
+        /// </summary>
+        /// <param name="frames">Number of copies of the buffer kept on the GPU, at most max_frames</param>
+        RYUJIN_API explicit instance_table(const u32 frames = 1);
+
+        /// <summary>
+        /// Stores an instance in a free slot, reusing released slots first.
+        /// </summary>
+        /// <returns>Slot of the instance</returns>
+        RYUJIN_API u32 allocate(const gpu_instance_data& data);
+
+        /// <summary>
+        /// Frees a slot for reuse.  Its contents are left in place until the slot is allocated again.
+        /// </summary>
+        RYUJIN_API void release(const u32 slot);
+
+        /// <summary>
+        /// Replaces the instance in a slot and marks it changed for every frame.
+        /// </summary>
+        RYUJIN_API void update(const u32 slot, const gpu_instance_data& data);
+
+        /// <summary>
+        /// Collects the slots changed since the frame was last flushed, as sorted ranges of adjacent slots.  The
+        /// ranges are valid until the next call to flush.
+        /// </summary>
+        RYUJIN_API span<range> flush(const u32 frame);
+
+        /// <summary>
+        /// Gets the number of slots that can hold instances, including released slots.  Buffers mirroring the table
+        /// must hold at least this many instances.
+        /// </summary>
+        RYUJIN_API sz size() const noexcept;
+        RYUJIN_API sz live() const noexcept;
+        RYUJIN_API u32 frames() const noexcept;
+
+        RYUJIN_API const gpu_instance_data* data() const noexcept;
+        RYUJIN_API const gpu_instance_data& operator[](const u32 slot) const noexcept;
+
+    private:
+        vector<gpu_instance_data> _instances;
+        vector<u8> _pending; // bit per frame, set while the slot waits in that frame's dirty list
+        vector<u32> _free;
+        vector<vector<u32>> _dirty;
+        vector<range> _ranges;
+        u32 _frames;
+
+        void _markDirty(const u32 slot);
+    };
+}
+
+#endif // instance_table_hpp__
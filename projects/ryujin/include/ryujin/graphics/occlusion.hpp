@@ -0,0 +1,141 @@
+#ifndef occlusion_hpp__
+#define occlusion_hpp__
+
+#include "culling.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+#include "../core/vector.hpp"
+#include "../math/mat4.hpp"
+#include "../math/vec3.hpp"
+
+namespace ryujin
+{
+    class system_scheduler;
+
+    /// <summary>
+    /// Low resolution depth buffer rasterized on the CPU from occluder meshes and used to reject instances hidden
+    /// behind them.  Depth is stored in tiles of tile_width x tile_height pixels, each tile also tracking its farthest
+    /// depth so that most occludee tests never touch individual pixels.  Triangles are rasterized four pixels at a
+    /// time using SSE when available.  Triangle setup and rasterization are split into jobs run on the worker pool of a
+    /// system_scheduler; set up triangles are binned by the tile rows they overlap and every tile row is written by
+    /// exactly one job from its own bin, so the result does not depend on the worker count.
+    ///
+    /// Depth follows the clip space of perspective(), nearer surfaces have smaller z / w.  Occluder triangles with a
+    /// vertex behind the camera are skipped, which only makes the buffer less occluding.
+    /// </summary>
+    class occlusion_buffer
+    {
+    public:
+        static constexpr u32 tile_width = 8;
+        static constexpr u32 tile_height = 4;
+
+        /// <summary>
+        /// Constructs an occlusion buffer.
+        /// </summary>
+        /// <param name="width">Width in pixels, rounded up to a multiple of tile_width</param>
+        /// <param name="height">Height in pixels, rounded up to a multiple of tile_height</param>
+        /// <param name="scheduler">Scheduler whose worker threads the jobs are split across, null to rasterize on the
+        /// calling thread only</param>
+        RYUJIN_API explicit occlusion_buffer(const u32 width = 256, const u32 height = 144, system_scheduler* scheduler = nullptr);
+
+        occlusion_buffer(const occlusion_buffer&) = delete;
+        occlusion_buffer(occlusion_buffer&&) noexcept = delete;
+        occlusion_buffer& operator=(const occlusion_buffer&) = delete;
+        occlusion_buffer& operator=(occlusion_buffer&&) noexcept = delete;
+
+        /// <summary>
+        /// Clears the buffer and the queued occluders and sets the view projection used by following calls.
+        /// </summary>
+        RYUJIN_API void begin(const mat4<float>& viewProj);
+
+        /// <summary>
+        /// Queues an indexed triangle list as an occluder.  The positions and indices are referenced, not copied, and
+        /// must stay alive until rasterize returns.
+        /// </summary>
+        /// <param name="positions">Vertex positions in mesh space</param>
+        /// <param name="indices">Three indices per triangle</param>
+        /// <param name="transform">Mesh to world transform</param>
+        RYUJIN_API void add_occluder(const span<vec3<float>> positions, const span<u32> indices, const mat4<float>& transform);
+
+        /// <summary>
+        /// Rasterizes all queued occluders.  Returns once the buffer is complete.
+        /// </summary>
+        RYUJIN_API void rasterize();
+
+        /// <summary>
+        /// Tests whether a mesh placed by a world transform may be visible.  The screen rectangle and nearest depth
+        /// of its box are compared against the buffer: false is only returned when every pixel the rectangle touches
+        /// holds an occluder nearer than the whole box.  Occluders are sampled at pixel centers, so the test is
+        /// conservative down to the buffer resolution; a box that only shows through a sub pixel gap next to an
+        /// occluder edge may still be reported hidden.
+        /// </summary>
+        RYUJIN_API bool is_visible(const mesh_bounds& bounds, const mat4<float>& transform) const noexcept;
+
+        /// <summary>
+        /// Gets the depth stored at a pixel.  Pixels not covered by an occluder hold the largest float.
+        /// </summary>
+        RYUJIN_API f32 depth(const u32 x, const u32 y) const noexcept;
+
+        RYUJIN_API u32 width() const noexcept;
+        RYUJIN_API u32 height() const noexcept;
+        RYUJIN_API sz worker_count() const noexcept;
+
+    private:
+        struct occluder
+        {
+            const vec3<float>* positions;
+            const u32* indices;
+            sz triangleCount;
+            sz firstTriangle;
+            mat4<float> transform; // mesh to clip space
+        };
+
+        struct setup_job
+        {
+            sz occluderIndex;
+            sz firstTriangle;
+            sz triangleCount;
+        };
+
+        struct screen_triangle
+        {
+            f32 edges[3][3]; // a * x + b * y + c per edge, all non negative inside
+            f32 depth[3]; // depth plane a * x + b * y + c
+            i32 minX, minY, maxX, maxY; // pixel bounds, inclusive, empty when minX > maxX
+        };
+
+        enum class job_kind
+        {
+            SETUP,
+            RASTERIZE
+        };
+
+        u32 _width;
+        u32 _height;
+        u32 _tilesX;
+        u32 _tilesY;
+        mat4<float> _viewProj;
+
+        vector<f32> _depth; // tile major, row major within each tile
+        vector<f32> _tileMax;
+
+        vector<occluder> _occluders;
+        vector<setup_job> _setupJobs;
+        vector<screen_triangle> _triangles;
+        vector<sz> _rowBins; // triangle indices grouped by tile row, in submission order within each row
+        vector<sz> _rowBinOffsets; // _tilesY + 1 offsets into _rowBins
+
+        system_scheduler* _scheduler;
+
+        void _dispatch(const job_kind kind, const sz jobCount);
+        void _run(const job_kind kind, const sz job);
+        void _setup(const setup_job& job);
+        void _binRows();
+        void _rasterizeRow(const u32 tileY);
+        void _shadeSpan(f32* depth, const f32 x, const f32 y, const screen_triangle& tri) const noexcept;
+    };
+}
+
+#endif // occlusion_hpp__
@@ -1,6 +1,7 @@
 #ifndef naive_translucent_pbr_pass__
 #define naive_translucent_pbr_pass__
 
+#include "../gpu_types.hpp"
 #include "../types.hpp"
 
 #include "../../core/export.hpp"
@@ -14,11 +15,11 @@ namespace ryujin
     class naive_translucent_pbr_pass
     {
     public:
-        RYUJIN_API naive_translucent_pbr_pass(render_manager& manager, pipeline_layout layout, render_pass pass, u32 width, u32 height);
+        RYUJIN_API naive_translucent_pbr_pass(render_manager& manager, pipeline_layout layout, render_pass pass, u32 width, u32 height, instance_format format);
 
         RYUJIN_API void render(graphics_command_list& cmd, buffer& indirect, buffer& count, sz indirectOffset, sz countOffset, sz numBufferGroups);
     private:
-        void init_graphics_pipeline(u32 width, u32 height, render_pass pass);
+        void init_graphics_pipeline(u32 width, u32 height, render_pass pass, instance_format format);
 
         render_manager& _manager;
         pipeline_layout _layout = {};
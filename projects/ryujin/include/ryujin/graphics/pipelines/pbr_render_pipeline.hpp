@@ -13,6 +13,8 @@
 #include "../passes/blit_pass.hpp"
 #include "../passes/naive_translucent_pbr_pass.hpp"
 #include "../passes/opaque_pbr_pass.hpp"
+#include "../gpu_types.hpp"
+#include "../occlusion.hpp"
 #include "../render_manager.hpp"
 #include "../types.hpp"
 
@@ -31,8 +33,16 @@ namespace ryujin
         static constexpr u32 _maxDrawCalls = 512;
         static constexpr u32 _maxTextures = 256;
         static constexpr u32 _maxCameras = 32;
+        static constexpr u32 _occlusionWidth = 256;
+        static constexpr u32 _occlusionHeight = 144;
 
     public:
+        /// <summary>
+        /// Constructs the pipeline.
+        /// </summary>
+        /// <param name="format">Layout of the instances in the instance buffers read by the vertex shader</param>
+        RYUJIN_API explicit pbr_render_pipeline(const instance_format format = instance_format::AFFINE);
+
         RYUJIN_API void pre_render() override;
         RYUJIN_API void render() override;
     protected:
@@ -62,26 +72,32 @@ namespace ryujin
         unique_ptr<blit_pass> _blit;
         unique_ptr<opaque_pbr_pass> _opaque;
         unique_ptr<naive_translucent_pbr_pass> _naiveTranslucent;
+        unique_ptr<occlusion_buffer> _occlusion;
 
         buffer _indirectCommands = {};
         buffer _translucentIndirectCommands = {};
         buffer _indirectCount = {};
         buffer _translucentIndirectCount = {};
         buffer _materials = {};
-        buffer _instanceData = {};
+        buffer _staticInstances = {};
+        buffer _staticStaging = {};
+        buffer _dynamicInstances = {};
+        buffer _visibleInstances = {};
         buffer _cameraData = {};
         buffer _sceneData = {};
         vector<texture> _textures;
         texture _invalidTexture = {};
 
         vector<descriptor_image_info> _textureWriteScratchBuffer;
+        vector<buffer_copy_regions> _staticCopies; // staged by pre_render, recorded by render
         vector<entity_handle<registry::entity_type>> _activeCams;
 
         renderable_manager::draw_call_write_info _numBufferGroupsToDraw = {};
         renderable_manager::draw_call_write_info _numTranslucentBufferGroupsToDraw = {};
-        renderable_manager::instance_write_info _instanceCounts;
 
         u32 _textureCount = 0;
+        instance_format _instanceFormat;
+        sz _instanceStride;
     };
 }
 
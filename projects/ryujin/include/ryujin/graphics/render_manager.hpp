@@ -24,6 +24,7 @@
 #include <functional>
 #include <optional>
 #include <unordered_map>
+#include <utility>
 
 namespace ryujin
 {
@@ -38,6 +39,7 @@ namespace ryujin
     concept render_pipeline_type = std::is_base_of_v<base_render_pipeline, T> && std::is_default_constructible_v<T>;
 
     class render_manager;
+    class system_scheduler;
 
     class command_list
     {
@@ -48,6 +50,7 @@ namespace ryujin
         RYUJIN_API void submit(const submit_info& info, const fence f = nullptr);
 
         RYUJIN_API void barrier(pipeline_stage src, pipeline_stage dst, const span<memory_barrier>& memBarriers, const span<buffer_memory_barrier>& bufMemBarriers, const span<image_memory_barrier>& imgMemBarriers);
+        RYUJIN_API void copy(const buffer& src, const buffer& dst, const span<buffer_copy_regions>& regions);
         RYUJIN_API void push_constants(const pipeline_layout& layout, const shader_stage stages, const u32 offset, const u32 size, const void* data);
 
         RYUJIN_API operator bool() const noexcept;
@@ -94,7 +97,7 @@ namespace ryujin
     public:
         RYUJIN_API ~transfer_command_list() = default;
 
-        RYUJIN_API void copy(const buffer& src, const buffer& dst, const span<buffer_copy_regions>& regions);
+        using command_list::copy;
         RYUJIN_API void copy(const buffer& src, const image& dst, const image_layout layout, const span<buffer_image_copy_regions>& regions);
 
     private:
@@ -284,7 +287,7 @@ namespace ryujin
             ILLEGAL_ARGUMENT
         };
 
-        RYUJIN_API static result<unique_ptr<render_manager>, error_code> create(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry& reg);
+        RYUJIN_API static result<unique_ptr<render_manager>, error_code> create(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry& reg, system_scheduler* scheduler = nullptr);
 
         render_manager(const render_manager&) = delete;
         render_manager(render_manager&&) noexcept = delete;
@@ -347,15 +350,21 @@ namespace ryujin
         RYUJIN_API fence flight_complete_fence() const noexcept;
 
         RYUJIN_API renderable_manager& renderables() noexcept;
+
+        /// <summary>
+        /// Gets the scheduler whose worker pool render work may be split across.
+        /// </summary>
+        /// <returns>Engine system scheduler, null if render work runs on the render thread only</returns>
+        RYUJIN_API system_scheduler* scheduler() const noexcept;
         
-        template <render_pipeline_type T>
-        void use_render_pipeline();
+        template <render_pipeline_type T, typename ... Args>
+        void use_render_pipeline(Args&& ... args);
 
         RYUJIN_API unique_ptr<base_render_pipeline>& get_render_pipeline() noexcept;
 
         RYUJIN_API void wait(const fence& f);
     private:
-        render_manager(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry* reg);
+        render_manager(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry* reg, system_scheduler* scheduler);
 
         error_code create_surface();
         error_code create_swapchain();
@@ -422,6 +431,7 @@ namespace ryujin
         std::atomic_bool _isMinimized = false;
 
         renderable_manager _renderables;
+        system_scheduler* _scheduler;
 
         inline VkAllocationCallbacks* get_allocation_callbacks()
         {
@@ -439,10 +449,10 @@ namespace ryujin
         }
     };
     
-    template<render_pipeline_type T>
-    inline void render_manager::use_render_pipeline()
+    template<render_pipeline_type T, typename ... Args>
+    inline void render_manager::use_render_pipeline(Args&& ... args)
     {
-        _renderer = ryujin::unique_ptr<base_render_pipeline>(new T());
+        _renderer = ryujin::unique_ptr<base_render_pipeline>(new T(std::forward<Args>(args)...));
         _renderer->set_render_manager(this);
     }
 }
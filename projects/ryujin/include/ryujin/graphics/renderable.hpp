@@ -1,7 +1,13 @@
 #ifndef renderable_hpp__
 #define renderable_hpp__
 
+#include "camera_component.hpp"
+#include "culling.hpp"
+#include "draw_buckets.hpp"
+#include "gpu_types.hpp"
+#include "instance_table.hpp"
 #include "lighting_components.hpp"
+#include "occlusion.hpp"
 #include "types.hpp"
 
 #include "../core/assets.hpp"
@@ -9,7 +15,10 @@
 #include "../core/optional.hpp"
 #include "../core/primitives.hpp"
 #include "../core/slot_map.hpp"
+#include "../core/span.hpp"
 #include "../core/vector.hpp"
+#include "../entities/observer.hpp"
+#include "../entities/prefab.hpp"
 #include "../entities/registry.hpp"
 
 #include <map>
@@ -41,86 +50,32 @@ namespace ryujin
         u32 vertexOffset;
         u32 indexOffset;
         u32 indexCount;
+        mesh_bounds bounds;
     };
 
     struct renderable_component
     {
         slot_map_key material = slot_map<ryujin::material>::invalid;
         slot_map_key mesh = slot_map<ryujin::renderable_mesh>::invalid;
+        bool isStatic = false; // static instances are uploaded to device local memory once and rarely move
     };
 
-    struct gpu_instance_data
+    /// <summary>
+    /// Triangles kept on the CPU for occlusion culling, usually a simplified version of a renderable mesh.
+    /// </summary>
+    struct occluder_mesh
     {
-        mat4<float> transform;
-        u32 material;
-        u32 parent;
-        u32 pad0, pad1;
+        vector<vec3<float>> positions;
+        vector<u32> indices;
     };
 
-    struct gpu_material_data
+    /// <summary>
+    /// Marks an entity as an occluder.  The mesh is rasterized into the occlusion buffer of every camera using the
+    /// entity's world transform.
+    /// </summary>
+    struct occluder_component
     {
-        u32 albedo;
-        u32 normal;
-        u32 metallicRoughness;
-        u32 emissive;
-        u32 ambientOcclusion;
-    };
-
-    struct gpu_indirect_call
-    {
-        u32 indexCount;
-        u32 instanceCount;
-        u32 firstIndex;
-        i32 vertexOffset;
-        u32 firstInstance;
-    };
-
-    struct gpu_directional_light
-    {
-        vec4<float> directionIntensity; // (xyz) direction, (w) intensity
-        vec4<float> color;
-    };
-    
-    struct gpu_point_light
-    {
-        vec4<f32> position;
-        vec4<f32> color;
-        vec4<f32> attenuation; // constant, linear, quadratic, range
-    };
-
-    struct gpu_spot_light
-    {
-        vec4<f32> position;
-        vec4<f32> rotation;
-        vec4<f32> color;
-        vec4<f32> attenuation; // constant, linear, quadratic, range
-        f32 innerRadius;
-        f32 outerRadius;
-        f32 pad0, pad1;
-    };
-
-    struct alignas(16) gpu_ambient_light
-    {
-        vec4<float> color; // (xyz) color, (w) intensity
-    };
-
-    struct gpu_scene_lighting
-    {
-        static constexpr sz MAX_POINT_LIGHTS = 512;
-        static constexpr sz MAX_SPOT_LIGHTS = 512;
-        u32 numPointLights;
-        u32 numSpotLights;
-        u32 pad0, pad1;
-        gpu_point_light points[MAX_POINT_LIGHTS];
-        gpu_spot_light spots[MAX_SPOT_LIGHTS];
-        gpu_directional_light sun;
-        gpu_ambient_light ambient;
-    };
-
-    struct alignas(512) gpu_scene_data
-    {
-        gpu_scene_lighting lighting;
-        u32 texturesLoaded;
+        slot_map_key mesh = slot_map<ryujin::occluder_mesh>::invalid;
     };
 
     class renderable_manager
@@ -135,12 +90,6 @@ namespace ryujin
             buffer indices;
         };
 
-        struct instance_write_info
-        {
-            sz opaqueCount;
-            sz translucentCount;
-        };
-
         struct draw_call_write_info
         {
             sz meshGroupCount;
@@ -148,6 +97,7 @@ namespace ryujin
         };
 
         RYUJIN_API explicit renderable_manager(render_manager* manager, registry* reg);
+        RYUJIN_API ~renderable_manager();
         RYUJIN_API slot_map_key load_texture(const string& name, const texture_asset& asset);
         RYUJIN_API slot_map_key load_texture(const string& name, const image img, const image_view view);
         RYUJIN_API optional<texture> try_fetch_texture(const string& name);
@@ -155,15 +105,40 @@ namespace ryujin
         RYUJIN_API void unload_texture(const slot_map_key& key);
 
         RYUJIN_API entity_handle<registry::entity_type> load_to_entities(const asset_manager& mgr, const model_asset& asset);
+        RYUJIN_API prefab bake_prefab(const asset_manager& mgr, const model_asset& asset);
 
         RYUJIN_API slot_map_key load_material(const string& name, const material_asset& asset);
 
         RYUJIN_API slot_map_key load_mesh(const string& name, const mesh& m);
         RYUJIN_API void build_meshes();
 
-        RYUJIN_API instance_write_info write_instances(buffer& buf, const sz offset);
+        RYUJIN_API slot_map_key load_occluder(const string& name, const mesh& m);
+        RYUJIN_API sz write_occluders(occlusion_buffer& buffer);
+
+        /// <summary>
+        /// Copies the world transforms of renderables that moved since the last call into their instance slots.
+        /// </summary>
+        RYUJIN_API void update_instances();
+
+        /// <summary>
+        /// Encodes the static instance slots that changed since the frame's copy of the buffer was last written into
+        /// the frame's range of a host visible staging buffer laid out like the device buffer, and appends the copies
+        /// uploading them to that range.  The offset is in instances.
+        /// </summary>
+        /// <returns>Number of slots staged</returns>
+        RYUJIN_API sz write_static_instances(buffer& staging, const sz offset, const u32 frame, const instance_format format, vector<buffer_copy_regions>& copies);
+
+        /// <summary>
+        /// Writes the dynamic instance slots that changed since the frame's copy of the buffer was last written,
+        /// encoded in the buffer's instance format.  The offset is in instances.
+        /// </summary>
+        /// <returns>Number of slots written</returns>
+        RYUJIN_API sz write_dynamic_instances(buffer& buf, const sz offset, const u32 frame, const instance_format format);
+
+        RYUJIN_API sz write_visible_instances(const frustum& view, const material_type type, buffer& visibleBuffer, const sz visibleOffset, const u32 firstInstance,
+            const sz capacity, buffer& indirectBuffer, const sz indirectOffset, const occlusion_buffer* occlusion = nullptr);
         RYUJIN_API sz write_materials(buffer& buf, const sz offset);
-        RYUJIN_API draw_call_write_info write_draw_calls(buffer& indirectBuffer, buffer& drawCountBuffer, const sz offset, const material_type type);
+        RYUJIN_API draw_call_write_info write_draw_calls(buffer& indirectBuffer, buffer& drawCountBuffer, const sz indirectOffset, const sz countOffset, const material_type type);
         RYUJIN_API sz write_textures(texture* buf, sz offset);
 
         RYUJIN_API sz write_scene_data(buffer& buf, const sz offset);
@@ -177,10 +152,17 @@ namespace ryujin
         // TODO: Reference count textures used in materials, unload texture on reference count decrement to zero
 
     private:
+        void bake_model(prefab& pf, const asset_manager& mgr, const model_asset& asset, const u32 parent);
+
         void register_entity(entity_type ent);
+        void register_entities(const span<entity_type> ents);
         void unregister_entity(entity_type ent);
         void update_entity(entity_type ent);
 
+        gpu_instance_data instance_of(const entity_handle<entity_type>& handle) const;
+        void allocate_instance(entity_type ent, const renderable_component& renderable);
+        void release_instance(entity_type ent);
+
         void register_camera(entity_type ent);
         void unregister_camera(entity_type ent);
 
@@ -190,6 +172,14 @@ namespace ryujin
         void unregister_point_light(entity_type ent);
         void unregister_spot_light(entity_type ent);
         void unregister_directional_light(entity_type ent);
+
+        void on_renderable_added(const component_add_event<renderable_component, entity_type>& e);
+        void on_renderables_added(const component_batch_add_event<renderable_component, entity_type>& e);
+        void on_renderable_removed(const component_remove_event<renderable_component, entity_type>& e);
+        void on_renderable_replaced(const component_replace_event<renderable_component, entity_type>& e);
+        void on_camera_added(const component_add_event<camera_component, entity_type>& e);
+        void on_cameras_added(const component_batch_add_event<camera_component, entity_type>& e);
+        void on_camera_removed(const component_remove_event<camera_component, entity_type>& e);
         
         registry* _registry;
         render_manager* _manager;
@@ -221,21 +211,23 @@ namespace ryujin
         slot_map<renderable_mesh> _meshes;
         unordered_map<string, slot_map_key> _meshesLut;
 
+        slot_map<occluder_mesh> _occluders;
+        unordered_map<string, slot_map_key> _occludersLut;
+
         slot_map<material> _materials;
         unordered_map<string, slot_map_key> _materialsLut;
 
         image_sampler _defaultSampler = {};
 
-        // mesh group id -> collection of meshes -> vector of entities with that mesh
-        vector<unordered_map<u32, unordered_map<slot_map_key, vector<entity_type>, slot_map_key_hash>>> _entities;
-        bool _entitiesDirty;
-
         vector<entity_type> _directionalLights;
         gpu_scene_data _sceneDataCache = {};
 
-        vector<vector<gpu_indirect_call>> _drawCallCache;
-        vector<vector<u32>> _drawCountCache;
-        vector<draw_call_write_info> _groupsWrittenCount;
+        draw_bucket_table _drawBuckets; // draw call of every (material type, mesh group, mesh) and the instances it draws
+
+        instance_table _staticInstances;
+        instance_table _dynamicInstances;
+        vector<u32> _instanceRefs; // entity identifier -> instance reference
+        observer _transformChanges;
         std::map<u32, vector<entity_type>> _cameras;
     };
 }
@@ -623,10 +623,17 @@ namespace ryujin
         span<unsigned char> bytes;
     };
 
+    struct shader_specialization
+    {
+        u32 constantId;
+        u32 value;
+    };
+
     struct shader_stage_info
     {
         shader_stage stage;
         shader_module mod;
+        span<shader_specialization> specializations = {};
     };
 
     struct vertex_input_binding
@@ -42,15 +42,10 @@ namespace ryujin
         if constexpr (std::is_same_v<T, float>)
         {
             // Quake 3 Fast Inversion Square Root
-            long i;
-            float x2, y;
             const float threeHalfs = 1.5f;
-
-            x2 = value * 0.5f;
-            y = value;
-            i = *reinterpret_cast<long*>(&y);
-            i = 0x5f3759df - (i >> 1);
-            y = *reinterpret_cast<float*>(&i);
+            const float x2 = value * 0.5f;
+            const u32 i = 0x5f3759df - (detail::as_u32_bits(value) >> 1);
+            float y = detail::as_float_bits(i);
             y = y * (threeHalfs - (x2 * y * y));
             return as<T>(y);
         }
@@ -90,6 +85,18 @@ namespace ryujin
         return detail::as_float_bits((value & 0x8000) << 16 | (e != 0) * ((e + 112) << 23 | m) | ((e == 0) & (m != 0)) * ((v - 37) << 23 | ((m << (150 - v)) & 0x007FE000))); // sign : normalized : denormalized
     }
 
+    inline constexpr u16 deflate_to_half(const f32 value) { // inverse of inflate_to_float, rounds to nearest and saturates to +-65504.0 instead of overflowing to infinity
+        const u32 b = detail::as_u32_bits(value) + 0x00001000; // round-to-nearest-even: add last bit after truncated mantissa
+        const u32 e = (b & 0x7F800000) >> 23; // exponent
+        const u32 m = b & 0x007FFFFF; // mantissa; 0x007FF000 = 0x00800000 - 0x00001000 = decimal indicator flag - initial rounding
+        const u32 sign = (b & 0x80000000) >> 16;
+        if (e > 142)
+        {
+            return as<u16>(sign | 0x7BFF);
+        }
+        return as<u16>(sign | (e > 112) * (((e - 112) << 10) | m >> 13) | ((e < 113) & (e > 101)) * ((((0x007FF000 + m) >> (125 - e)) + 1) >> 1)); // sign : normalized : denormalized
+    }
+
     template <numeric T>
     inline constexpr T inverse_lerp(const T value, const T low, const T high)
     {
@@ -0,0 +1,25 @@
+#ifndef transform_kernels_hpp__
+#define transform_kernels_hpp__
+
+#include "mat4.hpp"
+#include "quat.hpp"
+#include "vec3.hpp"
+
+#include "../core/export.hpp"
+#include "../core/primitives.hpp"
+#include "../core/span.hpp"
+
+namespace ryujin
+{
+    /// <summary>
+    /// Composes translation * rotation * scale matrices for a batch of transforms, equivalent to calling transform()
+    /// on each element.  Four transforms are composed per iteration using SSE when available.
+    /// </summary>
+    /// <param name="positions">Translation of each transform</param>
+    /// <param name="rotations">Rotation of each transform</param>
+    /// <param name="scales">Scale of each transform</param>
+    /// <param name="out">Destination of the composed matrices, must hold positions.length() matrices</param>
+    RYUJIN_API void compose_transforms(const span<vec3<float>> positions, const span<quat<float>> rotations, const span<vec3<float>> scales, mat4<float>* out);
+}
+
+#endif // transform_kernels_hpp__
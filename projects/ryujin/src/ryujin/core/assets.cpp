@@ -78,7 +78,13 @@ namespace ryujin
 
     transform_component model_asset::transform() const noexcept
     {
-        return transform_component();
+        transform_component tx;
+        tx.matrix = _transform;
+        tx.position = _translation;
+        tx.rotation = _rotation;
+        tx.scale = _scale;
+        tx.deformScale = vec3(1.0f);
+        return tx;
     }
 
     void model_asset::transform(const transform_component& tx) noexcept
@@ -447,10 +447,8 @@ namespace ryujin::assets
                 for (auto childNode : node.children)
                 {
                     auto& child = models[childNode];
+                    // node transforms stay relative to their parent, transform_system propagates them
                     parent->add_child(*child);
-                    auto tx = child->transform();
-                    apply_parent_transform(tx, parent->transform());
-                    child->transform(tx);
                 }
             }
         }
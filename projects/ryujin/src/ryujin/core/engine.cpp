@@ -26,6 +26,9 @@ namespace ryujin
         unique_ptr<render_system> _renderer;
 
         registry _reg;
+        registry_command_queue _commands;
+        system_scheduler _scheduler;
+        transform_system _transforms{ _reg };
 
         std::atomic_bool _isRunning;
         std::binary_semaphore _rendererComplete = std::binary_semaphore(0);
@@ -138,6 +141,10 @@ namespace ryujin
             _impl->_delta = delta.count();
 
             app->on_frame(*this);
+            _impl->_scheduler.execute(_impl->_reg);
+            _impl->_commands.flush(_impl->_reg);
+            _impl->_reg.events().dispatch();
+            _impl->_transforms.update(&_impl->_scheduler);
 
             _impl->_lastTime = currentTime;
 
@@ -159,6 +166,16 @@ namespace ryujin
         return _impl->_reg;
     }
 
+    registry_command_queue& engine_context::get_command_queue() noexcept
+    {
+        return _impl->_commands;
+    }
+
+    system_scheduler& engine_context::get_scheduler() noexcept
+    {
+        return _impl->_scheduler;
+    }
+
     asset_manager& engine_context::get_assets() noexcept
     {
         return *_impl->_assets;
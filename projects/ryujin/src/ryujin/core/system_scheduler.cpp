@@ -0,0 +1,330 @@
+#include <ryujin/core/system_scheduler.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace ryujin
+{
+    system_scheduler::system_scheduler(const sz workerCount)
+    {
+        sz workers = workerCount;
+        if (workers == ~sz(0))
+        {
+            const sz hardware = std::thread::hardware_concurrency();
+            workers = hardware > 1 ? hardware - 1 : 0;
+        }
+
+        _workers.reserve(workers);
+        for (sz i = 0; i < workers; ++i)
+        {
+            _workers.push_back(std::thread([this]() { _workerLoop(); }));
+        }
+    }
+
+    system_scheduler::~system_scheduler()
+    {
+        {
+            std::scoped_lock guard(_lock);
+            _stop = true;
+        }
+        _signal.notify_all();
+
+        for (auto& worker : _workers)
+        {
+            worker.join();
+        }
+    }
+
+    system_scheduler::system_id system_scheduler::add_exclusive_system(const string& name, system_fn&& fn)
+    {
+        return _addSystem(name, ryujin::move(fn), nullptr, {}, {}, true);
+    }
+
+    void system_scheduler::set_enabled(const system_id id, const bool enabled) noexcept
+    {
+        _systems[id].enabled = enabled;
+    }
+
+    bool system_scheduler::is_enabled(const system_id id) const noexcept
+    {
+        return _systems[id].enabled;
+    }
+
+    void system_scheduler::execute(registry& reg)
+    {
+        using std::chrono::high_resolution_clock;
+
+        const auto start = high_resolution_clock::now();
+
+        // pools are created up front so that concurrent systems never grow the registry's pool table
+        for (auto& sys : _systems)
+        {
+            sys.duration = 0.0;
+            if (sys.enabled && sys.prepare)
+            {
+                sys.prepare(reg);
+            }
+        }
+
+        _buildGraph();
+
+        if (_scheduled > 0)
+        {
+            {
+                std::scoped_lock guard(_lock);
+                _registry = &reg;
+            }
+            _signal.notify_all();
+
+            // the calling thread works through the graph alongside the workers
+            std::unique_lock guard(_lock);
+            while (_completed < _scheduled)
+            {
+                if (_ready.empty())
+                {
+                    if (!_runTask(guard))
+                    {
+                        _signal.wait(guard);
+                    }
+                    continue;
+                }
+
+                const sz idx = _ready.back();
+                _ready.pop_back();
+                guard.unlock();
+                _run(idx);
+                guard.lock();
+                _complete(idx);
+            }
+            _registry = nullptr;
+        }
+
+        const auto end = high_resolution_clock::now();
+        _frameDuration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    }
+
+    sz system_scheduler::system_count() const noexcept
+    {
+        return _systems.size();
+    }
+
+    sz system_scheduler::worker_count() const noexcept
+    {
+        return _workers.size();
+    }
+
+    const string& system_scheduler::name(const system_id id) const noexcept
+    {
+        return _systems[id].name;
+    }
+
+    f64 system_scheduler::last_duration(const system_id id) const noexcept
+    {
+        return _systems[id].duration;
+    }
+
+    f64 system_scheduler::last_frame_duration() const noexcept
+    {
+        return _frameDuration;
+    }
+
+    system_scheduler::system_id system_scheduler::_addSystem(const string& name, system_fn&& fn, void (*prepare)(registry&), vector<sz>&& reads, vector<sz>&& writes, const bool exclusive)
+    {
+        std::sort(reads.begin(), reads.end());
+        std::sort(writes.begin(), writes.end());
+
+        _systems.push_back(system{
+                .name = name,
+                .fn = ryujin::move(fn),
+                .prepare = prepare,
+                .reads = ryujin::move(reads),
+                .writes = ryujin::move(writes),
+                .exclusive = exclusive,
+                .enabled = true,
+                .duration = 0.0
+            });
+
+        return _systems.size() - 1;
+    }
+
+    bool system_scheduler::_conflicts(const system& a, const system& b) const noexcept
+    {
+        if (a.exclusive || b.exclusive)
+        {
+            return true;
+        }
+
+        const auto intersects = [](const vector<sz>& lhs, const vector<sz>& rhs) {
+            sz i = 0;
+            sz j = 0;
+            while (i < lhs.size() && j < rhs.size())
+            {
+                if (lhs[i] == rhs[j])
+                {
+                    return true;
+                }
+
+                if (lhs[i] < rhs[j])
+                {
+                    ++i;
+                }
+                else
+                {
+                    ++j;
+                }
+            }
+            return false;
+        };
+
+        return intersects(a.writes, b.writes) || intersects(a.writes, b.reads) || intersects(a.reads, b.writes);
+    }
+
+    void system_scheduler::_buildGraph()
+    {
+        const sz count = _systems.size();
+
+        _dependentOffsets.clear();
+        _dependents.clear();
+        _pending.clear();
+        _ready.clear();
+        _pending.resize(count, 0);
+        _scheduled = 0;
+        _completed = 0;
+
+        // a system depends on every earlier conflicting system, so conflicting systems keep registration order
+        for (sz i = 0; i < count; ++i)
+        {
+            _dependentOffsets.push_back(_dependents.size());
+            if (!_systems[i].enabled)
+            {
+                continue;
+            }
+
+            ++_scheduled;
+            for (sz j = i + 1; j < count; ++j)
+            {
+                if (_systems[j].enabled && _conflicts(_systems[i], _systems[j]))
+                {
+                    _dependents.push_back(j);
+                    ++_pending[j];
+                }
+            }
+        }
+        _dependentOffsets.push_back(_dependents.size());
+
+        // reversed so that the ready stack pops the earliest registered system first
+        for (sz i = count; i > 0; --i)
+        {
+            if (_systems[i - 1].enabled && _pending[i - 1] == 0)
+            {
+                _ready.push_back(i - 1);
+            }
+        }
+    }
+
+    void system_scheduler::_workerLoop()
+    {
+        std::unique_lock guard(_lock);
+        while (true)
+        {
+            _signal.wait(guard, [this]() { return _stop || (_registry && !_ready.empty()) || !_batches.empty(); });
+            if (_stop)
+            {
+                return;
+            }
+
+            if (!_registry || _ready.empty())
+            {
+                _runTask(guard);
+                continue;
+            }
+
+            const sz idx = _ready.back();
+            _ready.pop_back();
+            guard.unlock();
+            _run(idx);
+            guard.lock();
+            _complete(idx);
+        }
+    }
+
+    void system_scheduler::_run(const sz idx)
+    {
+        using std::chrono::high_resolution_clock;
+
+        auto& sys = _systems[idx];
+        const auto start = high_resolution_clock::now();
+        sys.fn(*_registry);
+        const auto end = high_resolution_clock::now();
+        sys.duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    }
+
+    void system_scheduler::_complete(const sz idx)
+    {
+        // expects the lock to be held
+        ++_completed;
+
+        sz released = 0;
+        for (sz i = _dependentOffsets[idx]; i < _dependentOffsets[idx + 1]; ++i)
+        {
+            const sz dependent = _dependents[i];
+            if (--_pending[dependent] == 0)
+            {
+                _ready.push_back(dependent);
+                ++released;
+            }
+        }
+
+        if (released > 0 || _completed == _scheduled)
+        {
+            _signal.notify_all();
+        }
+    }
+
+    void system_scheduler::_runBatch(task_batch& batch)
+    {
+        if (batch.count == 0)
+        {
+            return;
+        }
+
+        std::unique_lock guard(_lock);
+        _batches.push_back(&batch);
+        _signal.notify_all();
+
+        // the calling thread takes tasks alongside the workers until every index of its batch has completed
+        while (batch.completed < batch.count)
+        {
+            if (!_runTask(guard))
+            {
+                _signal.wait(guard);
+            }
+        }
+    }
+
+    bool system_scheduler::_runTask(std::unique_lock<std::mutex>& guard)
+    {
+        // expects the lock to be held, newest batches first so that nested parallel_for calls finish quickly
+        if (_batches.empty())
+        {
+            return false;
+        }
+
+        task_batch& batch = *_batches.back();
+        const sz index = batch.next++;
+        if (batch.next == batch.count)
+        {
+            _batches.pop_back();
+        }
+
+        guard.unlock();
+        batch.invoke(batch.context, index);
+        guard.lock();
+
+        if (++batch.completed == batch.count)
+        {
+            _signal.notify_all();
+        }
+        return true;
+    }
+}
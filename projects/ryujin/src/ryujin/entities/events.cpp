@@ -2,7 +2,56 @@
 
 #include <ryujin/core/primitives.hpp>
 
-namespace ryujin::detail
+namespace ryujin
 {
-    sz struct_identifier_utility::id = 0;
-}
\ No newline at end of file
+    namespace detail
+    {
+        sz struct_identifier_utility::id = 0;
+    }
+
+    void event_manager::dispatch()
+    {
+        // types queued again by subscribers stay in the list for the next dispatch
+        const sz queued = _queued.size();
+        for (sz i = 0; i < queued; ++i)
+        {
+            const sz id = _queued[i];
+            _queues[id]->dispatch(_delegatesOf(id));
+        }
+        _queued.erase(_queued.begin(), _queued.begin() + queued);
+    }
+
+    bool event_manager::has_queued() const noexcept
+    {
+        return !_queued.empty();
+    }
+
+    void event_manager::unsubscribe(const void* instance)
+    {
+        for (auto& delegates : _delegates)
+        {
+            sz kept = 0;
+            for (sz i = 0; i < delegates.size(); ++i)
+            {
+                if (delegates[i].instance != instance)
+                {
+                    delegates[kept++] = delegates[i];
+                }
+            }
+
+            while (delegates.size() > kept)
+            {
+                delegates.pop_back();
+            }
+        }
+    }
+
+    vector<detail::event_delegate_entry>& event_manager::_delegatesOf(const sz id)
+    {
+        while (id >= _delegates.size())
+        {
+            _delegates.push_back({});
+        }
+        return _delegates[id];
+    }
+}
@@ -0,0 +1,348 @@
+#include <ryujin/entities/hierarchy.hpp>
+
+#include <cassert>
+
+namespace ryujin
+{
+    hierarchy::hierarchy(registry& reg)
+        : _registry(&reg)
+    {
+        _registry->events().subscribe<component_remove_event<relationship_type, entity_type>, &hierarchy::_onRelationshipRemoved>(this);
+    }
+
+    hierarchy::~hierarchy()
+    {
+        _registry->events().unsubscribe(this);
+    }
+
+    void hierarchy::add(const entity_type entity, const entity_type parent)
+    {
+        assert(!contains(entity) && "Entity is already part of the hierarchy.");
+
+        const u32 parentIdx = parent == relationship_type::tombstone ? no_parent : _indexOf(parent);
+        assert((parent == relationship_type::tombstone || parentIdx != no_parent) && "Parent is not part of the hierarchy.");
+
+        const node n = { entity, 0, 1 };
+        const u32 idx = _insert(&n, 1, parentIdx);
+        _linkAround(parentIdx, idx);
+    }
+
+    void hierarchy::destroy_subtree(const entity_type entity)
+    {
+        const u32 idx = _indexOf(entity);
+        if (idx == no_parent)
+        {
+            return;
+        }
+
+        const u32 parentIdx = _nodes[idx].parent;
+        const u32 previous = _previousSibling(idx);
+
+        vector<entity_type> removed;
+        removed.reserve(_nodes[idx].size);
+        for (u32 i = idx; i < idx + _nodes[idx].size; ++i)
+        {
+            removed.push_back(_nodes[i].entity);
+        }
+
+        // erased first, the remove events of the deallocated entities find no nodes left to dissolve
+        _erase(idx);
+
+        for (const entity_type e : removed)
+        {
+            entity_handle<entity_type> handle(e, _registry);
+            _registry->deallocate(handle);
+        }
+
+        // both precede the erased range, their indices are unchanged
+        if (parentIdx != no_parent)
+        {
+            _link(parentIdx);
+        }
+        if (previous != no_parent)
+        {
+            _link(previous);
+        }
+    }
+
+    void hierarchy::reparent(const entity_type entity, const entity_type parent)
+    {
+        const u32 idx = _indexOf(entity);
+        assert(idx != no_parent && "Entity is not part of the hierarchy.");
+
+        const u32 count = _nodes[idx].size;
+        const u32 target = parent == relationship_type::tombstone ? no_parent : _indexOf(parent);
+        assert((parent == relationship_type::tombstone || target != no_parent) && "Parent is not part of the hierarchy.");
+        assert((target == no_parent || target < idx || target >= idx + count) && "Cannot reparent an entity below itself.");
+
+        // lift the block out with parents relative to its root
+        vector<node> block;
+        block.insert(block.end(), _nodes.data() + idx, _nodes.data() + idx + count);
+        for (u32 i = 1; i < count; ++i)
+        {
+            block[i].parent -= idx;
+        }
+
+        const u32 oldParent = _nodes[idx].parent;
+        const u32 oldPrevious = _previousSibling(idx);
+        _erase(idx);
+
+        if (oldParent != no_parent)
+        {
+            _link(oldParent);
+        }
+        if (oldPrevious != no_parent)
+        {
+            _link(oldPrevious);
+        }
+
+        const u32 parentIdx = target == no_parent ? no_parent : _indexOf(parent);
+        const u32 inserted = _insert(block.data(), count, parentIdx);
+        _linkAround(parentIdx, inserted);
+    }
+
+    hierarchy::entity_type hierarchy::clone_subtree(const entity_type entity, const entity_type parent)
+    {
+        const u32 idx = _indexOf(entity);
+        assert(idx != no_parent && "Entity is not part of the hierarchy.");
+
+        const u32 count = _nodes[idx].size;
+        vector<entity_handle<entity_type>> copies(count);
+        _registry->allocate_n(count, copies.data());
+
+        vector<node> block;
+        block.insert(block.end(), _nodes.data() + idx, _nodes.data() + idx + count);
+        for (u32 i = 0; i < count; ++i)
+        {
+            _registry->clone(entity_handle<entity_type>(block[i].entity, _registry), copies[i]);
+            block[i].entity = copies[i].handle();
+            block[i].parent = i == 0 ? 0 : block[i].parent - idx;
+        }
+
+        const u32 parentIdx = parent == relationship_type::tombstone ? no_parent : _indexOf(parent);
+        assert((parent == relationship_type::tombstone || parentIdx != no_parent) && "Parent is not part of the hierarchy.");
+
+        const u32 inserted = _insert(block.data(), count, parentIdx);
+
+        // the cloned links still point into the source subtree
+        for (u32 i = inserted + 1; i < inserted + count; ++i)
+        {
+            _link(i);
+        }
+        _linkAround(parentIdx, inserted);
+
+        return copies[0].handle();
+    }
+
+    span<hierarchy::node> hierarchy::subtree(const entity_type entity) const noexcept
+    {
+        const u32 idx = _indexOf(entity);
+        if (idx == no_parent)
+        {
+            return span<node>();
+        }
+        return span<node>(_nodes.data() + idx, _nodes[idx].size);
+    }
+
+    bool hierarchy::contains(const entity_type entity) const noexcept
+    {
+        return _indexOf(entity) != no_parent;
+    }
+
+    hierarchy::entity_type hierarchy::parent(const entity_type entity) const noexcept
+    {
+        const u32 idx = _indexOf(entity);
+        if (idx == no_parent || _nodes[idx].parent == no_parent)
+        {
+            return relationship_type::tombstone;
+        }
+        return _nodes[_nodes[idx].parent].entity;
+    }
+
+    span<hierarchy::node> hierarchy::nodes() const noexcept
+    {
+        return span<node>(_nodes.data(), _nodes.size());
+    }
+
+    sz hierarchy::size() const noexcept
+    {
+        return _nodes.size();
+    }
+
+    u32 hierarchy::_indexOf(const entity_type entity) const noexcept
+    {
+        if (entity.identifier >= _slots.size())
+        {
+            return no_parent;
+        }
+
+        const u32 idx = _slots[entity.identifier];
+        return idx != no_parent && _nodes[idx].entity == entity ? idx : no_parent;
+    }
+
+    u32 hierarchy::_previousSibling(const u32 idx) const noexcept
+    {
+        const u32 parentIdx = _nodes[idx].parent;
+        if (parentIdx == no_parent)
+        {
+            return no_parent;
+        }
+
+        u32 previous = no_parent;
+        for (u32 child = parentIdx + 1; child != idx; child += _nodes[child].size)
+        {
+            previous = child;
+        }
+        return previous;
+    }
+
+    u32 hierarchy::_insert(const node* block, const sz count, const u32 parent)
+    {
+        const u32 idx = parent == no_parent ? static_cast<u32>(_nodes.size()) : parent + _nodes[parent].size;
+        for (u32 ancestor = parent; ancestor != no_parent; ancestor = _nodes[ancestor].parent)
+        {
+            _nodes[ancestor].size += static_cast<u32>(count);
+        }
+
+        _nodes.insert(_nodes.begin() + idx, block, block + count);
+
+        // block parents are relative to the block root, nodes after the block shift by its size
+        _nodes[idx].parent = parent;
+        for (sz i = idx + 1; i < idx + count; ++i)
+        {
+            _nodes[i].parent += idx;
+        }
+        for (sz i = idx + count; i < _nodes.size(); ++i)
+        {
+            if (_nodes[i].parent != no_parent && _nodes[i].parent >= idx)
+            {
+                _nodes[i].parent += static_cast<u32>(count);
+            }
+        }
+
+        _reindex(idx);
+        return idx;
+    }
+
+    void hierarchy::_erase(const u32 first)
+    {
+        const u32 count = _nodes[first].size;
+        for (u32 ancestor = _nodes[first].parent; ancestor != no_parent; ancestor = _nodes[ancestor].parent)
+        {
+            _nodes[ancestor].size -= count;
+        }
+
+        for (u32 i = first; i < first + count; ++i)
+        {
+            _slots[_nodes[i].entity.identifier] = no_parent;
+        }
+
+        _nodes.erase(_nodes.begin() + first, _nodes.begin() + first + count);
+
+        // descendants of the erased root were erased with it, any remaining parent past the range shifts down
+        for (sz i = first; i < _nodes.size(); ++i)
+        {
+            if (_nodes[i].parent != no_parent && _nodes[i].parent >= first)
+            {
+                _nodes[i].parent -= count;
+            }
+        }
+
+        _reindex(first);
+    }
+
+    void hierarchy::_reindex(const sz first)
+    {
+        for (sz i = first; i < _nodes.size(); ++i)
+        {
+            const auto identifier = _nodes[i].entity.identifier;
+            if (identifier >= _slots.size())
+            {
+                _slots.resize(identifier + 1, no_parent);
+            }
+            _slots[identifier] = static_cast<u32>(i);
+        }
+    }
+
+    void hierarchy::_link(const u32 idx)
+    {
+        const node& n = _nodes[idx];
+        const sz next = idx + n.size;
+
+        const relationship_type relationship = {
+            .parent = n.parent == no_parent ? relationship_type::tombstone : _nodes[n.parent].entity,
+            .firstChild = n.size > 1 ? _nodes[idx + 1].entity : relationship_type::tombstone,
+            .nextSibling = n.parent != no_parent && next < _nodes.size() && _nodes[next].parent == n.parent ? _nodes[next].entity : relationship_type::tombstone
+        };
+
+        entity_handle<entity_type> handle(n.entity, _registry);
+        _registry->assign_or_replace(handle, relationship);
+    }
+
+    void hierarchy::_linkAround(const u32 parent, const u32 idx)
+    {
+        _link(idx);
+        if (parent != no_parent)
+        {
+            _link(parent);
+        }
+
+        const u32 previous = _previousSibling(idx);
+        if (previous != no_parent)
+        {
+            _link(previous);
+        }
+    }
+
+    void hierarchy::_dissolve(const u32 idx)
+    {
+        const u32 parentIdx = _nodes[idx].parent;
+        const u32 previous = _previousSibling(idx);
+        const u32 childCount = _nodes[idx].size - 1;
+
+        for (u32 ancestor = parentIdx; ancestor != no_parent; ancestor = _nodes[ancestor].parent)
+        {
+            --_nodes[ancestor].size;
+        }
+
+        _slots[_nodes[idx].entity.identifier] = no_parent;
+        _nodes.erase(_nodes.begin() + idx);
+
+        // children of the dissolved node are adopted by its parent, every other parent past it shifts down
+        for (sz i = idx; i < _nodes.size(); ++i)
+        {
+            if (_nodes[i].parent == idx)
+            {
+                _nodes[i].parent = parentIdx;
+            }
+            else if (_nodes[i].parent != no_parent && _nodes[i].parent > idx)
+            {
+                --_nodes[i].parent;
+            }
+        }
+
+        _reindex(idx);
+
+        for (u32 child = idx; child < idx + childCount; child += _nodes[child].size)
+        {
+            _link(child);
+        }
+        if (parentIdx != no_parent)
+        {
+            _link(parentIdx);
+        }
+        if (previous != no_parent)
+        {
+            _link(previous);
+        }
+    }
+
+    void hierarchy::_onRelationshipRemoved(const component_remove_event<relationship_type, entity_type>& e)
+    {
+        const u32 idx = _indexOf(e.entity.handle());
+        if (idx != no_parent)
+        {
+            _dissolve(idx);
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#include <ryujin/entities/transform_storage.hpp>
+
+#include <ryujin/math/transform_kernels.hpp>
+
+#include <bit>
+
+namespace ryujin
+{
+    sz transform_storage::push_back(const vec3<float>& position, const quat<float>& rotation, const vec3<float>& scale)
+    {
+        const sz idx = _positions.size();
+        _positions.push_back(position);
+        _rotations.push_back(rotation);
+        _scales.push_back(scale);
+        _matrices.push_back(mat4(1.0f));
+
+        if (idx / 64 >= _dirty.size())
+        {
+            _dirty.push_back(0);
+        }
+        _markDirty(idx);
+
+        return idx;
+    }
+
+    sz transform_storage::swap_remove(const sz idx)
+    {
+        const sz last = _positions.size() - 1;
+        const bool wasDirty = _isDirty(idx);
+        const bool lastDirty = _isDirty(last);
+
+        if (wasDirty)
+        {
+            _dirty[idx / 64] &= ~(u64(1) << (idx % 64));
+            --_dirtyCount;
+        }
+
+        if (idx != last)
+        {
+            _positions[idx] = _positions[last];
+            _rotations[idx] = _rotations[last];
+            _scales[idx] = _scales[last];
+            _matrices[idx] = _matrices[last];
+
+            if (lastDirty)
+            {
+                _dirty[last / 64] &= ~(u64(1) << (last % 64));
+                --_dirtyCount;
+                _markDirty(idx);
+            }
+        }
+
+        _positions.pop_back();
+        _rotations.pop_back();
+        _scales.pop_back();
+        _matrices.pop_back();
+
+        return idx != last ? last : _positions.size();
+    }
+
+    void transform_storage::reserve(const sz count)
+    {
+        _positions.reserve(count);
+        _rotations.reserve(count);
+        _scales.reserve(count);
+        _matrices.reserve(count);
+        _dirty.reserve((count + 63) / 64);
+    }
+
+    void transform_storage::clear()
+    {
+        _positions.clear();
+        _rotations.clear();
+        _scales.clear();
+        _matrices.clear();
+        _dirty.clear();
+        _dirtyCount = 0;
+    }
+
+    sz transform_storage::size() const noexcept
+    {
+        return _positions.size();
+    }
+
+    sz transform_storage::dirty_count() const noexcept
+    {
+        return _dirtyCount;
+    }
+
+    void transform_storage::set_position(const sz idx, const vec3<float>& position) noexcept
+    {
+        _positions[idx] = position;
+        _markDirty(idx);
+    }
+
+    void transform_storage::set_rotation(const sz idx, const quat<float>& rotation) noexcept
+    {
+        _rotations[idx] = rotation;
+        _markDirty(idx);
+    }
+
+    void transform_storage::set_scale(const sz idx, const vec3<float>& scale) noexcept
+    {
+        _scales[idx] = scale;
+        _markDirty(idx);
+    }
+
+    void transform_storage::set_transform(const sz idx, const vec3<float>& position, const quat<float>& rotation, const vec3<float>& scale) noexcept
+    {
+        _positions[idx] = position;
+        _rotations[idx] = rotation;
+        _scales[idx] = scale;
+        _markDirty(idx);
+    }
+
+    const vec3<float>& transform_storage::position(const sz idx) const noexcept
+    {
+        return _positions[idx];
+    }
+
+    const quat<float>& transform_storage::rotation(const sz idx) const noexcept
+    {
+        return _rotations[idx];
+    }
+
+    const vec3<float>& transform_storage::scale(const sz idx) const noexcept
+    {
+        return _scales[idx];
+    }
+
+    const mat4<float>& transform_storage::matrix(const sz idx) const noexcept
+    {
+        return _matrices[idx];
+    }
+
+    span<vec3<float>> transform_storage::positions() const noexcept
+    {
+        return span<vec3<float>>(_positions.data(), _positions.size());
+    }
+
+    span<quat<float>> transform_storage::rotations() const noexcept
+    {
+        return span<quat<float>>(_rotations.data(), _rotations.size());
+    }
+
+    span<vec3<float>> transform_storage::scales() const noexcept
+    {
+        return span<vec3<float>>(_scales.data(), _scales.size());
+    }
+
+    span<mat4<float>> transform_storage::matrices() const noexcept
+    {
+        return span<mat4<float>>(_matrices.data(), _matrices.size());
+    }
+
+    sz transform_storage::compose()
+    {
+        const sz composed = _dirtyCount;
+        if (composed == 0)
+        {
+            return 0;
+        }
+
+        const sz count = _positions.size();
+        sz runStart = count;
+        for (sz word = 0; word < _dirty.size(); ++word)
+        {
+            u64 bits = _dirty[word];
+            sz bit = 0;
+            while (bit < 64)
+            {
+                const sz idx = word * 64 + bit;
+                if (bits & 1)
+                {
+                    const sz ones = bits == ~u64(0) ? 64 : std::countr_one(bits);
+                    if (runStart == count)
+                    {
+                        runStart = idx;
+                    }
+                    bit += ones;
+                    bits = ones == 64 ? 0 : bits >> ones;
+                    continue;
+                }
+
+                if (runStart != count)
+                {
+                    compose_transforms(span<vec3<float>>(_positions.data() + runStart, idx - runStart), span<quat<float>>(_rotations.data() + runStart, idx - runStart),
+                        span<vec3<float>>(_scales.data() + runStart, idx - runStart), _matrices.data() + runStart);
+                    runStart = count;
+                }
+
+                if (bits == 0)
+                {
+                    break;
+                }
+
+                const sz zeros = std::countr_zero(bits);
+                bit += zeros;
+                bits >>= zeros;
+            }
+            _dirty[word] = 0;
+        }
+
+        if (runStart != count)
+        {
+            compose_transforms(span<vec3<float>>(_positions.data() + runStart, count - runStart), span<quat<float>>(_rotations.data() + runStart, count - runStart),
+                span<vec3<float>>(_scales.data() + runStart, count - runStart), _matrices.data() + runStart);
+        }
+
+        _dirtyCount = 0;
+        return composed;
+    }
+
+    void transform_storage::_markDirty(const sz idx) noexcept
+    {
+        u64& word = _dirty[idx / 64];
+        const u64 mask = u64(1) << (idx % 64);
+        if (!(word & mask))
+        {
+            word |= mask;
+            ++_dirtyCount;
+        }
+    }
+
+    bool transform_storage::_isDirty(const sz idx) const noexcept
+    {
+        return _dirty[idx / 64] & (u64(1) << (idx % 64));
+    }
+}
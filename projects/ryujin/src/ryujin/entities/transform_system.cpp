@@ -0,0 +1,378 @@
+#include <ryujin/entities/transform_system.hpp>
+
+#include <ryujin/core/system_scheduler.hpp>
+
+namespace ryujin
+{
+    transform_system::transform_system(registry& reg)
+        : _registry(&reg), _removals(reg, observer_matcher().removed<transform_component, relationship_type>())
+    {
+        _registry->track_changes<transform_component>();
+        _registry->track_changes<relationship_type>();
+    }
+
+    void transform_system::update(system_scheduler* scheduler)
+    {
+        if (_invalid)
+        {
+            _removals.clear();
+            _rebuild();
+        }
+        else
+        {
+            _collectChanges();
+        }
+
+        _lastTick = _registry->tick();
+
+        if (_dirtySegments.empty())
+        {
+            return;
+        }
+
+        sz dirtyNodes = 0;
+        for (const u32 segment : _dirtySegments)
+        {
+            dirtyNodes += _segments[segment + 1] - _segments[segment];
+        }
+
+        if (!scheduler || scheduler->worker_count() == 0 || dirtyNodes < _parallelThreshold)
+        {
+            _propagate(_dirtySegments.data(), _dirtySegments.size());
+        }
+        else
+        {
+            // split the dirty roots into contiguous batches of roughly equal node counts, one per thread
+            const sz batchCount = ryujin::min(scheduler->worker_count() + 1, _dirtySegments.size());
+            const sz perBatch = (dirtyNodes + batchCount - 1) / batchCount;
+
+            _batches.clear();
+            _batches.push_back(0);
+            sz batchNodes = 0;
+            for (sz i = 0; i + 1 < _dirtySegments.size(); ++i)
+            {
+                const u32 segment = _dirtySegments[i];
+                batchNodes += _segments[segment + 1] - _segments[segment];
+                if (batchNodes >= perBatch)
+                {
+                    _batches.push_back(i + 1);
+                    batchNodes = 0;
+                }
+            }
+            _batches.push_back(_dirtySegments.size());
+
+            scheduler->parallel_for(_batches.size() - 1, [this](const sz batch) {
+                _propagate(_dirtySegments.data() + _batches[batch], _batches[batch + 1] - _batches[batch]);
+            });
+        }
+
+        // report changed world matrices as updates, so that observers of the transform pool see them
+        for (const u32 segment : _dirtySegments)
+        {
+            for (sz i = _segments[segment]; i < _segments[segment + 1]; ++i)
+            {
+                if (_dirty[i] & _changed)
+                {
+                    _registry->get_mut<transform_component>(entity_handle(_order[i].entity, _registry));
+                }
+                _dirty[i] = 0;
+            }
+            _segmentDirty[segment] = 0;
+        }
+        _dirtySegments.clear();
+
+        // the updates above must not mark the same entities dirty again on the next update
+        _lastTick = _registry->tick();
+    }
+
+    void transform_system::invalidate() noexcept
+    {
+        _invalid = true;
+    }
+
+    bool transform_system::_isNode(const entity_type entity) const
+    {
+        return entity != relationship_type::tombstone && _registry->contains<transform_component>(entity_handle(entity, _registry));
+    }
+
+    u32 transform_system::_slotOf(const entity_type entity) const noexcept
+    {
+        return entity.identifier < _slots.size() ? _slots[entity.identifier] : _noParent;
+    }
+
+    transform_system::entity_type transform_system::_rootOf(const entity_type entity) const
+    {
+        // entities whose parent is missing or has no transform are treated as roots, the walk is bounded so that a
+        // cyclic hierarchy cannot hang it
+        entity_type current = entity;
+        for (sz depth = 0; depth < _registry->allocated(); ++depth)
+        {
+            const auto relationship = entity_handle(current, _registry).try_get<relationship_type>();
+            if (!relationship || !_isNode(relationship->parent))
+            {
+                return current;
+            }
+            current = relationship->parent;
+        }
+        return entity;
+    }
+
+    void transform_system::_collectChanges()
+    {
+        _moved.clear();
+        _restructured.clear();
+
+        // transforms of entities not in the ordering yet were just added
+        _registry->updated_since<transform_component>(_lastTick).each([&](const entity_handle<entity_type>& handle, transform_component&) {
+            const auto entity = handle.handle();
+            const u32 slot = _slotOf(entity);
+            if (slot != _noParent && _order[slot].entity == entity)
+            {
+                _moved.push_back(entity);
+            }
+            else
+            {
+                _restructured.push_back(entity);
+            }
+        });
+
+        _registry->updated_since<relationship_type>(_lastTick).each([&](const entity_handle<entity_type>& handle, relationship_type&) {
+            _restructured.push_back(handle.handle());
+        });
+
+        _removals.drain([&](const entity_handle<entity_type>& handle) {
+            _restructured.push_back(handle.handle());
+        });
+
+        if (!_restructured.empty())
+        {
+            _restructure();
+        }
+
+        for (const entity_type entity : _moved)
+        {
+            _markDirty(entity);
+        }
+    }
+
+    void transform_system::_markDirty(const entity_type entity)
+    {
+        const u32 slot = _slotOf(entity);
+        if (slot == _noParent)
+        {
+            return;
+        }
+
+        _dirty[slot] |= _recompute;
+        const u32 segment = _order[slot].segment;
+        if (!_segmentDirty[segment])
+        {
+            _segmentDirty[segment] = 1;
+            _dirtySegments.push_back(segment);
+        }
+    }
+
+    void transform_system::_restructure()
+    {
+        _roots.clear();
+        _released.clear();
+
+        const auto release = [this](const u32 slot) {
+            const u32 segment = _order[slot].segment;
+            if (_segmentAlive[segment])
+            {
+                _segmentAlive[segment] = 0;
+                _released.push_back(segment);
+            }
+        };
+
+        // queues the root of a node to be laid out again, releasing the segment the root currently lives in
+        const auto place = [&](const entity_type entity) {
+            if (!_isNode(entity))
+            {
+                return;
+            }
+
+            const entity_type root = _rootOf(entity);
+            _roots.push_back(root);
+            const u32 slot = _slotOf(root);
+            if (slot != _noParent)
+            {
+                release(slot);
+            }
+        };
+
+        for (const entity_type entity : _restructured)
+        {
+            const u32 slot = _slotOf(entity);
+            if (slot != _noParent)
+            {
+                release(slot);
+            }
+
+            // children of an entity that just became a node were roots of their own segments
+            const auto relationship = _isNode(entity) ? entity_handle(entity, _registry).try_get<relationship_type>() : nullptr;
+            for (auto child = relationship ? relationship->firstChild : relationship_type::tombstone; _isNode(child); )
+            {
+                const u32 childSlot = _slotOf(child);
+                if (childSlot != _noParent)
+                {
+                    release(childSlot);
+                }
+
+                const auto childRelationship = entity_handle(child, _registry).try_get<relationship_type>();
+                child = childRelationship ? childRelationship->nextSibling : relationship_type::tombstone;
+            }
+
+            place(entity);
+        }
+
+        // every node of a released segment that is still alive belongs to a tree that has to be laid out again
+        for (sz i = 0; i < _released.size(); ++i)
+        {
+            const u32 segment = _released[i];
+            for (sz idx = _segments[segment]; idx < _segments[segment + 1]; ++idx)
+            {
+                place(_order[idx].entity);
+            }
+            _release(segment);
+        }
+
+        if (_releasedNodes * 2 > _order.size())
+        {
+            _rebuild();
+            return;
+        }
+
+        if (_slots.size() < _registry->allocated())
+        {
+            _slots.resize(_registry->allocated(), _noParent);
+        }
+
+        for (const entity_type root : _roots)
+        {
+            // a root queued more than once is already laid out
+            if (_slotOf(root) == _noParent)
+            {
+                _appendSegment(root);
+            }
+        }
+    }
+
+    void transform_system::_release(const u32 segment)
+    {
+        for (sz idx = _segments[segment]; idx < _segments[segment + 1]; ++idx)
+        {
+            const u32 identifier = _order[idx].entity.identifier;
+            if (identifier < _slots.size() && _slots[identifier] == idx)
+            {
+                _slots[identifier] = _noParent;
+            }
+            _order[idx].entity = relationship_type::tombstone;
+        }
+        _releasedNodes += _segments[segment + 1] - _segments[segment];
+    }
+
+    void transform_system::_rebuild()
+    {
+        _order.clear();
+        _world.clear();
+        _dirty.clear();
+        _segments.clear();
+        _segments.push_back(0);
+        _segmentDirty.clear();
+        _segmentAlive.clear();
+        _dirtySegments.clear();
+        _slots.clear();
+        _slots.resize(_registry->allocated(), _noParent);
+        _releasedNodes = 0;
+
+        _registry->entity_view<transform_component>().each([&](const entity_handle<entity_type>& handle, transform_component&) {
+            const auto relationship = handle.try_get<relationship_type>();
+            if (!relationship || !_isNode(relationship->parent))
+            {
+                _appendSegment(handle.handle());
+            }
+        });
+
+        // pack the transform pool in propagation order so that propagation walks component memory front to back
+        _registry->sort<transform_component>([this](const entity_type lhs, const entity_type rhs) {
+            return _slotOf(lhs) < _slotOf(rhs);
+        });
+
+        _invalid = false;
+    }
+
+    void transform_system::_appendSegment(const entity_type root)
+    {
+        const u32 segment = static_cast<u32>(_segments.size() - 1);
+        const sz first = _order.size();
+        _slots[root.identifier] = static_cast<u32>(_order.size());
+        _order.push_back({ root, _noParent, segment });
+
+        // breadth first walk of the subtree, parents always precede their children
+        for (sz idx = first; idx < _order.size(); ++idx)
+        {
+            const auto parentRelationship = entity_handle(_order[idx].entity, _registry).try_get<relationship_type>();
+            if (!parentRelationship)
+            {
+                continue;
+            }
+
+            for (auto child = parentRelationship->firstChild; _isNode(child); )
+            {
+                if (_slots[child.identifier] != _noParent)
+                {
+                    break; // malformed sibling list, already visited
+                }
+
+                _slots[child.identifier] = static_cast<u32>(_order.size());
+                _order.push_back({ child, static_cast<u32>(idx), segment });
+
+                const auto childRelationship = entity_handle(child, _registry).try_get<relationship_type>();
+                child = childRelationship ? childRelationship->nextSibling : relationship_type::tombstone;
+            }
+        }
+        _segments.push_back(_order.size());
+
+        // the world matrices last written are kept to tell which recomputed matrices actually changed
+        for (sz idx = first; idx < _order.size(); ++idx)
+        {
+            _world.push_back(_registry->get<transform_component>(entity_handle(_order[idx].entity, _registry)).world);
+            _dirty.push_back(_recompute);
+        }
+        _segmentAlive.push_back(1);
+        _segmentDirty.push_back(1);
+        _dirtySegments.push_back(segment);
+    }
+
+    void transform_system::_propagate(const u32* segments, const sz count)
+    {
+        for (sz s = 0; s < count; ++s)
+        {
+            const u32 segment = segments[s];
+            for (sz i = _segments[segment]; i < _segments[segment + 1]; ++i)
+            {
+                const node& n = _order[i];
+                const bool parentChanged = n.parent != _noParent && (_dirty[n.parent] & _changed);
+                if (!(_dirty[i] & _recompute) && !parentChanged)
+                {
+                    continue;
+                }
+
+                auto& tx = _registry->get<transform_component>(entity_handle(n.entity, _registry));
+                const mat4<float> world = n.parent == _noParent ? tx.matrix : _world[n.parent] * tx.matrix;
+                tx.world = world;
+                if (world == _world[i])
+                {
+                    _dirty[i] = 0;
+                }
+                else
+                {
+                    _world[i] = world;
+                    _dirty[i] = _changed;
+                }
+            }
+        }
+    }
+}
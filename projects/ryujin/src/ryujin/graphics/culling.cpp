@@ -0,0 +1,207 @@
+#include <ryujin/graphics/culling.hpp>
+
+#include <ryujin/graphics/occlusion.hpp>
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RYUJIN_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace ryujin
+{
+    namespace
+    {
+        vec4<float> normalize_plane(const vec4<float>& plane) noexcept
+        {
+            const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+            return vec4(plane.x * inv, plane.y * inv, plane.z * inv, plane.w * inv);
+        }
+
+        float project_axis(const vec4<float>& plane, const vec4<float>& axis) noexcept
+        {
+            return std::abs(plane.x * axis.x + plane.y * axis.y + plane.z * axis.z);
+        }
+
+#ifdef RYUJIN_CULLING_SSE
+        // lanes set for instances outside the frustum
+        int cull_four(const frustum& view, const mesh_bounds& bounds, const gpu_instance_data* const src[4]) noexcept
+        {
+            // transpose the matrix columns so that each register holds one element of all four transforms
+            __m128 cx[4], cy[4], cz[4];
+            for (sz k = 0; k < 4; ++k)
+            {
+                __m128 a = _mm_load_ps(src[0]->transform.columns[k].data);
+                __m128 b = _mm_load_ps(src[1]->transform.columns[k].data);
+                __m128 c = _mm_load_ps(src[2]->transform.columns[k].data);
+                __m128 d = _mm_load_ps(src[3]->transform.columns[k].data);
+                _MM_TRANSPOSE4_PS(a, b, c, d);
+                cx[k] = a;
+                cy[k] = b;
+                cz[k] = c;
+            }
+
+            const __m128 bx = _mm_set1_ps(bounds.center.x);
+            const __m128 by = _mm_set1_ps(bounds.center.y);
+            const __m128 bz = _mm_set1_ps(bounds.center.z);
+            const __m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx[0], bx), _mm_mul_ps(cx[1], by)), _mm_add_ps(_mm_mul_ps(cx[2], bz), cx[3]));
+            const __m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cy[0], bx), _mm_mul_ps(cy[1], by)), _mm_add_ps(_mm_mul_ps(cy[2], bz), cy[3]));
+            const __m128 pz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cz[0], bx), _mm_mul_ps(cz[1], by)), _mm_add_ps(_mm_mul_ps(cz[2], bz), cz[3]));
+
+            // sphere radius grows with the largest axis scale
+            __m128 scale = _mm_setzero_ps();
+            for (sz k = 0; k < 3; ++k)
+            {
+                const __m128 axis = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx[k], cx[k]), _mm_mul_ps(cy[k], cy[k])), _mm_mul_ps(cz[k], cz[k]));
+                scale = _mm_max_ps(scale, axis);
+            }
+            const __m128 radius = _mm_mul_ps(_mm_sqrt_ps(scale), _mm_set1_ps(bounds.radius));
+
+            __m128 distances[6];
+            __m128 outside = _mm_setzero_ps();
+            for (sz p = 0; p < 6; ++p)
+            {
+                const vec4<float>& plane = view.planes[p];
+                const __m128 nx = _mm_set1_ps(plane.x);
+                const __m128 ny = _mm_set1_ps(plane.y);
+                const __m128 nz = _mm_set1_ps(plane.z);
+                distances[p] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, px), _mm_mul_ps(ny, py)), _mm_add_ps(_mm_mul_ps(nz, pz), _mm_set1_ps(plane.w)));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distances[p], radius), _mm_setzero_ps()));
+            }
+
+            if (_mm_movemask_ps(outside) == 0xF)
+            {
+                return 0xF;
+            }
+
+            // refine the survivors with the box, its projected radius is the sum of the oriented half extents
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+            const __m128 ex = _mm_set1_ps(bounds.extents.x);
+            const __m128 ey = _mm_set1_ps(bounds.extents.y);
+            const __m128 ez = _mm_set1_ps(bounds.extents.z);
+            for (sz p = 0; p < 6; ++p)
+            {
+                const vec4<float>& plane = view.planes[p];
+                const __m128 nx = _mm_set1_ps(plane.x);
+                const __m128 ny = _mm_set1_ps(plane.y);
+                const __m128 nz = _mm_set1_ps(plane.z);
+
+                __m128 projected[3];
+                for (sz k = 0; k < 3; ++k)
+                {
+                    const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx[k]), _mm_mul_ps(ny, cy[k])), _mm_mul_ps(nz, cz[k]));
+                    projected[k] = _mm_andnot_ps(signMask, d);
+                }
+
+                const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(projected[0], ex), _mm_mul_ps(projected[1], ey)), _mm_mul_ps(projected[2], ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distances[p], r), _mm_setzero_ps()));
+            }
+
+            return _mm_movemask_ps(outside);
+        }
+#endif
+    }
+
+    frustum extract_frustum(const mat4<float>& viewProj) noexcept
+    {
+        // rows of the column major matrix
+        const vec4<float> r0(viewProj.m00, viewProj.m01, viewProj.m02, viewProj.m03);
+        const vec4<float> r1(viewProj.m10, viewProj.m11, viewProj.m12, viewProj.m13);
+        const vec4<float> r2(viewProj.m20, viewProj.m21, viewProj.m22, viewProj.m23);
+        const vec4<float> r3(viewProj.m30, viewProj.m31, viewProj.m32, viewProj.m33);
+
+        // near uses the -w <= z convention of perspective(), which is conservative for a 0 <= z depth range
+        frustum result;
+        result.planes[0] = normalize_plane(r3 + r0);
+        result.planes[1] = normalize_plane(r3 - r0);
+        result.planes[2] = normalize_plane(r3 + r1);
+        result.planes[3] = normalize_plane(r3 - r1);
+        result.planes[4] = normalize_plane(r3 + r2);
+        result.planes[5] = normalize_plane(r3 - r2);
+        return result;
+    }
+
+    bool is_visible(const frustum& view, const mesh_bounds& bounds, const mat4<float>& transform) noexcept
+    {
+        const vec4<float> center = transform * vec4(bounds.center.x, bounds.center.y, bounds.center.z, 1.0f);
+
+        float scale = 0.0f;
+        for (sz k = 0; k < 3; ++k)
+        {
+            const vec4<float>& axis = transform.columns[k];
+            scale = std::fmax(scale, axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+        }
+        const float radius = std::sqrt(scale) * bounds.radius;
+
+        bool sphereInside = true;
+        for (const auto& plane : view.planes)
+        {
+            const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            sphereInside &= distance + radius >= 0.0f;
+        }
+
+        if (!sphereInside)
+        {
+            return false;
+        }
+
+        for (const auto& plane : view.planes)
+        {
+            const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            const float r = project_axis(plane, transform.columns[0]) * bounds.extents.x
+                + project_axis(plane, transform.columns[1]) * bounds.extents.y
+                + project_axis(plane, transform.columns[2]) * bounds.extents.z;
+            if (distance + r < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    sz cull_instances(const frustum& view, const span<gpu_indirect_call> calls, const span<mesh_bounds> bounds, const span<u32> refs,
+        const instance_source& instances, const u32 firstInstance, const sz capacity, u32* out, gpu_indirect_call* outCalls,
+        const occlusion_buffer* occlusion) noexcept
+    {
+        sz written = 0;
+        for (sz c = 0; c < calls.length(); ++c)
+        {
+            gpu_indirect_call call = calls[c];
+            const mesh_bounds& meshBounds = bounds[c];
+            const u32* src = refs.data() + call.firstInstance;
+            const sz count = call.instanceCount;
+            const sz first = written;
+
+            sz i = 0;
+#ifdef RYUJIN_CULLING_SSE
+            for (; i + 4 <= count && written + 4 <= capacity; i += 4)
+            {
+                const gpu_instance_data* const batch[4] = { &instances[src[i]], &instances[src[i + 1]], &instances[src[i + 2]], &instances[src[i + 3]] };
+                const int outside = cull_four(view, meshBounds, batch);
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    if ((outside & (1 << lane)) == 0 && (!occlusion || occlusion->is_visible(meshBounds, batch[lane]->transform)))
+                    {
+                        out[written++] = src[i + lane];
+                    }
+                }
+            }
+#endif
+            for (; i < count && written < capacity; ++i)
+            {
+                const auto& transform = instances[src[i]].transform;
+                if (is_visible(view, meshBounds, transform) && (!occlusion || occlusion->is_visible(meshBounds, transform)))
+                {
+                    out[written++] = src[i];
+                }
+            }
+
+            call.firstInstance = firstInstance + static_cast<u32>(first);
+            call.instanceCount = static_cast<u32>(written - first);
+            outCalls[c] = call;
+        }
+        return written;
+    }
+}
@@ -0,0 +1,228 @@
+#include <ryujin/graphics/draw_buckets.hpp>
+
+#include <ryujin/core/as.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace ryujin
+{
+    draw_bucket_table::draw_bucket_table(const u32 typeCount)
+        : _typeCount(typeCount)
+    {
+        _calls.resize(typeCount);
+        _bounds.resize(typeCount);
+        _groupCounts.resize(typeCount);
+    }
+
+    void draw_bucket_table::add(const u32 entity, const u32 ref, const bucket_key& key, const gpu_indirect_call& mesh, const mesh_bounds& bounds)
+    {
+        if (entity >= _locations.size())
+        {
+            _locations.resize(entity + 1);
+        }
+        assert(_locations[entity].bucket == invalid_bucket && "Entity already has an instance in the table.");
+
+        const sz lutIndex = as<sz>(key.mesh) * _typeCount + key.type;
+        if (lutIndex >= _lut.size())
+        {
+            _lut.resize(lutIndex + 1, invalid_bucket);
+        }
+
+        u32 bucketIndex = _lut[lutIndex];
+        if (bucketIndex == invalid_bucket)
+        {
+            bucketIndex = _createBucket(key, mesh, bounds);
+            _lut[lutIndex] = bucketIndex;
+        }
+
+        if (_calls[key.type][_buckets[bucketIndex].draw].instanceCount == _buckets[bucketIndex].capacity)
+        {
+            _grow(bucketIndex);
+        }
+
+        const bucket& b = _buckets[bucketIndex];
+        auto& call = _calls[key.type][b.draw];
+        const u32 index = call.instanceCount++;
+        _refs[b.first + index] = ref;
+        _owners[b.first + index] = entity;
+        _locations[entity] = { bucketIndex, index };
+    }
+
+    bool draw_bucket_table::remove(const u32 entity)
+    {
+        if (!contains(entity))
+        {
+            return false;
+        }
+
+        const location loc = _locations[entity];
+        const bucket& b = _buckets[loc.bucket];
+        auto& call = _calls[b.key.type][b.draw];
+        const u32 last = --call.instanceCount;
+        if (loc.index != last)
+        {
+            const u32 moved = _owners[b.first + last];
+            _refs[b.first + loc.index] = _refs[b.first + last];
+            _owners[b.first + loc.index] = moved;
+            _locations[moved].index = loc.index;
+        }
+
+        _locations[entity] = {};
+        return true;
+    }
+
+    bool draw_bucket_table::contains(const u32 entity) const noexcept
+    {
+        return entity < _locations.size() && _locations[entity].bucket != invalid_bucket;
+    }
+
+    span<gpu_indirect_call> draw_bucket_table::calls(const u32 type) const noexcept
+    {
+        return span(_calls[type].data(), _calls[type].size());
+    }
+
+    span<mesh_bounds> draw_bucket_table::bounds(const u32 type) const noexcept
+    {
+        return span(_bounds[type].data(), _bounds[type].size());
+    }
+
+    span<u32> draw_bucket_table::group_counts(const u32 type) const noexcept
+    {
+        return span(_groupCounts[type].data(), _groupCounts[type].size());
+    }
+
+    span<u32> draw_bucket_table::refs() const noexcept
+    {
+        return span(_refs.data(), _refs.size());
+    }
+
+    sz draw_bucket_table::bucket_count() const noexcept
+    {
+        return _buckets.size();
+    }
+
+    u32 draw_bucket_table::_createBucket(const bucket_key& key, const gpu_indirect_call& mesh, const mesh_bounds& bounds)
+    {
+        const u32 bucketIndex = as<u32>(_buckets.size());
+        const u32 first = as<u32>(_refs.size());
+        _refs.resize(_refs.size() + _minCapacity);
+        _owners.resize(_owners.size() + _minCapacity);
+
+        auto& calls = _calls[key.type];
+        _buckets.push_back({
+            .key = key,
+            .draw = as<u32>(calls.size()),
+            .first = first,
+            .capacity = _minCapacity
+        });
+
+        gpu_indirect_call call = mesh;
+        call.instanceCount = 0;
+        call.firstInstance = first;
+        calls.push_back(call);
+        _bounds[key.type].push_back(bounds);
+
+        _rebuildDraws(key.type);
+        return bucketIndex;
+    }
+
+    void draw_bucket_table::_rebuildDraws(const u32 type)
+    {
+        // only runs when a bucket is created, so a new mesh costs a pass over the buckets rather than the instances
+        vector<u32> order;
+        for (u32 i = 0; i < _buckets.size(); ++i)
+        {
+            if (_buckets[i].key.type == type)
+            {
+                order.push_back(i);
+            }
+        }
+
+        std::sort(order.begin(), order.end(), [this](const u32 lhs, const u32 rhs) {
+            const auto& l = _buckets[lhs].key;
+            const auto& r = _buckets[rhs].key;
+            return l.group != r.group ? l.group < r.group : l.mesh < r.mesh;
+        });
+
+        vector<gpu_indirect_call> calls;
+        vector<mesh_bounds> bounds;
+        calls.reserve(order.size());
+        bounds.reserve(order.size());
+
+        auto& counts = _groupCounts[type];
+        counts.clear();
+        for (const u32 bucketIndex : order)
+        {
+            bucket& b = _buckets[bucketIndex];
+            calls.push_back(_calls[type][b.draw]);
+            bounds.push_back(_bounds[type][b.draw]);
+            b.draw = as<u32>(calls.size() - 1);
+
+            // every group up to the last one gets a count, so counts can be indexed by mesh group
+            if (b.key.group >= counts.size())
+            {
+                counts.resize(b.key.group + 1, 0);
+            }
+            ++counts[b.key.group];
+        }
+
+        _calls[type] = std::move(calls);
+        _bounds[type] = std::move(bounds);
+    }
+
+    void draw_bucket_table::_grow(const u32 bucketIndex)
+    {
+        bucket& b = _buckets[bucketIndex];
+        auto& call = _calls[b.key.type][b.draw];
+        const u32 capacity = b.capacity * 2;
+
+        // the last range grows in place, any other range moves to the end
+        if (b.first + b.capacity == _refs.size())
+        {
+            _refs.resize(b.first + capacity);
+            _owners.resize(b.first + capacity);
+            b.capacity = capacity;
+            return;
+        }
+
+        const u32 first = as<u32>(_refs.size());
+        _refs.resize(first + capacity);
+        _owners.resize(first + capacity);
+        std::copy(_refs.begin() + b.first, _refs.begin() + b.first + call.instanceCount, _refs.begin() + first);
+        std::copy(_owners.begin() + b.first, _owners.begin() + b.first + call.instanceCount, _owners.begin() + first);
+
+        _unused += b.capacity;
+        b.first = first;
+        b.capacity = capacity;
+        call.firstInstance = first;
+
+        if (_unused > _refs.size() / 2)
+        {
+            _compact();
+        }
+    }
+
+    void draw_bucket_table::_compact()
+    {
+        vector<u32> refs;
+        vector<u32> owners;
+        refs.resize(_refs.size() - _unused);
+        owners.resize(_owners.size() - _unused);
+
+        u32 first = 0;
+        for (auto& b : _buckets)
+        {
+            auto& call = _calls[b.key.type][b.draw];
+            std::copy(_refs.begin() + b.first, _refs.begin() + b.first + call.instanceCount, refs.begin() + first);
+            std::copy(_owners.begin() + b.first, _owners.begin() + b.first + call.instanceCount, owners.begin() + first);
+            b.first = first;
+            call.firstInstance = first;
+            first += b.capacity;
+        }
+
+        _refs = std::move(refs);
+        _owners = std::move(owners);
+        _unused = 0;
+    }
+}
@@ -0,0 +1,158 @@
+#include <ryujin/graphics/instance_encoding.hpp>
+
+#include <ryujin/core/as.hpp>
+#include <ryujin/core/memory.hpp>
+#include <ryujin/math/math_utils.hpp>
+#include <ryujin/math/transformations.hpp>
+
+#include <cmath>
+
+namespace ryujin
+{
+    namespace
+    {
+        i16 compress_to_snorm16(const f32 value)
+        {
+            return as<i16>(std::round(clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+
+        f32 inflate_snorm16(const i16 value)
+        {
+            return clamp(as<f32>(value) / 32767.0f, -1.0f, 1.0f);
+        }
+
+        void encode_affine(const gpu_instance_data& instance, gpu_affine_instance_data& out)
+        {
+            for (sz row = 0; row < 3; ++row)
+            {
+                for (sz col = 0; col < 4; ++col)
+                {
+                    out.rows[row][col] = instance.transform[col][row];
+                }
+            }
+            out.material = instance.material;
+        }
+
+        void encode_quantized(const gpu_instance_data& instance, gpu_quantized_instance_data& out)
+        {
+            const auto& m = instance.transform;
+            vec3<f32> axes[3] = {
+                vec3(m[0][0], m[0][1], m[0][2]),
+                vec3(m[1][0], m[1][1], m[1][2]),
+                vec3(m[2][0], m[2][1], m[2][2])
+            };
+
+            vec3<f32> scale(norm(axes[0]), norm(axes[1]), norm(axes[2]));
+
+            // a mirrored basis cannot be expressed by a rotation, flip it through the x scale instead
+            if (dot(cross(axes[0], axes[1]), axes[2]) < 0.0f)
+            {
+                scale.x = -scale.x;
+            }
+
+            for (sz i = 0; i < 3; ++i)
+            {
+                if (scale[i] != 0.0f)
+                {
+                    axes[i] = axes[i] * (1.0f / scale[i]);
+                }
+                else
+                {
+                    axes[i] = vec3(0.0f);
+                    axes[i][i] = 1.0f;
+                }
+            }
+
+            auto rotation = normalize(as_quat(mat3(axes[0], axes[1], axes[2])));
+            if (rotation.w < 0.0f)
+            {
+                rotation = -rotation;
+            }
+
+            out.position[0] = m[3][0];
+            out.position[1] = m[3][1];
+            out.position[2] = m[3][2];
+            out.rotation[0] = compress_to_snorm16(rotation.x);
+            out.rotation[1] = compress_to_snorm16(rotation.y);
+            out.rotation[2] = compress_to_snorm16(rotation.z);
+            out.rotation[3] = compress_to_snorm16(rotation.w);
+            out.scale[0] = deflate_to_half(scale.x);
+            out.scale[1] = deflate_to_half(scale.y);
+            out.scale[2] = deflate_to_half(scale.z);
+            out.pad0 = 0;
+            out.material = instance.material;
+        }
+    }
+
+    sz instance_stride(const instance_format format) noexcept
+    {
+        switch (format)
+        {
+        case instance_format::AFFINE:
+            return sizeof(gpu_affine_instance_data);
+        case instance_format::QUANTIZED:
+            return sizeof(gpu_quantized_instance_data);
+        default:
+            return sizeof(gpu_instance_data);
+        }
+    }
+
+    void encode_instances(const instance_format format, const gpu_instance_data* instances, const sz count, void* dst) noexcept
+    {
+        switch (format)
+        {
+        case instance_format::AFFINE:
+        {
+            auto out = reinterpret_cast<gpu_affine_instance_data*>(dst);
+            for (sz i = 0; i < count; ++i)
+            {
+                encode_affine(instances[i], out[i]);
+            }
+            break;
+        }
+        case instance_format::QUANTIZED:
+        {
+            auto out = reinterpret_cast<gpu_quantized_instance_data*>(dst);
+            for (sz i = 0; i < count; ++i)
+            {
+                encode_quantized(instances[i], out[i]);
+            }
+            break;
+        }
+        default:
+            ryujin::memcpy(dst, instances, count * sizeof(gpu_instance_data));
+            break;
+        }
+    }
+
+    gpu_instance_data decode_instance(const instance_format format, const void* src) noexcept
+    {
+        gpu_instance_data instance = {};
+        switch (format)
+        {
+        case instance_format::AFFINE:
+        {
+            const auto& in = *reinterpret_cast<const gpu_affine_instance_data*>(src);
+            for (sz col = 0; col < 4; ++col)
+            {
+                instance.transform[col] = vec4(in.rows[0][col], in.rows[1][col], in.rows[2][col], col == 3 ? 1.0f : 0.0f);
+            }
+            instance.material = in.material;
+            break;
+        }
+        case instance_format::QUANTIZED:
+        {
+            const auto& in = *reinterpret_cast<const gpu_quantized_instance_data*>(src);
+            const quat<f32> rotation(inflate_snorm16(in.rotation[3]), inflate_snorm16(in.rotation[0]), inflate_snorm16(in.rotation[1]), inflate_snorm16(in.rotation[2]));
+            const vec3<f32> scale(inflate_to_float(in.scale[0]), inflate_to_float(in.scale[1]), inflate_to_float(in.scale[2]));
+            instance.transform = transform(vec3(in.position[0], in.position[1], in.position[2]), rotation, scale);
+            instance.material = in.material;
+            break;
+        }
+        default:
+            instance = *reinterpret_cast<const gpu_instance_data*>(src);
+            break;
+        }
+        return instance;
+    }
+}
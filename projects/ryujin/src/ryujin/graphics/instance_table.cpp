@@ -0,0 +1,110 @@
+#include <ryujin/graphics/instance_table.hpp>
+
+#include <ryujin/core/as.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+namespace ryujin
+{
+    instance_table::instance_table(const u32 frames)
+        : _frames(frames)
+    {
+        assert(frames > 0 && frames <= max_frames && "Unsupported number of frames in flight.");
+        _dirty.resize(frames);
+    }
+
+    u32 instance_table::allocate(const gpu_instance_data& data)
+    {
+        u32 slot;
+        if (_free.empty())
+        {
+            slot = as<u32>(_instances.size());
+            _instances.push_back(data);
+            _pending.push_back(0);
+        }
+        else
+        {
+            slot = _free.back();
+            _free.pop_back();
+            _instances[slot] = data;
+        }
+
+        _markDirty(slot);
+        return slot;
+    }
+
+    void instance_table::release(const u32 slot)
+    {
+        _free.push_back(slot);
+    }
+
+    void instance_table::update(const u32 slot, const gpu_instance_data& data)
+    {
+        _instances[slot] = data;
+        _markDirty(slot);
+    }
+
+    span<instance_table::range> instance_table::flush(const u32 frame)
+    {
+        auto& dirty = _dirty[frame];
+        std::sort(dirty.begin(), dirty.end());
+
+        _ranges.clear();
+        const u8 bit = as<u8>(1u << frame);
+        for (const u32 slot : dirty)
+        {
+            _pending[slot] &= as<u8>(~bit);
+            if (!_ranges.empty() && _ranges.back().first + _ranges.back().count == slot)
+            {
+                ++_ranges.back().count;
+            }
+            else
+            {
+                _ranges.push_back({ slot, 1 });
+            }
+        }
+        dirty.clear();
+
+        return span(_ranges.data(), _ranges.size());
+    }
+
+    sz instance_table::size() const noexcept
+    {
+        return _instances.size();
+    }
+
+    sz instance_table::live() const noexcept
+    {
+        return _instances.size() - _free.size();
+    }
+
+    u32 instance_table::frames() const noexcept
+    {
+        return _frames;
+    }
+
+    const gpu_instance_data* instance_table::data() const noexcept
+    {
+        return _instances.data();
+    }
+
+    const gpu_instance_data& instance_table::operator[](const u32 slot) const noexcept
+    {
+        return _instances[slot];
+    }
+
+    void instance_table::_markDirty(const u32 slot)
+    {
+        // each frame lists a slot once no matter how often it changes before that frame is flushed
+        for (u32 frame = 0; frame < _frames; ++frame)
+        {
+            const u8 bit = as<u8>(1u << frame);
+            if ((_pending[slot] & bit) == 0)
+            {
+                _pending[slot] |= bit;
+                _dirty[frame].push_back(slot);
+            }
+        }
+    }
+}
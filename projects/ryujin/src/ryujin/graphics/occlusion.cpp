@@ -0,0 +1,395 @@
+#include <ryujin/graphics/occlusion.hpp>
+
+#include <ryujin/core/as.hpp>
+#include <ryujin/core/system_scheduler.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RYUJIN_OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace ryujin
+{
+    namespace
+    {
+        constexpr f32 far_depth = std::numeric_limits<f32>::max();
+        constexpr sz tile_size = occlusion_buffer::tile_width * occlusion_buffer::tile_height;
+        constexpr sz triangles_per_setup_job = 512;
+
+        // vertices closer to the camera plane than this are treated as behind it
+        constexpr f32 min_clip_w = 1e-5f;
+    }
+
+    occlusion_buffer::occlusion_buffer(const u32 width, const u32 height, system_scheduler* scheduler)
+        : _width((width + tile_width - 1) / tile_width * tile_width), _height((height + tile_height - 1) / tile_height * tile_height),
+        _tilesX(_width / tile_width), _tilesY(_height / tile_height), _viewProj(mat4<float>(1.0f)), _scheduler(scheduler)
+    {
+        _depth.resize(as<sz>(_width) * _height, far_depth);
+        _tileMax.resize(as<sz>(_tilesX) * _tilesY, far_depth);
+    }
+
+    void occlusion_buffer::begin(const mat4<float>& viewProj)
+    {
+        _viewProj = viewProj;
+        _occluders.clear();
+        std::fill(_depth.begin(), _depth.end(), far_depth);
+        std::fill(_tileMax.begin(), _tileMax.end(), far_depth);
+    }
+
+    void occlusion_buffer::add_occluder(const span<vec3<float>> positions, const span<u32> indices, const mat4<float>& transform)
+    {
+        const sz firstTriangle = _occluders.empty() ? 0 : _occluders.back().firstTriangle + _occluders.back().triangleCount;
+        _occluders.push_back({
+            .positions = positions.data(),
+            .indices = indices.data(),
+            .triangleCount = indices.length() / 3,
+            .firstTriangle = firstTriangle,
+            .transform = _viewProj * transform
+        });
+    }
+
+    void occlusion_buffer::rasterize()
+    {
+        _setupJobs.clear();
+        for (sz i = 0; i < _occluders.size(); ++i)
+        {
+            const auto& occ = _occluders[i];
+            for (sz first = 0; first < occ.triangleCount; first += triangles_per_setup_job)
+            {
+                _setupJobs.push_back({
+                    .occluderIndex = i,
+                    .firstTriangle = first,
+                    .triangleCount = std::min(triangles_per_setup_job, occ.triangleCount - first)
+                });
+            }
+        }
+
+        if (_setupJobs.empty())
+        {
+            return;
+        }
+
+        _triangles.resize(_occluders.back().firstTriangle + _occluders.back().triangleCount);
+
+        // setup writes one slot per triangle and every tile row is owned by one job, no job shares its output
+        _dispatch(job_kind::SETUP, _setupJobs.size());
+        _binRows();
+        _dispatch(job_kind::RASTERIZE, _tilesY);
+    }
+
+    bool occlusion_buffer::is_visible(const mesh_bounds& bounds, const mat4<float>& transform) const noexcept
+    {
+        const mat4<float> mvp = _viewProj * transform;
+
+        f32 minX = far_depth, minY = far_depth, minDepth = far_depth;
+        f32 maxX = -far_depth, maxY = -far_depth;
+        for (u32 corner = 0; corner < 8; ++corner)
+        {
+            const f32 x = bounds.center.x + ((corner & 1) ? bounds.extents.x : -bounds.extents.x);
+            const f32 y = bounds.center.y + ((corner & 2) ? bounds.extents.y : -bounds.extents.y);
+            const f32 z = bounds.center.z + ((corner & 4) ? bounds.extents.z : -bounds.extents.z);
+            const vec4<float> clip = mvp * vec4(x, y, z, 1.0f);
+
+            // boxes reaching behind the camera cannot be placed on screen
+            if (clip.w < min_clip_w)
+            {
+                return true;
+            }
+
+            const f32 invW = 1.0f / clip.w;
+            const f32 sx = (clip.x * invW * 0.5f + 0.5f) * as<f32>(_width);
+            const f32 sy = (clip.y * invW * 0.5f + 0.5f) * as<f32>(_height);
+            minX = std::min(minX, sx);
+            maxX = std::max(maxX, sx);
+            minY = std::min(minY, sy);
+            maxY = std::max(maxY, sy);
+            minDepth = std::min(minDepth, clip.z * invW);
+        }
+
+        // every pixel the box touches, clamped to the buffer, boxes off screen are left to the frustum test
+        const i32 x0 = std::max(as<i32>(std::floor(minX)), 0);
+        const i32 y0 = std::max(as<i32>(std::floor(minY)), 0);
+        const i32 x1 = std::min(as<i32>(std::floor(maxX)), as<i32>(_width) - 1);
+        const i32 y1 = std::min(as<i32>(std::floor(maxY)), as<i32>(_height) - 1);
+        if (x0 > x1 || y0 > y1)
+        {
+            return true;
+        }
+
+        for (i32 ty = y0 / as<i32>(tile_height); ty <= y1 / as<i32>(tile_height); ++ty)
+        {
+            for (i32 tx = x0 / as<i32>(tile_width); tx <= x1 / as<i32>(tile_width); ++tx)
+            {
+                const sz tile = as<sz>(ty) * _tilesX + as<sz>(tx);
+                if (_tileMax[tile] < minDepth)
+                {
+                    continue;
+                }
+
+                const f32* depth = _depth.data() + tile * tile_size;
+                const i32 py0 = std::max(y0, ty * as<i32>(tile_height));
+                const i32 py1 = std::min(y1, ty * as<i32>(tile_height) + as<i32>(tile_height) - 1);
+                const i32 px0 = std::max(x0, tx * as<i32>(tile_width));
+                const i32 px1 = std::min(x1, tx * as<i32>(tile_width) + as<i32>(tile_width) - 1);
+                for (i32 py = py0; py <= py1; ++py)
+                {
+                    const f32* row = depth + as<sz>(py - ty * as<i32>(tile_height)) * tile_width;
+                    for (i32 px = px0; px <= px1; ++px)
+                    {
+                        if (row[px - tx * as<i32>(tile_width)] >= minDepth)
+                        {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    f32 occlusion_buffer::depth(const u32 x, const u32 y) const noexcept
+    {
+        const sz tile = as<sz>(y / tile_height) * _tilesX + x / tile_width;
+        return _depth[tile * tile_size + (y % tile_height) * tile_width + x % tile_width];
+    }
+
+    u32 occlusion_buffer::width() const noexcept
+    {
+        return _width;
+    }
+
+    u32 occlusion_buffer::height() const noexcept
+    {
+        return _height;
+    }
+
+    sz occlusion_buffer::worker_count() const noexcept
+    {
+        return _scheduler ? _scheduler->worker_count() : 0;
+    }
+
+    void occlusion_buffer::_dispatch(const job_kind kind, const sz jobCount)
+    {
+        if (!_scheduler || _scheduler->worker_count() == 0 || jobCount == 1)
+        {
+            for (sz job = 0; job < jobCount; ++job)
+            {
+                _run(kind, job);
+            }
+            return;
+        }
+
+        _scheduler->parallel_for(jobCount, [this, kind](const sz job) {
+            _run(kind, job);
+        });
+    }
+
+    void occlusion_buffer::_run(const job_kind kind, const sz job)
+    {
+        if (kind == job_kind::SETUP)
+        {
+            _setup(_setupJobs[job]);
+        }
+        else
+        {
+            _rasterizeRow(as<u32>(job));
+        }
+    }
+
+    void occlusion_buffer::_setup(const setup_job& job)
+    {
+        const auto& occ = _occluders[job.occluderIndex];
+        for (sz i = job.firstTriangle; i < job.firstTriangle + job.triangleCount; ++i)
+        {
+            screen_triangle& tri = _triangles[occ.firstTriangle + i];
+            tri.minX = 0;
+            tri.maxX = -1;
+
+            f32 x[3], y[3], z[3];
+            bool behind = false;
+            for (sz v = 0; v < 3; ++v)
+            {
+                const vec3<float>& p = occ.positions[occ.indices[i * 3 + v]];
+                const vec4<float> clip = occ.transform * vec4(p.x, p.y, p.z, 1.0f);
+                behind |= clip.w < min_clip_w;
+
+                const f32 invW = 1.0f / clip.w;
+                x[v] = (clip.x * invW * 0.5f + 0.5f) * as<f32>(_width);
+                y[v] = (clip.y * invW * 0.5f + 0.5f) * as<f32>(_height);
+                z[v] = clip.z * invW;
+            }
+
+            f32 area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (behind || !(std::abs(area) > 1e-8f))
+            {
+                continue;
+            }
+
+            // occluders are double sided, wind every triangle the same way so that inside is non negative
+            if (area < 0.0f)
+            {
+                std::swap(x[1], x[2]);
+                std::swap(y[1], y[2]);
+                std::swap(z[1], z[2]);
+                area = -area;
+            }
+
+            for (sz e = 0; e < 3; ++e)
+            {
+                const sz a = e;
+                const sz b = (e + 1) % 3;
+                const f32 ea = y[a] - y[b];
+                const f32 eb = x[b] - x[a];
+                tri.edges[e][0] = ea;
+                tri.edges[e][1] = eb;
+                tri.edges[e][2] = -(ea * x[a] + eb * y[a]);
+            }
+
+            const f32 dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+            const f32 dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+            tri.depth[0] = dzdx;
+            tri.depth[1] = dzdy;
+            tri.depth[2] = z[0] - dzdx * x[0] - dzdy * y[0];
+
+            const f32 minX = std::min({ x[0], x[1], x[2] });
+            const f32 maxX = std::max({ x[0], x[1], x[2] });
+            const f32 minY = std::min({ y[0], y[1], y[2] });
+            const f32 maxY = std::max({ y[0], y[1], y[2] });
+
+            // clamp before converting, vertices far outside the view do not fit an integer
+            tri.minX = as<i32>(std::floor(std::clamp(minX, 0.0f, as<f32>(_width))));
+            tri.maxX = as<i32>(std::floor(std::clamp(maxX, -1.0f, as<f32>(_width) - 1.0f)));
+            tri.minY = as<i32>(std::floor(std::clamp(minY, 0.0f, as<f32>(_height))));
+            tri.maxY = as<i32>(std::floor(std::clamp(maxY, -1.0f, as<f32>(_height) - 1.0f)));
+            if (tri.minY > tri.maxY)
+            {
+                tri.maxX = tri.minX - 1;
+            }
+        }
+    }
+
+    void occlusion_buffer::_binRows()
+    {
+        // counting sort of the triangles by every tile row they overlap, a row job then only visits its own bin
+        _rowBinOffsets.resize(as<sz>(_tilesY) + 1);
+        std::fill(_rowBinOffsets.begin(), _rowBinOffsets.end(), sz(0));
+        for (const auto& tri : _triangles)
+        {
+            if (tri.minX > tri.maxX)
+            {
+                continue;
+            }
+
+            for (i32 ty = tri.minY / as<i32>(tile_height); ty <= tri.maxY / as<i32>(tile_height); ++ty)
+            {
+                ++_rowBinOffsets[as<sz>(ty)];
+            }
+        }
+
+        // offsets hold the end of each bin, filling back to front leaves them at the start in submission order
+        for (sz ty = 1; ty < _rowBinOffsets.size(); ++ty)
+        {
+            _rowBinOffsets[ty] += _rowBinOffsets[ty - 1];
+        }
+
+        _rowBins.resize(_rowBinOffsets.back());
+        for (sz i = _triangles.size(); i > 0; --i)
+        {
+            const auto& tri = _triangles[i - 1];
+            if (tri.minX > tri.maxX)
+            {
+                continue;
+            }
+
+            for (i32 ty = tri.minY / as<i32>(tile_height); ty <= tri.maxY / as<i32>(tile_height); ++ty)
+            {
+                _rowBins[--_rowBinOffsets[as<sz>(ty)]] = i - 1;
+            }
+        }
+    }
+
+    void occlusion_buffer::_rasterizeRow(const u32 tileY)
+    {
+        const i32 rowY0 = as<i32>(tileY * tile_height);
+        const i32 rowY1 = rowY0 + as<i32>(tile_height) - 1;
+        f32* rowTiles = _depth.data() + as<sz>(tileY) * _tilesX * tile_size;
+
+        for (sz bin = _rowBinOffsets[tileY]; bin < _rowBinOffsets[as<sz>(tileY) + 1]; ++bin)
+        {
+            const auto& tri = _triangles[_rowBins[bin]];
+            const i32 y0 = std::max(rowY0, tri.minY);
+            const i32 y1 = std::min(rowY1, tri.maxY);
+            for (i32 tx = tri.minX / as<i32>(tile_width); tx <= tri.maxX / as<i32>(tile_width); ++tx)
+            {
+                f32* tile = rowTiles + as<sz>(tx) * tile_size;
+                const i32 tileX = tx * as<i32>(tile_width);
+                for (i32 y = y0; y <= y1; ++y)
+                {
+                    f32* row = tile + as<sz>(y - rowY0) * tile_width;
+                    for (i32 span = 0; span < as<i32>(tile_width); span += 4)
+                    {
+                        if (tileX + span + 3 >= tri.minX && tileX + span <= tri.maxX)
+                        {
+                            _shadeSpan(row + span, as<f32>(tileX + span), as<f32>(y), tri);
+                        }
+                    }
+                }
+            }
+        }
+
+        for (u32 tx = 0; tx < _tilesX; ++tx)
+        {
+            const f32* tile = rowTiles + as<sz>(tx) * tile_size;
+            _tileMax[as<sz>(tileY) * _tilesX + tx] = *std::max_element(tile, tile + tile_size);
+        }
+    }
+
+    void occlusion_buffer::_shadeSpan(f32* depth, const f32 x, const f32 y, const screen_triangle& tri) const noexcept
+    {
+        // four horizontally adjacent pixels sampled at their centers
+#ifdef RYUJIN_OCCLUSION_SSE
+        const __m128 px = _mm_add_ps(_mm_set1_ps(x), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+        const __m128 py = _mm_set1_ps(y + 0.5f);
+
+        __m128 inside = _mm_setzero_ps();
+        for (sz e = 0; e < 3; ++e)
+        {
+            const __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edges[e][0]), px), _mm_mul_ps(_mm_set1_ps(tri.edges[e][1]), py)),
+                _mm_set1_ps(tri.edges[e][2]));
+            const __m128 covered = _mm_cmpge_ps(value, _mm_setzero_ps());
+            inside = e == 0 ? covered : _mm_and_ps(inside, covered);
+        }
+
+        if (_mm_movemask_ps(inside) == 0)
+        {
+            return;
+        }
+
+        const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.depth[0]), px), _mm_mul_ps(_mm_set1_ps(tri.depth[1]), py)), _mm_set1_ps(tri.depth[2]));
+        const __m128 current = _mm_loadu_ps(depth);
+        const __m128 nearest = _mm_min_ps(current, z);
+        _mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+#else
+        const f32 py = y + 0.5f;
+        for (sz i = 0; i < 4; ++i)
+        {
+            const f32 px = x + as<f32>(i) + 0.5f;
+            bool inside = true;
+            for (sz e = 0; e < 3; ++e)
+            {
+                inside &= tri.edges[e][0] * px + tri.edges[e][1] * py + tri.edges[e][2] >= 0.0f;
+            }
+
+            if (inside)
+            {
+                depth[i] = std::min(depth[i], tri.depth[0] * px + tri.depth[1] * py + tri.depth[2]);
+            }
+        }
+#endif
+    }
+}
@@ -6,10 +6,10 @@
 
 namespace ryujin
 {
-    naive_translucent_pbr_pass::naive_translucent_pbr_pass(render_manager& manager, pipeline_layout layout, render_pass pass, u32 width, u32 height)
+    naive_translucent_pbr_pass::naive_translucent_pbr_pass(render_manager& manager, pipeline_layout layout, render_pass pass, u32 width, u32 height, instance_format format)
         : _manager(manager), _layout(layout)
     {
-        init_graphics_pipeline(width, height, pass);
+        init_graphics_pipeline(width, height, pass, format);
     }
 
     void naive_translucent_pbr_pass::render(graphics_command_list& cmd, buffer& indirect, buffer& count, sz indirectOffset, sz countOffset, sz numBufferGroups)
@@ -17,9 +17,9 @@ namespace ryujin
         cmd.bind_graphics_pipeline(_shader);
 
         const auto countPtr = reinterpret_cast<u32*>(count.info.pMappedData) + countOffset;
-        const auto indirectBaseAddr = countOffset * sizeof(gpu_indirect_call);
+        const auto indirectBaseAddr = indirectOffset * sizeof(gpu_indirect_call);
         auto indirectAddrOffset = 0;
-        const auto countBaseAddr = indirectOffset * sizeof(u32);
+        const auto countBaseAddr = countOffset * sizeof(u32);
         auto countAddrOffset = 0;
 
         for (sz bufferGroupId = 0; bufferGroupId < numBufferGroups; ++bufferGroupId)
@@ -31,9 +31,9 @@ namespace ryujin
             cmd.bind_index_buffer(meshGroup.indices);
 
             // draw
-            const auto indirectOffset = indirectBaseAddr + indirectAddrOffset * sizeof(gpu_indirect_call);
-            const auto countOffset = countBaseAddr + countAddrOffset * sizeof(uint32_t);
-            cmd.draw_indexed_indirect(indirect, indirectOffset, count, countOffset, 512, sizeof(gpu_indirect_call));
+            const auto indirectAddr = indirectBaseAddr + indirectAddrOffset * sizeof(gpu_indirect_call);
+            const auto countAddr = countBaseAddr + countAddrOffset * sizeof(uint32_t);
+            cmd.draw_indexed_indirect(indirect, indirectAddr, count, countAddr, 512, sizeof(gpu_indirect_call));
 
             auto drawCallCount = countPtr[countAddrOffset];
             ++countAddrOffset;
@@ -41,7 +41,7 @@ namespace ryujin
         }
     }
 
-    void naive_translucent_pbr_pass::init_graphics_pipeline(u32 width, u32 height, render_pass pass)
+    void naive_translucent_pbr_pass::init_graphics_pipeline(u32 width, u32 height, render_pass pass, instance_format format)
     {
         auto vertexSource = files::load_binary("data/shaders/pbr/shader.vert.spv");
         auto fragmentSource = files::load_binary("data/shaders/pbr/shader.opaque.frag.spv");
@@ -62,9 +62,14 @@ namespace ryujin
         auto vertexModule = _manager.create(vertexModuleInfo);
         auto fragmentModule = _manager.create(fragmentModuleInfo);
 
+        const shader_specialization vertexSpecializations[] = {
+            { .constantId = instance_format_constant_id, .value = as<u32>(format) }
+        };
+
         const shader_stage_info vertexStage = {
             .stage = shader_stage::VERTEX,
-            .mod = *vertexModule
+            .mod = *vertexModule,
+            .specializations = span(vertexSpecializations)
         };
 
         const shader_stage_info fragmentStage = {
@@ -2,20 +2,36 @@
 
 #include <ryujin/core/primitives.hpp>
 #include <ryujin/graphics/camera_component.hpp>
+#include <ryujin/graphics/instance_encoding.hpp>
 #include <ryujin/graphics/render_manager.hpp>
 #include <ryujin/math/transformations.hpp>
 
 namespace ryujin
 {
+    pbr_render_pipeline::pbr_render_pipeline(const instance_format format)
+        : _instanceFormat(format), _instanceStride(instance_stride(format))
+    {
+    }
+
     void pbr_render_pipeline::pre_render()
     {
         auto& renderables = get_render_manager()->renderables();
         auto frameInFlight = get_render_manager()->get_frame_in_flight();
 
-        _numBufferGroupsToDraw = renderables.write_draw_calls(_indirectCommands, _indirectCount, frameInFlight * _maxDrawCalls, material_type::OPAQUE);
-        _numTranslucentBufferGroupsToDraw = renderables.write_draw_calls(_translucentIndirectCommands, _translucentIndirectCount, frameInFlight * _maxDrawCalls, material_type::TRANSLUCENT);
+        // every camera owns a slice of the frame's indirect buffers, draw counts do not change with culling and are shared
+        const sz frameIndirectOffset = frameInFlight * _maxCameras * _maxDrawCalls;
+        const sz frameCountOffset = frameInFlight * _maxDrawCalls;
+
+        _numBufferGroupsToDraw = renderables.write_draw_calls(_indirectCommands, _indirectCount, frameIndirectOffset, frameCountOffset, material_type::OPAQUE);
+        _numTranslucentBufferGroupsToDraw = renderables.write_draw_calls(_translucentIndirectCommands, _translucentIndirectCount, frameIndirectOffset, frameCountOffset, material_type::TRANSLUCENT);
         renderables.write_materials(_materials, frameInFlight * _maxMaterials);
-        _instanceCounts = renderables.write_instances(_instanceData, frameInFlight * _maxInstances);
+
+        // instances keep their slots across frames, only slots that changed since this frame was last written are copied,
+        // static slots are staged here while the game thread is blocked and copied by the frame's command list in render
+        renderables.update_instances();
+        _staticCopies.clear();
+        renderables.write_static_instances(_staticStaging, frameInFlight * _maxInstances, frameInFlight, _instanceFormat, _staticCopies);
+        renderables.write_dynamic_instances(_dynamicInstances, frameInFlight * _maxInstances, frameInFlight, _instanceFormat);
         _textureCount = as<u32>(renderables.write_textures(_textures.data(), frameInFlight * _maxTextures));
 
         _activeCams.clear();
@@ -24,6 +40,10 @@ namespace ryujin
         assert(_activeCams.size() <= _maxCameras && "Too many active cameras defined.");
         assert(_activeCams.size() > 0 && "No active cameras defined.");
 
+        // visible instance references of all cameras are packed back to back into the frame's range
+        const sz frameInstanceOffset = frameInFlight * _maxInstances;
+        sz instancesWritten = 0;
+
         auto camPtr = reinterpret_cast<scene_camera*>(_cameraData.info.pMappedData) + frameInFlight * _maxCameras;
         for (sz i = 0; i < _activeCams.size(); ++i)
         {
@@ -33,14 +53,34 @@ namespace ryujin
 
             auto projection = perspective(16.0f / 9.0f, cameraData.fov, cameraData.near, cameraData.far);
             auto view = look_direction(cameraTransform.position, extract_forward(cameraTransform.rotation), extract_up(cameraTransform.rotation));
+            const auto viewProj = projection * view;
 
             camPtr[i] = {
                 .view = view,
                 .proj = projection,
-                .viewProj = projection * view,
+                .viewProj = viewProj,
                 .position = cameraTransform.position,
                 .orientation = euler(cameraTransform.rotation)
             };
+
+            const frustum cameraFrustum = extract_frustum(viewProj);
+
+            // occluders are rasterized from the camera's point of view before its draws are built
+            _occlusion->begin(viewProj);
+            const occlusion_buffer* occlusion = nullptr;
+            if (renderables.write_occluders(*_occlusion) > 0)
+            {
+                _occlusion->rasterize();
+                occlusion = _occlusion.get();
+            }
+
+            const sz cameraIndirectOffset = frameIndirectOffset + i * _maxDrawCalls;
+            for (const auto type : { material_type::OPAQUE, material_type::TRANSLUCENT })
+            {
+                buffer& indirect = type == material_type::OPAQUE ? _indirectCommands : _translucentIndirectCommands;
+                instancesWritten += renderables.write_visible_instances(cameraFrustum, type, _visibleInstances, frameInstanceOffset + instancesWritten, as<u32>(instancesWritten),
+                    _maxInstances - instancesWritten, indirect, cameraIndirectOffset, occlusion);
+            }
         }
 
         renderables.write_scene_data(_sceneData, frameInFlight);
@@ -51,6 +91,19 @@ namespace ryujin
         auto graphicsList = get_render_manager()->next_graphics_command_list();
         graphicsList.begin();
 
+        // each frame owns its range of the static buffer, so the copy never overwrites instances an earlier frame still reads
+        if (!_staticCopies.empty())
+        {
+            graphicsList.copy(_staticStaging, _staticInstances, span(_staticCopies.data(), _staticCopies.size()));
+
+            const memory_barrier copied = {
+                .src = access_type::TRANSFER_WRITE,
+                .dst = access_type::SHADER_READ
+            };
+
+            graphicsList.barrier(pipeline_stage::TRANSFER, pipeline_stage::VERTEX_SHADER, span(copied), {}, {});
+        }
+
         u32 activeCameraIdx = 0;
         for (const auto& cam : _activeCams)
         {
@@ -117,18 +170,46 @@ namespace ryujin
                 .info = span(sceneBufferInfo)
             };
 
-            const descriptor_buffer_info instanceBufferInfo = {
-                .buf = _instanceData,
-                .offset = frameInFlight * _maxInstances * sizeof(gpu_instance_data),
-                .length = _maxInstances * sizeof(gpu_instance_data)
+            const descriptor_buffer_info staticInstanceBufferInfo = {
+                .buf = _staticInstances,
+                .offset = frameInFlight * _maxInstances * _instanceStride,
+                .length = _maxInstances * _instanceStride
             };
 
-            const descriptor_write_info instances = {
+            const descriptor_write_info staticInstances = {
                 .set = *drawableDescriptor,
                 .type = descriptor_type::DYNAMIC_STORAGE_BUFFER,
                 .binding = 0,
                 .element = 0,
-                .info = span(instanceBufferInfo)
+                .info = span(staticInstanceBufferInfo)
+            };
+
+            const descriptor_buffer_info dynamicInstanceBufferInfo = {
+                .buf = _dynamicInstances,
+                .offset = frameInFlight * _maxInstances * _instanceStride,
+                .length = _maxInstances * _instanceStride
+            };
+
+            const descriptor_write_info dynamicInstances = {
+                .set = *drawableDescriptor,
+                .type = descriptor_type::DYNAMIC_STORAGE_BUFFER,
+                .binding = 3,
+                .element = 0,
+                .info = span(dynamicInstanceBufferInfo)
+            };
+
+            const descriptor_buffer_info visibleInstanceBufferInfo = {
+                .buf = _visibleInstances,
+                .offset = frameInFlight * _maxInstances * sizeof(u32),
+                .length = _maxInstances * sizeof(u32)
+            };
+
+            const descriptor_write_info visibleInstances = {
+                .set = *drawableDescriptor,
+                .type = descriptor_type::DYNAMIC_STORAGE_BUFFER,
+                .binding = 4,
+                .element = 0,
+                .info = span(visibleInstanceBufferInfo)
             };
 
             const descriptor_buffer_info materialBufferInfo = {
@@ -192,11 +273,11 @@ namespace ryujin
                 .info = span(_textureWriteScratchBuffer.data(), _textureWriteScratchBuffer.size())
             };
 
-            const descriptor_write_info writes[] = { camera, scene, instances, materials, textures };
+            const descriptor_write_info writes[] = { camera, scene, staticInstances, materials, textures, dynamicInstances, visibleInstances };
             get_render_manager()->write(writes);
 
             const descriptor_set descriptors[] = { *sceneDescriptor, *drawableDescriptor };
-            const u32 dynamicOffsets[] = { 0, 0 };
+            const u32 dynamicOffsets[] = { 0, 0, 0, 0 };
 
             const viewport vp = {
                 .x = 0.0f,
@@ -224,15 +305,13 @@ namespace ryujin
             graphicsList.set_viewports(span(vp));
             graphicsList.set_scissors(span(sc));
 
-            const sz opaqueIndirectOffset = _maxDrawCalls * frameInFlight;
-            const sz opaqueCountOffset = _maxDrawCalls * frameInFlight;
-            const sz translucentIndirectOffset = opaqueIndirectOffset + _numBufferGroupsToDraw.meshGroupCount;
-            const sz translucentCountOffset = opaqueCountOffset + _numBufferGroupsToDraw.drawCallCount;
+            const sz indirectOffset = (frameInFlight * _maxCameras + activeCameraIdx) * _maxDrawCalls;
+            const sz countOffset = frameInFlight * _maxDrawCalls;
 
             graphicsList.bind_graphics_descriptor_sets(_sceneLayout, span(descriptors), 0, span(dynamicOffsets));
             graphicsList.begin_render_pass(beginInfo);
-            _opaque->render(graphicsList, _indirectCommands, _indirectCount, opaqueIndirectOffset, opaqueCountOffset, _numBufferGroupsToDraw.meshGroupCount);
-            // _naiveTranslucent->render(graphicsList, _translucentIndirectCommands, _translucentIndirectCount, _maxDrawCalls* frameInFlight, translucentCountOffset, _numTranslucentBufferGroupsToDraw.meshGroupCount);
+            _opaque->render(graphicsList, _indirectCommands, _indirectCount, indirectOffset, countOffset, _numBufferGroupsToDraw.meshGroupCount);
+            // _naiveTranslucent->render(graphicsList, _translucentIndirectCommands, _translucentIndirectCount, indirectOffset, countOffset, _numTranslucentBufferGroupsToDraw.meshGroupCount);
             graphicsList.end_render_pass();
         }
 
@@ -270,8 +349,9 @@ namespace ryujin
         initialize_textures();
 
         _blit = make_unique<blit_pass>(*get_render_manager());
-        _opaque = make_unique<opaque_pbr_pass>(*get_render_manager(), _sceneLayout, _scenePass, _targetWidth, _targetHeight);
-        _naiveTranslucent = make_unique<naive_translucent_pbr_pass>(*get_render_manager(), _sceneLayout, _scenePass, _targetWidth, _targetHeight);
+        _opaque = make_unique<opaque_pbr_pass>(*get_render_manager(), _sceneLayout, _scenePass, _targetWidth, _targetHeight, _instanceFormat);
+        _naiveTranslucent = make_unique<naive_translucent_pbr_pass>(*get_render_manager(), _sceneLayout, _scenePass, _targetWidth, _targetHeight, _instanceFormat);
+        _occlusion = make_unique<occlusion_buffer>(_occlusionWidth, _occlusionHeight, get_render_manager()->scheduler());
     }
 
     void pbr_render_pipeline::init_scene_pass()
@@ -379,11 +459,11 @@ namespace ryujin
             .stages = shader_stage::FRAGMENT
         };
 
-        descriptor_set_layout_binding instanceData = {
+        descriptor_set_layout_binding staticInstanceData = {
             .binding = 0,
             .type = descriptor_type::DYNAMIC_STORAGE_BUFFER,
             .count = 1,
-            .stages = shader_stage::VERTEX | shader_stage::FRAGMENT
+            .stages = shader_stage::VERTEX
         };
 
         descriptor_set_layout_binding materialData = {
@@ -400,8 +480,22 @@ namespace ryujin
             .stages = shader_stage::FRAGMENT
         };
 
+        descriptor_set_layout_binding dynamicInstanceData = {
+            .binding = 3,
+            .type = descriptor_type::DYNAMIC_STORAGE_BUFFER,
+            .count = 1,
+            .stages = shader_stage::VERTEX
+        };
+
+        descriptor_set_layout_binding visibleInstances = {
+            .binding = 4,
+            .type = descriptor_type::DYNAMIC_STORAGE_BUFFER,
+            .count = 1,
+            .stages = shader_stage::VERTEX
+        };
+
         const descriptor_set_layout_binding sceneBindings[] = { sceneCamera, sceneData };
-        const descriptor_set_layout_binding drawableBindings[] = { instanceData, materialData, textures };
+        const descriptor_set_layout_binding drawableBindings[] = { staticInstanceData, materialData, textures, dynamicInstanceData, visibleInstances };
 
         const descriptor_set_layout_create_info sceneSetLayoutCi = {
             .bindings = span(sceneBindings)
@@ -442,16 +536,33 @@ namespace ryujin
     void pbr_render_pipeline::initialize_buffers()
     {
         const auto frames = get_render_manager()->get_frames_in_flight();
-        const auto instanceBytes = sizeof(gpu_instance_data) * _maxInstances * frames;
+        const auto staticInstanceBytes = _instanceStride * _maxInstances * frames;
+        const auto dynamicInstanceBytes = _instanceStride * _maxInstances * frames;
+        const auto visibleInstanceBytes = sizeof(u32) * _maxInstances * frames;
         const auto materialBytes = sizeof(gpu_material_data) * _maxMaterials * frames;
-        const auto indirectBytes = sizeof(gpu_indirect_call) * _maxDrawCalls * frames;
+        const auto indirectBytes = sizeof(gpu_indirect_call) * _maxDrawCalls * _maxCameras * frames;
         const auto drawCallBytes = sizeof(u32) * _maxDrawCalls * frames;
         const auto cameraDataBytes = sizeof(scene_camera) * frames * _maxCameras;
         const auto sceneDataBytes = sizeof(gpu_scene_data) * frames;
         const auto textureCount = _maxTextures * frames;
 
-        const buffer_create_info instanceBufferCi = {
-            .size = instanceBytes,
+        const buffer_create_info staticInstanceBufferCi = {
+            .size = staticInstanceBytes,
+            .usage = buffer_usage::STORAGE | buffer_usage::TRANSFER_DST
+        };
+
+        const buffer_create_info staticStagingBufferCi = {
+            .size = staticInstanceBytes,
+            .usage = buffer_usage::TRANSFER_SRC
+        };
+
+        const buffer_create_info dynamicInstanceBufferCi = {
+            .size = dynamicInstanceBytes,
+            .usage = buffer_usage::STORAGE
+        };
+
+        const buffer_create_info visibleInstanceBufferCi = {
+            .size = visibleInstanceBytes,
             .usage = buffer_usage::STORAGE
         };
 
@@ -498,7 +609,19 @@ namespace ryujin
             .persistentlyMapped = true
         };
 
-        auto instanceBufferResult = get_render_manager()->create(instanceBufferCi, allocCi);
+        const allocation_create_info deviceAllocCi = {
+            .required = memory_property::DEVICE_LOCAL,
+            .preferred = memory_property::NONE,
+            .usage = memory_usage::PREFER_DEVICE,
+            .hostSequentialWriteAccess = false,
+            .hostRandomAccess = false,
+            .persistentlyMapped = false
+        };
+
+        auto staticInstanceBufferResult = get_render_manager()->create(staticInstanceBufferCi, deviceAllocCi);
+        auto staticStagingBufferResult = get_render_manager()->create(staticStagingBufferCi, seqAllocCi);
+        auto dynamicInstanceBufferResult = get_render_manager()->create(dynamicInstanceBufferCi, allocCi);
+        auto visibleInstanceBufferResult = get_render_manager()->create(visibleInstanceBufferCi, seqAllocCi);
         auto materialBufferResult = get_render_manager()->create(materialBufferCi, allocCi);
         auto opaqueIndirectBufferResult = get_render_manager()->create(indirectBufferCi, seqAllocCi);
         auto translucentIndirectBufferResult = get_render_manager()->create(indirectBufferCi, seqAllocCi);
@@ -507,17 +630,19 @@ namespace ryujin
         auto cameraBufferResult = get_render_manager()->create(cameraBufferCi, allocCi);
         auto sceneBufferResult = get_render_manager()->create(sceneBufferCi, allocCi);
 
-        const auto buffersBuilt = instanceBufferResult && materialBufferResult && opaqueIndirectBufferResult && translucentIndirectBufferResult && 
+        const auto buffersBuilt = staticInstanceBufferResult && staticStagingBufferResult && dynamicInstanceBufferResult && visibleInstanceBufferResult && materialBufferResult && opaqueIndirectBufferResult && translucentIndirectBufferResult && 
                                   opaqueCountBufferResult && translucentCountBufferResult && cameraBufferResult && sceneBufferResult;
         assert(buffersBuilt);
 
         _indirectCommands = *opaqueIndirectBufferResult;
         _indirectCount = *opaqueCountBufferResult;
         _translucentIndirectCommands = *translucentIndirectBufferResult;
-        _indirectCount = *translucentCountBufferResult;
         _translucentIndirectCount = *translucentCountBufferResult;
         _materials = *materialBufferResult;
-        _instanceData = *instanceBufferResult;
+        _staticInstances = *staticInstanceBufferResult;
+        _staticStaging = *staticStagingBufferResult;
+        _dynamicInstances = *dynamicInstanceBufferResult;
+        _visibleInstances = *visibleInstanceBufferResult;
         _cameraData = *cameraBufferResult;
         _sceneData = *sceneBufferResult;
         _textures.resize(textureCount);
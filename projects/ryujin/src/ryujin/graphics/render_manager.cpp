@@ -9,6 +9,7 @@
 #undef APIENTRY
 #include <spdlog/spdlog.h>
 
+#include <cstddef>
 #include <utility>
 
 #undef NO_ERROR
@@ -97,11 +98,11 @@ namespace ryujin
         }
     }
 
-    result<unique_ptr<render_manager>, render_manager::error_code> render_manager::create(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry& reg)
+    result<unique_ptr<render_manager>, render_manager::error_code> render_manager::create(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry& reg, system_scheduler* scheduler)
     {
         using result_type = result<unique_ptr<render_manager>, error_code>;
 
-        unique_ptr<render_manager> manager(new render_manager(win, instance, device, allocator, nameObjects, &reg));
+        unique_ptr<render_manager> manager(new render_manager(win, instance, device, allocator, nameObjects, &reg, scheduler));
 
         const auto surfaceResult = manager->create_surface();
         if (surfaceResult != error_code::NO_ERROR)
@@ -148,6 +149,9 @@ namespace ryujin
             return error_code::NO_ERROR;
         }
 
+        // the frame's previous submission must complete before the pipeline rewrites the frame's host visible ranges
+        _funcs.waitForFences(1, &(get_current_frame_resources().renderFence), VK_TRUE, UINT64_MAX);
+
         _renderer->pre_render();
         return error_code::NO_ERROR;
     }
@@ -632,6 +636,29 @@ namespace ryujin
         auto stages = _inlineScratchBuffer.typed_allocate<VkPipelineShaderStageCreateInfo>(info.stages.length());
         for (size_t i = 0; i < info.stages.length(); ++i)
         {
+            const auto& specializations = info.stages[i].specializations;
+            VkSpecializationInfo* specializationInfo = nullptr;
+            if (specializations.length() > 0)
+            {
+                auto entries = _inlineScratchBuffer.typed_allocate<VkSpecializationMapEntry>(specializations.length());
+                for (size_t j = 0; j < specializations.length(); ++j)
+                {
+                    entries[j] = {
+                        specializations[j].constantId,
+                        as<u32>(j * sizeof(shader_specialization) + offsetof(shader_specialization, value)),
+                        sizeof(u32)
+                    };
+                }
+
+                specializationInfo = _inlineScratchBuffer.typed_allocate<VkSpecializationInfo>(1);
+                *specializationInfo = {
+                    as<u32>(specializations.length()),
+                    entries,
+                    specializations.length() * sizeof(shader_specialization),
+                    specializations.data()
+                };
+            }
+
             stages[i] = {
                 VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
                 nullptr,
@@ -639,7 +666,7 @@ namespace ryujin
                 as<VkShaderStageFlagBits>(to_vulkan(info.stages[i].stage)),
                 info.stages[i].mod,
                 "main",
-                nullptr
+                specializationInfo
             };
         }
 
@@ -1479,6 +1506,11 @@ namespace ryujin
         return _renderables;
     }
 
+    system_scheduler* render_manager::scheduler() const noexcept
+    {
+        return _scheduler;
+    }
+
     void render_manager::wait(const fence& f)
     {
         _funcs.waitForFences(1, &f, VK_TRUE, UINT64_MAX);
@@ -1489,9 +1521,9 @@ namespace ryujin
         return _renderer;
     }
 
-    render_manager::render_manager(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry* reg)
+    render_manager::render_manager(const unique_ptr<window>& win, vkb::Instance instance, vkb::Device device, VmaAllocator allocator, const bool nameObjects, registry* reg, system_scheduler* scheduler)
         : _win(win), _instance(instance), _device(device), _allocator(allocator), _funcs(device.make_table()), _nameObjects(nameObjects), _descriptorLayoutCache(*this),
-            _renderables(this, reg)
+            _renderables(this, reg), _scheduler(scheduler)
     {
         auto setMinimized = [this]() { spdlog::info("Render manager notifying minimized."); _isMinimized = true; };
         auto setVisible = [this]() { spdlog::info("Render manager notifying not minimized."); _isMinimized = false; };
@@ -1998,6 +2030,31 @@ namespace ryujin
         _funcs->cmdPushConstants(_buffer, layout, to_vulkan(stages), offset, size, data);
     }
 
+    void command_list::copy(const buffer& src, const buffer& dst, const span<buffer_copy_regions>& regions)
+    {
+        static constexpr sz max = 16;
+        VkBufferCopy copies[max] = {};
+
+        sz copied = 0;
+
+        for (sz i = 0; i < regions.length(); i += max)
+        {
+            sz count = std::min(regions.length() - copied, max);
+
+            for (sz j = 0; j < count; ++j)
+            {
+                copies[j] = {
+                    .srcOffset = regions[copied + j].srcOffset,
+                    .dstOffset = regions[copied + j].dstOffset,
+                    .size = regions[copied + j].size
+                };
+            }
+
+            _funcs->cmdCopyBuffer(_buffer, src.buffer, dst.buffer, as<u32>(count), copies);
+            copied += count;
+        }
+    }
+
     command_list::operator bool() const noexcept
     {
         return _buffer != nullptr;
@@ -2128,31 +2185,6 @@ namespace ryujin
     {
     }
 
-    void transfer_command_list::copy(const buffer& src, const buffer& dst, const span<buffer_copy_regions>& regions)
-    {
-        static constexpr sz max = 16;
-        VkBufferCopy copies[max] = {};
-
-        sz copied = 0;
-
-        for (sz i = 0; i < regions.length(); i += max)
-        {
-            sz count = std::min(regions.length() - copied, max);
-
-            for (sz j = 0; j < count; ++j)
-            {
-                copies[j] = {
-                    .srcOffset = regions[copied + j].srcOffset,
-                    .dstOffset = regions[copied + j].dstOffset,
-                    .size = regions[copied + j].size
-                };
-            }
-
-            _funcs->cmdCopyBuffer(_buffer, src.buffer, dst.buffer, as<u32>(count), copies + copied);
-            copied += count;
-        }
-    }
-
     void transfer_command_list::copy(const buffer& src, const image& dst, const image_layout layout, const span<buffer_image_copy_regions>& regions)
     {
         static constexpr sz max = 16;
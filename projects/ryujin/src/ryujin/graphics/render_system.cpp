@@ -187,7 +187,7 @@ namespace ryujin
 	{
 		for (auto& [name, win] : ctx.get_windows())
 		{
-			auto managerResult = render_manager::create(win, _instance, _device, _allocator, _shouldNameObjects, ctx.get_registry());
+			auto managerResult = render_manager::create(win, _instance, _device, _allocator, _shouldNameObjects, ctx.get_registry(), &ctx.get_scheduler());
 
 			if (managerResult)
 			{
@@ -3,9 +3,12 @@
 #include <ryujin/core/as.hpp>
 #include <ryujin/core/primitives.hpp>
 #include <ryujin/graphics/camera_component.hpp>
+#include <ryujin/graphics/instance_encoding.hpp>
 #include <ryujin/graphics/render_manager.hpp>
 #include <ryujin/math/transformations.hpp>
 
+#include <cmath>
+
 #undef APIENTRY
 #include <spdlog/spdlog.h>
 
@@ -13,14 +16,61 @@
 
 namespace ryujin
 {
-    renderable_manager::renderable_manager(render_manager* manager, registry* reg)
-        : _registry(reg), _manager(manager), _entitiesDirty(true)
+    namespace
     {
-        _entities.resize(2);
-        _drawCallCache.resize(2);
-        _drawCountCache.resize(2);
-        _groupsWrittenCount.resize(2);
+        draw_bucket_table::bucket_key bucket_of(const slot_map_key meshKey, const renderable_mesh& mesh, const material& mat)
+        {
+            return {
+                .type = as<u32>(mat.type),
+                .group = mesh.bufferGroupId,
+                .mesh = meshKey.index
+            };
+        }
 
+        mesh_bounds bounds_of(const mesh& m)
+        {
+            vec3 minPosition = vec3(0.0f);
+            vec3 maxPosition = vec3(0.0f);
+            if (!m.vertices.empty())
+            {
+                minPosition = maxPosition = m.vertices[0].position;
+            }
+
+            for (const auto& vertex : m.vertices)
+            {
+                minPosition = vec3(std::fmin(minPosition.x, vertex.position.x), std::fmin(minPosition.y, vertex.position.y), std::fmin(minPosition.z, vertex.position.z));
+                maxPosition = vec3(std::fmax(maxPosition.x, vertex.position.x), std::fmax(maxPosition.y, vertex.position.y), std::fmax(maxPosition.z, vertex.position.z));
+            }
+
+            // the sphere shares the box center and encloses every vertex, which is tighter than enclosing the box
+            mesh_bounds bounds = {
+                .center = (minPosition + maxPosition) * 0.5f,
+                .extents = (maxPosition - minPosition) * 0.5f,
+                .radius = 0.0f
+            };
+            for (const auto& vertex : m.vertices)
+            {
+                bounds.radius = std::fmax(bounds.radius, norm(vertex.position - bounds.center));
+            }
+            return bounds;
+        }
+
+        gpu_indirect_call draw_of(const renderable_mesh& mesh)
+        {
+            return {
+                .indexCount = mesh.indexCount,
+                .instanceCount = 0,
+                .firstIndex = mesh.indexOffset,
+                .vertexOffset = as<i32>(mesh.vertexOffset),
+                .firstInstance = 0
+            };
+        }
+    }
+
+    renderable_manager::renderable_manager(render_manager* manager, registry* reg)
+        : _registry(reg), _manager(manager), _drawBuckets(2), _staticInstances(manager->get_frames_in_flight()), _dynamicInstances(manager->get_frames_in_flight()),
+        _transformChanges(*reg, observer_matcher().updated<transform_component>())
+    {
         const sampler_create_info info = {
             .min = filter::LINEAR,
             .mag = filter::LINEAR,
@@ -48,32 +98,20 @@ namespace ryujin
             spdlog::error("Failed to create default texture sampler.");
         }
 
-        const std::function renderableAddedCallback = [this](const component_add_event<renderable_component, registry::entity_type>& e) {
-            register_entity(e.entity.handle());
-        };
-
-        const std::function renderableRemovedCallback = [this](const component_remove_event<renderable_component, registry::entity_type>& e) {
-            unregister_entity(e.entity.handle());
-        };
-
-        const std::function renderableReplacedCallback = [this](const component_replace_event<renderable_component, registry::entity_type>& e) {
-            update_entity(e.entity.handle());
-        };
-
-        reg->events().subscribe(renderableAddedCallback);
-        reg->events().subscribe(renderableRemovedCallback);
-        reg->events().subscribe(renderableReplacedCallback);
-
-        const std::function cameraCreatedCallback = [this](const component_add_event<camera_component, registry::entity_type>& e) {
-            register_camera(e.entity.handle());
-        };
+        auto& events = reg->events();
+        events.subscribe<component_add_event<renderable_component, entity_type>, &renderable_manager::on_renderable_added>(this);
+        events.subscribe<component_batch_add_event<renderable_component, entity_type>, &renderable_manager::on_renderables_added>(this);
+        events.subscribe<component_remove_event<renderable_component, entity_type>, &renderable_manager::on_renderable_removed>(this);
+        events.subscribe<component_replace_event<renderable_component, entity_type>, &renderable_manager::on_renderable_replaced>(this);
 
-        const std::function cameraDestroyedCallback = [this](const component_remove_event<camera_component, registry::entity_type>& e) {
-            unregister_camera(e.entity.handle());
-        };
+        events.subscribe<component_add_event<camera_component, entity_type>, &renderable_manager::on_camera_added>(this);
+        events.subscribe<component_batch_add_event<camera_component, entity_type>, &renderable_manager::on_cameras_added>(this);
+        events.subscribe<component_remove_event<camera_component, entity_type>, &renderable_manager::on_camera_removed>(this);
+    }
 
-        reg->events().subscribe(cameraCreatedCallback);
-        reg->events().subscribe(cameraDestroyedCallback);
+    renderable_manager::~renderable_manager()
+    {
+        _registry->events().unsubscribe(this);
     }
 
     slot_map_key renderable_manager::load_texture(const string& name, const texture_asset& asset)
@@ -369,26 +407,26 @@ namespace ryujin
 
     entity_handle<registry::entity_type> renderable_manager::load_to_entities(const asset_manager& mgr, const model_asset& asset)
     {
-        auto meshGroupKey = asset.get_mesh_group();
-        auto baseTransform = asset.transform();
-
-        // Handle parent transform prop
+        const auto pf = bake_prefab(mgr, asset);
 
-        auto baseEntity = _registry->allocate();
-        baseEntity.replace(baseTransform);
-
-        const auto entityTombstone = entity_relationship_component<registry::entity_type>::tombstone;
+        vector<entity_handle<registry::entity_type>> entities(pf.node_count());
+        pf.instantiate(*_registry, 1, entities.data());
+        return entities[0];
+    }
 
-        entity_relationship_component<registry::entity_type> children = {
-            .parent = entityTombstone,
-            .firstChild = entityTombstone,
-            .nextSibling = entityTombstone
-        };
+    prefab renderable_manager::bake_prefab(const asset_manager& mgr, const model_asset& asset)
+    {
+        prefab pf;
+        bake_model(pf, mgr, asset, prefab::no_parent);
+        return pf;
+    }
 
-        baseEntity.assign(children);
+    void renderable_manager::bake_model(prefab& pf, const asset_manager& mgr, const model_asset& asset, const u32 parent)
+    {
+        const u32 model = pf.add_node(parent, asset.transform());
 
         // TODO: Coalesce to a single entity if we only have a single mesh?
-        for (const auto meshGroup = mgr.get_mesh_group(meshGroupKey); auto mesh : meshGroup->meshes)
+        for (const auto meshGroup = mgr.get_mesh_group(asset.get_mesh_group()); auto mesh : meshGroup->meshes)
         {
             auto meshKeyIt = _meshesLut.find(mesh.name);
             auto meshKey = meshKeyIt == _meshesLut.end() ? invalid_slot_map_key : meshKeyIt->second;
@@ -398,12 +436,6 @@ namespace ryujin
                 meshKey = load_mesh(mesh.name, mesh);
             }
 
-            auto entity = _registry->allocate();
-            // apply mesh-specific transformations
-            auto position = baseTransform.position;
-            auto rotation = baseTransform.rotation;
-            auto scale = baseTransform.scale;
-
             auto& material = *mesh.material;
             string materialName = fmt::v8::format("{}_{}", asset.name().c_str(), material.name.c_str()).c_str();
             auto materialKeyIt = _materialsLut.find(materialName);
@@ -414,42 +446,24 @@ namespace ryujin
                 materialKey = load_material(materialName, material);
             }
 
-            auto& tx = entity.get<transform_component>();
+            // mesh entities are placed relative to the model entity, the transform system applies the parent
+            transform_component tx;
             tx.offset = mesh.position;
             tx.deformScale = mesh.scale;
+            set_transform(tx, vec3(0.0f), quat<float>(), vec3(1.0f));
 
-            set_transform(tx, position, rotation, scale);
-            entity.assign(renderable_component{
+            const u32 node = pf.add_node(model, tx);
+            pf.set(node, renderable_component{
                     .material = materialKey,
                     .mesh = meshKey
                 });
-
-            auto& parentRelationship = baseEntity.get<entity_relationship_component<registry::entity_type>>();
-
-            entity_relationship_component<registry::entity_type> relate = {
-                .parent = baseEntity.handle(),
-                .firstChild = entityTombstone,
-                .nextSibling = parentRelationship.firstChild
-            };
-
-            parentRelationship.firstChild = entity.handle();
-            entity.assign(relate);
         }
 
         // After loading each of the meshes to a child, load child models
         for (const auto child : asset.children())
         {
-            auto parent = load_to_entities(mgr, *child);
-
-            auto& baseRelationship = baseEntity.get<entity_relationship_component<registry::entity_type>>();
-            auto& myRelationship = parent.get<entity_relationship_component<registry::entity_type>>();
-
-            myRelationship.parent = baseEntity.handle();
-            myRelationship.nextSibling = baseRelationship.firstChild;
-            baseRelationship.firstChild = parent.handle();
+            bake_model(pf, mgr, *child, model);
         }
-
-        return baseEntity;
     }
 
     slot_map_key renderable_manager::load_material(const string& name, const material_asset& asset)
@@ -487,7 +501,8 @@ namespace ryujin
             .bufferGroupId = as<u32>(_bakedBufferGroups.size()),
             .vertexOffset = as<u32>(_activeMeshGroup.positions.size()),
             .indexOffset = as<u32>(_activeMeshGroup.indices.size()),
-            .indexCount = as<u32>(m.indices.size())
+            .indexCount = as<u32>(m.indices.size()),
+            .bounds = bounds_of(m)
         };
 
         auto requestedVerts = _activeMeshGroup.positions.size() + m.vertices.size();
@@ -542,6 +557,35 @@ namespace ryujin
         return key;
     }
 
+    slot_map_key renderable_manager::load_occluder(const string& name, const mesh& m)
+    {
+        occluder_mesh occluder;
+        occluder.positions.reserve(m.vertices.size());
+        for (const auto& vertex : m.vertices)
+        {
+            occluder.positions.push_back(vertex.position);
+        }
+        occluder.indices = m.indices;
+
+        auto key = _occluders.insert(occluder);
+        _occludersLut[name] = key;
+        return key;
+    }
+
+    sz renderable_manager::write_occluders(occlusion_buffer& buffer)
+    {
+        sz written = 0;
+        _registry->entity_view<occluder_component, transform_component>().each([&](const entity_handle<entity_type>&, occluder_component& occ, transform_component& tx) {
+            auto mesh = _occluders.try_get(occ.mesh);
+            if (mesh)
+            {
+                buffer.add_occluder(span(mesh->positions.data(), mesh->positions.size()), span(mesh->indices.data(), mesh->indices.size()), tx.world);
+                ++written;
+            }
+        });
+        return written;
+    }
+
     void renderable_manager::build_meshes()
     {
         // build staging buffer
@@ -682,49 +726,75 @@ namespace ryujin
         _activeMeshGroup.clear();
     }
     
-    renderable_manager::instance_write_info renderable_manager::write_instances(buffer& buf, const sz offset)
+    void renderable_manager::update_instances()
     {
-        auto instances = reinterpret_cast<gpu_instance_data*>(buf.info.pMappedData) + offset;
-        sz opaqueInstances = 0;
-        for (const auto& [meshGroupId, meshMapping] : _entities[as<sz>(material_type::OPAQUE)])
-        {
-            for (const auto& [key, ents] : meshMapping)
+        _transformChanges.drain([this](const entity_handle<entity_type>& handle) {
+            const auto entity = handle.handle();
+            if (entity.identifier >= _instanceRefs.size() || _instanceRefs[entity.identifier] == instance_table::invalid_slot)
             {
-                for (const auto& ent : ents)
-                {
-                    entity_handle handle(ent, _registry);
-                    auto tx = handle.get<transform_component>();
-                    auto matHandle = handle.get<renderable_component>().material;
-                    auto mat = _materials.index_of(matHandle);
-                    instances[opaqueInstances].transform = tx.matrix;
-                    instances[opaqueInstances].material = as<u32>(mat);
-                    ++opaqueInstances;
-                }
+                return;
             }
-        }
 
-        sz transparentInstances = 0;
-        for (const auto& [meshGroupId, meshMapping] : _entities[as<sz>(material_type::TRANSLUCENT)])
-        {
-            for (const auto& [key, ents] : meshMapping)
+            const u32 ref = _instanceRefs[entity.identifier];
+            const auto instance = instance_of(handle);
+            if (ref & dynamic_instance_bit)
             {
-                for (const auto& ent : ents)
-                {
-                    entity_handle handle(ent, _registry);
-                    auto& tx = handle.get<transform_component>();
-                    auto matHandle = handle.get<renderable_component>().material;
-                    auto mat = _materials.index_of(matHandle);
-                    instances[opaqueInstances + transparentInstances].transform = tx.matrix;
-                    instances[opaqueInstances + transparentInstances].material = as<u32>(mat);
-                    ++transparentInstances;
-                }
+                _dynamicInstances.update(ref & ~dynamic_instance_bit, instance);
             }
+            else
+            {
+                _staticInstances.update(ref, instance);
+            }
+        });
+    }
+
+    sz renderable_manager::write_static_instances(buffer& staging, const sz offset, const u32 frame, const instance_format format, vector<buffer_copy_regions>& copies)
+    {
+        const sz stride = instance_stride(format);
+        auto staged = reinterpret_cast<std::byte*>(staging.info.pMappedData) + offset * stride;
+        const auto ranges = _staticInstances.flush(frame);
+        sz slots = 0;
+        for (sz i = 0; i < ranges.length(); ++i)
+        {
+            const auto& r = ranges[i];
+            encode_instances(format, _staticInstances.data() + r.first, r.count, staged + r.first * stride);
+            copies.push_back({
+                .srcOffset = (offset + r.first) * stride,
+                .dstOffset = (offset + r.first) * stride,
+                .size = r.count * stride
+            });
+            slots += r.count;
+        }
+        return slots;
+    }
+
+    sz renderable_manager::write_dynamic_instances(buffer& buf, const sz offset, const u32 frame, const instance_format format)
+    {
+        const sz stride = instance_stride(format);
+        auto instances = reinterpret_cast<std::byte*>(buf.info.pMappedData) + offset * stride;
+        const auto ranges = _dynamicInstances.flush(frame);
+        sz slots = 0;
+        for (sz i = 0; i < ranges.length(); ++i)
+        {
+            const auto& r = ranges[i];
+            encode_instances(format, _dynamicInstances.data() + r.first, r.count, instances + r.first * stride);
+            slots += r.count;
         }
+        return slots;
+    }
 
-        return instance_write_info{
-            .opaqueCount = opaqueInstances,
-            .translucentCount = transparentInstances
+    sz renderable_manager::write_visible_instances(const frustum& view, const material_type type, buffer& visibleBuffer, const sz visibleOffset, const u32 firstInstance,
+        const sz capacity, buffer& indirectBuffer, const sz indirectOffset, const occlusion_buffer* occlusion)
+    {
+        const u32 typeId = as<u32>(type);
+        auto visible = reinterpret_cast<u32*>(visibleBuffer.info.pMappedData) + visibleOffset;
+        auto drawCalls = reinterpret_cast<gpu_indirect_call*>(indirectBuffer.info.pMappedData) + indirectOffset;
+        const instance_source instances = {
+            .statics = _staticInstances.data(),
+            .dynamics = _dynamicInstances.data()
         };
+
+        return cull_instances(view, _drawBuckets.calls(typeId), _drawBuckets.bounds(typeId), _drawBuckets.refs(), instances, firstInstance, capacity, visible, drawCalls, occlusion);
     }
 
     sz renderable_manager::write_materials(buffer& buf, const sz offset)
@@ -754,65 +824,23 @@ namespace ryujin
         return materialId;
     }
 
-    renderable_manager::draw_call_write_info renderable_manager::write_draw_calls(buffer& indirectBuffer, buffer& drawCountBuffer, const sz offset, const material_type type)
+    renderable_manager::draw_call_write_info renderable_manager::write_draw_calls(buffer& indirectBuffer, buffer& drawCountBuffer, const sz indirectOffset, const sz countOffset, const material_type type)
     {
-        const sz typeId = as<sz>(type);
+        // draw calls are kept up to date as entities are registered, writing them out is a plain copy
+        const u32 typeId = as<u32>(type);
+        const auto calls = _drawBuckets.calls(typeId);
+        const auto counts = _drawBuckets.group_counts(typeId);
 
-        if (_entitiesDirty)
-        {
-            spdlog::debug("Renderable entities change detected. Rebuilding draw information.");
-            u32 firstInstance = 0;
-            u32 meshGroupsWritten = 0;
-            sz totalDrawCalls = 0;
-
-            for (sz i = 0; i < _drawCallCache.size(); ++i)
-            {
-                meshGroupsWritten = 0;
-                totalDrawCalls = 0;
-                _drawCallCache[i].clear();
-                _drawCountCache[i].clear();
+        auto drawCallMapping = reinterpret_cast<gpu_indirect_call*>(indirectBuffer.info.pMappedData) + indirectOffset;
+        ryujin::memcpy(drawCallMapping, calls.data(), calls.length() * sizeof(gpu_indirect_call));
 
-                for (const auto& [meshGroupId, meshMapping] : _entities[i])
-                {
-                    u32 drawCallCount = 0;
-
-                    for (const auto& [key, ents] : meshMapping)
-                    {
-                        auto mesh = _meshes.try_get(key);
-                        gpu_indirect_call call = {
-                            .indexCount = mesh->indexCount,
-                            .instanceCount = as<u32>(ents.size()),
-                            .firstIndex = mesh->indexOffset,
-                            .vertexOffset = as<i32>(mesh->vertexOffset),
-                            .firstInstance = firstInstance
-                        };
-
-                        _drawCallCache[i].push_back(call);
-
-                        firstInstance += as<u32>(ents.size());
-                        ++drawCallCount;
-                    }
-                    _drawCountCache[i].push_back(drawCallCount);
-                    totalDrawCalls += drawCallCount;
-                    ++meshGroupsWritten;
-                }
+        auto mapped = reinterpret_cast<u32*>(drawCountBuffer.info.pMappedData) + countOffset;
+        ryujin::memcpy(mapped, counts.data(), counts.length() * sizeof(u32));
 
-                _groupsWrittenCount[i] = {
-                    .meshGroupCount = meshGroupsWritten,
-                    .drawCallCount = totalDrawCalls
-                };
-            }
-
-            _entitiesDirty = false;
-        }
-
-        auto drawCallMapping = reinterpret_cast<gpu_indirect_call*>(indirectBuffer.info.pMappedData) + offset;
-        ryujin::memcpy(drawCallMapping, _drawCallCache[typeId].data(), _drawCallCache[typeId].size() * sizeof(gpu_indirect_call));
-
-        auto mapped = reinterpret_cast<u32*>(drawCountBuffer.info.pMappedData) + offset;
-        ryujin::memcpy(mapped, _drawCountCache[typeId].data(), _drawCountCache[typeId].size() * sizeof(u32));
-        
-        return _groupsWrittenCount[typeId];
+        return {
+            .meshGroupCount = counts.length(),
+            .drawCallCount = calls.length()
+        };
     }
 
     sz renderable_manager::write_textures(texture* buf, sz offset)
@@ -869,7 +897,7 @@ namespace ryujin
         auto cameraEntityView = _registry->entity_view<camera_component>();
         for (const auto& e : cameraEntityView)
         {
-            return e;
+            return ryujin::get<0>(e);
         }
         return _registry->invalid();
     }
@@ -892,40 +920,58 @@ namespace ryujin
 
     void renderable_manager::register_entity(entity_type ent)
     {
+        // an identifier is only ever drawn by its current entity, drop anything left behind by an earlier owner
+        unregister_entity(ent);
+
         entity_handle e(ent, _registry);
         auto renderable = e.try_get<renderable_component>();
         if (renderable)
         {
-            auto mesh = renderable->mesh;
-            auto group = _meshes.try_get(mesh);
+            auto mesh = _meshes.try_get(renderable->mesh);
             auto mat = _materials.try_get(renderable->material);
-            _entities[as<sz>(mat->type)][group->bufferGroupId][mesh].push_back(ent);
-
-            _entitiesDirty = true;
+            allocate_instance(ent, *renderable);
+            _drawBuckets.add(ent.identifier, _instanceRefs[ent.identifier], bucket_of(renderable->mesh, *mesh, *mat), draw_of(*mesh), mesh->bounds);
         }
     }
 
-    void renderable_manager::unregister_entity(entity_type ent)
+    void renderable_manager::register_entities(const span<entity_type> ents)
     {
-        entity_handle e(ent, _registry);
-        auto renderable = e.try_get<renderable_component>();
-        if (renderable)
+        // batches are usually runs of the same mesh and material, so reuse the bucket key until either changes
+        draw_bucket_table::bucket_key key = {};
+        const renderable_mesh* lastMeshData = nullptr;
+        slot_map_key lastMesh = invalid_slot_map_key;
+        slot_map_key lastMaterial = invalid_slot_map_key;
+
+        for (sz i = 0; i < ents.length(); ++i)
         {
-            auto mesh = renderable->mesh;
-            auto group = _meshes.try_get(mesh);
-            auto mat = _materials.try_get(renderable->material);
-            auto& ents = _entities[as<sz>(mat->type)][group->bufferGroupId][mesh];
-            auto it = std::find(ents.begin(), ents.end(), ent);
-            if (it != ents.end())
+            const entity_type ent = ents[i];
+            unregister_entity(ent);
+
+            entity_handle e(ent, _registry);
+            auto renderable = e.try_get<renderable_component>();
+            if (!renderable)
             {
-                ents.erase(it);
+                continue;
             }
-            else
+
+            if (!lastMeshData || renderable->mesh != lastMesh || renderable->material != lastMaterial)
             {
-                spdlog::warn("Failed to remove previous entity from mesh list. Not sure how we got here.");
+                lastMeshData = _meshes.try_get(renderable->mesh);
+                key = bucket_of(renderable->mesh, *lastMeshData, *_materials.try_get(renderable->material));
+                lastMesh = renderable->mesh;
+                lastMaterial = renderable->material;
             }
 
-            _entitiesDirty = true;
+            allocate_instance(ent, *renderable);
+            _drawBuckets.add(ent.identifier, _instanceRefs[ent.identifier], key, draw_of(*lastMeshData), lastMeshData->bounds);
+        }
+    }
+
+    void renderable_manager::unregister_entity(entity_type ent)
+    {
+        if (_drawBuckets.remove(ent.identifier))
+        {
+            release_instance(ent);
         }
     }
 
@@ -935,6 +981,45 @@ namespace ryujin
         register_entity(ent);
     }
 
+    gpu_instance_data renderable_manager::instance_of(const entity_handle<entity_type>& handle) const
+    {
+        gpu_instance_data instance = {};
+        const auto tx = handle.try_get<transform_component>();
+        instance.transform = tx ? tx->world : mat4<float>(1.0f);
+        instance.material = as<u32>(_materials.index_of(handle.get<renderable_component>().material));
+        return instance;
+    }
+
+    void renderable_manager::allocate_instance(entity_type ent, const renderable_component& renderable)
+    {
+        if (ent.identifier >= _instanceRefs.size())
+        {
+            _instanceRefs.resize(ent.identifier + 1, instance_table::invalid_slot);
+        }
+
+        const auto instance = instance_of(entity_handle(ent, _registry));
+        _instanceRefs[ent.identifier] = renderable.isStatic ? _staticInstances.allocate(instance) : (_dynamicInstances.allocate(instance) | dynamic_instance_bit);
+    }
+
+    void renderable_manager::release_instance(entity_type ent)
+    {
+        if (ent.identifier >= _instanceRefs.size() || _instanceRefs[ent.identifier] == instance_table::invalid_slot)
+        {
+            return;
+        }
+
+        const u32 ref = _instanceRefs[ent.identifier];
+        if (ref & dynamic_instance_bit)
+        {
+            _dynamicInstances.release(ref & ~dynamic_instance_bit);
+        }
+        else
+        {
+            _staticInstances.release(ref);
+        }
+        _instanceRefs[ent.identifier] = instance_table::invalid_slot;
+    }
+
     void renderable_manager::register_camera(entity_type ent)
     {
         entity_handle e(ent, _registry);
@@ -990,6 +1075,44 @@ namespace ryujin
         }
     }
 
+    void renderable_manager::on_renderable_added(const component_add_event<renderable_component, entity_type>& e)
+    {
+        register_entity(e.entity.handle());
+    }
+
+    void renderable_manager::on_renderables_added(const component_batch_add_event<renderable_component, entity_type>& e)
+    {
+        register_entities(e.entities);
+    }
+
+    void renderable_manager::on_renderable_removed(const component_remove_event<renderable_component, entity_type>& e)
+    {
+        unregister_entity(e.entity.handle());
+    }
+
+    void renderable_manager::on_renderable_replaced(const component_replace_event<renderable_component, entity_type>& e)
+    {
+        update_entity(e.entity.handle());
+    }
+
+    void renderable_manager::on_camera_added(const component_add_event<camera_component, entity_type>& e)
+    {
+        register_camera(e.entity.handle());
+    }
+
+    void renderable_manager::on_cameras_added(const component_batch_add_event<camera_component, entity_type>& e)
+    {
+        for (sz i = 0; i < e.entities.length(); ++i)
+        {
+            register_camera(e.entities[i]);
+        }
+    }
+
+    void renderable_manager::on_camera_removed(const component_remove_event<camera_component, entity_type>& e)
+    {
+        unregister_camera(e.entity.handle());
+    }
+
     void renderable_manager::mesh_group::clear()
     {
         positions.clear();
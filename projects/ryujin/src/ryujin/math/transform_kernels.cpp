@@ -0,0 +1,105 @@
+#include <ryujin/math/transform_kernels.hpp>
+
+#include <ryujin/math/transformations.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define RYUJIN_TRANSFORM_KERNELS_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace ryujin
+{
+    void compose_transforms(const span<vec3<float>> positions, const span<quat<float>> rotations, const span<vec3<float>> scales, mat4<float>* out)
+    {
+        const sz count = positions.length();
+        sz i = 0;
+
+#ifdef RYUJIN_TRANSFORM_KERNELS_SSE
+        // vec3, quat and mat4 are all 16 byte aligned, so every element loads as a single register
+        const float* pos = positions.data()->data;
+        const float* rot = rotations.data()->data;
+        const float* scl = scales.data()->data;
+        float* dst = out->data;
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+
+        for (; i + 4 <= count; i += 4)
+        {
+            // transpose four quaternions so each register holds one component of all four
+            __m128 x = _mm_load_ps(rot + (i + 0) * 4);
+            __m128 y = _mm_load_ps(rot + (i + 1) * 4);
+            __m128 z = _mm_load_ps(rot + (i + 2) * 4);
+            __m128 w = _mm_load_ps(rot + (i + 3) * 4);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            __m128 scaleX = _mm_load_ps(scl + (i + 0) * 4);
+            __m128 scaleY = _mm_load_ps(scl + (i + 1) * 4);
+            __m128 scaleZ = _mm_load_ps(scl + (i + 2) * 4);
+            __m128 scaleW = _mm_load_ps(scl + (i + 3) * 4);
+            _MM_TRANSPOSE4_PS(scaleX, scaleY, scaleZ, scaleW);
+
+            // s = 2 / |q|^2, zero for degenerate quaternions, matching as_mat4
+            const __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+            const __m128 s = _mm_and_ps(_mm_div_ps(two, n), _mm_cmpgt_ps(n, zero));
+
+            const __m128 xs = _mm_mul_ps(s, x);
+            const __m128 ys = _mm_mul_ps(s, y);
+            const __m128 zs = _mm_mul_ps(s, z);
+            const __m128 xx = _mm_mul_ps(xs, x);
+            const __m128 xy = _mm_mul_ps(xs, y);
+            const __m128 xz = _mm_mul_ps(xs, z);
+            const __m128 xw = _mm_mul_ps(xs, w);
+            const __m128 yy = _mm_mul_ps(ys, y);
+            const __m128 yz = _mm_mul_ps(ys, z);
+            const __m128 yw = _mm_mul_ps(ys, w);
+            const __m128 zz = _mm_mul_ps(zs, z);
+            const __m128 zw = _mm_mul_ps(zs, w);
+
+            // rows of the scaled rotation columns, one lane per transform
+            __m128 c0x = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, yy), zz), scaleX);
+            __m128 c0y = _mm_mul_ps(_mm_add_ps(xy, zw), scaleX);
+            __m128 c0z = _mm_mul_ps(_mm_sub_ps(xz, yw), scaleX);
+            __m128 c0w = zero;
+
+            __m128 c1x = _mm_mul_ps(_mm_sub_ps(xy, zw), scaleY);
+            __m128 c1y = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), zz), scaleY);
+            __m128 c1z = _mm_mul_ps(_mm_add_ps(yz, xw), scaleY);
+            __m128 c1w = zero;
+
+            __m128 c2x = _mm_mul_ps(_mm_add_ps(xz, yw), scaleZ);
+            __m128 c2y = _mm_mul_ps(_mm_sub_ps(yz, xw), scaleZ);
+            __m128 c2z = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(one, xx), yy), scaleZ);
+            __m128 c2w = zero;
+
+            _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+            _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+            _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+
+            const __m128 column0[4] = { c0x, c0y, c0z, c0w };
+            const __m128 column1[4] = { c1x, c1y, c1z, c1w };
+            const __m128 column2[4] = { c2x, c2y, c2z, c2w };
+
+            for (sz j = 0; j < 4; ++j)
+            {
+                float* m = dst + (i + j) * 16;
+
+                // translation column with w forced to one, vec3 padding is undefined
+                const __m128 p = _mm_load_ps(pos + (i + j) * 4);
+                const __m128 pw = _mm_shuffle_ps(p, _mm_unpackhi_ps(p, one), _MM_SHUFFLE(3, 0, 1, 0));
+
+                _mm_store_ps(m + 0, column0[j]);
+                _mm_store_ps(m + 4, column1[j]);
+                _mm_store_ps(m + 8, column2[j]);
+                _mm_store_ps(m + 12, pw);
+            }
+        }
+#endif
+
+        for (; i < count; ++i)
+        {
+            out[i] = transform(positions[i], rotations[i], scales[i]);
+        }
+    }
+}
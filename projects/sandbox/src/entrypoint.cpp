@@ -49,22 +49,21 @@ public:
 
         auto& renderables = manager->renderables();
 
-        cubeEnt = renderables.load_to_entities(ctx.get_assets(), *cube); // actually get first child
-        auto& hierarchy = cubeEnt.get<entity_relationship_component<registry::entity_type>>();
-        cubeEnt = entity_handle(hierarchy.firstChild, &ctx.get_registry());
+        // bake the model once, every cube is a copy of the same component blocks
+        const auto cubePrefab = renderables.bake_prefab(ctx.get_assets(), *cube);
+        const size_t cubeCount = 4096;
+        const size_t nodeCount = cubePrefab.node_count();
 
-        auto& cubeTx = cubeEnt.get<transform_component>();
-        set_position(cubeTx, vec3(0.0f, 0.0f, 0.0f));
+        vector<entity_handle<registry::entity_type>> cubes(cubeCount * nodeCount);
+        cubePrefab.instantiate(ctx.get_registry(), cubeCount, cubes.data());
 
-        for (size_t i = 1; i < 4096; ++i)
+        for (size_t i = 0; i < cubeCount; ++i)
         {
-            auto e = renderables.load_to_entities(ctx.get_assets(), *cube); // actually get first child
-            auto& hierarchy = e.get<entity_relationship_component<registry::entity_type>>();
-            e = entity_handle(hierarchy.firstChild, &ctx.get_registry());
-
-            auto& eTx = e.get<transform_component>();
+            auto e = cubes[i * nodeCount + 1]; // first mesh of the model
+            auto& eTx = e.get_mut<transform_component>();
             set_position(eTx, vec3(i * 4.0f, 0.0f, 0.0f));
         }
+        cubeEnt = cubes[1];
 
         _camera = free_look_camera(vec3(0.0f, 1.0f, -10.0f), ctx.get_registry());
 
@@ -85,7 +84,7 @@ public:
 
     void on_frame(engine_context& ctx) override
     {
-        auto& cubeTx = cubeEnt.get<transform_component>();
+        auto& cubeTx = cubeEnt.get_mut<transform_component>();
         cubeRotation.x = std::fmod(cubeRotation.x + as<float>(2.0 * ctx.deltaTime()), 360.0f);
         set_rotation(cubeTx, as_radians(cubeRotation));
 
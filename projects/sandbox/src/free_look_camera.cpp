@@ -10,7 +10,7 @@ free_look_camera::free_look_camera(const vec3<float> position, registry& reg)
 	_entity = reg.allocate();
 	_entity.assign(camera_component{0.01f, 1000.0f, 70.0f, invalid_slot_map_key, 0, true});
 
-	set_position(_entity.get<transform_component>(), position);
+	set_position(_entity.get_mut<transform_component>(), position);
 }
 
 void free_look_camera::on_update(const f64 delta)
@@ -19,7 +19,7 @@ void free_look_camera::on_update(const f64 delta)
 	if (!in)
 		return;
 
-	transform_component& transform = _entity.get<transform_component>();
+	transform_component& transform = _entity.get_mut<transform_component>();
 
 	// Movement
 	if(in->get_keys().get_state(keyboard::key::W) != keyboard::state::RELEASED)